@@ -13,6 +13,8 @@
 #include "HfstFlagDiacritics.h"
 #include "implementations/optimized-lookup/pmatch.h"
 
+#include <iterator>
+
 #ifndef MAIN_TEST
 
 namespace hfst
@@ -54,6 +56,52 @@ static StringSet remove_flags(const StringSet & alpha)
   return retval;
 }
 
+/* Compute t2_symbols - t1_symbols into t1_missing and t1_symbols -
+   t2_symbols into t2_missing. Unknown and identity are never missing. */
+static void compute_symbol_differences
+(const StringSet &t1_symbols,const StringSet &t2_symbols,
+ StringSet &t1_missing,StringSet &t2_missing)
+{
+  if (debug_harmonize)
+    { debug_harmonize_print("Computing t1 symbols - t2 symbols."); }
+
+  std::set_difference(t1_symbols.begin(),t1_symbols.end(),
+                      t2_symbols.begin(),t2_symbols.end(),
+                      std::inserter(t2_missing,t2_missing.end()));
+  t2_missing.erase(HarmonizeUnknownAndIdentitySymbols::identity);
+  t2_missing.erase(HarmonizeUnknownAndIdentitySymbols::unknown);
+
+  if (debug_harmonize)
+    {
+      debug_harmonize_print("Symbols:");
+      debug_harmonize_print(t2_missing);
+    }
+
+  if (debug_harmonize)
+    { debug_harmonize_print("Computing t2 symbols - t1 symbols."); }
+
+  std::set_difference(t2_symbols.begin(),t2_symbols.end(),
+                      t1_symbols.begin(),t1_symbols.end(),
+                      std::inserter(t1_missing,t1_missing.end()));
+  t1_missing.erase(HarmonizeUnknownAndIdentitySymbols::identity);
+  t1_missing.erase(HarmonizeUnknownAndIdentitySymbols::unknown);
+
+  if (debug_harmonize)
+    {
+      debug_harmonize_print("Symbols:");
+      debug_harmonize_print(t1_missing);
+    }
+}
+
+void HarmonizeUnknownAndIdentitySymbols::collect_missing_symbols
+(const StringSet &t1_alphabet,const StringSet &t2_alphabet,
+ StringSet &t1_missing,StringSet &t2_missing)
+{
+  compute_symbol_differences(remove_flags(t1_alphabet),
+                             remove_flags(t2_alphabet),
+                             t1_missing,t2_missing);
+}
+
 HarmonizeUnknownAndIdentitySymbols::HarmonizeUnknownAndIdentitySymbols
 (HfstBasicTransducer &t1,HfstBasicTransducer &t2) :
   t1(t1),
@@ -72,48 +120,12 @@ HarmonizeUnknownAndIdentitySymbols::HarmonizeUnknownAndIdentitySymbols
       assert(is_subset(t2_symbols_in_transitions,t2_symbol_set));
     }
 
-  // --- typedef StringVector (not in HfstSymbolDefs.h, maybe it should be?)
-  std::vector<std::string> diff_vector
-    (max_(t1_symbol_set.size(),t2_symbol_set.size()),"");
-  
-  if (debug_harmonize)
-    { debug_harmonize_print("Computing t1 symbols - t2 symbols."); }
-
-  // --- documentation would be useful
-  std::vector<std::string>::iterator diff_end =
-    std::set_difference(t1_symbol_set.begin(),t1_symbol_set.end(),
-            t2_symbol_set.begin(),t2_symbol_set.end(),
-            diff_vector.begin());
-
-  StringSet t1_symbols_minus_t2_symbols(diff_vector.begin(),diff_end);
-
-  t1_symbols_minus_t2_symbols.erase(identity);
-  t1_symbols_minus_t2_symbols.erase(unknown);
-
-  if (debug_harmonize)
-    {
-      debug_harmonize_print("Symbols:");
-      debug_harmonize_print(t1_symbols_minus_t2_symbols);
-    }
+  StringSet t1_symbols_minus_t2_symbols;
+  StringSet t2_symbols_minus_t1_symbols;
+  compute_symbol_differences(t1_symbol_set,t2_symbol_set,
+                             t2_symbols_minus_t1_symbols,
+                             t1_symbols_minus_t2_symbols);
 
-  if (debug_harmonize)
-    { debug_harmonize_print("Computing t2 symbols - t1 symbols."); }
-
-  diff_end = std::set_difference(t2_symbol_set.begin(),t2_symbol_set.end(),
-                 t1_symbol_set.begin(),t1_symbol_set.end(),
-                 diff_vector.begin());
-
-  StringSet t2_symbols_minus_t1_symbols(diff_vector.begin(),diff_end);
-
-  t1_symbols_minus_t2_symbols.erase(unknown);
-  t1_symbols_minus_t2_symbols.erase(identity);
-
-  if (debug_harmonize)
-    {
-      debug_harmonize_print("Symbols:");
-      debug_harmonize_print(t2_symbols_minus_t1_symbols);
-    }
-  
   if (debug_harmonize)
     { debug_harmonize_print("Harmonizing identity symbols."); }
 
@@ -54,6 +54,15 @@ class HarmonizeUnknownAndIdentitySymbols
   // symbols of its arguments.
   HFSTDLL HarmonizeUnknownAndIdentitySymbols
     (HfstBasicTransducer &,HfstBasicTransducer &);
+
+  // Given the alphabets of two transducers, collect the symbols known to
+  // the second but not to the first into the first set and vice versa.
+  // Flag diacritics, special symbols and unknown and identity are left
+  // out. These are the symbols that the unknown and identity transitions
+  // of each transducer are expanded with in harmonization.
+  HFSTDLL static void collect_missing_symbols
+    (const StringSet &t1_alphabet, const StringSet &t2_alphabet,
+     StringSet &t1_missing, StringSet &t2_missing);
  protected:
 
   HfstBasicTransducer &t1;
@@ -120,7 +120,8 @@ namespace hfst
         {
       fsm * foma_temp =
             foma_funct(implementation.foma);
-      this->foma_interface.delete_foma(implementation.foma);
+      if (! release_shared_implementation())
+        this->foma_interface.delete_foma(implementation.foma);
           implementation.foma = foma_temp;
           break;
         }
@@ -213,7 +214,8 @@ NETptr (*xfsm_funct)(NETptr, unsigned int n),
         {
       fsm * foma_temp =
             foma_funct(implementation.foma,n);
-      this->foma_interface.delete_foma(implementation.foma);
+      if (! release_shared_implementation())
+        this->foma_interface.delete_foma(implementation.foma);
           implementation.foma = foma_temp;
           break;
     }
@@ -309,7 +311,8 @@ NETptr (*xfsm_funct)(NETptr, unsigned int n),
         {
       fsm * foma_temp =
             foma_funct(implementation.foma,s1,s2);
-      this->foma_interface.delete_foma(implementation.foma);
+      if (! release_shared_implementation())
+        this->foma_interface.delete_foma(implementation.foma);
           implementation.foma = foma_temp;
       break;
         }
@@ -431,7 +434,8 @@ NETptr (*xfsm_funct)(NETptr, unsigned int n),
         {
           fsm * foma_temp =
             foma_funct(implementation.foma,another_->implementation.foma);
-          this->foma_interface.delete_foma(implementation.foma);
+          if (! release_shared_implementation())
+            this->foma_interface.delete_foma(implementation.foma);
           implementation.foma = foma_temp;
           break;
         }
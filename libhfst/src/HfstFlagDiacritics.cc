@@ -152,6 +152,7 @@ std::string::size_type FdOperation::find_diacritic
 
 #include <iostream>
 #include <cassert>
+#include <cstdio>
 
 using namespace hfst;
 
@@ -166,6 +167,65 @@ int main(int argc, char * argv[])
     assert(FdOperation::has_value("@D.NeedNoun.ON@"));
     assert(not FdOperation::has_value("@C.NeedNoun@"));
 
+    FdTable<int> table;
+    table.define_diacritic(1, "@P.CASE.NOM@");
+    table.define_diacritic(2, "@N.CASE.NOM@");
+    table.define_diacritic(3, "@R.CASE.NOM@");
+    table.define_diacritic(4, "@U.CASE.GEN@");
+    table.define_diacritic(7, "@C.CASE@");
+    table.define_diacritic(9, "@D.NUM@");
+    assert(table.is_diacritic(7) && !table.is_diacritic(5));
+    assert(!table.is_diacritic(-1) && !table.is_diacritic(100));
+    assert(table.get_operation("@R.CASE.NOM@") == table.get_operation(3));
+    assert(table.get_symbols_with_feature("CASE").size() == 5);
+
+    // logged operations roll back to where they started, also negative
+    // values
+    FdState<int> state(table);
+    state.apply_operation(1);
+    size_t position = state.log_position();
+    bool ok = state.apply_operation_logged(2);
+    assert(ok);
+    assert(state.get_value(0) < 0);
+    ok = state.apply_operation_logged(7);
+    assert(ok);
+    ok = state.apply_operation_logged(3);
+    assert(!ok);
+    state.rollback(position);
+    ok = state.apply_operation(3);
+    assert(ok);
+    std::vector<FdValue> values = state.get_values();
+    FdState<int> other(table);
+    other.assign_values(values);
+    assert(other.get_packed_values() == state.get_packed_values());
+
+    // rolling back the log leaves the same state as restoring a copy
+    FdTable<int> features;
+    char buffer[64];
+    for (int f = 0; f < 10; ++f) {
+        sprintf(buffer, "@P.F%d.%d@", f, f % 3);
+        features.define_diacritic(3 * f, buffer);
+        sprintf(buffer, "@R.F%d.%d@", f, f % 3);
+        features.define_diacritic(3 * f + 1, buffer);
+        sprintf(buffer, "@U.F%d.%d@", f, f % 2);
+        features.define_diacritic(3 * f + 2, buffer);
+    }
+    FdState<int> copied(features);
+    FdState<int> logged(features);
+    for (int i = 0; i < 300; ++i) {
+        int symbol = (i * 7) % 30;
+        FdState<int> saved(copied);
+        size_t mark = logged.log_position();
+        bool copied_ok = copied.apply_operation(symbol);
+        bool logged_ok = logged.apply_operation_logged(symbol);
+        assert(copied_ok == logged_ok);
+        if (i % 3 != 0) {
+            copied = saved;
+            logged.rollback(mark);
+        }
+        assert(copied.get_packed_values() == logged.get_packed_values());
+    }
+
     std::cout << "ok" << std::endl;
     return 0;
 }
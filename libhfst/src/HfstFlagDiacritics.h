@@ -16,6 +16,8 @@
 #include <vector>
 #include <cassert>
 #include <utility>
+#include <algorithm>
+#include <stdint.h>
 
 #include "hfstdll.h"
 #include "HfstDataTypes.h"
@@ -74,11 +76,17 @@ private:
     // Used for generating IDs that stand in for feature and value strings
     std::map<std::string, FdFeature> feature_map;
     std::map<std::string, FdValue> value_map;
-    
-    std::map<T, FdOperation> operations;
+
+    // Indexed with symbols, -1 for symbols that aren't diacritics. The
+    // symbols of a transducer are small consecutive numbers, so this is
+    // one array lookup instead of a search for each arc.
+    std::vector<int> operation_index;
+    std::vector<FdOperation> operations;
+    std::vector<T> operation_symbols;
     std::map<std::string, T> symbol_map;
+    FdValue max_value;
 public:
-    FdTable(): feature_map(), value_map()
+    FdTable(): feature_map(), value_map(), max_value(0)
         { value_map[std::string()] = 0; } // empty value = neutral
     
     void define_diacritic(T symbol, const std::string& str)
@@ -121,14 +129,30 @@ public:
             }
 
             FdOperation operation(op, feature_map[feat], value_map[val], str);
-            operations[symbol] = operation;
+            if (operation.Value() > max_value)
+                max_value = operation.Value();
+            size_t index = static_cast<size_t>(symbol);
+            if (index >= operation_index.size())
+                operation_index.resize(index + 1, -1);
+            if (operation_index[index] == -1)
+            {
+                operation_index[index] = static_cast<int>(operations.size());
+                operations.push_back(operation);
+                operation_symbols.push_back(symbol);
+            }
+            else
+                operations[operation_index[index]] = operation;
             symbol_map[str] = symbol;
         }
     
     FdFeature num_features() const { return (hfst::FdFeature)feature_map.size(); }
 
+    /** The largest value number of any operation, so that a state knows
+        how many bits its values need. */
+    FdValue get_max_value() const { return max_value; }
+
     bool is_diacritic(T symbol) const
-        { return operations.find(symbol) != operations.end(); }
+        { return get_operation(symbol) != NULL; }
 
     std::vector<T> get_symbols_with_feature(const std::string& feature) const
         {
@@ -137,29 +161,29 @@ public:
                 return retval;
             }
             FdFeature feature_code = feature_map.at(feature);
-            for (typename std::map<T, FdOperation>::const_iterator it = operations.begin();
-                 it != operations.end(); ++it) {
-                if ((it->second).Feature() == feature_code) {
-                    retval.push_back(it->first);
+            for (size_t i = 0; i < operations.size(); ++i) {
+                if (operations[i].Feature() == feature_code) {
+                    retval.push_back(operation_symbols[i]);
                 }
             }
+            std::sort(retval.begin(), retval.end());
             return retval;
         }
       
     const FdOperation* get_operation(T symbol) const
         {
-          // for some reason this fails to compile???
-          //std::map<T,FdOperation>::const_iterator i
-          //  = operations.find(symbol);
-          //return (i==operations.end()) ? NULL : &(i->second);
-        
-          return (operations.find(symbol)==operations.end()) ? NULL :
-            &(operations.find(symbol)->second);
+            // a negative symbol wraps around to a large index
+            size_t index = static_cast<size_t>(symbol);
+            if (index >= operation_index.size() ||
+                operation_index[index] == -1)
+                return NULL;
+            return &operations[operation_index[index]];
         }
     const FdOperation* get_operation(const std::string& symbol) const
         {
-            return (symbol_map.find(symbol)==symbol_map.end()) ? NULL :
-              get_operation(symbol_map.find(symbol)->second);
+            typename std::map<std::string, T>::const_iterator it
+              = symbol_map.find(symbol);
+            return (it == symbol_map.end()) ? NULL : get_operation(it->second);
         }
     
     bool is_valid_string(const std::vector<T>& symbols) const
@@ -196,8 +220,20 @@ public:
         }
 };
 
+/** \brief The words that the values of an FdState are packed into.
+
+    States of the same table pack their values the same way, so these
+    compare equal exactly when the values do, and can be used as keys. */
+typedef std::vector<uint64_t> FdPackedValues;
+
 /** \brief Contains the values of each of the flag diacritic features from a
     table. It allows for evaluating a series of diacritic operations
+
+    The values are packed into as few bits as the largest value of the
+    table needs, so copying a state with many features is cheap. A
+    search that backtracks doesn't need to copy the state at all: it
+    applies operations with apply_operation_logged and goes back to an
+    earlier state with rollback.
 */
 template<class T>
 class FdState
@@ -205,87 +241,142 @@ class FdState
 private:
     const FdTable<T>* table;
     
-    // This is indexed with values of type FdFeature
-    typename std::vector<FdValue> values;
-    T num_features;
+    // Feature f is in bits [f*bits, (f+1)*bits) of values, stored as
+    // 2v for v >= 0 and -2v-1 for v < 0, so that 0 is all zero bits.
+    // bits is a power of two no larger than 16, so no value straddles
+    // two words.
+    FdPackedValues values;
+    unsigned int bits;
+    FdFeature num_features;
+
+    // The old values of the features that logged operations changed
+    std::vector<std::pair<FdFeature, FdValue> > undo_log;
     
     bool error_flag;
-public:
-    FdState(const FdTable<T>& t):
-    table(&t), values(table->num_features()),
-    num_features(table->num_features()), error_flag(false)
-        {}
 
-    FdState():
-    table(NULL), values(), num_features(0), error_flag(false)
-    {}
-
-    const FdTable<T>& get_table() const {return *table;}
-
-    const std::vector<FdValue> & get_values(void) const
-    { return values; }
+    static unsigned int bits_for(FdValue max_value)
+        {
+            unsigned int needed = 0;
+            for (unsigned int code = 2 * (unsigned int)max_value; code != 0;
+                 code >>= 1)
+                ++needed;
+            unsigned int b = 1;
+            while (b < needed)
+                b *= 2;
+            return b;
+        }
 
-    void assign_values(std::vector<FdValue> const & vals)
-    {
-        values = vals;
-        if (values.size() != num_features) {
-            error_flag = true;
+    void set_value(FdFeature f, FdValue v)
+        {
+            size_t bit = (size_t)f * bits;
+            uint64_t mask = (((uint64_t)1 << bits) - 1) << (bit % 64);
+            uint64_t code = v >= 0 ? 2 * (uint64_t)v : 2 * (uint64_t)(-v) - 1;
+            uint64_t & word = values[bit / 64];
+            word = (word & ~mask) | (code << (bit % 64));
         }
-    }
 
-    bool apply_operation(T symbol)
+    void set_value(FdFeature f, FdValue v, bool log)
         {
-            const FdOperation* op = table->get_operation(symbol);
-            if(op)
-                return apply_operation(*op);
-            return true; // if the symbol isn't a diacritic
+            if (log)
+                undo_log.push_back(std::make_pair(f, get_value(f)));
+            set_value(f, v);
         }
-    bool apply_operation(const FdOperation& op)
+
+    bool apply(const FdOperation& op, bool log)
         {
+            FdValue value = get_value(op.Feature());
             switch(op.Operator()) {
             case Pop: // positive set
-                values[op.Feature()] = op.Value();
+                set_value(op.Feature(), op.Value(), log);
                 return true;
           
             case Nop: // negative set (literally, in this implementation)
-                values[op.Feature()] = -1*op.Value();
+                set_value(op.Feature(), -1*op.Value(), log);
                 return true;
           
             case Rop: // require
                 if (op.Value() == 0) // empty require
-                    return (values[op.Feature()] != 0);
+                    return (value != 0);
                 else // nonempty require
-                    return (values[op.Feature()] == op.Value());
+                    return (value == op.Value());
             
             case Dop: // disallow
                 if (op.Value() == 0) // empty disallow
-                    return (values[op.Feature()] == 0);
+                    return (value == 0);
                 else // nonempty disallow
-                    return (values[op.Feature()] != op.Value());
+                    return (value != op.Value());
             
             case Cop: // clear
-                values[op.Feature()] = 0;
+                set_value(op.Feature(), 0, log);
                 return true;
           
             case Uop: // unification
-              if(values[op.Feature()] == 0 || /* if the feature is unset or */
-                 values[op.Feature()] == op.Value() || /* the feature is at
-                                                          this value already
-                                                          or */
-                 (values[op.Feature()] < 0 &&
-                  (values[op.Feature()]*(-1) != op.Value())) /* the feature is
-                                                              negatively set
-                                                              to something
-                                                              else */
+              if(value == 0 || /* if the feature is unset or */
+                 value == op.Value() || /* the feature is at this value
+                                           already or */
+                 (value < 0 &&
+                  (value*(-1) != op.Value())) /* the feature is negatively
+                                                 set to something else */
                  )
                 {
-                    values[op.Feature()] = op.Value();
+                    set_value(op.Feature(), op.Value(), log);
                     return true;
                 }
                 return false;
             }
             throw; // for the compiler's peace of mind
         }
+
+public:
+    FdState(const FdTable<T>& t):
+    table(&t), values(), bits(bits_for(t.get_max_value())),
+    num_features(t.num_features()), undo_log(), error_flag(false)
+        { values.resize(((size_t)num_features * bits + 63) / 64, 0); }
+
+    FdState():
+    table(NULL), values(), bits(1), num_features(0), undo_log(),
+    error_flag(false)
+    {}
+
+    const FdTable<T>& get_table() const {return *table;}
+
+    FdValue get_value(FdFeature f) const
+        {
+            size_t bit = (size_t)f * bits;
+            uint64_t code =
+                (values[bit / 64] >> (bit % 64)) & (((uint64_t)1 << bits) - 1);
+            return (code & 1) ? -(FdValue)((code + 1) / 2) : (FdValue)(code / 2);
+        }
+
+    std::vector<FdValue> get_values(void) const
+    {
+        std::vector<FdValue> retval(num_features);
+        for (FdFeature f = 0; f < num_features; ++f)
+            retval[f] = get_value(f);
+        return retval;
+    }
+
+    const FdPackedValues & get_packed_values(void) const
+    { return values; }
+
+    void assign_values(std::vector<FdValue> const & vals)
+    {
+        if (vals.size() != num_features) {
+            error_flag = true;
+        }
+        for (FdFeature f = 0; f < num_features && f < vals.size(); ++f)
+            set_value(f, vals[f]);
+    }
+
+    bool apply_operation(T symbol)
+        {
+            const FdOperation* op = table->get_operation(symbol);
+            if(op)
+                return apply_operation(*op);
+            return true; // if the symbol isn't a diacritic
+        }
+    bool apply_operation(const FdOperation& op)
+        { return apply(op, false); }
     bool apply_operation(const std::string& symbol)
         {
             const FdOperation* op = table->get_operation(symbol);
@@ -293,13 +384,39 @@ public:
                 return apply_operation(*op);
             return true;
         }
+
+    /** Like apply_operation, but remember what was changed so that
+        rollback can undo it. */
+    bool apply_operation_logged(const FdOperation& op)
+        { return apply(op, true); }
+    bool apply_operation_logged(T symbol)
+        {
+            const FdOperation* op = table->get_operation(symbol);
+            if(op)
+                return apply_operation_logged(*op);
+            return true;
+        }
+
+    /** A position to give to rollback. */
+    size_t log_position() const { return undo_log.size(); }
+
+    /** Undo the logged operations applied after \a position. */
+    void rollback(size_t position)
+        {
+            while (undo_log.size() > position) {
+                set_value(undo_log.back().first, undo_log.back().second);
+                undo_log.pop_back();
+            }
+        }
     
     bool fails() const {return error_flag;}
     void reset()
         {
             error_flag = false;
-            values.clear();
-            values.insert(values.begin(), table->num_features(), 0);
+            undo_log.clear();
+            bits = bits_for(table->get_max_value());
+            num_features = table->num_features();
+            values.assign(((size_t)num_features * bits + 63) / 64, 0);
         }
 };
 
@@ -10,6 +10,7 @@
 //! @FIXME: The structure of this class and its functions is disorganised.
 
 #include <string>
+#include <fstream>
 
 using std::string;
 
@@ -73,6 +74,42 @@ namespace hfst
       }
   }
 
+  void HfstInputStream::seek(long offset)
+  {
+    switch (type)
+      {
+#if HAVE_SFST || HAVE_LEAN_SFST
+      case SFST_TYPE:
+        this->implementation.sfst->seek(offset);
+        break;
+#endif
+#if HAVE_OPENFST
+      case TROPICAL_OPENFST_TYPE:
+        this->implementation.tropical_ofst->seek(offset);
+        break;
+#if HAVE_OPENFST_LOG || HAVE_LEAN_OPENFST_LOG
+      case LOG_OPENFST_TYPE:
+        this->implementation.log_ofst->seek(offset);
+        break;
+#endif
+#endif
+#if HAVE_FOMA
+      case FOMA_TYPE:
+        this->implementation.foma->seek(offset);
+        break;
+#endif
+      case HFST_OL_TYPE:
+      case HFST_OLW_TYPE:
+          this->implementation.hfst_ol->seek(offset);
+          break;
+
+      default:
+        HFST_THROW_MESSAGE(FunctionNotImplementedException,
+                           "HfstInputStream::seek");
+        break;
+      }
+  }
+
   char &HfstInputStream::stream_get(char &c)
   {
     if (input_stream != NULL)
@@ -283,7 +320,7 @@ namespace hfst
   {
     if (input_stream != 0)
       return input_stream->eof();
-    return is_eof();
+    return implementation_eof();
   }
 
   bool HfstInputStream::set_implementation_specific_header_data
@@ -941,7 +978,7 @@ namespace hfst
      the type of the first transducer in the stream. */
   HfstInputStream::HfstInputStream(void):
     bytes_to_skip(0), filename(std::string()), has_hfst_header(false),
-    hfst_version_2_weighted_transducer(false)
+    hfst_version_2_weighted_transducer(false), index_read(false)
   {
     input_stream = &std::cin;
     if (stream_eof())
@@ -1007,7 +1044,7 @@ namespace hfst
   //        HfstInputStream a const char*
   HfstInputStream::HfstInputStream(const std::string &filename):
     bytes_to_skip(0), filename(std::string(filename)), has_hfst_header(false),
-    hfst_version_2_weighted_transducer(false)
+    hfst_version_2_weighted_transducer(false), index_read(false)
   {
     if (strcmp("",filename.c_str()) != 0) {
       std::ifstream ifs(filename.c_str());
@@ -1092,7 +1129,7 @@ namespace hfst
   
   HfstInputStream::HfstInputStream(std::istream &is):
     bytes_to_skip(0), filename(std::string()), has_hfst_header(false),
-    hfst_version_2_weighted_transducer(false)
+    hfst_version_2_weighted_transducer(false), index_read(false)
   {
     input_stream = &is;
     if (stream_eof()) {
@@ -1243,6 +1280,11 @@ namespace hfst
   }
 
   bool HfstInputStream::is_eof(void)
+  {
+    return implementation_eof() || at_index();
+  }
+
+  bool HfstInputStream::implementation_eof(void)
   {
     switch (type)
       {
@@ -1331,6 +1373,8 @@ namespace hfst
 
   bool HfstInputStream::is_good(void)
   {
+    if (at_index())
+      return false;
     switch (type)
       {
 #if HAVE_SFST || HAVE_LEAN_SFST
@@ -1383,6 +1427,133 @@ namespace hfst
     return has_hfst_header;
   }
 
+  void HfstInputStream::set_mmap_tables(bool value)
+  {
+    if (type == HFST_OL_TYPE || type == HFST_OLW_TYPE)
+      { implementation.hfst_ol->set_mmap_tables(value); }
+  }
+
+  bool HfstInputStream::at_index(void)
+  {
+    // the header of the first transducer has not been skipped yet
+    if (input_stream != NULL || implementation_eof())
+      return false;
+    if (stream_peek() != HFST_INDEX_ID[0])
+      return false;
+
+    const size_t id_length = sizeof(HFST_INDEX_ID);
+    std::vector<char> chars_read;
+    while (chars_read.size() < id_length)
+      {
+        char c = stream_get();
+        chars_read.push_back(c);
+        if (c != HFST_INDEX_ID[chars_read.size() - 1] || implementation_eof())
+          break;
+      }
+    bool retval = (chars_read.size() == id_length &&
+                   chars_read.back() == '\0');
+    for (size_t i = chars_read.size(); i > 0; i--)
+      stream_unget(chars_read[i - 1]);
+    return retval;
+  }
+
+  /* Read a number written with eight bytes, least significant first. */
+  static long read_index_number(std::istream &is)
+  {
+    unsigned char bytes[8];
+    is.read((char*)bytes, 8);
+    unsigned long long n = 0;
+    for (int i=7; i>=0; i--)
+      n = (n << 8) | bytes[i];
+    return (long)n;
+  }
+
+  /* Read the index written by HfstOutputStream::write_index. */
+  void HfstInputStream::read_index(void)
+  {
+    index_read = true;
+    if (filename == "")
+      return;
+    std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+    const long id_length = (long)sizeof(HFST_INDEX_ID);
+    ifs.seekg(0, std::ios::end);
+    long file_size = (long)ifs.tellg();
+    if (! ifs.good() || file_size < 2 * id_length + 16)
+      return;
+
+    // the position of the index and the identifier end the file
+    char id[sizeof(HFST_INDEX_ID)];
+    ifs.seekg(file_size - id_length - 8);
+    long index_position = read_index_number(ifs);
+    ifs.read(id, id_length);
+    if (! ifs.good() || memcmp(id, HFST_INDEX_ID, id_length) != 0)
+      return;
+
+    ifs.seekg(index_position);
+    ifs.read(id, id_length);
+    if (index_position < 0 || index_position >= file_size ||
+        ! ifs.good() || memcmp(id, HFST_INDEX_ID, id_length) != 0)
+      {
+        HFST_THROW_MESSAGE(NotTransducerStreamException,
+                           "the index of the stream is not valid");
+      }
+    std::string index_type;
+    std::getline(ifs, index_type, '\0');
+    long entries = read_index_number(ifs);
+    for (long i=0; i<entries && ifs.good(); i++)
+      {
+        std::string transducer_name;
+        std::getline(ifs, transducer_name, '\0');
+        IndexEntry entry;
+        entry.offset = read_index_number(ifs);
+        entry.size = read_index_number(ifs);
+        if (entry.offset < 0 || entry.offset >= index_position)
+          break;
+        index_names.push_back(transducer_name);
+        index.insert(std::make_pair(transducer_name, entry));
+      }
+    if (! ifs.good() || (long)index_names.size() != entries)
+      {
+        index.clear();
+        index_names.clear();
+        HFST_THROW_MESSAGE(NotTransducerStreamException,
+                           "the index of the stream is not valid");
+      }
+  }
+
+  bool HfstInputStream::has_index(void)
+  {
+    if (! index_read)
+      read_index();
+    return ! index_names.empty();
+  }
+
+  StringVector HfstInputStream::get_index_names(void)
+  {
+    if (! index_read)
+      read_index();
+    return index_names;
+  }
+
+  bool HfstInputStream::seek_transducer(const std::string &transducer_name)
+  {
+    if (! has_index())
+      {
+        HFST_THROW_MESSAGE(StreamNotReadableException,
+                           "the stream has no index");
+      }
+    std::unordered_map<std::string, IndexEntry>::const_iterator it
+      = index.find(transducer_name);
+    if (it == index.end())
+      return false;
+    // the header is read again from the new position
+    input_stream = NULL;
+    name = "";
+    props.clear();
+    seek(it->second.offset);
+    return true;
+  }
+
 }
 
 #else // MAIN_TEST was defined
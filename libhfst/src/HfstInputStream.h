@@ -16,6 +16,8 @@
 
 #include "HfstDataTypes.h"
 
+#include <unordered_map>
+
 #include "hfstdll.h"
 
 /** @file HfstInputStream.h
@@ -175,6 +177,25 @@ For documentation on the HFST binary transducer format, see
     char stream_peek();
     /* The stream implementation ignores n bytes. */
     void ignore(unsigned int n);
+    /* The stream implementation moves to byte offset in the file. */
+    void seek(long offset);
+    /* Whether the stream implementation is at end. */
+    bool implementation_eof(void);
+
+    /* A transducer listed in the index of an indexed stream */
+    struct IndexEntry
+    {
+      long offset;
+      long size;
+    };
+    /* The index, if the stream has one, read when first needed */
+    bool index_read;
+    std::unordered_map<std::string, IndexEntry> index;
+    StringVector index_names;
+    /* Read the index from the end of the file, if there is one. */
+    void read_index(void);
+    /* Whether the next bytes in the stream start the index. */
+    bool at_index(void);
 
     /* The type of a transducer not supported directly by HFST version 3.0
        but which can occur in conversion functions. */
@@ -281,6 +302,45 @@ For documentation on the HFST binary transducer format, see
 
     HFSTDLL bool is_hfst_header_included(void) const;
 
+    /** \brief Whether to memory-map the tables of optimized-lookup
+        transducers instead of copying them into memory.
+
+        Only has an effect on streams opened from a named file that contain
+        optimized-lookup transducers. Mapped transducers start up faster
+        and share their tables between processes, but the file must not
+        be modified while they are in use. */
+    HFSTDLL void set_mmap_tables(bool value);
+
+    /** \brief Whether the stream is a file that ends in an index of its
+        transducers.
+
+        An index is written by an HfstOutputStream if requested with
+        HfstOutputStream::set_write_index. Streams reading standard input
+        are never indexed. Reading the transducers one after another works
+        the same whether the stream is indexed or not, the index being
+        skipped at the end.
+
+        @see seek_transducer */
+    HFSTDLL bool has_index(void);
+
+    /** \brief The names of the transducers listed in the index, in the
+        order they were written.
+
+        Empty if the stream has no index. */
+    HFSTDLL StringVector get_index_names(void);
+
+    /** \brief Move to the transducer named \a name so that it is the
+        next one read from the stream.
+
+        The transducer is found through the index, so the transducers
+        before it are neither read nor parsed. If several transducers have
+        the same name, the first of them is used. Returns false if the
+        index has no transducer named \a name.
+
+        @throws StreamNotReadableException if the stream has no index.
+        @see has_index */
+    HFSTDLL bool seek_transducer(const std::string &name);
+
     friend class HfstTransducer;
   };
 
@@ -19,7 +19,7 @@ using std::string;
 namespace hfst
 {
   HfstOutputStream::HfstOutputStream(ImplementationType type, bool hfst_format):
-    type(type), hfst_format(hfst_format), is_open(false)
+    type(type), hfst_format(hfst_format), is_open(false), indexed(false)
   {
     if (! HfstTransducer::is_lean_implementation_type_available(type)) {
       throw ImplementationTypeNotAvailableException("ImplementationTypeNotAvailableException", __FILE__, __LINE__, type);
@@ -82,7 +82,7 @@ namespace hfst
   //        HfstInputStream a const char*
   HfstOutputStream::HfstOutputStream
   (const std::string &filename,ImplementationType type, bool hfst_format_):
-    type(type), hfst_format(hfst_format_), is_open(false)
+    type(type), hfst_format(hfst_format_), is_open(false), indexed(false)
   {
     if (! HfstTransducer::is_lean_implementation_type_available(type)) {
       throw ImplementationTypeNotAvailableException("ImplementationTypeNotAvailableException", __FILE__, __LINE__, type);
@@ -257,6 +257,84 @@ namespace hfst
       }
   }
 
+  long HfstOutputStream::tell(void)
+  {
+    switch(type)
+      {
+#if HAVE_SFST || HAVE_LEAN_SFST
+      case SFST_TYPE:
+        return implementation.sfst->tell();
+#endif
+#if HAVE_OPENFST
+      case TROPICAL_OPENFST_TYPE:
+        return implementation.tropical_ofst->tell();
+#if HAVE_OPENFST_LOG || HAVE_LEAN_OPENFST_LOG
+      case LOG_OPENFST_TYPE:
+        return implementation.log_ofst->tell();
+#endif
+#endif
+#if HAVE_FOMA
+      case FOMA_TYPE:
+        return implementation.foma->tell();
+#endif
+      case HFST_OL_TYPE:
+      case HFST_OLW_TYPE:
+        return implementation.hfst_ol->tell();
+      default:
+        return -1;
+      }
+  }
+
+  void HfstOutputStream::write_number(unsigned long long n)
+  {
+    for (unsigned int i=0; i<8; i++)
+      {
+        write((char)(n & 0xff));
+        n = n >> 8;
+      }
+  }
+
+  /* Write the index of an indexed stream. The index follows the last
+     transducer and has the following structure:
+
+     - the identifier HFST_INDEX_ID:                  "HFST_INDEX\0"
+     - the implementation type of the transducers:    "FOMA_TYPE\0"
+     - the number of transducers using eight bytes
+     - for each transducer, its name followed by "\0", its position
+       from the beginning of the stream and its size in bytes, the
+       numbers using eight bytes each
+     - the position of the index using eight bytes
+     - the identifier HFST_INDEX_ID again
+
+     All numbers are written least significant byte first. A reader
+     finds the index by reading the last bytes of the stream. */
+  void HfstOutputStream::write_index(void)
+  {
+    long index_position = tell();
+    write(std::string(HFST_INDEX_ID));
+    write('\0');
+    write(std::string(implementation_type_to_string(type)));
+    write('\0');
+    write_number(index_entries.size());
+    for (unsigned int i=0; i<index_entries.size(); i++)
+      {
+        long next_position = (i + 1 < index_entries.size()) ?
+          index_entries[i+1].second : index_position;
+        write(index_entries[i].first);
+        write('\0');
+        write_number(index_entries[i].second);
+        write_number(next_position - index_entries[i].second);
+      }
+    write_number(index_position);
+    write(std::string(HFST_INDEX_ID));
+    write('\0');
+  }
+
+  void HfstOutputStream::set_write_index(bool value)
+  {
+    indexed = value;
+  }
+
   void HfstOutputStream::append_hfst_header_data(std::vector<char> &header)
   {
     append(header, "version");
@@ -400,6 +478,19 @@ HfstOutputStream::append_implementation_specific_header_data(std::vector<char>&,
        Note: in XFSM format, we never write the HFST header. hfst_format is always
        false if the stream is of XFSM format.
      */
+    if (indexed)
+      {
+        long position = tell();
+        if (! hfst_format || position < 0)
+          {
+            HFST_THROW_MESSAGE(StreamCannotBeWrittenException,
+                               "an index can only be written to a file "
+                               "in HFST format");
+          }
+        index_entries.push_back
+          (std::pair<std::string, long>(transducer.get_name(), position));
+      }
+
     if (hfst_format) {
 
       const int MAX_HEADER_LENGTH=65535;
@@ -495,6 +586,10 @@ HfstOutputStream::append_implementation_specific_header_data(std::vector<char>&,
   }
 
   void HfstOutputStream::close(void) {
+    if (this->is_open && indexed && ! index_entries.empty())
+      {
+        write_index();
+      }
     switch (type)
       {
 #if HAVE_SFST || HAVE_LEAN_SFST
@@ -47,6 +47,11 @@ namespace hfst
   }
 
 
+  /* The identifier that starts and ends the index of an indexed stream.
+     It cannot be mistaken for an HFST header, whose identifier "HFST"
+     is followed by a '\0'. */
+  const char HFST_INDEX_ID[] = "HFST_INDEX";
+
   /** \brief A stream for writing binary transducers.
 
       An example:
@@ -108,6 +113,17 @@ For more information on HFST transducer structure, see
     // if file is open
     bool is_open;
 
+    // whether an index is written at the end of the stream
+    bool indexed;
+    // the name and start position of each transducer written so far
+    std::vector<std::pair<std::string, long> > index_entries;
+    // the current position in the stream implementation
+    long tell(void);
+    // write a number using eight bytes, least significant first
+    void write_number(unsigned long long n);
+    // write the index of the transducers in index_entries
+    void write_index(void);
+
     // append string s to vector str and a '\0'
     static void append(std::vector<char> &str, const std::string &s);
 
@@ -164,6 +180,30 @@ For more information on HFST transducer structure, see
      @see operator<< */
     HFSTDLL HfstOutputStream& redirect (HfstTransducer &transducer);
 
+    /** \brief Whether to write an index of the transducers at the end
+        of the stream when it is closed.
+
+        The index lists the name, position and size of each transducer,
+        so that a single transducer can be read with
+        HfstInputStream::seek_transducer without reading the ones before
+        it. HfstInputStream treats the index as the end of the stream, so
+        programs that read the transducers one after another get the same
+        transducers as without it.
+
+        The index is not an HFST header, so versions of HFST that do not
+        know about it cannot read an indexed stream to its end: they
+        read the transducers but throw an exception when they come to
+        the index. Write an index only to files that will be read
+        with a version of HFST that supports it.
+
+        Must be called before any transducer is written. The stream must
+        write HFST headers and its positions must be known, i.e. it must
+        be a file and not a pipe, else a StreamCannotBeWrittenException
+        is thrown when a transducer is written.
+
+        @see HfstInputStream::has_index */
+    HFSTDLL void set_write_index(bool value);
+
     /** \brief Close the stream.
 
         If the stream points to standard output, nothing is done. */
@@ -16,6 +16,10 @@
 #include <string>
 #include <map>
 #include <cassert>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <exception>
 
 using std::string;
 using std::map;
@@ -23,6 +27,7 @@ using std::map;
 #include "HfstTransducer.h"
 #include "HfstFlagDiacritics.h"
 #include "HfstExceptionDefs.h"
+#include "HarmonizeUnknownAndIdentitySymbols.h"
 #include "implementations/compose_intersect/ComposeIntersectLexicon.h"
 
 using hfst::implementations::ConversionFunctions;
@@ -151,6 +156,30 @@ void set_encode_weights(bool value) {
   bool get_encode_weights(void) {
     return encode_weights; }
 
+  /* Counters behind get_harmonization_counts. */
+  static std::atomic<unsigned long> harmonized_unchanged(0);
+  static std::atomic<unsigned long> harmonized_recoded(0);
+  static std::atomic<unsigned long> harmonized_expanded(0);
+  static std::atomic<unsigned long> harmonized_converted(0);
+
+  HarmonizationCounts get_harmonization_counts()
+  {
+    HarmonizationCounts counts;
+    counts.unchanged = harmonized_unchanged;
+    counts.recoded = harmonized_recoded;
+    counts.expanded = harmonized_expanded;
+    counts.converted = harmonized_converted;
+    return counts;
+  }
+
+  void reset_harmonization_counts()
+  {
+    harmonized_unchanged = 0;
+    harmonized_recoded = 0;
+    harmonized_expanded = 0;
+    harmonized_converted = 0;
+  }
+
   void set_warning_stream(std::ostream * os)
   {
 #if HAVE_OPENFST
@@ -427,6 +456,52 @@ HfstTransducer * HfstTransducer::harmonize_symbol_encodings(const HfstTransducer
   return new HfstTransducer(another_basic, another.get_type());
 }
 
+bool HfstTransducer::harmonize_natively(HfstTransducer &another)
+{
+#if HAVE_OPENFST
+  using namespace implementations;
+  if (this->type != TROPICAL_OPENFST_TYPE ||
+      another.type != TROPICAL_OPENFST_TYPE)
+    { return false; }
+
+  StringSet this_alphabet = this->get_alphabet();
+  StringSet another_alphabet = another.get_alphabet();
+  StringSet missing_from_this;
+  StringSet missing_from_another;
+  HarmonizeUnknownAndIdentitySymbols::collect_missing_symbols
+    (this_alphabet, another_alphabet, missing_from_this, missing_from_another);
+
+  // Both transducers end up with the union of the alphabets, numbered
+  // as in HfstBasicTransducer, just as after a conversion there and back.
+  StringSet alphabet(this_alphabet);
+  alphabet.insert(another_alphabet.begin(), another_alphabet.end());
+
+  TropicalWeightTransducer::HarmonizationResult this_result
+    = TropicalWeightTransducer::harmonize_in_place
+    (this->implementation.tropical_ofst, alphabet, missing_from_this);
+  TropicalWeightTransducer::HarmonizationResult another_result
+    = TropicalWeightTransducer::harmonize_in_place
+    (another.implementation.tropical_ofst, alphabet, missing_from_another);
+
+  switch (std::max(this_result, another_result))
+    {
+    case TropicalWeightTransducer::HARMONIZATION_UNCHANGED:
+      harmonized_unchanged++;
+      break;
+    case TropicalWeightTransducer::HARMONIZATION_RECODED:
+      harmonized_recoded++;
+      break;
+    case TropicalWeightTransducer::HARMONIZATION_EXPANDED:
+      harmonized_expanded++;
+      break;
+    }
+  return true;
+#else
+  (void)another;
+  return false;
+#endif
+}
+
 /*
    Harmonize this transducer with a copy of another.
    another is not modifed, but a modified copy of it is returned.
@@ -446,14 +521,14 @@ HfstTransducer * HfstTransducer::harmonize_(const HfstTransducer &another)
       HFST_THROW_MESSAGE
     (HfstFatalException, "harmonize_ with anonymous transducers"); }
 
-    HfstTransducer another_copy(another);
+    HfstTransducer * another_copy = new HfstTransducer(another);
 
     // Prevent flag diacritics from being harmonized by inserting them to
     // the alphabet. FIX?: remove them at the end?
     if (this->get_type() == FOMA_TYPE)
       {
     StringSet this_alphabet    = this->get_alphabet();
-    StringSet another_alphabet = another_copy.get_alphabet();
+    StringSet another_alphabet = another_copy->get_alphabet();
     StringSet add_to_this;
     StringSet add_to_another;
 
@@ -477,7 +552,12 @@ HfstTransducer * HfstTransducer::harmonize_(const HfstTransducer &another)
         add_to_another.insert(*it);
       }
       }
-    another_copy.insert_to_alphabet(add_to_another);
+    another_copy->insert_to_alphabet(add_to_another);
+      }
+
+    if (this->harmonize_natively(*another_copy))
+      {
+        return another_copy;
       }
 
     switch(this->type)
@@ -485,13 +565,13 @@ HfstTransducer * HfstTransducer::harmonize_(const HfstTransducer &another)
 #if HAVE_FOMA
     case (FOMA_TYPE):
       // no need to harmonize as foma's functions take care of harmonizing
-      return new HfstTransducer(another_copy);
-      return NULL;
+      return another_copy;
       break;
 #endif // HAVE_FOMA
 #if HAVE_XFSM
     case (XFSM_TYPE):
       // no need to harmonize as xfsm's functions take care of harmonizing
+      delete another_copy;
       return NULL;
       break;
 #endif // HAVE_XFSM
@@ -502,10 +582,12 @@ HfstTransducer * HfstTransducer::harmonize_(const HfstTransducer &another)
     case (LOG_OPENFST_TYPE):
 #endif
       {
-    HfstBasicTransducer * another_basic = another_copy.get_basic_transducer();
+    HfstBasicTransducer * another_basic = another_copy->get_basic_transducer();
+    delete another_copy;
     HfstBasicTransducer * this_basic = this->convert_to_basic_transducer();
 
     this_basic->harmonize(*another_basic);
+    harmonized_converted++;
 
     this->convert_to_hfst_transducer(this_basic);
     HfstTransducer * another_harmonized
@@ -518,6 +600,7 @@ HfstTransducer * HfstTransducer::harmonize_(const HfstTransducer &another)
 #endif
     case (ERROR_TYPE):
     default:
+        delete another_copy;
         HFST_THROW(TransducerHasWrongTypeException);
     }
     return NULL; // make compiler happy
@@ -563,6 +646,11 @@ HfstTransducer * HfstTransducer::harmonize_(const HfstTransducer &another)
       }
       }
 
+    if (this->harmonize_natively(another))
+      {
+        return;
+      }
+
     switch(this->type)
     {
 #if HAVE_FOMA
@@ -588,6 +676,7 @@ HfstTransducer * HfstTransducer::harmonize_(const HfstTransducer &another)
       another.convert_to_basic_transducer();
 
     this_basic->harmonize(*another_basic);
+    harmonized_converted++;
 
     this->convert_to_hfst_transducer(this_basic);
     another.convert_to_hfst_transducer(another_basic);
@@ -694,6 +783,56 @@ HfstOneLevelPaths * HfstTransducer::lookup_fd(const std::string & s,
     }
 }
 
+std::vector<HfstOneLevelPaths*> HfstTransducer::lookup_fd_batch
+(const StringVector& inputs, unsigned int threads, ssize_t limit,
+ double time_cutoff, std::vector<bool> * infinite,
+ ssize_t infinite_limit) const
+{
+    switch(this->type) {
+
+    case (HFST_OL_TYPE):
+    case (HFST_OLW_TYPE):
+        return this->implementation.hfst_ol->lookup_fd_batch
+          (inputs, threads, limit, time_cutoff, infinite, infinite_limit);
+
+    case (ERROR_TYPE):
+      HFST_THROW(TransducerHasWrongTypeException);
+    default:
+      HFST_THROW(FunctionNotImplementedException);
+    }
+}
+
+void HfstTransducer::set_lookup_cache(size_t max_entries, size_t max_bytes)
+{
+    switch(this->type) {
+
+    case (HFST_OL_TYPE):
+    case (HFST_OLW_TYPE):
+        this->implementation.hfst_ol->set_lookup_cache(max_entries, max_bytes);
+        break;
+
+    case (ERROR_TYPE):
+      HFST_THROW(TransducerHasWrongTypeException);
+    default:
+      HFST_THROW(FunctionNotImplementedException);
+    }
+}
+
+const hfst_ol::LookupCache * HfstTransducer::get_lookup_cache() const
+{
+    switch(this->type) {
+
+    case (HFST_OL_TYPE):
+    case (HFST_OLW_TYPE):
+        return this->implementation.hfst_ol->get_lookup_cache();
+
+    case (ERROR_TYPE):
+      HFST_THROW(TransducerHasWrongTypeException);
+    default:
+      HFST_THROW(FunctionNotImplementedException);
+    }
+}
+
 HfstOneLevelPaths * HfstTransducer::lookup(const HfstTokenizer& tok,
                        const std::string &s,
                        ssize_t limit, double time_cutoff) const
@@ -1170,9 +1309,107 @@ HfstTransducer::HfstTransducer(HfstInputStream &in):
     in.read_transducer(*this);
 }
 
+/* Owns a backend implementation shared by copies of a transducer and
+   deletes it when the last of them is gone. */
+struct HfstTransducer::SharedImplementation
+{
+    ImplementationType type;
+    TransducerImplementation implementation;
+
+    SharedImplementation(ImplementationType type_,
+                         TransducerImplementation implementation_):
+      type(type_), implementation(implementation_) {}
+
+    ~SharedImplementation()
+    {
+        switch (type)
+        {
+#if HAVE_FOMA
+        case FOMA_TYPE:
+            foma_interface.delete_foma(implementation.foma);
+            break;
+#endif
+        default:
+            // taken over by the last transducer that shared it
+            break;
+        }
+    }
+};
+
+static std::mutex shared_implementation_mutex;
+
+bool HfstTransducer::is_shareable(ImplementationType type)
+{
+    // OpenFst transducers are already copied on write by OpenFst itself.
+    // SFST marks the nodes it visits even when it only reads a transducer
+    // and optimized-lookup transducers keep their lookup state, so sharing
+    // them would not be safe.
+    return type == FOMA_TYPE;
+}
+
+void HfstTransducer::share_implementation(const HfstTransducer &another)
+{
+    // another may be copied by several threads at a time
+    std::lock_guard<std::mutex> lock(shared_implementation_mutex);
+    if (another.shared_implementation.get() == NULL)
+      {
+        another.shared_implementation.reset
+          (new SharedImplementation(another.type, another.implementation));
+      }
+    shared_implementation = another.shared_implementation;
+    implementation = another.implementation;
+}
+
+void HfstTransducer::detach()
+{
+    if (shared_implementation.get() == NULL)
+      { return; }
+
+    if (shared_implementation.use_count() == 1)
+      {
+        // nobody else uses it any more, take it over
+        shared_implementation->type = UNSPECIFIED_TYPE;
+      }
+    else
+      {
+        switch (type)
+        {
+#if HAVE_FOMA
+        case FOMA_TYPE:
+            implementation.foma = foma_interface.copy(implementation.foma);
+            break;
+#endif
+        default:
+            HFST_THROW(TransducerHasWrongTypeException);
+        }
+      }
+    shared_implementation.reset();
+}
+
+bool HfstTransducer::release_shared_implementation()
+{
+    if (shared_implementation.get() == NULL)
+      { return false; }
+    shared_implementation.reset();
+    return true;
+}
+
 HfstTransducer::HfstTransducer(const HfstTransducer &another):
     type(another.type),anonymous(another.anonymous),
     is_trie(another.is_trie), name("")
+{
+    copy_implementation(another, false);
+}
+
+HfstTransducer::HfstTransducer(const HfstTransducer &another, bool deep):
+    type(another.type),anonymous(another.anonymous),
+    is_trie(another.is_trie), name("")
+{
+    copy_implementation(another, deep);
+}
+
+void HfstTransducer::copy_implementation(const HfstTransducer &another,
+                                         bool deep)
 {
     if (! is_implementation_type_available(type))
       throw ImplementationTypeNotAvailableException("ImplementationTypeNotAvailableException", __FILE__, __LINE__, type);
@@ -1186,6 +1423,11 @@ HfstTransducer::HfstTransducer(const HfstTransducer &another):
             this->props[prop->first] = prop->second;
           }
       }
+    if (is_shareable(type) && ! deep)
+      {
+        share_implementation(another);
+        return;
+      }
     switch (type)
     {
 #if HAVE_SFST
@@ -1195,13 +1437,17 @@ HfstTransducer::HfstTransducer(const HfstTransducer &another):
 #endif
 #if HAVE_OPENFST
     case TROPICAL_OPENFST_TYPE:
-        implementation.tropical_ofst =
-        tropical_ofst_interface.copy(another.implementation.tropical_ofst);
+        // a plain OpenFst copy shares the states of another
+        implementation.tropical_ofst = deep ?
+          tropical_ofst_interface.deep_copy
+          (another.implementation.tropical_ofst) :
+          tropical_ofst_interface.copy(another.implementation.tropical_ofst);
         break;
 #if HAVE_OPENFST_LOG
     case LOG_OPENFST_TYPE:
-        implementation.log_ofst =
-        log_ofst_interface.copy(another.implementation.log_ofst);
+        implementation.log_ofst = deep ?
+          log_ofst_interface.deep_copy(another.implementation.log_ofst) :
+          log_ofst_interface.copy(another.implementation.log_ofst);
         break;
 #endif
 #endif
@@ -1232,6 +1478,11 @@ HfstTransducer::HfstTransducer(const HfstTransducer &another):
     }
 }
 
+HfstTransducer HfstTransducer::deep_copy() const
+{
+    return HfstTransducer(*this, true);
+}
+
 HfstTransducer::HfstTransducer
 ( const hfst::implementations::HfstBasicTransducer &net,
   ImplementationType type):
@@ -1294,6 +1545,9 @@ HfstTransducer::~HfstTransducer(void)
     if (! is_lean_implementation_type_available(type))
       throw ImplementationTypeNotAvailableException("ImplementationTypeNotAvailableException", __FILE__, __LINE__, type);
 
+    if (release_shared_implementation())
+      { return; }
+
     switch (type)
     {
 #if HAVE_SFST || HAVE_LEAN_SFST
@@ -1616,6 +1870,15 @@ bool HfstTransducer::is_cyclic(void) const
 #endif
 #if HAVE_FOMA
     case FOMA_TYPE:
+        // fsm_topsort renumbers the net in place, so a net shared with
+        // other copies is checked through a copy of its own
+        if (shared_implementation.get() != NULL)
+          {
+            fsm * net = foma_interface.copy(implementation.foma);
+            bool retval = foma_interface.is_cyclic(net);
+            foma_interface.delete_foma(net);
+            return retval;
+          }
         return foma_interface.is_cyclic(implementation.foma);
 #endif
 #if HAVE_XFSM
@@ -1943,6 +2206,7 @@ HfstTransducer &HfstTransducer::eliminate_flags()
 #if HAVE_FOMA
   if (type == FOMA_TYPE)
     {
+      this->detach();
       struct fsm * result = this->foma_interface.eliminate_flags(this->implementation.foma);
       this->implementation.foma = result;
       return *this;
@@ -2000,6 +2264,7 @@ HfstTransducer &HfstTransducer::eliminate_flag(const std::string & flag)
 #if HAVE_FOMA
   if (type == FOMA_TYPE)
     {
+      this->detach();
       struct fsm * result = this->foma_interface.eliminate_flag(this->implementation.foma, flag);
       this->implementation.foma = result;
       return *this;
@@ -3397,6 +3662,8 @@ HfstTransducer &HfstTransducer::insert_freely
     // Now we need to harmonize because we are using internal transducers.
       if (harmonize)
         {
+          this->detach();
+          tr_harmonized->detach();
           this->foma_interface.harmonize
             (implementation.foma,tr_harmonized->implementation.foma);
         }
@@ -3404,7 +3671,8 @@ HfstTransducer &HfstTransducer::insert_freely
     hfst::implementations::HfstBasicTransducer * net =
             ConversionFunctions::foma_to_hfst_basic_transducer
             (implementation.foma);
-    this->foma_interface.delete_foma(implementation.foma);
+    if (! release_shared_implementation())
+      this->foma_interface.delete_foma(implementation.foma);
           
     hfst::implementations::HfstBasicTransducer * substituting_net =
             ConversionFunctions::foma_to_hfst_basic_transducer
@@ -3692,6 +3960,8 @@ HfstTransducer &HfstTransducer::substitute
         // HfstTransducer::harmonize does nothing to a foma transducer,
         // because foma's own functions take care of harmonizing.
         // Now we need to harmonize because we are using internal transducers.
+        this->detach();
+        transducer.detach();
         this->foma_interface.harmonize
         (implementation.foma,transducer.implementation.foma);
 
@@ -4099,7 +4369,8 @@ HfstTransducer &HfstTransducer::compose
     fsm * foma_temp =
             this->foma_interface.compose
             (implementation.foma,another_copy->implementation.foma);
-    this->foma_interface.delete_foma(implementation.foma);
+    if (! release_shared_implementation())
+      this->foma_interface.delete_foma(implementation.foma);
     implementation.foma = foma_temp;
     break;
     }
@@ -4599,8 +4870,26 @@ HfstTransducer &HfstTransducer::priority_union (const HfstTransducer &another)
     return *this;
 }
 
+// A copy of rule ready for compose_intersect: converted from foma if
+// convert_to_openfst is set and inverted if invert is set.
+static implementations::ComposeIntersectRule * make_compose_intersect_rule
+(const HfstTransducer &rule, bool convert_to_openfst, bool invert)
+{
+  HfstTransducer rule_fst(rule);
+  if (convert_to_openfst)
+    { rule_fst.convert(TROPICAL_OPENFST_TYPE); }
+
+  if (invert)
+    {
+      rule_fst.invert();
+      rule_fst.substitute(StringPair(internal_epsilon,"@#@"),
+                          StringPair("@#@",internal_epsilon));
+    }
+  return new implementations::ComposeIntersectRule(rule_fst);
+}
+
 HfstTransducer &HfstTransducer::compose_intersect
-(const HfstTransducerVector &v, bool invert, bool)
+(const HfstTransducerVector &v, bool invert, bool, unsigned int threads)
 {
 #if HAVE_XFSM
   if (this->type == XFSM_TYPE)
@@ -4665,101 +4954,94 @@ HfstTransducer &HfstTransducer::compose_intersect
     harmonized_lexicon->substitute(internal_identity,"||_IDENTITY_SYMBOL_||");
     harmonized_lexicon->substitute(internal_unknown,"||_UNKNOWN_SYMBOL_||");
 
-    if (v.size() == 1)
-    {
-      HfstTransducer rule_fst = v.at(0);
-      if (convert_to_openfst)
-        { rule_fst.convert(TROPICAL_OPENFST_TYPE); }
-
-      if (invert)
-        {
-          rule_fst.invert();
-          rule_fst.substitute(StringPair(internal_epsilon,"@#@"),
-                              StringPair("@#@",internal_epsilon));
-        }
-      
-      // In case there is only onw rule, compose with that.
-      implementations::ComposeIntersectRule rule(rule_fst);
-      // Create a ComposeIntersectLexicon from *this.
-      
-      //implementations::ComposeIntersectLexicon lexicon(*this);
-      implementations::ComposeIntersectLexicon lexicon(*harmonized_lexicon);
-      
-      hfst::implementations::HfstBasicTransducer res =
-        lexicon.compose_with_rules(&rule);
-      
-      res.prune_alphabet();
-      *this = HfstTransducer(res,type);
-    }
+    // Prepare the rules. The conversions dominate with many rules and
+    // are independent, so OpenFst rules can be prepared in parallel.
+    std::vector<implementations::ComposeIntersectRule*> rules(v.size(), NULL);
+    if (convert_to_openfst ||
+        (type != TROPICAL_OPENFST_TYPE && type != LOG_OPENFST_TYPE))
+      { threads = 1; }
+    else if (threads == 0)
+      { threads = std::thread::hardware_concurrency(); }
+    if (threads <= 1 || v.size() == 1)
+      {
+        for (size_t i = 0; i < v.size(); ++i)
+          {
+            rules[i] = make_compose_intersect_rule
+              (v.at(i), convert_to_openfst, invert);
+          }
+      }
     else
       {
-
-        // In case there are many rules, build a ComposeIntersectRulePair
-        // recursively and compose with that.
-        
-        HfstTransducer first_rule_fst = v.at(0);
-        if (convert_to_openfst)
-          { first_rule_fst.convert(TROPICAL_OPENFST_TYPE); }
-
-        if (invert)
+        // Copies of OpenFst transducers share their data through reference
+        // counts that are not thread-safe, so each worker gets rules that
+        // share nothing with v or with each other.
+        HfstTransducerVector inputs;
+        inputs.reserve(v.size());
+        for (size_t i = 0; i < v.size(); ++i)
+          { inputs.push_back(v.at(i).deep_copy()); }
+
+        std::atomic<size_t> next(0);
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < threads && t < inputs.size(); ++t)
           {
-            first_rule_fst.invert();
-            first_rule_fst.substitute(StringPair(internal_epsilon,"@#@"),
-                                      StringPair("@#@",internal_epsilon));
+            workers.push_back(std::thread([&]()
+              {
+                for (size_t i = next++; i < inputs.size(); i = next++)
+                  {
+                    try
+                      {
+                        rules[i] = make_compose_intersect_rule
+                          (inputs[i], convert_to_openfst, invert);
+                      }
+                    catch (...)
+                      {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        error = std::current_exception();
+                      }
+                  }
+              }));
           }
-
-        HfstTransducer second_rule_fst = v.at(1);
-        if (convert_to_openfst)
-          { second_rule_fst.convert(TROPICAL_OPENFST_TYPE); }
-
-        if (invert)
+        for (size_t t = 0; t < workers.size(); ++t)
+          { workers[t].join(); }
+        if (error)
           {
-            second_rule_fst.invert();
-            second_rule_fst.substitute(StringPair(internal_epsilon,"@#@"),
-                                       StringPair("@#@",internal_epsilon));
+            for (size_t i = 0; i < rules.size(); ++i)
+              { delete rules[i]; }
+            delete harmonized_lexicon;
+            std::rethrow_exception(error);
           }
+      }
 
-        std::vector<implementations::ComposeIntersectRule*> rule_vector;
-        implementations::ComposeIntersectRule * first_rule =
-          new implementations::ComposeIntersectRule(first_rule_fst);
-        implementations::ComposeIntersectRule * second_rule =
-          new implementations::ComposeIntersectRule(second_rule_fst);
-        
-        implementations::ComposeIntersectRulePair * rules =
-          new implementations::ComposeIntersectRulePair
-          (first_rule,second_rule);
-        
-        for (HfstTransducerVector::const_iterator it = v.begin() + 2;
-             it != v.end();
-             ++it)
+    // In case there are many rules, pair them up into a balanced tree of
+    // ComposeIntersectRulePairs, so that each transition of the
+    // intersection is computed through a logarithmic number of pairs.
+    while (rules.size() > 1)
+      {
+        std::vector<implementations::ComposeIntersectRule*> pairs;
+        for (size_t i = 0; i + 1 < rules.size(); i += 2)
           {
-            HfstTransducer rule_fst(*it);
-            if (convert_to_openfst)
-              { rule_fst.convert(TROPICAL_OPENFST_TYPE); }
-
-            if (invert)
-              {
-                rule_fst.invert();
-                rule_fst.substitute(StringPair(internal_epsilon,"@#@"),
-                                    StringPair("@#@",internal_epsilon));
-              }
-        
-            rules = new implementations::ComposeIntersectRulePair
-              (new implementations::ComposeIntersectRule(rule_fst),rules);
+            pairs.push_back(new implementations::ComposeIntersectRulePair
+                            (rules[i], rules[i+1]));
           }
-        // Create a ComposeIntersectLexicon from *this.
-        implementations::ComposeIntersectLexicon lexicon(*harmonized_lexicon);
-        hfst::implementations::HfstBasicTransducer res =
-          lexicon.compose_with_rules(rules);
-        
-        res.prune_alphabet();
-        *this = HfstTransducer(res,type);
-        
-        if (invert)
-          { this->invert(); }
-
-        delete rules;
+        if (rules.size() % 2 == 1)
+          { pairs.push_back(rules.back()); }
+        rules.swap(pairs);
       }
+
+    // Create a ComposeIntersectLexicon from *this.
+    implementations::ComposeIntersectLexicon lexicon(*harmonized_lexicon);
+    hfst::implementations::HfstBasicTransducer res =
+      lexicon.compose_with_rules(rules[0]);
+
+    res.prune_alphabet();
+    *this = HfstTransducer(res,type);
+
+    if (invert && v.size() > 1)
+      { this->invert(); }
+
+    delete rules[0];
     
     delete harmonized_lexicon;
     
@@ -5021,7 +5303,8 @@ convert_to_basic_transducer()
         hfst::implementations::HfstBasicTransducer * net =
       ConversionFunctions::foma_to_hfst_basic_transducer
       (implementation.foma);
-        foma_interface.delete_foma(implementation.foma);
+        if (! release_shared_implementation())
+          foma_interface.delete_foma(implementation.foma);
     return net;
       }
 #endif
@@ -5193,7 +5476,8 @@ HfstTransducer &HfstTransducer::convert(ImplementationType type,
       internal =
         ConversionFunctions::foma_to_hfst_basic_transducer
         (implementation.foma);
-      foma_interface.delete_foma(implementation.foma);
+      if (! release_shared_implementation())
+        foma_interface.delete_foma(implementation.foma);
       break;
 #endif
 #if HAVE_XFSM
@@ -5668,7 +5952,8 @@ HfstTransducer &HfstTransducer::operator=(const HfstTransducer &another)
     {
 #if HAVE_FOMA
     case FOMA_TYPE:
-      foma_interface.delete_foma(implementation.foma);
+      if (! release_shared_implementation())
+        foma_interface.delete_foma(implementation.foma);
     break;
 #endif
 #if HAVE_SFST
@@ -5709,6 +5994,11 @@ HfstTransducer &HfstTransducer::operator=(const HfstTransducer &another)
     // const_cast here. Shouldn't be a problem...
     HfstTransducer &another_1 = const_cast<HfstTransducer&>(another);
     type = another.type;
+    if (is_shareable(type))
+      {
+        share_implementation(another);
+        return *this;
+      }
     switch (type)
     {
 #if HAVE_FOMA
@@ -6331,6 +6621,39 @@ void lenient_composition_test ( ImplementationType type )
 
 }
 
+// Copies that share an implementation must not see each other's changes
+void copy_on_write_test ( ImplementationType type )
+{
+    HfstTransducer orig("a", "b", type);
+    orig.disjunct(HfstTransducer("c", type)).minimize();
+    HfstTransducer a(orig);
+
+    HfstTransducer b(a);
+    HfstTransducer c(b);
+    b.repeat_star().minimize();
+    assert ( ! b.compare(a) );
+    assert ( a.compare(orig) && c.compare(orig) );
+
+    c.insert_to_alphabet("x");
+    assert ( a.get_alphabet().count("x") == 0 );
+
+    HfstTransducer d(a);
+    HfstTransducer y("y", type);
+    HfstTransducer y_copy(y);
+    d.insert_freely(y_copy);
+    HfstTransducer e(a);
+    e.substitute(StringPair("a", "b"), y_copy);
+    assert ( a.compare(orig) && y_copy.compare(y) );
+
+    HfstTransducer f(type);
+    f = a;
+    f.invert();
+    a.reverse();
+    assert ( ! f.compare(orig) );
+    a.reverse();
+    assert ( a.compare(orig) );
+}
+
 int main(int argc, char * argv[])
 {
     std::cout << "Unit tests for " __FILE__ ":" << std::endl;
@@ -6425,6 +6748,8 @@ int main(int argc, char * argv[])
         // universal pair unit tests
         universal_pair_test( types[i] );
 
+        copy_on_write_test( types[i] );
+
         void insert_freely_missing_flags_from
           (const HfstTransducer &another);
 
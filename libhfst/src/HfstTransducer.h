@@ -58,6 +58,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <memory>
 
 #include "hfstdll.h"
 
@@ -160,6 +161,23 @@ namespace hfst
   HFSTDLL void set_unknown_symbols_in_use(bool);
   HFSTDLL bool get_unknown_symbols_in_use();
 
+  /* How binary operations have harmonized their operands. Each
+     harmonization of two transducers is counted once, under the most
+     expensive thing that had to be done to either of them. */
+  struct HarmonizationCounts
+  {
+    /* OpenFst transducers whose alphabets and symbol numbers agreed */
+    unsigned long unchanged;
+    /* OpenFst transducers whose symbol tables or numbers were recoded */
+    unsigned long recoded;
+    /* OpenFst transducers whose unknown and identity arcs were expanded */
+    unsigned long expanded;
+    /* Transducers converted to HfstBasicTransducer and back */
+    unsigned long converted;
+  };
+  HFSTDLL HarmonizationCounts get_harmonization_counts();
+  HFSTDLL void reset_harmonization_counts();
+
   /* Where warnings from TropicalWeightTransducer are printed. */
   void set_warning_stream(std::ostream * os);
   std::ostream * get_warning_stream();
@@ -300,6 +318,34 @@ An example:
     /* The backend implementation */
     TransducerImplementation implementation;
 
+    /* The owner of the backend implementation when it is shared with
+       copies of this transducer, NULL when this transducer owns it alone.
+       Copies of the types for which is_shareable holds share the
+       implementation until one of them is changed, see detach. */
+    struct SharedImplementation;
+    mutable std::shared_ptr<SharedImplementation> shared_implementation;
+
+    /* Whether copies of transducers of type \a type share their
+       backend implementation. */
+    static bool is_shareable(ImplementationType type);
+
+    /* Share the backend implementation of \a another. */
+    void share_implementation(const HfstTransducer &another);
+
+    /* Copy the properties and backend implementation of \a another,
+       sharing nothing with it if \a deep. */
+    void copy_implementation(const HfstTransducer &another, bool deep);
+
+    /* Make this transducer the only owner of its backend implementation,
+       copying it if it is shared. Called before the implementation is
+       changed in place. */
+    void detach();
+
+    /* If the backend implementation is shared, stop sharing it without
+       deleting it and return true. Called instead of deleting the
+       implementation when it is replaced with a new one. */
+    bool release_shared_implementation();
+
     /* Interfaces through which the backend implementations can be accessed */
 #if HAVE_SFST || HAVE_LEAN_SFST
     static hfst::implementations::SfstTransducer sfst_interface;
@@ -333,6 +379,12 @@ An example:
 
     HfstTransducer * harmonize_symbol_encodings(const HfstTransducer &another);
 
+    /* Harmonize this transducer and \a another in their own
+       implementation type, without converting them to
+       HfstBasicTransducer. Returns false if this is not supported for
+       the type, in which case neither transducer is changed. */
+    bool harmonize_natively(HfstTransducer &another);
+
     /* Check if transducer \a another has in its alphabet flag diacritics
        that are not found in the alphabet of this transducer and insert
        all missing flag diacritics to \a missing_flags.
@@ -390,6 +442,10 @@ An example:
 
   protected:
 
+    /* For internal use: Create a copy of \a another that shares no data
+       with it if \a deep, else as the copy constructor does. */
+    HfstTransducer(const HfstTransducer &another, bool deep);
+
     /* Get the number used to represent the symbol \a symbol. */
     //unsigned int get_symbol_number(const std::string &symbol);
     
@@ -567,9 +623,19 @@ An example:
         @see HfstInputStream **/
     HFSTDLL HfstTransducer(HfstInputStream &in);
 
-    /** \brief Create a deep copy of transducer \a another. **/
+    /** \brief Create a copy of transducer \a another.
+
+        OpenFst and foma copies share their data with \a another until
+        one of them is changed, so they must not be used on another
+        thread than \a another. See deep_copy. **/
     HFSTDLL HfstTransducer(const HfstTransducer &another);
 
+    /** \brief A copy of this transducer that shares no data with it
+        and can be handed over to another thread.
+
+        Make the copy on the thread that owns this transducer. **/
+    HFSTDLL HfstTransducer deep_copy() const;
+
     /** \brief Create an HFST transducer equivalent to
         HFST basic transducer \a t. The type of the created transducer
         is defined by \a type.  **/
@@ -1134,6 +1200,53 @@ ccc : ddd
                                           ssize_t limit = -1,
                                           double time_cutoff = 0.0) const;
 
+    //! @brief Look up each string of \a inputs minding flag diacritics
+    //! properly, using \a threads threads.
+    //!
+    //! The lookups are the same as those of
+    //! #lookup_fd(const std::string&, ssize_t, double) const, but each
+    //! thread has its own lookup state over the shared transducer, so
+    //! the transducer is not modified. The results are returned in the
+    //! order of \a inputs and must be deleted by the caller.
+    //!
+    //! @pre The transducer must be of type #HFST_OL_TYPE or #HFST_OLW_TYPE.
+    //!
+    //! @param inputs  Strings to look up.
+    //! @param threads  Number of threads to use, 0 for one per hardware thread.
+    //! @param limit  Maximum number of results per input, -1 for no limit.
+    //! @param time_cutoff Number of seconds that can pass before the lookup
+    //!                    of an input is stopped.
+    //! @param infinite  If not NULL and \a time_cutoff is 0.0, set to tell
+    //!                  which inputs are infinitely ambiguous.
+    //! @param infinite_limit  Maximum number of results for infinitely
+    //!                        ambiguous inputs, used when \a infinite is
+    //!                        not NULL.
+    //!
+    //! @see is_lookup_infinitely_ambiguous(const std::string&) const
+    HFSTDLL std::vector<HfstOneLevelPaths*> lookup_fd_batch(
+        const StringVector& inputs, unsigned int threads = 0,
+        ssize_t limit = -1, double time_cutoff = 0.0,
+        std::vector<bool> * infinite = NULL,
+        ssize_t infinite_limit = -1) const;
+
+    //! @brief Cache the results of #lookup_fd and #lookup_fd_batch.
+    //!
+    //! At most \a max_entries results taking about \a max_bytes bytes are
+    //! kept, the least recently used results being dropped first. A bound
+    //! of 0 means no bound; if both are 0, caching is switched off.
+    //! Lookups with a time cutoff bypass the cache.
+    //!
+    //! @pre The transducer must be of type #HFST_OL_TYPE or #HFST_OLW_TYPE.
+    //! @see get_lookup_cache
+    HFSTDLL void set_lookup_cache(size_t max_entries, size_t max_bytes = 0);
+
+    //! @brief The lookup cache with its hit and miss counts, or NULL if
+    //! caching is off.
+    //!
+    //! @pre The transducer must be of type #HFST_OL_TYPE or #HFST_OLW_TYPE.
+    //! @see set_lookup_cache
+    HFSTDLL const hfst_ol::LookupCache * get_lookup_cache() const;
+
     //! @brief Lookup or apply a single string \a s and store a maximum of
     //! \a limit results to \a results. \a tok defined how \a s is tokenized.
     //!
@@ -1341,10 +1454,15 @@ ccc : ddd
         all transducers one by one and then composing this transducer
         with the intersection.
 
+        The rules are prepared on \a threads threads, 0 meaning one per
+        core. Only OpenFst rules are prepared in parallel, each from a
+        deep copy made on the calling thread.
+
         @pre The transducers in \a v are deterministic and epsilon-free.
     */
     HFSTDLL HfstTransducer &compose_intersect(const HfstTransducerVector &v,
-                                      bool invert=false, bool harmonize=true);
+                                      bool invert=false, bool harmonize=true,
+                                      unsigned int threads=1);
 
     /** \brief Concatenate this transducer with \a another. */
     HFSTDLL HfstTransducer &concatenate(const HfstTransducer &another, bool harmonize=true);
@@ -11,6 +11,12 @@
 
 #ifndef MAIN_TEST
 
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
 namespace hfst
 {
   namespace xeroxRules
@@ -283,6 +289,86 @@ namespace hfst
 
 
 
+      //////////////////////////////////////
+      //    OPTIMIZATION SCHEDULE
+      //////////////////////////////////////
+
+      // set from one thread while rules are compiled on others
+      static std::atomic<float> optimization_threshold(2);
+      static std::atomic<std::ostream *> profile_stream(NULL);
+      static std::mutex profile_mutex;
+      static thread_local std::chrono::steady_clock::time_point profile_checkpoint;
+
+      void set_optimization_threshold(float growth)
+      {
+          optimization_threshold = growth;
+      }
+
+      float get_optimization_threshold()
+      {
+          return optimization_threshold;
+      }
+
+      void set_profile_stream(std::ostream * os)
+      {
+          profile_stream = os;
+      }
+
+      // Start timing the steps of a new rule.
+      static void profileStart()
+      {
+          profile_checkpoint = std::chrono::steady_clock::now();
+      }
+
+      // Write the size of t and the time since the previous step.
+      static void profileStep(const HfstTransducer &t, const char * step)
+      {
+          std::ostream * os = profile_stream;
+          if (os == NULL)
+          {
+              return;
+          }
+          std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+          double ms = std::chrono::duration<double, std::milli>(now - profile_checkpoint).count();
+          profile_checkpoint = now;
+
+          std::ostringstream line;
+          line << step << "\t" << t.number_of_states() << " states\t"
+               << t.number_of_arcs() << " arcs\t"
+               << std::fixed << std::setprecision(2) << ms << " ms\n";
+          std::lock_guard<std::mutex> lock(profile_mutex);
+          *os << line.str() << std::flush;
+      }
+
+      // Optimize t if it has grown past the threshold since optimizedStates,
+      // its size when it was last optimized, and update optimizedStates.
+      // A transducer built up by a chain of steps keeps the same
+      // optimizedStates, so that unions and concatenations, which never
+      // double their operands in one step, are optimized once the chain
+      // has grown enough. Formats that don't report their size are always
+      // optimized.
+      static HfstTransducer & optimizeStep(HfstTransducer &t, const char * step, unsigned int & optimizedStates)
+      {
+          float threshold = optimization_threshold;
+          unsigned int states = t.number_of_states();
+          if (threshold <= 0 || states == 0 ||
+              states > threshold * optimizedStates)
+          {
+              t.optimize();
+              optimizedStates = t.number_of_states();
+          }
+          profileStep(t, step);
+          return t;
+      }
+
+      // Optimize t before it is composed or subtracted, or returned.
+      static HfstTransducer & optimizeBoundary(HfstTransducer &t, const char * step)
+      {
+          t.optimize();
+          profileStep(t, step);
+          return t;
+      }
+
       HfstTransducer disjunctVectorMembers( const HfstTransducerVector &trVector )
       {
           HfstTransducer retval( trVector[0] );
@@ -307,14 +393,15 @@ namespace hfst
         String leftMarker("@LM@");
         String rightMarker("@RM@");
 
-        retval.substitute(StringPair(leftMarker, leftMarker), StringPair("@_EPSILON_SYMBOL_@", "@_EPSILON_SYMBOL_@")).optimize();
-        retval.substitute(StringPair(rightMarker, rightMarker), StringPair("@_EPSILON_SYMBOL_@", "@_EPSILON_SYMBOL_@")).optimize();
+        // substituting doesn't add states, so optimize only once
+        retval.substitute(StringPair(leftMarker, leftMarker), StringPair("@_EPSILON_SYMBOL_@", "@_EPSILON_SYMBOL_@"));
+        retval.substitute(StringPair(rightMarker, rightMarker), StringPair("@_EPSILON_SYMBOL_@", "@_EPSILON_SYMBOL_@"));
 
 
         retval.remove_from_alphabet(leftMarker);
         retval.remove_from_alphabet(rightMarker);
 
-        retval.optimize();
+        optimizeBoundary(retval, "removeMarkers");
 
 
         
@@ -347,22 +434,23 @@ namespace hfst
           HfstTransducer retval(t);
           retval.transform_weights(&zero_weight);
 
-          retval.input_project().optimize();
+          optimizeBoundary(retval.input_project(), "constraintComposition: input");
 
           HfstTransducer tmp(retval);
-          tmp.compose(Constraint).optimize();
+          unsigned int inputStates = tmp.number_of_states() + Constraint.number_of_states();
+          optimizeStep(tmp.compose(Constraint), "constraintComposition: constrain", inputStates);
           //printf("tmp: \n");
            //tmp.write_in_att_format(stdout, 1);
 
-          tmp.compose(retval).optimize();
+          optimizeBoundary(tmp.compose(retval), "constraintComposition: compose");
          //printf("tmp 2: \n");
          //tmp.write_in_att_format(stdout, 1);
-          tmp.output_project().optimize();
-          retval.subtract(tmp).optimize();
+          optimizeBoundary(tmp.output_project(), "constraintComposition: output");
+          optimizeBoundary(retval.subtract(tmp), "constraintComposition: subtract");
 
           //transform weights to zero
           retval.transform_weights(&zero_weight);
-          retval.compose(t).optimize();
+          optimizeBoundary(retval.compose(t), "constraintComposition");
 
           return retval;
       }
@@ -609,6 +697,8 @@ namespace hfst
         TOK.add_multichar_symbol(newEpsilon);
         TOK.add_multichar_symbol( ".#.");
 
+        profileStart();
+
         //first, encode all flag diacritics
         Rule ruletmp(rule);
         ruletmp.encodeFlags();
@@ -624,9 +714,19 @@ namespace hfst
         HfstTransducer identity (identityPair);
         identity.repeat_star().optimize();
 
+        // for removing .#. from the center
+        HfstTransducer identityWithoutBoundary(identity);
+        identityWithoutBoundary.insert_to_alphabet(".#.");
+        HfstTransducer removeHash(identityWithoutBoundary);
+        HfstTransducer boundary(".#.", TOK, type);
+        removeHash.concatenate(boundary).concatenate(identityWithoutBoundary).optimize();
+        //printf("removeHash \n");
+        //removeHash.write_in_att_format(stdout, 1);
+
 
         HfstTransducer epsilon("@_EPSILON_SYMBOL_@", TOK, type);
         HfstTransducer mapping(type);
+        unsigned int mappingStates = 0;
         for ( unsigned int i = 0; i < mappingPairVector.size(); i++ )
         {
             HfstTransducer oneMappingPair(mappingPairVector[i].first);
@@ -639,16 +739,6 @@ namespace hfst
             }
            // printf("aftrer cross product \n");
            // oneMappingPair.write_in_att_format(stdout, 1);
-          
-          
-            // for removing .#. from the center
-            HfstTransducer identityWithoutBoundary(identity);
-            identityWithoutBoundary.insert_to_alphabet(".#.");
-            HfstTransducer removeHash(identityWithoutBoundary);
-            HfstTransducer boundary(".#.", TOK, type);
-            removeHash.concatenate(boundary).concatenate(identityWithoutBoundary).optimize();
-            //printf("removeHash \n");
-            //removeHash.write_in_att_format(stdout, 1);
 
 
             // printf("oneMappingPair kkkk\n");
@@ -662,12 +752,13 @@ namespace hfst
                 oneMappingPair.subtract(removeHash, false).optimize();
                 oneMappingPair.remove_from_alphabet(".#.");
                 mapping = oneMappingPair;
+                mappingStates = mapping.number_of_states();
             }
             else
             {
                 oneMappingPair.subtract(removeHash, false).optimize();
                 oneMappingPair.remove_from_alphabet(".#.");
-                mapping.disjunct(oneMappingPair).optimize();
+                optimizeStep(mapping.disjunct(oneMappingPair), "bracketedReplace: mapping", mappingStates);
             }
         }
         //printf("mapping all after cross product \n");
@@ -709,7 +800,8 @@ namespace hfst
 
         // Surround mapping with brackets
         HfstTransducer tmpMapping(leftBracket);
-        tmpMapping.concatenate(mapping).concatenate(rightBracket).optimize();
+        optimizeStep(tmpMapping.concatenate(mapping).concatenate(rightBracket),
+                     "bracketedReplace: brackets", mappingStates);
 
         HfstTransducer mappingWithBrackets(tmpMapping);
 
@@ -727,9 +819,11 @@ namespace hfst
             HfstTransducer mappingWithBrackets2(leftBracket2);
             HfstTransducer leftMappingUnion(type);
             leftMappingUnion = mappingPairVector[0].first;
+            unsigned int leftMappingStates = leftMappingUnion.number_of_states();
             for ( unsigned int i = 1; i < mappingPairVector.size(); i++ )
             {
-                leftMappingUnion.disjunct(mappingPairVector[i].first).optimize();
+                optimizeStep(leftMappingUnion.disjunct(mappingPairVector[i].first),
+                             "bracketedReplace: left side", leftMappingStates);
             }
             // needed in case of ? -> x replacement
             leftMappingUnion.insert_to_alphabet(leftMarker2);
@@ -742,7 +836,8 @@ namespace hfst
             //leftMappingUnion.optimize().write_in_att_format(stdout, 1);
 
 
-            mappingWithBrackets2.concatenate(leftMappingUnion).concatenate(rightBracket2).optimize();
+            optimizeStep(mappingWithBrackets2.concatenate(leftMappingUnion).concatenate(rightBracket2),
+                         "bracketedReplace: brackets 2", leftMappingStates);
 
             //printf("mappingWithBrackets2: \n");
             //mappingWithBrackets2.optimize().write_in_att_format(stdout, 1);
@@ -752,8 +847,9 @@ namespace hfst
             mappingWithBrackets.insert_to_alphabet(rightMarker2);
             //mappingWithBrackets.insert_to_alphabet(leftMarker);
             //mappingWithBrackets.insert_to_alphabet(rightMarker);
-            mappingWithBrackets.disjunct(mappingWithBrackets2).optimize();
+            mappingWithBrackets.disjunct(mappingWithBrackets2);
         }
+        optimizeBoundary(mappingWithBrackets, "bracketedReplace: bracketed mapping");
 
         //printf("mappingWithBrackets: \n");
         //mappingWithBrackets.optimize().write_in_att_format(stdout, 1);
@@ -773,8 +869,8 @@ namespace hfst
           identityExpanded.insert_to_alphabet(rightMarker2);
         }
 
-        identityExpanded.disjunct(mappingWithBrackets).optimize();
-        identityExpanded.repeat_star().optimize();
+        identityExpanded.disjunct(mappingWithBrackets).repeat_star();
+        optimizeBoundary(identityExpanded, "bracketedReplace: identity expanded");
 
         // when there aren't any contexts, result is identityExpanded
         if ( ContextVector.size() == 1 )
@@ -791,14 +887,16 @@ namespace hfst
 
         // Surround mapping with tmp boudaries
         HfstTransducer mappingWithBracketsAndTmpBoundary(tmpBracket);
-        mappingWithBracketsAndTmpBoundary.concatenate(mappingWithBrackets).concatenate(tmpBracket).optimize();
+        optimizeBoundary(mappingWithBracketsAndTmpBoundary.concatenate(mappingWithBrackets).concatenate(tmpBracket),
+                         "bracketedReplace: tmp boundaries");
         //printf("mappingWithBracketsAndTmpBoundary: \n");
         //mappingWithBracketsAndTmpBoundary.write_in_att_format(stdout, 1);
 
 
         // .* |<a:b>| :*
         HfstTransducer bracketedReplace(identityExpanded);
-        bracketedReplace.concatenate(mappingWithBracketsAndTmpBoundary).concatenate(identityExpanded).optimize();
+        optimizeBoundary(bracketedReplace.concatenate(mappingWithBracketsAndTmpBoundary).concatenate(identityExpanded),
+                         "bracketedReplace: without contexts");
 
         //printf("mappingWithBracketsAndTmpBoundary: \n");
         //mappingWithBracketsAndTmpBoundary.write_in_att_format(stdout, 1);
@@ -820,22 +918,22 @@ namespace hfst
 
         // subtract all mappings in contexts from replace without contexts
         HfstTransducer replaceWithoutContexts(bracketedReplace);
-        replaceWithoutContexts.subtract(unionContextReplace).optimize();
+        replaceWithoutContexts.subtract(unionContextReplace);
 
         //printf("replaceWithoutContexts \n");
         //replaceWithoutContexts.write_in_att_format(stdout, 1);
 
         // remove tmpMaprker
         replaceWithoutContexts.substitute(StringPair(tmpMarker, tmpMarker),
-                        StringPair("@_EPSILON_SYMBOL_@", "@_EPSILON_SYMBOL_@")).optimize();
+                        StringPair("@_EPSILON_SYMBOL_@", "@_EPSILON_SYMBOL_@"));
         replaceWithoutContexts.remove_from_alphabet(tmpMarker);
-        replaceWithoutContexts.optimize();
+        optimizeBoundary(replaceWithoutContexts, "bracketedReplace: outside contexts");
 
         identityExpanded.remove_from_alphabet(tmpMarker);
 
         // final negation
         HfstTransducer uncondidtionalTr(identityExpanded);
-        uncondidtionalTr.subtract(replaceWithoutContexts).optimize();
+        optimizeBoundary(uncondidtionalTr.subtract(replaceWithoutContexts), "bracketedReplace");
 
         return uncondidtionalTr;
 
@@ -877,6 +975,8 @@ namespace hfst
       // because the transition <a:b::2> will be eliminated by the transition
       // <a:b::1> as it has a lower weight.
 
+      profileStart();
+
       StringSet marker_symbols; // "@1@", "@2@", ... , "@N@"
       HfstSymbolSubstitutions marker_substitutions; // any-marker-to-epsilon
       for (unsigned int i=0; i < ruleVector.size(); i++)
@@ -930,6 +1030,7 @@ namespace hfst
         identityExpanded.insert_to_alphabet(tmpMarker);
         identityExpanded.insert_to_alphabet(marker_symbols);
         // will be expanded with mappings
+        unsigned int identityExpandedStates = identityExpanded.number_of_states();
 
         // for removing .#. from the center
         HfstTransducer identityWithoutBoundary(identity);
@@ -955,6 +1056,7 @@ namespace hfst
           HfstTransducerPairVector mappingPairVector 
             = ruletmp.get_mapping();
           HfstTransducer mapping(type);
+          unsigned int mappingStates = 0;
           for ( unsigned int j = 0; j < mappingPairVector.size(); j++ )
             {
               // i+1 because @0@ is epsilon..
@@ -980,12 +1082,14 @@ namespace hfst
                   oneMappingPair.subtract(removeHash, false).optimize();
                   oneMappingPair.remove_from_alphabet(".#.");
                   mapping = oneMappingPair;
+                  mappingStates = mapping.number_of_states();
                 }
               else
                 {
                   oneMappingPair.subtract(removeHash, false).optimize();
                   oneMappingPair.remove_from_alphabet(".#.");
-                  mapping.disjunct(oneMappingPair).optimize();
+                  optimizeStep(mapping.disjunct(oneMappingPair),
+                               "parallelBracketedReplace: mapping", mappingStates);
                 }
             }
           
@@ -1072,11 +1176,12 @@ namespace hfst
 
             }
 
-          identityExpanded.disjunct(mappingWithBrackets).optimize();
+          optimizeStep(identityExpanded.disjunct(mappingWithBrackets),
+                       "parallelBracketedReplace: mappings", identityExpandedStates);
           mappingWithBracketsVector.push_back(mappingWithBrackets);
         }
         
-        identityExpanded.repeat_star().optimize();
+        optimizeBoundary(identityExpanded.repeat_star(), "parallelBracketedReplace: identity expanded");
         
         // if none of the rules have contexts, return identityExpanded
         if ( noContexts )
@@ -1100,6 +1205,8 @@ namespace hfst
         
         HfstTransducer unionContextReplace(type);
         HfstTransducer bracketedReplace(type);
+        unsigned int unionContextReplaceStates = unionContextReplace.number_of_states();
+        unsigned int bracketedReplaceStates = bracketedReplace.number_of_states();
         //THIS is for disjuncting labels first, and then substitute them with
         // transducers
         //HfstTransducer unionContextReplace_labels(type);
@@ -1121,7 +1228,8 @@ namespace hfst
               .optimize();
             
             bracketedReplaceTmp.transform_weights(&zero_weight);
-            bracketedReplace.disjunct(bracketedReplaceTmp).optimize();
+            optimizeStep(bracketedReplace.disjunct(bracketedReplaceTmp),
+                         "parallelBracketedReplace: without contexts", bracketedReplaceStates);
             
             //Create context part
             HfstTransducer unionContextReplaceTmp(type);
@@ -1165,7 +1273,8 @@ namespace hfst
             
             unionContextReplaceTmp.transform_weights(&zero_weight);
             
-            unionContextReplace.disjunct(unionContextReplaceTmp).optimize();
+            optimizeStep(unionContextReplace.disjunct(unionContextReplaceTmp),
+                         "parallelBracketedReplace: in contexts", unionContextReplaceStates);
            /*
            //THIS part is for disjuncting labels first, and then substitute
            // them with transducers
@@ -1225,16 +1334,18 @@ namespace hfst
         //printf("subtract all mappings in contexts from replace without
         //contexts: \n");
         // subtract all mappings in contexts from replace without contexts
+        optimizeBoundary(bracketedReplace, "parallelBracketedReplace: without contexts");
+        optimizeBoundary(unionContextReplace, "parallelBracketedReplace: in contexts");
         HfstTransducer replaceWithoutContexts(bracketedReplace);
-        replaceWithoutContexts.subtract(unionContextReplace).optimize();
+        replaceWithoutContexts.subtract(unionContextReplace);
         
         //printf("remove bla bla: \n");
         // remove tmpMaprker
         replaceWithoutContexts.substitute
           (StringPair(tmpMarker, tmpMarker),
-           StringPair("@_EPSILON_SYMBOL_@", "@_EPSILON_SYMBOL_@")).optimize();
+           StringPair("@_EPSILON_SYMBOL_@", "@_EPSILON_SYMBOL_@"));
         replaceWithoutContexts.remove_from_alphabet(tmpMarker);
-        replaceWithoutContexts.optimize();
+        optimizeBoundary(replaceWithoutContexts, "parallelBracketedReplace: outside contexts");
 
         identityExpanded.remove_from_alphabet(tmpMarker);
         
@@ -1244,7 +1355,7 @@ namespace hfst
         //printf("final subtract: \n");
         // final negation
         HfstTransducer uncondidtionalTr(identityExpanded);
-        uncondidtionalTr.subtract(replaceWithoutContexts).optimize();
+        optimizeBoundary(uncondidtionalTr.subtract(replaceWithoutContexts), "parallelBracketedReplace");
         
         //printf("uncondidtionalTr: \n");
         //uncondidtionalTr.write_in_att_format(stdout, 1);
@@ -2257,21 +2368,23 @@ namespace hfst
             //printf("----first: ----\n");
             //tr.write_in_att_format(stdout, 1);
 
-            retval.compose(tr).optimize();
+            // the helper transducers are small, so the compositions are
+            // about as big as tr and there is no need to optimize each
+            unsigned int inputStates = retval.number_of_states() + tr.number_of_states();
+            optimizeStep(retval.compose(tr), "applyBoundaryMark: insert", inputStates);
 
 
 //            printf("first composition: \n");
 //            retval.write_in_att_format(stdout, 1);
 
             // compose with .#. (? - .#.)* .#.
-            retval.compose(boundaryAnythingBoundary)
-                  .optimize();
+            optimizeStep(retval.compose(boundaryAnythingBoundary), "applyBoundaryMark: check", inputStates);
 
 //            printf("2. composition: \n");
 //            retval.write_in_att_format(stdout, 1);
 
             // compose with [.#.:0 | ? - .#.]*
-            retval.compose(removeBoundary).optimize();
+            optimizeBoundary(retval.compose(removeBoundary), "applyBoundaryMark");
 
 //            printf("3. composition: \n");
 //            retval.write_in_att_format(stdout, 1);
@@ -2348,12 +2461,14 @@ namespace hfst
           // it can't have more than one epsilon repetition in a row
 
           retval = noRepetitionConstraint( retval );
+          profileStep(retval, "noRepetitionConstraint");
 
           //printf("-----noRepetitionConstraint-----: \n");
           //retval.write_in_att_format(stdout, 1);
 
           // deals with boundary symbol, must be before mostBracketsStarConstraint
           retval = applyBoundaryMark( retval );
+          profileStep(retval, "applyBoundaryMark");
 
          //printf("----after applyBoundaryMark: ----\n");
          //retval.write_in_att_format(stdout, 1);
@@ -2364,11 +2479,14 @@ namespace hfst
               // Epenthesis rules behave differently if used mostBracketsPlusConstraint
               //retval = mostBracketsPlusConstraint(retval);
               retval = mostBracketsStarConstraint(retval);
+              profileStep(retval, "mostBracketsStarConstraint");
               //printf("after non optional: \n");
               //retval.write_in_att_format(stdout, 1);
           }
           retval = removeB2Constraint(retval);
+          profileStep(retval, "removeB2Constraint");
           retval = removeMarkers( retval );
+          profileStep(retval, "removeMarkers");
           //printf("after removeMarkers: \n");
           //retval.write_in_att_format(stdout, 1);
           return retval;
@@ -2398,6 +2516,7 @@ namespace hfst
             // for epenthesis rules
             // it can't have more than one epsilon repetition in a row
             retval = noRepetitionConstraint( retval );
+            profileStep(retval, "noRepetitionConstraint");
 
 
         //   printf("----after noRepetitionConstraint: ----\n");
@@ -2406,6 +2525,7 @@ namespace hfst
 
             // deals with boundary symbol
             retval = applyBoundaryMark( retval );
+            profileStep(retval, "applyBoundaryMark");
 
         //printf("----after applyBoundaryMark: ----\n");
         //retval.write_in_att_format(stdout, 1);
@@ -2415,17 +2535,20 @@ namespace hfst
                 // Epenthesis rules behave differently if used mostBracketsPlusConstraint
                // retval = mostBracketsPlusConstraint(retval);
                 retval = mostBracketsStarConstraint(retval);
+                profileStep(retval, "mostBracketsStarConstraint");
             }
 
          // printf("----after mostBracketsStarConstraint: ----\n");
          //  retval.write_in_att_format(stdout, 1);
 
             retval = removeB2Constraint(retval);
+            profileStep(retval, "removeB2Constraint");
 
          //printf("----after removeB2Constraint: ----\n");
          // retval.write_in_att_format(stdout, 1);
 
             retval = removeMarkers( retval );
+            profileStep(retval, "removeMarkers");
 
             //printf("----after removeMarkers: ----\n");
             //retval.write_in_att_format(stdout, 1);
@@ -2504,26 +2627,32 @@ namespace hfst
           // it can't have more than one epsilon repetition in a row
           // it should be before leftMostConstraint
           uncondidtionalTr = noRepetitionConstraint( uncondidtionalTr );
+          profileStep(uncondidtionalTr, "noRepetitionConstraint");
 
           HfstTransducer retval (leftMostConstraint(uncondidtionalTr));
 
           //to remove empty strings
           retval = oneBetterthanNoneConstraint(retval);
+          profileStep(retval, "oneBetterthanNoneConstraint");
 
 
           // printf("leftMostConstraint: \n");
           // retval.write_in_att_format(stdout, 1);
           retval = longestMatchLeftMostConstraint( retval );
+          profileStep(retval, "longestMatchLeftMostConstraint");
 
           //printf("longestMatchLeftMostConstraint: \n");
           //retval.write_in_att_format(stdout, 1);
 
 
           retval = removeB2Constraint(retval);
+          profileStep(retval, "removeB2Constraint");
           retval = removeMarkers( retval );
+          profileStep(retval, "removeMarkers");
 
           // deals with boundary symbol
           retval = applyBoundaryMark( retval );
+          profileStep(retval, "applyBoundaryMark");
 
           return retval;
       }
@@ -2549,6 +2678,7 @@ namespace hfst
         // it can't have more than one epsilon repetition in a row
         // it should be before leftMostConstraint
         uncondidtionalTr = noRepetitionConstraint( uncondidtionalTr );
+        profileStep(uncondidtionalTr, "noRepetitionConstraint");
         //printf("uncondidtionalTr epenthesis \n");
         //uncondidtionalTr.write_in_att_format(stdout, 1);
 
@@ -2556,24 +2686,29 @@ namespace hfst
 
         //to remove empty strings
         retval = oneBetterthanNoneConstraint(retval);
+        profileStep(retval, "oneBetterthanNoneConstraint");
 
         retval = longestMatchLeftMostConstraint( retval );
+        profileStep(retval, "longestMatchLeftMostConstraint");
        //printf("retval longestMatchLeftMostConstraint \n");
        //retval.write_in_att_format(stdout, 1);
 
         // remove LM2, RM2
         retval = removeB2Constraint(retval);
+        profileStep(retval, "removeB2Constraint");
 
         //printf("retval removeB2Constraint \n");
         //retval.write_in_att_format(stdout, 1);
 
         retval = removeMarkers( retval );
+        profileStep(retval, "removeMarkers");
 
 //       printf("LM removeMarkers: \n");
 //        retval.write_in_att_format(stdout, 1);
 
         // deals with boundary symbol
         retval = applyBoundaryMark( retval );
+        profileStep(retval, "applyBoundaryMark");
 
      // printf("LM applyBoundaryMark: \n");
      // retval.write_in_att_format(stdout, 1);
@@ -2596,6 +2731,7 @@ namespace hfst
           //retval.write_in_att_format(stdout, 1);
 
           retval = longestMatchRightMostConstraint( retval );
+          profileStep(retval, "longestMatchRightMostConstraint");
 
           //printf("longestMatchLeftMostConstraint: \n");
           //retval.write_in_att_format(stdout, 1);
@@ -2603,14 +2739,18 @@ namespace hfst
           // for epenthesis rules
           // it can't have more than one epsilon repetition in a row
           retval = noRepetitionConstraint( retval );
+          profileStep(retval, "noRepetitionConstraint");
           // remove LM2, RM2
           retval = removeB2Constraint(retval);
+          profileStep(retval, "removeB2Constraint");
 
           retval = removeMarkers( retval );
+          profileStep(retval, "removeMarkers");
 
 
           // deals with boundary symbol
           retval = applyBoundaryMark( retval );
+          profileStep(retval, "applyBoundaryMark");
 
           return retval;
       }
@@ -2636,6 +2776,7 @@ namespace hfst
           //retval.write_in_att_format(stdout, 1);
 
           retval = longestMatchRightMostConstraint( retval );
+          profileStep(retval, "longestMatchRightMostConstraint");
 
           //printf("longestMatchLeftMostConstraint: \n");
           //retval.write_in_att_format(stdout, 1);
@@ -2643,13 +2784,17 @@ namespace hfst
           // for epenthesis rules
           // it can't have more than one epsilon repetition in a row
           retval = noRepetitionConstraint( retval );
+          profileStep(retval, "noRepetitionConstraint");
           // remove LM2, RM2
           retval = removeB2Constraint(retval);
+          profileStep(retval, "removeB2Constraint");
 
           retval = removeMarkers( retval );
+          profileStep(retval, "removeMarkers");
 
           // deals with boundary symbol
           retval = applyBoundaryMark( retval );
+          profileStep(retval, "applyBoundaryMark");
 
           return retval;
       }
@@ -2664,12 +2809,15 @@ namespace hfst
           // it can't have more than one epsilon repetition in a row
           //has to be before leftMostConstraint
           uncondidtionalTr = noRepetitionConstraint( uncondidtionalTr );
+          profileStep(uncondidtionalTr, "noRepetitionConstraint");
 
           HfstTransducer retval (leftMostConstraint(uncondidtionalTr));
           //to remove empty strings
           retval = oneBetterthanNoneConstraint(retval);
+          profileStep(retval, "oneBetterthanNoneConstraint");
 
           retval = shortestMatchLeftMostConstraint( retval );
+          profileStep(retval, "shortestMatchLeftMostConstraint");
 
           //printf("sh tr: \n");
           //retval.write_in_att_format(stdout, 1);
@@ -2677,11 +2825,14 @@ namespace hfst
 
           // remove LM2, RM2
           retval = removeB2Constraint(retval);
+          profileStep(retval, "removeB2Constraint");
 
           retval = removeMarkers( retval );
+          profileStep(retval, "removeMarkers");
 
           // deals with boundary symbol
           retval = applyBoundaryMark( retval );
+          profileStep(retval, "applyBoundaryMark");
 
           return retval;
       }
@@ -2702,25 +2853,31 @@ namespace hfst
         // for epenthesis rules
         // it can't have more than one epsilon repetition in a row
         uncondidtionalTr = noRepetitionConstraint( uncondidtionalTr );
+        profileStep(uncondidtionalTr, "noRepetitionConstraint");
 
 
         HfstTransducer retval (leftMostConstraint(uncondidtionalTr));
 
         //to remove empty strings
         retval = oneBetterthanNoneConstraint(retval);
+        profileStep(retval, "oneBetterthanNoneConstraint");
 
         retval = shortestMatchLeftMostConstraint( retval );
+        profileStep(retval, "shortestMatchLeftMostConstraint");
 
         //printf("sh tr: \n");
         //retval.write_in_att_format(stdout, 1);
 
         // remove LM2, RM2
         retval = removeB2Constraint(retval);
+        profileStep(retval, "removeB2Constraint");
 
         retval = removeMarkers( retval );
+        profileStep(retval, "removeMarkers");
 
         // deals with boundary symbol
         retval = applyBoundaryMark( retval );
+        profileStep(retval, "applyBoundaryMark");
 
         return retval;
       }
@@ -2734,6 +2891,7 @@ namespace hfst
         HfstTransducer retval (rightMostConstraint(uncondidtionalTr));
         //retval = rightMostConstraint(uncondidtionalTr);
         retval = shortestMatchRightMostConstraint( retval );
+        profileStep(retval, "shortestMatchRightMostConstraint");
 
         //printf("sh tr: \n");
         //retval.write_in_att_format(stdout, 1);
@@ -2742,13 +2900,17 @@ namespace hfst
         // for epenthesis rules
         // it can't have more than one epsilon repetition in a row
         retval = noRepetitionConstraint( retval );
+        profileStep(retval, "noRepetitionConstraint");
         // remove LM2, RM2
         retval = removeB2Constraint(retval);
+        profileStep(retval, "removeB2Constraint");
 
         retval = removeMarkers( retval );
+        profileStep(retval, "removeMarkers");
 
         // deals with boundary symbol
         retval = applyBoundaryMark( retval );
+        profileStep(retval, "applyBoundaryMark");
 
         return retval;
     }
@@ -2767,6 +2929,7 @@ namespace hfst
         HfstTransducer retval (rightMostConstraint(uncondidtionalTr));
         //retval = rightMostConstraint(uncondidtionalTr);
         retval = shortestMatchRightMostConstraint( retval );
+        profileStep(retval, "shortestMatchRightMostConstraint");
 
         //printf("sh tr: \n");
         //retval.write_in_att_format(stdout, 1);
@@ -2775,13 +2938,17 @@ namespace hfst
         // for epenthesis rules
         // it can't have more than one epsilon repetition in a row
         retval = noRepetitionConstraint( retval );
+        profileStep(retval, "noRepetitionConstraint");
         // remove LM2, RM2
         retval = removeB2Constraint(retval);
+        profileStep(retval, "removeB2Constraint");
 
         retval = removeMarkers( retval );
+        profileStep(retval, "removeMarkers");
 
         // deals with boundary symbol
         retval = applyBoundaryMark( retval );
+        profileStep(retval, "applyBoundaryMark");
 
         return retval;
     }
@@ -3024,6 +3191,13 @@ int main(int argc, char * argv[])
           ImplementationType types[] = {SFST_TYPE, TROPICAL_OPENFST_TYPE, FOMA_TYPE};
           unsigned int NUMBER_OF_TYPES=3;
 
+          // deferred optimization and optimization after every step
+          // must give the same results
+          float thresholds[] = {2, 0};
+
+          for (unsigned int t=0; t < 2; t++)
+          {
+          set_optimization_threshold(thresholds[t]);
 
           for (unsigned int i=0; i < NUMBER_OF_TYPES; i++)
           {
@@ -3144,6 +3318,7 @@ int main(int argc, char * argv[])
 
             before_test1( types[i] );
           }
+          }
 
           std::cout << "ok" << std::endl;
           return 0;
@@ -37,6 +37,26 @@ namespace hfst
                            E_LTR_LONGEST_MATCH,
                            E_LTR_SHORTEST_MATCH
     };
+
+        /** \brief Optimize an intermediate transducer of replace rule
+         *  compilation only if it has more than \a growth times the states
+         *  it had when it was last optimized.
+         *
+         *  A transducer built by a chain of unions or concatenations is thus
+         *  optimized each time the chain has grown by that factor, and the
+         *  result of a composition when it is that much bigger than its
+         *  operands. Operands of composition and subtraction and the results
+         *  of the replace functions are always optimized. If \a growth is 0,
+         *  every intermediate transducer is optimized. The default is 2.
+         *
+         *  The threshold and the profile stream are shared by all threads. */
+        void set_optimization_threshold(float growth);
+        float get_optimization_threshold();
+
+        /** \brief Write a line with the number of states and arcs and the
+         *  time in milliseconds for each step of replace rule compilation
+         *  to \a os. If \a os is NULL (the default), nothing is written. */
+        void set_profile_stream(std::ostream * os);
         /**
          * \brief A rule that contains mapping and context and replace type (if any).
          * If rule is A -> B || L _ R , than mapping is cross product of transducers A and B,
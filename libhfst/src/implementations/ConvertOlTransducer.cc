@@ -12,10 +12,14 @@
 #endif
 
 #include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
 
 #include "ConvertTransducerFormat.h"
 #include "optimized-lookup/convert.h"
 #include "HfstBasicTransducer.h"
+#include "HfstFrozenTransducer.h"
 //#include "HfstTransducer.h"
 
 #ifndef MAIN_TEST
@@ -164,57 +168,75 @@ void get_states_and_symbols(
     // We also gather information about possible gaps in the state numbering,
     // because we want it to be contiguous from now on.
 
-    // If we have been told to use a certain symbol table,
-    // there's no need to keep track of symbols here.
-    StringSet * input_symbols = new StringSet();
-    StringSet * flag_diacritics = new StringSet();
-    StringSet * other_symbols = new StringSet();
-    
-    unsigned int first_transition = 0;
-    unsigned int state_number = 0;
-    for (HfstBasicTransducer::const_iterator it = t->begin();
-         it != t->end(); ++it) {
-        hfst_ol::Weight final_w = 0.0;
-        if (t->is_final_state(state_number)) {
-            final_w = t->get_final_weight(state_number);
+    // Both passes go over the transducer frozen into one array, where
+    // symbols are numbers: each symbol is named, classified and looked
+    // up once instead of once for every transition.
+    HfstFrozenTransducer frozen(*t);
+    const HfstFrozenTransitions & arcs = frozen.get_transitions();
+    HfstState state_count = frozen.get_state_count();
+
+    // Which symbol numbers are used on the input and the output side
+    std::vector<bool> used_as_input;
+    std::vector<bool> used_as_output;
+    for (HfstFrozenTransitions::const_iterator it = arcs.begin();
+         it != arcs.end(); ++it) {
+        if (it->input_number >= used_as_input.size()) {
+            used_as_input.resize(it->input_number + 1, false);
+        }
+        used_as_input[it->input_number] = true;
+        if (it->output_number >= used_as_output.size()) {
+            used_as_output.resize(it->output_number + 1, false);
         }
+        used_as_output[it->output_number] = true;
+    }
+
+    unsigned int first_transition = 0;
+    for (HfstState s = 0; s < state_count; ++s) {
+        bool final = frozen.is_final_state(s);
+        hfst_ol::Weight final_w = final ? frozen.get_final_weight(s) : 0.0;
         state_placeholders.push_back(hfst_ol::StatePlaceholder(
-                                         state_number,
-                                         t->is_final_state(state_number),
+                                         s,
+                                         final,
                                          first_transition,
                                          final_w));
-        ++first_transition; // there's a padding entry between states
-        for (HfstBasicTransitions::const_iterator tr_it
-                 = it->begin();
-             tr_it != it->end(); ++tr_it) {
-            ++first_transition;
-            // If we don't already have a symbol table, collect symbols
-            if (harmonizer == NULL) {
-                if (FdOperation::is_diacritic(tr_it->get_input_symbol()) ||
-                    hfst_ol::PmatchAlphabet::is_insertion(
-                        tr_it->get_input_symbol())) {
-                    flag_diacritics->insert(tr_it->get_input_symbol());
-                } else {
-                    input_symbols->insert(tr_it->get_input_symbol());
-                }
-                other_symbols->insert(tr_it->get_output_symbol());
-            }
-        }
-        ++state_number;
+        // there's a padding entry between states
+        first_transition += 1 + (unsigned int)frozen.get_transition_count(s);
     }
 
     std::map<std::string, SymbolNumber> string_symbol_map;
 
-    // Collect symbols if we need to
+    // Collect symbols if we need to. If we have been told to use a
+    // certain symbol table, there's no need to keep track of symbols here.
     if (harmonizer == NULL) {
+
+        StringSet input_symbols;
+        StringSet flag_diacritics;
+        StringSet other_symbols;
+        for (unsigned int n = 0; n < used_as_input.size(); ++n) {
+            if (!used_as_input[n]) {
+                continue;
+            }
+            const std::string & symbol = HfstFrozenTransducer::get_symbol(n);
+            if (FdOperation::is_diacritic(symbol) ||
+                hfst_ol::PmatchAlphabet::is_insertion(symbol)) {
+                flag_diacritics.insert(symbol);
+            } else {
+                input_symbols.insert(symbol);
+            }
+        }
+        for (unsigned int n = 0; n < used_as_output.size(); ++n) {
+            if (used_as_output[n]) {
+                other_symbols.insert(HfstFrozenTransducer::get_symbol(n));
+            }
+        }
         
         // 1) epsilon
         string_symbol_map[internal_epsilon] = hfst::size_t_to_ushort(symbol_table.size());
         symbol_table.push_back(internal_epsilon);
         
         // 2) input symbols
-        for (std::set<std::string>::iterator it = input_symbols->begin();
-             it != input_symbols->end(); ++it) {
+        for (std::set<std::string>::iterator it = input_symbols.begin();
+             it != input_symbols.end(); ++it) {
             if (!is_epsilon(*it)) {
                 string_symbol_map[*it] = hfst::size_t_to_ushort(symbol_table.size());
                 symbol_table.push_back(*it);
@@ -223,8 +245,8 @@ void get_states_and_symbols(
         }
         
         // 3) Flag diacritics
-        for (std::set<std::string>::iterator it = flag_diacritics->begin();
-             it != flag_diacritics->end(); ++it) {
+        for (std::set<std::string>::iterator it = flag_diacritics.begin();
+             it != flag_diacritics.end(); ++it) {
             if (!is_epsilon(*it)) {
                 string_symbol_map[*it] = hfst::size_t_to_ushort(symbol_table.size());
                 // TODO: cl.exe: conversion from 'size_t' to 'char16_t'
@@ -236,10 +258,10 @@ void get_states_and_symbols(
         }
         
         // 4) non-input symbols
-        for (std::set<std::string>::iterator it = other_symbols->begin();
-             it != other_symbols->end(); ++it) {
-            if (!is_epsilon(*it) && input_symbols->count(*it) == 0 &&
-              flag_diacritics->count(*it) == 0) {
+        for (std::set<std::string>::iterator it = other_symbols.begin();
+             it != other_symbols.end(); ++it) {
+            if (!is_epsilon(*it) && input_symbols.count(*it) == 0 &&
+              flag_diacritics.count(*it) == 0) {
                 string_symbol_map[*it] = hfst::size_t_to_ushort(symbol_table.size());
                 symbol_table.push_back(*it);
             }
@@ -256,46 +278,70 @@ void get_states_and_symbols(
             }
         }
     }
-    delete input_symbols;
-    delete flag_diacritics;
-    delete other_symbols;
+
+    // The optimized-lookup number of each symbol number in use
+    std::vector<SymbolNumber> symbol_numbers
+        (std::max(used_as_input.size(), used_as_output.size()), 0);
+    for (unsigned int n = 0; n < symbol_numbers.size(); ++n) {
+        if ((n < used_as_input.size() && used_as_input[n]) ||
+            (n < used_as_output.size() && used_as_output[n])) {
+            symbol_numbers[n] =
+                string_symbol_map[HfstFrozenTransducer::get_symbol(n)];
+        }
+    }
 
     // Do a second pass over the transitions, figuring out everything
     // about the states except starting indices
 
-    state_number = 0;
-    for (HfstBasicTransducer::const_iterator it = t->begin();
-         it != t->end(); ++it) {
-        for (HfstBasicTransitions::const_iterator tr_it
-               = it->begin();
-             tr_it != it->end(); ++tr_it) {
+    for (HfstState s = 0; s < state_count; ++s) {
+        for (const HfstFrozenTransition * tr_it = frozen.transitions_begin(s);
+             tr_it != frozen.transitions_end(s); ++tr_it) {
+            SymbolNumber input = symbol_numbers[tr_it->input_number];
             // add input in case we're seeing it the first time
-            state_placeholders[state_number].add_input(
-                string_symbol_map[tr_it->get_input_symbol()],
-                flag_symbols);
-            unsigned int target = tr_it->get_target_state();
+            state_placeholders[s].add_input(input, flag_symbols);
             hfst_ol::TransitionPlaceholder trans(
-                target,
-                string_symbol_map[tr_it->get_input_symbol()],
-                string_symbol_map[tr_it->get_output_symbol()],
-                tr_it->get_weight());
-            //SymbolNumber input_sym = string_symbol_map[tr_it->get_input_symbol()];
-            state_placeholders[state_number].add_transition(trans);
+                tr_it->target,
+                input,
+                symbol_numbers[tr_it->output_number],
+                tr_it->weight);
+            state_placeholders[s].add_transition(trans);
+        }
+    }
+}
+
+/* Whether the space or comma separated list \a options has \a option. */
+static bool has_conversion_option(const std::string & options,
+                                  const std::string & option)
+{
+    std::string opts(options);
+    std::replace(opts.begin(), opts.end(), ',', ' ');
+    std::istringstream words(opts);
+    std::string word;
+    while (words >> word) {
+        if (word == option) {
+            return true;
         }
-        ++state_number;
     }
+    return false;
 }
 
   /* Create an hfst_ol::Transducer equivalent to HfstBasicTransducer \a t.
-     \a weighted defined whether the created transducer is weighted. */
+     \a weighted defined whether the created transducer is weighted.
+     \a options may contain "quick", to pack the index table faster but
+     less densely, and "statistics", to print the packing time and the
+     fill rate of the index table to standard error. */
   hfst_ol::Transducer * ConversionFunctions::
   hfst_basic_transducer_to_hfst_ol
   (const HfstBasicTransducer * t, bool weighted, std::string options,
    HfstTransducer * harmonizer)
   {
-      const float packing_aggression = (float)0.85; // double -> const float
-      const int floor_jump_threshold = 4; // a packing aggression parameter
-      //bool quick = options == "quick";
+      bool quick = has_conversion_option(options, "quick");
+      bool statistics = has_conversion_option(options, "statistics");
+      // When packing quickly, the search for free indices starts further
+      // along: fewer slots are considered full enough to skip, and the
+      // search floor jumps ahead as soon as it gets stuck
+      const float packing_aggression = quick ? (float)0.5 : (float)0.85;
+      const int floor_jump_threshold = quick ? 0 : 4; // a packing aggression parameter
       // The transition array is indexed starting from this constant
       const unsigned int TA_OFFSET = 2147483648u;
 
@@ -337,6 +383,9 @@ void get_states_and_symbols(
     // The starting state is special because it will have a TIA entry even if
     // it's simple, so we deal with it every time.
 
+    std::chrono::steady_clock::time_point packing_start =
+        std::chrono::steady_clock::now();
+    unsigned int packed_states = 0;
     unsigned int first_available_index = 0;
     unsigned int previous_first_index = 0;
     unsigned int previous_successful_index = 0;
@@ -347,12 +396,11 @@ void get_states_and_symbols(
         if (it->is_simple()) {
             continue;
         }
-        unsigned int i = first_available_index;
-
-        // While this index is not suitable for a starting index, keep looking
-        while (!used_indices->fits(*it, flag_symbols, i)) {
-            ++i;
-        }
+        ++packed_states;
+        // Find the first index from here on that is suitable for a
+        // starting index
+        unsigned int i = used_indices->find_fit(*it, flag_symbols,
+                                                first_available_index);
         it->start_index = i;
         previous_successful_index = i;
         // Once we've found a starting index, insert a finality marker and
@@ -401,6 +449,20 @@ void get_states_and_symbols(
         greatest_index = hfst::size_t_to_uint(used_indices->indices.size() - 1);
     }
 
+    if (statistics) {
+        double packing_time = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - packing_start).count();
+        size_t entries = used_indices->indices.size();
+        std::cerr << "Packed " << packed_states << " of "
+                  << state_placeholders.size() << " states into "
+                  << entries << " index entries in " << packing_time
+                  << " s" << std::endl
+                  << "Index entries used: " << used_indices->used_count
+                  << " (" << (entries == 0 ? 0.0 :
+                              100.0 * used_indices->used_count / entries)
+                  << "%)" << std::endl;
+    }
+
     for(unsigned int i = 0; i <= greatest_index; ++i) {
         if (!used_indices->used(i)) { // blank entries
             windex_table.append(hfst_ol::TransitionWIndex());
@@ -459,7 +521,7 @@ HfstTransducer * ConversionFunctions::hfst_ol_to_hfst_transducer(
     hfst::ImplementationType type = t->is_weighted() ? HFST_OLW_TYPE : HFST_OL_TYPE;
     HfstTransducer * retval = new HfstTransducer(type);
     delete retval->implementation.hfst_ol;
-    retval->implementation.hfst_ol = new hfst_ol::Transducer(*t);
+    retval->implementation.hfst_ol = t->copy(t, t->is_weighted());
     return retval;
 }
 
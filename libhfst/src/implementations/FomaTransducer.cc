@@ -162,6 +162,12 @@ namespace hfst { namespace implementations {
     fgetc(input_file);
     }
 
+  void FomaInputStream::seek(long offset)
+  {
+    if (fseek(input_file, offset, SEEK_SET) != 0)
+      { HFST_THROW(StreamNotReadableException); }
+  }
+
   fsm * FomaInputStream::read_transducer()
   {
     if (is_eof())
@@ -202,6 +208,11 @@ namespace hfst { namespace implementations {
   {
     fputc(c,ofile);
   }
+
+  long FomaOutputStream::tell(void)
+  {
+    return ftell(ofile);
+  }
     
     void FomaOutputStream::write_transducer(fsm * transducer)
   {
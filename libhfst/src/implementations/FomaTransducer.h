@@ -52,6 +52,7 @@ namespace hfst {
     bool is_good(void);
     bool is_fst(void);
     void ignore(unsigned int);
+    void seek(long offset);
     fsm * read_transducer();
 
     char stream_get();
@@ -72,6 +73,7 @@ namespace hfst {
     FomaOutputStream(const std::string &filename);
     void close(void);
     void write(const char &c);
+    long tell(void);
     void write_transducer(fsm * transducer);
   };
 
@@ -1120,6 +1120,7 @@
      
      friend class ConversionFunctions;
      friend class hfst::HarmonizeUnknownAndIdentitySymbols;
+     friend class HfstFrozenTransducer;
      };
      
    }
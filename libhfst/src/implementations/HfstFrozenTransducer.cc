@@ -0,0 +1,267 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+
+#include "HfstFrozenTransducer.h"
+
+#include <limits>
+
+#ifndef MAIN_TEST
+
+namespace hfst {
+
+  namespace implementations {
+
+    static const HfstTropicalTransducerTransitionData::WeightType
+    NOT_FINAL = std::numeric_limits<float>::infinity();
+
+    HfstFrozenTransducer::HfstFrozenTransducer():
+      offsets(2, 0), final_weights(1, NOT_FINAL), name("")
+    {
+      alphabet.insert(hfst::internal_epsilon);
+      alphabet.insert(hfst::internal_unknown);
+      alphabet.insert(hfst::internal_identity);
+    }
+
+    HfstFrozenTransducer::HfstFrozenTransducer
+    (const HfstBasicTransducer &graph):
+      alphabet(graph.alphabet), name(graph.name)
+    {
+      const HfstBasicStates &states = graph.state_vector;
+
+      size_t transition_count = 0;
+      for (HfstBasicStates::const_iterator it = states.begin();
+           it != states.end(); it++)
+        {
+          transition_count += it->size();
+        }
+
+      offsets.reserve(states.size() + 1);
+      arcs.reserve(transition_count);
+      offsets.push_back(0);
+      for (HfstBasicStates::const_iterator it = states.begin();
+           it != states.end(); it++)
+        {
+          for (HfstBasicTransitions::const_iterator tr_it = it->begin();
+               tr_it != it->end(); tr_it++)
+            {
+              HfstFrozenTransition arc;
+              arc.target = tr_it->get_target_state();
+              arc.input_number = tr_it->get_input_number();
+              arc.output_number = tr_it->get_output_number();
+              arc.weight = tr_it->get_weight();
+              arcs.push_back(arc);
+            }
+          offsets.push_back(arcs.size());
+        }
+
+      final_weights.assign(states.size(), NOT_FINAL);
+      for (HfstBasicTransducer::FinalWeightMap::const_iterator it
+             = graph.final_weight_map.begin();
+           it != graph.final_weight_map.end(); it++)
+        {
+          final_weights[it->first] = it->second;
+        }
+    }
+
+    HfstBasicTransducer HfstFrozenTransducer::thaw() const
+    {
+      HfstBasicTransducer graph;
+      HfstState state_count = get_state_count();
+
+      graph.state_vector.assign(state_count, HfstBasicTransitions());
+      for (HfstState s = 0; s < state_count; s++)
+        {
+          HfstBasicTransitions &transitions = graph.state_vector[s];
+          transitions.reserve(offsets[s+1] - offsets[s]);
+          for (size_t i = offsets[s]; i < offsets[s+1]; i++)
+            {
+              const HfstFrozenTransition &arc = arcs[i];
+              transitions.push_back
+                (HfstBasicTransition(arc.target, arc.input_number,
+                                     arc.output_number, arc.weight, false));
+            }
+          if (final_weights[s] != NOT_FINAL)
+            {
+              graph.final_weight_map[s] = final_weights[s];
+            }
+        }
+
+      graph.alphabet = alphabet;
+      graph.name = name;
+      return graph;
+    }
+
+    HfstState HfstFrozenTransducer::get_state_count() const
+    {
+      return (HfstState)final_weights.size();
+    }
+
+    size_t HfstFrozenTransducer::get_transition_count() const
+    {
+      return arcs.size();
+    }
+
+    bool HfstFrozenTransducer::is_final_state(HfstState s) const
+    {
+      return s < final_weights.size() && final_weights[s] != NOT_FINAL;
+    }
+
+    HfstFrozenTransducer::WeightType
+    HfstFrozenTransducer::get_final_weight(HfstState s) const
+    {
+      if (s >= final_weights.size())
+        HFST_THROW(StateIndexOutOfBoundsException);
+      if (final_weights[s] == NOT_FINAL)
+        HFST_THROW(StateIsNotFinalException);
+      return final_weights[s];
+    }
+
+    const std::vector<HfstFrozenTransducer::WeightType> &
+    HfstFrozenTransducer::get_final_weights() const
+    {
+      return final_weights;
+    }
+
+    const std::vector<size_t> & HfstFrozenTransducer::get_offsets() const
+    {
+      return offsets;
+    }
+
+    const HfstFrozenTransitions & HfstFrozenTransducer::get_transitions() const
+    {
+      return arcs;
+    }
+
+    const HfstFrozenTransducer::HfstAlphabet &
+    HfstFrozenTransducer::get_alphabet() const
+    {
+      return alphabet;
+    }
+
+    const std::string & HfstFrozenTransducer::get_symbol(unsigned int number)
+    {
+      return HfstTropicalTransducerTransitionData::get_symbol(number);
+    }
+
+    unsigned int HfstFrozenTransducer::get_number(const std::string &symbol)
+    {
+      return HfstTropicalTransducerTransitionData::get_number(symbol);
+    }
+
+    HfstFrozenTransducer & HfstFrozenTransducer::substitute_numbers
+    (const std::vector<unsigned int> &substitutions)
+    {
+      const size_t size = substitutions.size();
+      for (HfstFrozenTransitions::iterator it = arcs.begin();
+           it != arcs.end(); it++)
+        {
+          if (it->input_number < size)
+            it->input_number = substitutions[it->input_number];
+          if (it->output_number < size)
+            it->output_number = substitutions[it->output_number];
+        }
+
+      // As in HfstBasicTransducer::substitute, symbols that are
+      // substituted stay in the alphabet and their targets are added.
+      HfstAlphabet added;
+      for (HfstAlphabet::const_iterator it = alphabet.begin();
+           it != alphabet.end(); it++)
+        {
+          unsigned int number = get_number(*it);
+          if (number < size && substitutions[number] != number)
+            added.insert(get_symbol(substitutions[number]));
+        }
+      alphabet.insert(added.begin(), added.end());
+      return *this;
+    }
+
+    HfstFrozenTransducer & HfstFrozenTransducer::substitute_symbols
+    (const HfstSymbolSubstitutions &substitutions)
+    {
+      // Translate the string map into a dense number map once so that
+      // the pass over the transitions is plain indexing.
+      std::vector<unsigned int> numbers;
+      for (HfstSymbolSubstitutions::const_iterator it = substitutions.begin();
+           it != substitutions.end(); it++)
+        {
+          unsigned int from = get_number(it->first);
+          unsigned int to = get_number(it->second);
+          if (from >= numbers.size())
+            {
+              size_t old_size = numbers.size();
+              numbers.resize(from + 1);
+              for (size_t i = old_size; i < numbers.size(); i++)
+                numbers[i] = (unsigned int)i;
+            }
+          numbers[from] = to;
+        }
+      return substitute_numbers(numbers);
+    }
+
+  }
+
+}
+
+#else // MAIN_TEST was defined
+
+#include <cassert>
+#include <iostream>
+
+int main(int argc, char * argv[])
+{
+  using namespace hfst::implementations;
+  std::cout << "Unit tests for " __FILE__ ":" << std::endl;
+
+  HfstBasicTransducer basic;
+  basic.add_transition(0, HfstBasicTransition(1, "a", "b", 0.5));
+  basic.add_transition(0, HfstBasicTransition(2, "c", "c", 0.25));
+  basic.add_transition(1, HfstBasicTransition(2, "a", "a", 0));
+  basic.set_final_weight(2, 1.5);
+
+  HfstFrozenTransducer frozen(basic);
+  assert(frozen.get_state_count() == 3);
+  assert(frozen.get_transition_count() == 3);
+  assert(frozen.get_transition_count(0) == 2);
+  assert(frozen.get_transition_count(2) == 0);
+  assert(!frozen.is_final_state(0));
+  assert(frozen.is_final_state(2));
+  assert(frozen.get_final_weight(2) == 1.5);
+  assert(frozen.get_symbol(frozen.transitions_begin(0)->output_number) == "b");
+
+  size_t visited = 0;
+  float weight_sum = 0;
+  for (HfstState s = 0; s < frozen.get_state_count(); s++)
+    {
+      for (const HfstFrozenTransition * it = frozen.transitions_begin(s);
+           it != frozen.transitions_end(s); it++)
+        {
+          visited++;
+          weight_sum += it->weight;
+        }
+    }
+  assert(visited == 3);
+  assert(weight_sum == 0.75);
+
+  hfst::HfstSymbolSubstitutions subst;
+  subst["a"] = "d";
+  frozen.substitute_symbols(subst);
+  assert(frozen.get_alphabet().find("d") != frozen.get_alphabet().end());
+
+  HfstBasicTransducer thawed = frozen.thaw();
+  basic.substitute_symbols(subst);
+  assert(thawed.get_max_state() == basic.get_max_state());
+  assert(thawed.is_final_state(2) && thawed.get_final_weight(2) == 1.5);
+  assert(thawed.transitions(1)[0].get_input_symbol() == "d");
+  assert(thawed.get_alphabet() == basic.get_alphabet());
+
+  std::cout << "ok" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+#endif // MAIN_TEST
@@ -0,0 +1,181 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+
+#ifndef _HFST_FROZEN_TRANSDUCER_H_
+#define _HFST_FROZEN_TRANSDUCER_H_
+
+/** @file HfstFrozenTransducer.h
+    @brief Class HfstFrozenTransducer, a read-only flat copy of
+    an HfstBasicTransducer */
+
+#include "HfstBasicTransducer.h"
+#include "../hfstdll.h"
+
+#include <vector>
+#include <string>
+
+namespace hfst {
+
+  namespace implementations {
+
+    /** @brief A transition of an HfstFrozenTransducer.
+
+        Symbols are stored as the numbers used by
+        HfstTropicalTransducerTransitionData, so comparing two
+        transitions never touches the global symbol tables. */
+    struct HfstFrozenTransition
+    {
+      HfstState target;
+      unsigned int input_number;
+      unsigned int output_number;
+      HfstTropicalTransducerTransitionData::WeightType weight;
+    };
+
+    /** @brief A vector of frozen transitions. */
+    typedef std::vector<HfstFrozenTransition> HfstFrozenTransitions;
+
+    /** @brief A read-only transducer in compressed sparse row form.
+
+        All transitions of the graph are kept in one contiguous array,
+        ordered by source state, and an offset array of
+        get_state_count()+1 entries tells where the transitions of each
+        state begin. Final weights are kept in a dense vector indexed by
+        state, with infinity marking non-final states.
+
+        A frozen transducer is built from an HfstBasicTransducer and can
+        be turned back into one with #thaw. It is meant for passes that
+        visit the whole graph, where walking the nested transition
+        vectors and looking final weights up in a map dominate:
+
+\verbatim
+      HfstFrozenTransducer frozen(basic);
+      for (HfstState s = 0; s < frozen.get_state_count(); s++)
+        {
+          for (const HfstFrozenTransition * it = frozen.transitions_begin(s);
+               it != frozen.transitions_end(s); it++)
+            {
+              std::cerr << s << "\t" << it->target << "\t"
+                        << frozen.get_symbol(it->input_number) << std::endl;
+            }
+        }
+\endverbatim
+
+        @see HfstBasicTransducer */
+    class HfstFrozenTransducer
+    {
+    public:
+      /** @brief Datatype for the alphabet of a frozen transducer. */
+      typedef HfstBasicTransducer::HfstAlphabet HfstAlphabet;
+      /** @brief Datatype for a weight. */
+      typedef HfstTropicalTransducerTransitionData::WeightType WeightType;
+
+    protected:
+      /* offsets[s] is the index of the first transition of state s in
+         arcs, offsets[s+1] the index one past its last transition. */
+      std::vector<size_t> offsets;
+      /* The transitions of all states. */
+      HfstFrozenTransitions arcs;
+      /* The final weight of each state, infinity if it is not final. */
+      std::vector<WeightType> final_weights;
+      /* The alphabet of the transducer. */
+      HfstAlphabet alphabet;
+
+    public:
+      /** @brief The name of the transducer. */
+      std::string name;
+
+      /** @brief Create a frozen transducer with one non-final state
+          and no transitions. */
+      HFSTDLL HfstFrozenTransducer();
+
+      /** @brief Freeze \a graph into a flat representation. */
+      HFSTDLL explicit HfstFrozenTransducer(const HfstBasicTransducer &graph);
+
+      /** @brief Create an HfstBasicTransducer equivalent to this
+          transducer. */
+      HFSTDLL HfstBasicTransducer thaw() const;
+
+      /** @brief The number of states. */
+      HFSTDLL HfstState get_state_count() const;
+
+      /** @brief The total number of transitions. */
+      HFSTDLL size_t get_transition_count() const;
+
+      /** @brief Whether state \a s is final. */
+      HFSTDLL bool is_final_state(HfstState s) const;
+
+      /** @brief The final weight of state \a s.
+          @throws StateIndexOutOfBoundsException
+          @throws StateIsNotFinalException */
+      HFSTDLL WeightType get_final_weight(HfstState s) const;
+
+      /** @brief The final weights of all states, indexed by state.
+          Non-final states have an infinite weight. */
+      HFSTDLL const std::vector<WeightType> &get_final_weights() const;
+
+      /** @brief The offset array, get_state_count()+1 entries. */
+      HFSTDLL const std::vector<size_t> &get_offsets() const;
+
+      /** @brief All transitions, ordered by source state. */
+      HFSTDLL const HfstFrozenTransitions &get_transitions() const;
+
+      /** @brief A pointer to the first transition of state \a s. */
+      const HfstFrozenTransition * transitions_begin(HfstState s) const
+      { return arcs.empty() ? NULL : &arcs[0] + offsets[s]; }
+
+      /** @brief A pointer one past the last transition of state \a s. */
+      const HfstFrozenTransition * transitions_end(HfstState s) const
+      { return arcs.empty() ? NULL : &arcs[0] + offsets[s+1]; }
+
+      /** @brief The number of transitions leaving state \a s. */
+      size_t get_transition_count(HfstState s) const
+      { return offsets[s+1] - offsets[s]; }
+
+      /** @brief Call \a f(source, transition) for every transition,
+          in order of source state. */
+      template<class F> void for_each_transition(F f) const
+      {
+        for (HfstState s = 0; s + 1 < offsets.size(); s++)
+          {
+            for (size_t i = offsets[s]; i < offsets[s+1]; i++)
+              {
+                f(s, arcs[i]);
+              }
+          }
+      }
+
+      /** @brief The alphabet of the transducer. */
+      HFSTDLL const HfstAlphabet &get_alphabet() const;
+
+      /** @brief The symbol that \a number stands for. */
+      HFSTDLL static const std::string &get_symbol(unsigned int number);
+
+      /** @brief The number that stands for \a symbol. */
+      HFSTDLL static unsigned int get_number(const std::string &symbol);
+
+      /** @brief Replace every symbol number n in the transitions with
+          \a substitutions[n].
+
+          Numbers at or beyond the end of \a substitutions are left as
+          they are. The symbols that are substituted for are added to the
+          alphabet. */
+      HFSTDLL HfstFrozenTransducer &substitute_numbers
+        (const std::vector<unsigned int> &substitutions);
+
+      /** @brief Substitute symbols as defined in \a substitutions,
+          in a single pass over the transition array. */
+      HFSTDLL HfstFrozenTransducer &substitute_symbols
+        (const HfstSymbolSubstitutions &substitutions);
+    };
+
+  }
+
+}
+
+#endif // #ifndef _HFST_FROZEN_TRANSDUCER_H_
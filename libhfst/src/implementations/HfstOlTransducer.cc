@@ -14,18 +14,18 @@
 namespace hfst { namespace implementations
 {
   HfstOlInputStream::HfstOlInputStream(bool weighted):
-    i_stream(),input_stream(std::cin), weighted(weighted)
+    i_stream(),input_stream(std::cin), weighted(weighted), mmap_tables(false)
   {}
   HfstOlInputStream::HfstOlInputStream
   (const std::string &filename, bool weighted):
     filename(std::string(filename)),
     i_stream(filename.c_str(), std::ios::in | std::ios::binary),
-    input_stream(i_stream),weighted(weighted)
+    input_stream(i_stream),weighted(weighted), mmap_tables(false)
   {}
 
   HfstOlInputStream::HfstOlInputStream
   (std::istream &is, bool weighted):
-    input_stream(is),weighted(weighted)
+    input_stream(is),weighted(weighted), mmap_tables(false)
   {}
 
   /* Skip the identifier string "HFST_OL_TYPE" or "HFST_OLW_TYPE" */
@@ -153,6 +153,14 @@ void HfstOlInputStream::ignore(unsigned int n)
     input_stream.ignore(n);
 }
 
+void HfstOlInputStream::seek(long offset)
+{
+    input_stream.clear();
+    input_stream.seekg(offset);
+    if (input_stream.fail())
+      { HFST_THROW(StreamNotReadableException); }
+}
+
   bool HfstOlInputStream::operator() (void) const
   { return is_good(); }
 
@@ -166,7 +174,11 @@ void HfstOlInputStream::ignore(unsigned int n)
       if (has_header)
         skip_hfst_header();
 
-      hfst_ol::Transducer* t = new hfst_ol::Transducer(input_stream);
+      hfst_ol::Transducer* t;
+      if (mmap_tables && filename != string())
+        { t = new hfst_ol::Transducer(input_stream, filename); }
+      else
+        { t = new hfst_ol::Transducer(input_stream); }
       //t->display();
       return t;
     }
@@ -176,6 +188,10 @@ void HfstOlInputStream::ignore(unsigned int n)
   }
   
   
+  void HfstOlInputStream::set_mmap_tables(bool value)
+  { mmap_tables = value; }
+  
+  
   HfstOlOutputStream::HfstOlOutputStream(bool weighted):
     filename(std::string()), output_stream(std::cout), weighted(weighted)
   {}
@@ -207,6 +223,11 @@ void HfstOlInputStream::ignore(unsigned int n)
     output_stream.put(char(c));
   }
 
+  long HfstOlOutputStream::tell(void)
+  {
+    return (long)output_stream.tellp();
+  }
+
  
   hfst_ol::Transducer * HfstOlTransducer::create_empty_transducer(bool weighted)
   { return new hfst_ol::Transducer(weighted); }
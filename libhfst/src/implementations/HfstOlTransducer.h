@@ -37,6 +37,7 @@ namespace hfst { namespace implementations
     ifstream i_stream;
     istream &input_stream;
     bool weighted;
+    bool mmap_tables;
     void skip_identifier_version_3_0(void);
     void skip_hfst_header(void);
   public:
@@ -55,9 +56,11 @@ namespace hfst { namespace implementations
     short stream_get_short();
     void stream_unget(char c);
     void ignore(unsigned int n);
+    void seek(long offset);
     
     bool operator() (void) const;
     hfst_ol::Transducer * read_transducer(bool has_header);
+    void set_mmap_tables(bool value);
     
     // 1=unweighted, 2=weighted
     static int is_fst(FILE * f);
@@ -77,6 +80,7 @@ namespace hfst { namespace implementations
     void open(void);
     void close(void);
     void write(const char &c);
+    long tell(void);
     void write_transducer(hfst_ol::Transducer * transducer);
   };
   
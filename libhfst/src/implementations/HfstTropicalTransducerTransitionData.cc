@@ -15,6 +15,10 @@
 #include <cstdio>
 #include <iostream>
 #include <vector>
+#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <functional>
 #include "../HfstExceptionDefs.h"
 
 #include "../hfstdll.h"
@@ -38,18 +42,176 @@ namespace hfst {
         return SymbolType("@_IDENTITY_SYMBOL_@");
       }
 
-    HfstTropicalTransducerTransitionData::Number2SymbolVector
-    HfstTropicalTransducerTransitionData::number2symbol_map;
-    Number2SymbolVectorInitializer
-    dummy1(HfstTropicalTransducerTransitionData::number2symbol_map);
-    HfstTropicalTransducerTransitionData::Symbol2NumberMap
-    HfstTropicalTransducerTransitionData::symbol2number_map;
-    Symbol2NumberMapInitializer
-    dummy2(HfstTropicalTransducerTransitionData::symbol2number_map);
-    unsigned int HfstTropicalTransducerTransitionData::max_number=2;
+    /* The symbol table shared by all HfstTropicalTransducerTransitionData.
+
+       Symbols live in fixed-size chunks that are never moved or freed, so
+       a string, once published, can be read without locking. The mapping
+       from strings to numbers is an open-addressing hash table whose slots
+       are written only under insert_mutex. When the table is grown, a new
+       one is filled and published; the old one is kept, since readers may
+       still be probing it, and a reader that misses there falls back to
+       the locked path. */
+    class SymbolInterner
+    {
+    public:
+      static const unsigned int NO_NUMBER = (unsigned int)-1;
+
+      SymbolInterner():
+        symbol_count(0), table(NULL)
+      {
+        for (size_t i = 0; i < MAX_CHUNKS; i++)
+          chunks[i].store(NULL, std::memory_order_relaxed);
+        table.store(new Table(INITIAL_TABLE_SIZE), std::memory_order_release);
+        intern(HfstTropicalTransducerTransitionData::get_epsilon());
+        intern(HfstTropicalTransducerTransitionData::get_unknown());
+        intern(HfstTropicalTransducerTransitionData::get_identity());
+      }
+
+      ~SymbolInterner()
+      {
+        delete table.load();
+        for (std::vector<Table*>::iterator it = retired_tables.begin();
+             it != retired_tables.end(); it++)
+          delete *it;
+        for (size_t i = 0; i < MAX_CHUNKS; i++)
+          delete[] chunks[i].load();
+      }
+
+      /* The number of \a symbol, interning it if needed. */
+      unsigned int intern(const std::string &symbol)
+      {
+        size_t h = hash(symbol);
+        unsigned int number
+          = find_in(*table.load(std::memory_order_acquire), symbol, h);
+        if (number != NO_NUMBER)
+          return number;
+
+        std::lock_guard<std::mutex> lock(insert_mutex);
+        Table * current = table.load(std::memory_order_relaxed);
+        number = find_in(*current, symbol, h);
+        if (number != NO_NUMBER)
+          return number;
+
+        number = symbol_count.load(std::memory_order_relaxed);
+        if ((size_t)number >= MAX_CHUNKS * CHUNK_SIZE)
+          HFST_THROW_MESSAGE(HfstFatalException,
+                             "HfstTropicalTransducerTransitionData: "
+                             "too many symbols");
+        std::string * chunk
+          = chunks[number / CHUNK_SIZE].load(std::memory_order_relaxed);
+        if (chunk == NULL)
+          {
+            chunk = new std::string[CHUNK_SIZE];
+            chunks[number / CHUNK_SIZE].store(chunk, std::memory_order_release);
+          }
+        chunk[number % CHUNK_SIZE] = symbol;
+
+        if (2 * (number + 1) > current->size)
+          {
+            current = grow(*current);
+          }
+        insert_in(*current, number, h);
+        symbol_count.store(number + 1, std::memory_order_release);
+        return number;
+      }
+
+      /* The symbol of \a number, or NULL if \a number is not in use. */
+      const std::string * symbol(unsigned int number) const
+      {
+        if (number >= symbol_count.load(std::memory_order_acquire))
+          return NULL;
+        return symbol_at(number);
+      }
+
+      unsigned int size() const
+      {
+        return symbol_count.load(std::memory_order_acquire);
+      }
+
+    private:
+      static const size_t CHUNK_SIZE = 4096;
+      static const size_t MAX_CHUNKS = 16384;
+      static const size_t INITIAL_TABLE_SIZE = 1024;
+
+      /* Slots hold number+1, zero marks an empty slot. */
+      struct Table
+      {
+        size_t size;
+        std::atomic<unsigned int> * slots;
+
+        Table(size_t s): size(s), slots(new std::atomic<unsigned int>[s])
+        {
+          for (size_t i = 0; i < size; i++)
+            slots[i].store(0, std::memory_order_relaxed);
+        }
+        ~Table() { delete[] slots; }
+      };
+
+      std::atomic<std::string*> chunks[MAX_CHUNKS];
+      std::atomic<unsigned int> symbol_count;
+      std::atomic<Table*> table;
+      std::vector<Table*> retired_tables;
+      std::mutex insert_mutex;
+
+      static size_t hash(const std::string &symbol)
+      {
+        return std::hash<std::string>()(symbol);
+      }
+
+      const std::string * symbol_at(unsigned int number) const
+      {
+        return chunks[number / CHUNK_SIZE].load(std::memory_order_acquire)
+          + number % CHUNK_SIZE;
+      }
+
+      unsigned int find_in(const Table &t, const std::string &symbol,
+                           size_t h) const
+      {
+        for (size_t i = h & (t.size - 1); ; i = (i + 1) & (t.size - 1))
+          {
+            unsigned int slot = t.slots[i].load(std::memory_order_acquire);
+            if (slot == 0)
+              return NO_NUMBER;
+            if (*symbol_at(slot - 1) == symbol)
+              return slot - 1;
+          }
+      }
+
+      /* Called with insert_mutex held. */
+      void insert_in(Table &t, unsigned int number, size_t h)
+      {
+        size_t i = h & (t.size - 1);
+        while (t.slots[i].load(std::memory_order_relaxed) != 0)
+          i = (i + 1) & (t.size - 1);
+        t.slots[i].store(number + 1, std::memory_order_release);
+      }
+
+      /* Called with insert_mutex held. */
+      Table * grow(Table &old)
+      {
+        Table * bigger = new Table(old.size * 2);
+        for (size_t i = 0; i < old.size; i++)
+          {
+            unsigned int slot = old.slots[i].load(std::memory_order_relaxed);
+            if (slot != 0)
+              insert_in(*bigger, slot - 1, hash(*symbol_at(slot - 1)));
+          }
+        table.store(bigger, std::memory_order_release);
+        retired_tables.push_back(&old);
+        return bigger;
+      }
+    };
+
+    /* Constructed on first use, so that symbols can be interned from
+       the constructors of other static objects. */
+    static SymbolInterner & symbol_interner()
+    {
+      static SymbolInterner interner;
+      return interner;
+    }
 
     unsigned int HfstTropicalTransducerTransitionData::get_max_number() {
-      return max_number;
+      return symbol_interner().size() - 1;
     }
 
     std::vector<unsigned int> HfstTropicalTransducerTransitionData::get_harmonization_vector
@@ -70,6 +232,7 @@ namespace hfst {
         (const std::map<HfstTropicalTransducerTransitionData::SymbolType, unsigned int> &symbols)
       {
         std::vector<unsigned int> harmv;
+        unsigned int max_number = get_max_number();
         harmv.reserve(max_number+1);
         harmv.resize(max_number+1, 0);
         for (unsigned int i=0; i<harmv.size(); i++)
@@ -84,7 +247,8 @@ namespace hfst {
 
       const std::string & HfstTropicalTransducerTransitionData::get_symbol(unsigned int number)
       {
-        if (number >= number2symbol_map.size()) {
+        const std::string * symbol = symbol_interner().symbol(number);
+        if (symbol == NULL) {
           std::string message("HfstTropicalTransducerTransitionData: "
                               "number ");
           std::ostringstream oss;
@@ -94,33 +258,18 @@ namespace hfst {
           HFST_THROW_MESSAGE
             (HfstFatalException, message);
         }
-        return number2symbol_map[number];
+        return *symbol;
       }
 
       unsigned int HfstTropicalTransducerTransitionData::get_number(const std::string &symbol)
       {
         if(symbol == "") { // FAIL
-          Symbol2NumberMap::iterator it = symbol2number_map.find(symbol);
-          if (it == symbol2number_map.end()) {
-            std::cerr << "ERROR: No number for the empty symbol\n"
-                      << std::endl;
-          }
-          else {
-            std::cerr << "ERROR: The empty symbol corresdponds to number "
-                      << it->second << std::endl;
-          }
+          std::cerr << "ERROR: No number for the empty symbol\n"
+                    << std::endl;
           assert(false);
         }
 
-        Symbol2NumberMap::iterator it = symbol2number_map.find(symbol);
-        if (it == symbol2number_map.end())
-          {
-            max_number++;
-            symbol2number_map[symbol] = max_number;
-            number2symbol_map.push_back(symbol);
-            return max_number;
-          }
-        return it->second;
+        return symbol_interner().intern(symbol);
       }
 
 
@@ -249,20 +398,6 @@ namespace hfst {
       weight = another.weight;
     }
 
-    Number2SymbolVectorInitializer::Number2SymbolVectorInitializer
-    (HfstTropicalTransducerTransitionData::Number2SymbolVector &vect) {
-      vect.push_back(std::string("@_EPSILON_SYMBOL_@"));
-      vect.push_back(std::string("@_UNKNOWN_SYMBOL_@"));
-      vect.push_back(std::string("@_IDENTITY_SYMBOL_@"));
-    }
-
-    Symbol2NumberMapInitializer::Symbol2NumberMapInitializer
-    (HfstTropicalTransducerTransitionData::Symbol2NumberMap &map) {
-      map["@_EPSILON_SYMBOL_@"] = 0;
-      map["@_UNKNOWN_SYMBOL_@"] = 1;
-      map["@_IDENTITY_SYMBOL_@"] = 2;
-    }
-
   } // namespace implementations
 
 } // namespace hfst
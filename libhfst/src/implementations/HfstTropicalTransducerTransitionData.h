@@ -43,8 +43,8 @@ namespace hfst {
         \internal Actually a HfstTropicalTransducerTransitionData has an
         input and an output number of type unsigned int, but this
         implementation is hidden from the user.
-        The class has two static maps and functions that take care of conversion
-        between strings and internal numbers.
+        The class has a static symbol table and functions that take care of
+        conversion between strings and internal numbers.
         
         @see HfstTransition HfstBasicTransition */
     class HfstTropicalTransducerTransitionData {
@@ -65,13 +65,12 @@ namespace hfst {
       HFSTDLL static SymbolType get_unknown();
       HFSTDLL static SymbolType get_identity();
       
-    public: /* FIXME: Should be private. */
-      /* Maps that contain information of the mappings between strings
-         and numbers */
-      HFSTDLL static Number2SymbolVector number2symbol_map;
-      HFSTDLL static Symbol2NumberMap symbol2number_map;
-      /* The biggest number in use. */
-      HFSTDLL static unsigned int max_number;
+    public:
+      /* Symbols are interned in a table shared by all threads. Numbers
+         that are already known are looked up without locking, a new
+         symbol takes a lock while it is given the next free number.
+         A number, once given, is never reused or remapped, so the
+         reference returned by get_symbol stays valid. */
 
       /* Get the biggest number used to represent a symbol. */
       HFSTDLL static unsigned int get_max_number();
@@ -178,31 +177,16 @@ namespace hfst {
       HFSTDLL bool less_than_ignore_weight(const HfstTropicalTransducerTransitionData &another) const;
       HFSTDLL void operator=(const HfstTropicalTransducerTransitionData &another);
       
-      friend class Number2SymbolVectorInitializer;
-      friend class Symbol2NumberMapInitializer;
-
       friend class ComposeIntersectFst;
       friend class ComposeIntersectLexicon;
       friend class ComposeIntersectRule;
       friend class ComposeIntersectRulePair;
       friend class HfstBasicTransducer;
+      friend class HfstFrozenTransducer;
+      friend class TropicalWeightTransducer;
 
     };
 
-    // Initialization of static members in class
-    // HfstTropicalTransducerTransitionData..
-    class Number2SymbolVectorInitializer {
-    public:
-      HFSTDLL Number2SymbolVectorInitializer
-        (HfstTropicalTransducerTransitionData::Number2SymbolVector &vect);
-    };
-
-    class Symbol2NumberMapInitializer {
-    public:
-      HFSTDLL Symbol2NumberMapInitializer
-        (HfstTropicalTransducerTransitionData::Symbol2NumberMap &map);
-    };
-
   } // namespace implementations
 
 } // namespace hfst
@@ -122,6 +122,14 @@ namespace hfst { namespace implementations
   void LogWeightInputStream::ignore(unsigned int n)
   { input_stream.ignore(n); }
 
+  void LogWeightInputStream::seek(long offset)
+  {
+    input_stream.clear();
+    input_stream.seekg(offset);
+    if (input_stream.fail())
+      { HFST_THROW(StreamNotReadableException); }
+  }
+
   LogFst * LogWeightInputStream::read_transducer()
   {
     if (is_eof())
@@ -181,6 +189,11 @@ namespace hfst { namespace implementations
     output_stream.put(char(c));
   }
 
+  long LogWeightOutputStream::tell(void)
+  {
+    return (long)output_stream.tellp();
+  }
+
   void LogWeightOutputStream::write_transducer(LogFst * transducer)
   {
     if (!output_stream)
@@ -1268,6 +1281,32 @@ namespace hfst { namespace implementations
   LogWeightTransducer::copy(LogFst * t)
   { return new LogFst(*t); }
 
+  // A symbol table with the same symbols as table that doesn't share them.
+  static SymbolTable * copy_symbol_table(const SymbolTable * table)
+  {
+    if (table == NULL)
+      { return NULL; }
+    SymbolTable * retval = new SymbolTable(table->Name());
+    for (SymbolTableIterator it(*table); !it.Done(); it.Next())
+      { retval->AddSymbol(it.Symbol(), it.Value()); }
+    return retval;
+  }
+
+  LogFst *
+  LogWeightTransducer::deep_copy(LogFst * t)
+  {
+    // Converting from a generic Fst copies the states and arcs.
+    const Fst<LogArc> & fst = *t;
+    LogFst * retval = new LogFst(fst);
+    SymbolTable * isymbols = copy_symbol_table(t->InputSymbols());
+    SymbolTable * osymbols = copy_symbol_table(t->OutputSymbols());
+    retval->SetInputSymbols(isymbols);
+    retval->SetOutputSymbols(osymbols);
+    delete isymbols;
+    delete osymbols;
+    return retval;
+  }
+
 
   LogFst *
   LogWeightTransducer::determinize(LogFst * t)
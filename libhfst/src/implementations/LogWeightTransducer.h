@@ -98,6 +98,7 @@ namespace implementations
     bool is_fst(void) const;
     bool operator() (void) const;
     void ignore(unsigned int);
+    void seek(long offset);
     LogFst * read_transducer();
 
     char stream_get();
@@ -119,6 +120,7 @@ namespace implementations
     LogWeightOutputStream(const std::string &filename);
     void close(void);
     void write(const char &c);
+    long tell(void);
     void write_transducer(LogFst * transducer);
   };
 
@@ -150,6 +152,11 @@ namespace implementations
         (const std::vector<NumberPairSet> &npsv);
 
       static LogFst * copy(LogFst * t);
+      /* A copy of t that shares neither its states nor its symbol
+         tables with t. The reference counts through which copy shares
+         them are not thread-safe, so a transducer that another thread
+         will use must be copied with this. */
+      static LogFst * deep_copy(LogFst * t);
       static LogFst * determinize(LogFst * t);
       static LogFst * minimize(LogFst * t);
       static LogFst * remove_epsilons(LogFst * t);
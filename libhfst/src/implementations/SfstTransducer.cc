@@ -128,6 +128,12 @@ namespace hfst { namespace implementations {
         fgetc(input_file);
     }
 
+    void SfstInputStream::seek(long offset)
+    {
+      if (fseek(input_file, offset, SEEK_SET) != 0)
+        { HFST_THROW(StreamNotReadableException); }
+    }
+
     bool SfstInputStream::set_implementation_specific_header_data
     (StringPairVector &header_data, unsigned int index)
     {
@@ -223,6 +229,11 @@ namespace hfst { namespace implementations {
       fputc(c,ofile);
     }
 
+    long SfstOutputStream::tell(void)
+    {
+      return ftell(ofile);
+    }
+
     void SfstOutputStream::write_transducer(Transducer * transducer)
   {
     transducer->store(ofile);
@@ -53,6 +53,7 @@ namespace implementations
     bool is_good(void);
     bool is_fst(void);
     void ignore(unsigned int);
+    void seek(long offset);
 
     char stream_get();
     short stream_get_short();
@@ -76,6 +77,7 @@ namespace implementations
     SfstOutputStream(const std::string &filename);
     void close(void);
     void write(const char &c);
+    long tell(void);
     void append_implementation_specific_header_data
       (std::vector<char> &header, SFST::Transducer *t);
     void write_transducer(SFST::Transducer * transducer);
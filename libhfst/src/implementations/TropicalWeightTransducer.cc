@@ -1105,6 +1105,148 @@ namespace hfst {
   }
 
 
+  TropicalWeightTransducer::HarmonizationResult
+  TropicalWeightTransducer::harmonize_in_place
+  (StdVectorFst * t, const StringSet &alphabet, const StringSet &missing)
+  {
+    assert(t->InputSymbols() != NULL);
+    HarmonizationResult result = HARMONIZATION_UNCHANGED;
+
+    // The numbers that the symbols of t have in HfstBasicTransducer
+    StringVector symbol_vector = get_symbol_vector(t);
+    std::vector<unsigned int> harmonization_vector
+      = HfstTropicalTransducerTransitionData::get_harmonization_vector
+      (symbol_vector);
+    bool recode = false;
+    for (unsigned int i = 0; i < harmonization_vector.size(); i++)
+      {
+        if (symbol_vector[i] != "" && harmonization_vector[i] != i)
+          {
+            recode = true;
+            break;
+          }
+      }
+
+    // The symbol table is right if it has exactly the symbols in
+    // alphabet, numbered as in HfstBasicTransducer
+    bool table_ok = (! recode &&
+                     (size_t)t->InputSymbols()->NumSymbols() == alphabet.size());
+    for (StringSet::const_iterator it = alphabet.begin();
+         table_ok && it != alphabet.end(); it++)
+      {
+        if (t->InputSymbols()->Find(*it)
+            != (int64)HfstTropicalTransducerTransitionData::get_number(*it))
+          { table_ok = false; }
+      }
+
+    if (! table_ok)
+      {
+        SymbolTable st = create_symbol_table("");
+        for (StringSet::const_iterator it = alphabet.begin();
+             it != alphabet.end(); it++)
+          {
+            st.AddSymbol
+              (*it, HfstTropicalTransducerTransitionData::get_number(*it));
+          }
+        t->SetInputSymbols(&st);
+        t->SetOutputSymbols(NULL);
+        result = HARMONIZATION_RECODED;
+      }
+
+    std::vector<int64> missing_numbers;
+    for (StringSet::const_iterator it = missing.begin();
+         it != missing.end(); it++)
+      {
+        missing_numbers.push_back
+          (HfstTropicalTransducerTransitionData::get_number(*it));
+      }
+
+    if (! recode && missing_numbers.empty())
+      { return result; }
+
+    // As in HarmonizeUnknownAndIdentitySymbols, the arcs added for
+    // each unknown and identity arc go after the arcs of the state.
+    std::vector<StdArc> added_arcs;
+    for (fst::StateIterator<StdVectorFst> siter(*t);
+         ! siter.Done(); siter.Next())
+      {
+        StateId s = siter.Value();
+        added_arcs.clear();
+        for (fst::MutableArcIterator<StdVectorFst> aiter(t,s);
+             !aiter.Done(); aiter.Next())
+          {
+            StdArc arc = aiter.Value();
+            if (recode)
+              {
+                if (arc.ilabel >= (int64)harmonization_vector.size() ||
+                    arc.olabel >= (int64)harmonization_vector.size())
+                  {
+                    HFST_THROW_MESSAGE(HfstFatalException,
+                                       "symbol number not in symbol table");
+                  }
+                arc.ilabel = harmonization_vector[arc.ilabel];
+                arc.olabel = harmonization_vector[arc.olabel];
+                aiter.SetValue(arc);
+              }
+            if (missing_numbers.empty())
+              { continue; }
+
+            if (arc.ilabel == 2)  // identity "?:?"
+              {
+                for (size_t i = 0; i < missing_numbers.size(); i++)
+                  {
+                    added_arcs.push_back
+                      (StdArc(missing_numbers[i], missing_numbers[i],
+                              arc.weight, arc.nextstate));
+                  }
+                continue;
+              }
+            if (arc.ilabel == 1)  // "?:x"
+              {
+                for (size_t i = 0; i < missing_numbers.size(); i++)
+                  {
+                    added_arcs.push_back
+                      (StdArc(missing_numbers[i], arc.olabel,
+                              arc.weight, arc.nextstate));
+                  }
+              }
+            if (arc.olabel == 1)  // "x:?"
+              {
+                for (size_t i = 0; i < missing_numbers.size(); i++)
+                  {
+                    added_arcs.push_back
+                      (StdArc(arc.ilabel, missing_numbers[i],
+                              arc.weight, arc.nextstate));
+                  }
+              }
+            if (arc.ilabel == 1 && arc.olabel == 1)  // cross-product "?:?"
+              {
+                for (size_t i = 0; i < missing_numbers.size(); i++)
+                  {
+                    for (size_t j = 0; j < missing_numbers.size(); j++)
+                      {
+                        if (i == j)
+                          { continue; }
+                        added_arcs.push_back
+                          (StdArc(missing_numbers[j], missing_numbers[i],
+                                  arc.weight, arc.nextstate));
+                      }
+                  }
+              }
+          }
+        for (size_t i = 0; i < added_arcs.size(); i++)
+          {
+            t->AddArc(s, added_arcs[i]);
+          }
+        if (! added_arcs.empty())
+          { result = HARMONIZATION_EXPANDED; }
+      }
+
+    if (recode && result == HARMONIZATION_UNCHANGED)
+      { result = HARMONIZATION_RECODED; }
+    return result;
+  }
+
     /*  static StdVectorFst * copy_fst(const StdVectorFst * t)
   {
     StdVectorFst * result = new StdVectorFst();
@@ -1312,6 +1454,14 @@ namespace hfst {
   void TropicalWeightInputStream::ignore(unsigned int n)
   { input_stream.ignore(n); }
 
+  void TropicalWeightInputStream::seek(long offset)
+  {
+    input_stream.clear();
+    input_stream.seekg(offset);
+    if (input_stream.fail())
+      { HFST_THROW(StreamNotReadableException); }
+  }
+
   StdVectorFst * TropicalWeightInputStream::read_transducer()
   {
     if (is_eof())
@@ -1749,6 +1899,32 @@ namespace hfst {
   TropicalWeightTransducer::copy(StdVectorFst * t)
   { return new StdVectorFst(*t); }
 
+  // A symbol table with the same symbols as table that doesn't share them.
+  static SymbolTable * copy_symbol_table(const SymbolTable * table)
+  {
+    if (table == NULL)
+      { return NULL; }
+    SymbolTable * retval = new SymbolTable(table->Name());
+    for (SymbolTableIterator it(*table); !it.Done(); it.Next())
+      { retval->AddSymbol(it.Symbol(), it.Value()); }
+    return retval;
+  }
+
+  StdVectorFst *
+  TropicalWeightTransducer::deep_copy(StdVectorFst * t)
+  {
+    // Converting from a generic Fst copies the states and arcs.
+    const Fst<StdArc> & fst = *t;
+    StdVectorFst * retval = new StdVectorFst(fst);
+    SymbolTable * isymbols = copy_symbol_table(t->InputSymbols());
+    SymbolTable * osymbols = copy_symbol_table(t->OutputSymbols());
+    retval->SetInputSymbols(isymbols);
+    retval->SetOutputSymbols(osymbols);
+    delete isymbols;
+    delete osymbols;
+    return retval;
+  }
+
 
   StdVectorFst *
   TropicalWeightTransducer::determinize(StdVectorFst * t)
@@ -3104,6 +3280,11 @@ namespace hfst {
     output_stream.put(char(c));
   }
 
+  long TropicalWeightOutputStream::tell(void)
+  {
+    return (long)output_stream.tellp();
+  }
+
   void TropicalWeightOutputStream::write_transducer(StdVectorFst * transducer)
   {
     if (!output_stream)
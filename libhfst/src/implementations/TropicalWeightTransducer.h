@@ -98,6 +98,7 @@ namespace implementations
     bool is_fst(void) const;
     bool operator() (void) const;
     void ignore(unsigned int);
+    void seek(long offset);
     StdVectorFst * read_transducer();
 
     char stream_get();
@@ -121,6 +122,7 @@ namespace implementations
       (const std::string &filename, bool hfst_format=false);
     void close(void);
     void write(const char &c);
+    long tell(void);
     void write_transducer(StdVectorFst * transducer);
   };
 
@@ -154,6 +156,11 @@ namespace implementations
         (const std::vector<NumberPairSet> &npsv);
 
       static StdVectorFst * copy(StdVectorFst * t);
+      /* A copy of t that shares neither its states nor its symbol
+         tables with t. The reference counts through which copy shares
+         them are not thread-safe, so a transducer that another thread
+         will use must be copied with this. */
+      static StdVectorFst * deep_copy(StdVectorFst * t);
       static StdVectorFst * determinize(StdVectorFst * t);
       static StdVectorFst * minimize(StdVectorFst * t);
       static StdVectorFst * remove_epsilons(StdVectorFst * t);
@@ -285,6 +292,22 @@ namespace implementations
         (StdVectorFst * t, hfst::StringSet &unknown,
          bool unknown_symbols_in_use);
 
+      /* What harmonize_in_place had to do to a transducer. */
+      enum HarmonizationResult
+      {
+        HARMONIZATION_UNCHANGED, // symbol table and arcs were already right
+        HARMONIZATION_RECODED,   // symbol table or symbol numbers changed
+        HARMONIZATION_EXPANDED   // unknown and identity arcs were expanded
+      };
+
+      /* Harmonize \a t without converting it to HfstBasicTransducer:
+         make its symbol table hold \a alphabet with the symbol numbers
+         of HfstBasicTransducer, recode its arcs accordingly and expand
+         its unknown and identity arcs with the symbols in \a missing. */
+      static HarmonizationResult harmonize_in_place
+        (StdVectorFst * t, const hfst::StringSet &alphabet,
+         const hfst::StringSet &missing);
+
 #ifdef FOO
       static StdVectorFst * compose_intersect(StdVectorFst * t,
                                               Grammar * grammar);
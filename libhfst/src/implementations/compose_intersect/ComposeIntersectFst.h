@@ -57,7 +57,8 @@ namespace hfst
       std::ostream &print(std::ostream &) const;
 #endif
     protected:
-      typedef std::map<size_t,TransitionSet> SymbolTransitionMap;
+      typedef compose_intersect_utilities::SymbolIndex<TransitionSet>
+    SymbolTransitionMap;
       typedef std::vector<SymbolTransitionMap> TransitionMapVector;
       typedef std::vector<Transition> TransitionVector;
       typedef std::vector<float> FloatVector;
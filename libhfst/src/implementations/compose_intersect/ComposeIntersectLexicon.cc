@@ -51,7 +51,7 @@ namespace hfst
       // Sanity check...
       assert(s == state_pair_map.size());
 
-      state_pair_map[p] = s;
+      state_pair_map.insert(p,s);
       pair_vector.push_back(p);
       agenda.push(s);
       lexicon_non_epsilon_states.insert(s);
@@ -77,12 +77,13 @@ namespace hfst
     HfstState ComposeIntersectLexicon::get_state(const StatePair &p,
                                                  bool allow_lexicon_epsilons)
     {
-      if (state_pair_map.find(p) == state_pair_map.end())
+      const HfstState * s = state_pair_map.find(p);
+      if (s == NULL)
     {
       return map_state_and_add_to_agenda(p, allow_lexicon_epsilons);
     }
 
-      return state_pair_map[p];
+      return *s;
     }
 
     void ComposeIntersectLexicon::set_final_state_weights
@@ -32,7 +32,8 @@ namespace hfst
       HfstBasicTransducer compose_with_rules(ComposeIntersectRule *);
     protected:
       typedef std::pair<HfstState,HfstState> StatePair;
-      typedef std::map<StatePair,HfstState> StatePairMap;
+      typedef compose_intersect_utilities::StatePairMap<HfstState>
+    StatePairMap;
       typedef std::set<HfstState> StateSet;
 
       typedef std::vector<StatePair> PairVector;
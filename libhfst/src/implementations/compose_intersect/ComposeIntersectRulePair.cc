@@ -23,8 +23,8 @@ namespace hfst
     {
       ComposeIntersectRule::symbol_set = fst1->get_symbols();
 
-      pair_state_map[StatePair(ComposeIntersectRule::START,
-                   ComposeIntersectRule::START)] = START;
+      pair_state_map.insert(StatePair(ComposeIntersectRule::START,
+                                      ComposeIntersectRule::START),START);
 
       state_pair_vector.push_back(StatePair(ComposeIntersectRule::START,
                         ComposeIntersectRule::START));
@@ -54,7 +54,7 @@ namespace hfst
     
     bool ComposeIntersectRulePair::has_pair
     (const ComposeIntersectRulePair::StatePair &p) const
-    { return pair_state_map.find(p) != pair_state_map.end(); }
+    { return pair_state_map.find(p) != NULL; }
     
     bool ComposeIntersectRulePair::transitions_computed
     (HfstState state,size_t symbol)
@@ -63,14 +63,15 @@ namespace hfst
     
     HfstState ComposeIntersectRulePair::get_state(const StatePair &p)
     {
-      if (! has_pair(p))
+      const HfstState * s = pair_state_map.find(p);
+      if (s == NULL)
     {
-      pair_state_map[p] = hfst::size_t_to_uint(state_pair_vector.size());
+      pair_state_map.insert(p,hfst::size_t_to_uint(state_pair_vector.size()));
       state_pair_vector.push_back(p);
       state_transition_vector.push_back(SymbolTransitionMap());
       return hfst::size_t_to_uint(state_pair_vector.size() - 1);
     }
-      return pair_state_map[p];
+      return *s;
     }
 
     void ComposeIntersectRulePair::add_transition
@@ -43,8 +43,10 @@ namespace hfst
     protected:
       typedef std::pair<HfstState,HfstState> StatePair;
       typedef std::vector<StatePair> StatePairVector;
-      typedef std::map<StatePair,HfstState> PairStateMap;
-      typedef std::map<size_t,TransitionSet> SymbolTransitionMap;
+      typedef compose_intersect_utilities::StatePairMap<HfstState>
+    PairStateMap;
+      typedef compose_intersect_utilities::SymbolIndex<TransitionSet>
+    SymbolTransitionMap;
       typedef std::vector<SymbolTransitionMap> StateTransitionVector;
 
       StatePairVector state_pair_vector;
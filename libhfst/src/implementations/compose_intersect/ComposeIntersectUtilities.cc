@@ -101,6 +101,40 @@ int main(int argc, char * argv[])
   sset.insert(2);
   assert(! sset.has_element(1));
 
+  using hfst::implementations::compose_intersect_utilities::SymbolIndex;
+  using hfst::implementations::compose_intersect_utilities::StatePairMap;
+
+  SymbolIndex<int> index;
+  assert(index.find(3) == index.end());
+  index[3] = 30;
+  index[1] = 10;
+  index[2] = 20;
+  assert(index.size() == 3);
+  assert(index.find(2) != index.end() && index.find(2)->second == 20);
+  assert(index.find(4) == index.end());
+  SymbolIndex<int>::const_iterator it = index.begin();
+  assert(it->first == 1); ++it;
+  assert(it->first == 2); ++it;
+  assert(it->first == 3); ++it;
+  assert(it == index.end());
+
+  StatePairMap<unsigned int> pair_map;
+  for (unsigned int i = 0; i < 1000; ++i)
+    {
+      for (unsigned int j = 0; j < 10; ++j)
+        { pair_map.insert(std::make_pair(i,j),10*i + j); }
+    }
+  assert(pair_map.size() == 10000);
+  for (unsigned int i = 0; i < 1000; ++i)
+    {
+      for (unsigned int j = 0; j < 10; ++j)
+        { assert(*pair_map.find(std::make_pair(i,j)) == 10*i + j); }
+    }
+  assert(pair_map.find(std::make_pair(0u,10u)) == NULL);
+  pair_map.clear();
+  assert(pair_map.size() == 0);
+  assert(pair_map.find(std::make_pair(0u,0u)) == NULL);
+
   std::cout << "ok" << std::endl;
   return 0;
 }
@@ -45,12 +45,6 @@ namespace hfst
       iterator end(void)
       { return container_.end(); }
       
-      SpaceSavingSet &operator=(const SpaceSavingSet &another)
-      {
-        container_ = another.container_;
-        return *this;
-      }
-      
       void insert(const X &x)
       {
         iterator least_upper_bound = get_least_upper_bound(x);
@@ -118,6 +112,138 @@ namespace hfst
       { container_.insert(least_upper_bound,x); }
       };
 
+      /* A map from symbol numbers to values of type V, kept as a vector of
+         (symbol, value) pairs sorted by symbol. Lookups are a binary search
+         in one contiguous array. operator[] inserts missing symbols, which
+         moves the values after them, so a reference to a value is only
+         valid until the next insertion. */
+      template <class V> class SymbolIndex
+      {
+      public:
+        typedef std::pair<size_t,V> Entry;
+        typedef typename std::vector<Entry>::const_iterator const_iterator;
+
+        const_iterator begin(void) const
+        { return entries_.begin(); }
+
+        const_iterator end(void) const
+        { return entries_.end(); }
+
+        const_iterator find(size_t symbol) const
+        {
+          const_iterator it = std::lower_bound
+            (entries_.begin(),entries_.end(),symbol,CompareSymbol());
+          if (it == entries_.end() || it->first != symbol)
+            { return entries_.end(); }
+          return it;
+        }
+
+        V &operator[](size_t symbol)
+        {
+          typename std::vector<Entry>::iterator it = std::lower_bound
+            (entries_.begin(),entries_.end(),symbol,CompareSymbol());
+          if (it == entries_.end() || it->first != symbol)
+            { it = entries_.insert(it,Entry(symbol,V())); }
+          return it->second;
+        }
+
+        size_t size(void) const
+        { return entries_.size(); }
+
+      protected:
+        struct CompareSymbol
+        {
+          bool operator() (const Entry &entry,size_t symbol) const
+          { return entry.first < symbol; }
+        };
+
+        std::vector<Entry> entries_;
+      };
+
+      /* An open-addressing hash map from pairs of states to states, with
+         linear probing. Entries are never removed, so every slot of the
+         probe sequence before a key is in use. */
+      template <class S> class StatePairMap
+      {
+      public:
+        typedef std::pair<S,S> StatePair;
+
+        StatePairMap(void):
+          size_(0)
+        { slots_.resize(16); }
+
+        // The state mapped to p or NULL if p has not been inserted.
+        const S *find(const StatePair &p) const
+        {
+          const Slot &slot = slots_[probe(slots_,p)];
+          return slot.used ? &slot.value : NULL;
+        }
+
+        // Map p to s. p must not have been inserted before.
+        void insert(const StatePair &p,S s)
+        {
+          if (2*(size_ + 1) > slots_.size())
+            { grow(); }
+          Slot &slot = slots_[probe(slots_,p)];
+          slot.key = p;
+          slot.value = s;
+          slot.used = true;
+          ++size_;
+        }
+
+        size_t size(void) const
+        { return size_; }
+
+        void clear(void)
+        {
+          slots_.assign(16,Slot());
+          size_ = 0;
+        }
+
+      protected:
+        struct Slot
+        {
+          StatePair key;
+          S value;
+          bool used;
+          Slot(void): key(), value(), used(false) {}
+        };
+
+        std::vector<Slot> slots_;
+        size_t size_;
+
+        static size_t hash(const StatePair &p)
+        {
+          unsigned long long h = (unsigned long long)p.first;
+          h = h * 0x9E3779B97F4A7C15ULL + (unsigned long long)p.second;
+          h ^= h >> 29;
+          h *= 0xBF58476D1CE4E5B9ULL;
+          return (size_t)(h ^ (h >> 32));
+        }
+
+        // The slot of p, or the free slot where it would be inserted.
+        // The number of slots is a power of two.
+        static size_t probe(const std::vector<Slot> &slots,const StatePair &p)
+        {
+          size_t mask = slots.size() - 1;
+          size_t i = hash(p) & mask;
+          while (slots[i].used && !(slots[i].key == p))
+            { i = (i + 1) & mask; }
+          return i;
+        }
+
+        void grow(void)
+        {
+          std::vector<Slot> old_slots(slots_.size()*2);
+          old_slots.swap(slots_);
+          for (size_t i = 0; i < old_slots.size(); ++i)
+            {
+              if (old_slots[i].used)
+                { slots_[probe(slots_,old_slots[i].key)] = old_slots[i]; }
+            }
+        }
+      };
+
     }
   }
 }
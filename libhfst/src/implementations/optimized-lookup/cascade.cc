@@ -0,0 +1,509 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+#include "cascade.h"
+
+#ifndef MAIN_TEST
+
+namespace hfst_ol {
+
+// The cache key of the moves that don't read input
+static const unsigned int NO_INPUT_KEY = 0;
+
+size_t CascadeLookup::CacheKeyHash::operator()(const CacheKey & key) const
+{
+    // FNV-1a
+    size_t hash = 2166136261u;
+    for (CacheKey::const_iterator it = key.begin(); it != key.end(); ++it) {
+        hash = (hash ^ *it) * 16777619u;
+    }
+    return hash;
+}
+
+CascadeLookup::CascadeLookup(const std::vector<Transducer *> & stages,
+                             size_t max_cached_states):
+    stages(stages), max_cached_states(max_cached_states),
+    hits(0), misses(0), current_weight(0.0), results(NULL),
+    max_results(-1), max_time(0.0), output_cycle(false)
+{
+    if (stages.empty()) {
+        HFST_THROW_MESSAGE(HfstFatalException,
+                           "CascadeLookup: empty cascade");
+    }
+    symbols.push_back("");
+    for (size_t k = 0; k < stages.size(); ++k) {
+        const TransducerAlphabet & alphabet = stages[k]->get_alphabet();
+        const SymbolTable & table = alphabet.get_symbol_table();
+        SymbolNumberVector from(table.size(), 0);
+        for (SymbolNumber i = 1; i < table.size(); ++i) {
+            // Flag diacritics and the special symbols aren't passed on
+            if (alphabet.is_flag_diacritic(i) || alphabet.is_meta_arc(i)) {
+                continue;
+            }
+            from[i] = add_symbol(table[i]);
+        }
+        from_stage.push_back(from);
+    }
+    known_symbol_count = hfst::size_t_to_ushort(symbols.size());
+    for (size_t k = 0; k < stages.size(); ++k) {
+        const TransducerAlphabet & alphabet = stages[k]->get_alphabet();
+        SymbolNumberVector to(symbols.size(), NO_SYMBOL_NUMBER);
+        to[0] = 0;
+        for (SymbolNumber i = 1; i < from_stage[k].size(); ++i) {
+            if (from_stage[k][i] != 0) {
+                to[from_stage[k][i]] = i;
+            }
+        }
+        to_stage.push_back(to);
+        flag_states.push_back(
+            hfst::FdState<SymbolNumber>(alphabet.get_fd_table()));
+    }
+}
+
+SymbolNumber CascadeLookup::add_symbol(const std::string & symbol)
+{
+    StringSymbolMap::const_iterator it = symbol_numbers.find(symbol);
+    if (it != symbol_numbers.end()) {
+        return it->second;
+    }
+    if (symbols.size() >= NO_SYMBOL_NUMBER) {
+        HFST_THROW_MESSAGE(HfstFatalException,
+                           "CascadeLookup: too many symbols");
+    }
+    SymbolNumber number = hfst::size_t_to_ushort(symbols.size());
+    symbols.push_back(symbol);
+    symbol_numbers[symbol] = number;
+    return number;
+}
+
+SymbolNumber CascadeLookup::stage_symbol(unsigned int stage,
+                                         SymbolNumber symbol) const
+{
+    if (symbol >= to_stage[stage].size()) {
+        return NO_SYMBOL_NUMBER;
+    }
+    return to_stage[stage][symbol];
+}
+
+bool CascadeLookup::initialize_input(const char * input_str)
+{
+    // Forget the unknown symbols of the previous lookup
+    for (size_t i = known_symbol_count; i < symbols.size(); ++i) {
+        symbol_numbers.erase(symbols[i]);
+    }
+    symbols.resize(known_symbol_count);
+    input.clear();
+
+    const Encoder & encoder = stages[0]->get_encoder();
+    char * str = const_cast<char *>(input_str);
+    while (*str != 0) {
+        char * original_str = str;
+        SymbolNumber k = encoder.find_key(&str);
+        if (k != NO_SYMBOL_NUMBER && from_stage[0][k] != 0) {
+            input.push_back(from_stage[0][k]);
+            continue;
+        }
+        // As in LookupSession, take what we assume to be a utf-8
+        // character that the first transducer doesn't know
+        str = original_str;
+        int bytes = nByte_utf8(*str);
+        if (bytes == 0) {
+            return false;
+        }
+        input.push_back(add_symbol(std::string(str, bytes)));
+        str += bytes;
+    }
+    return true;
+}
+
+std::shared_ptr<const CascadeArcs>
+CascadeLookup::get_arcs(const CascadeState & state, SymbolNumber symbol)
+{
+    // The numbers of unknown input symbols change from lookup to lookup,
+    // so their moves aren't cached
+    if (max_cached_states == 0 || symbol >= known_symbol_count) {
+        std::shared_ptr<CascadeArcs> arcs(new CascadeArcs);
+        expand(state, symbol, *arcs);
+        return arcs;
+    }
+    CacheKey key(state.begin(), state.end());
+    key.push_back(symbol == 0 ? NO_INPUT_KEY : symbol);
+    std::unordered_map<CacheKey, CacheEntryList::iterator, CacheKeyHash>
+        ::iterator pos = cache_positions.find(key);
+    if (pos != cache_positions.end()) {
+        ++hits;
+        cache.splice(cache.begin(), cache, pos->second);
+        return cache.front().second;
+    }
+    ++misses;
+    std::shared_ptr<CascadeArcs> arcs(new CascadeArcs);
+    expand(state, symbol, *arcs);
+    cache.push_front(CacheEntry(key, arcs));
+    cache_positions[key] = cache.begin();
+    while (cache.size() > max_cached_states) {
+        cache_positions.erase(cache.back().first);
+        cache.pop_back();
+    }
+    return arcs;
+}
+
+void CascadeLookup::expand(const CascadeState & state, SymbolNumber symbol,
+                           CascadeArcs & arcs)
+{
+    CascadeArc arc;
+    arc.flag = NO_SYMBOL_NUMBER;
+    arc.weight = 0.0;
+    arc.target = state;
+    if (symbol != 0) {
+        arc.first_stage = 0;
+        follow(0, symbol, arc, arcs);
+        return;
+    }
+    for (unsigned int k = 0; k < stages.size(); ++k) {
+        arc.first_stage = k;
+        follow_epsilons(k, arc, arcs);
+    }
+}
+
+void CascadeLookup::follow(unsigned int stage, SymbolNumber symbol,
+                           CascadeArc & arc, CascadeArcs & arcs)
+{
+    if (stage == stages.size()) {
+        arc.last_stage = stage - 1;
+        arc.output = symbol;
+        arcs.push_back(arc);
+        return;
+    }
+    const TransducerAlphabet & alphabet = stages[stage]->get_alphabet();
+    SymbolNumber local = stage_symbol(stage, symbol);
+    bool found = false;
+    if (local != NO_SYMBOL_NUMBER) {
+        found = follow_transitions(stage, local, symbol, arc, arcs);
+    } else {
+        if (alphabet.get_identity_symbol() != NO_SYMBOL_NUMBER) {
+            found = follow_transitions(stage, alphabet.get_identity_symbol(),
+                                       symbol, arc, arcs);
+        }
+        if (alphabet.get_unknown_symbol() != NO_SYMBOL_NUMBER) {
+            found = follow_transitions(stage, alphabet.get_unknown_symbol(),
+                                       symbol, arc, arcs) || found;
+        }
+    }
+    if (!found && alphabet.get_default_symbol() != NO_SYMBOL_NUMBER) {
+        follow_transitions(stage, alphabet.get_default_symbol(),
+                           symbol, arc, arcs);
+    }
+}
+
+bool CascadeLookup::follow_transitions(unsigned int stage,
+                                       SymbolNumber stage_symbol,
+                                       SymbolNumber symbol,
+                                       CascadeArc & arc, CascadeArcs & arcs)
+{
+    const Transducer & t = *stages[stage];
+    const TransitionTableIndex state = arc.target[stage];
+    if (!t.has_transitions(state + 1, stage_symbol)) {
+        return false;
+    }
+    const Weight weight = arc.weight;
+    TransitionTableIndex next = t.next(state, stage_symbol);
+    STransition i_s = t.take_non_epsilons(next, stage_symbol);
+    while (i_s.symbol != NO_SYMBOL_NUMBER) {
+        arc.target[stage] = i_s.index;
+        arc.weight = weight + i_s.weight;
+        // Identity and unknown transitions write the symbol they read
+        SymbolNumber output = t.get_alphabet().is_meta_arc(i_s.symbol) ?
+            symbol : from_stage[stage][i_s.symbol];
+        if (output == 0) {
+            arc.last_stage = stage;
+            arc.output = 0;
+            arcs.push_back(arc);
+        } else {
+            follow(stage + 1, output, arc, arcs);
+        }
+        ++next;
+        i_s = t.take_non_epsilons(next, stage_symbol);
+    }
+    arc.target[stage] = state;
+    arc.weight = weight;
+    return true;
+}
+
+void CascadeLookup::follow_epsilons(unsigned int stage, CascadeArc & arc,
+                                    CascadeArcs & arcs)
+{
+    Transducer & t = *stages[stage];
+    const TransitionTableIndex state = arc.target[stage];
+    if (!t.has_epsilons_or_flags(state + 1)) {
+        return;
+    }
+    TransitionTableIndex next = t.next(state, 0);
+    STransition i_s = t.take_epsilons_and_flags(next);
+    while (i_s.symbol != NO_SYMBOL_NUMBER) {
+        arc.target[stage] = i_s.index;
+        arc.weight = i_s.weight;
+        SymbolNumber input = t.get_transition(next).get_input_symbol();
+        if (input != 0) {
+            arc.flag = input;
+            arc.last_stage = stage;
+            arc.output = 0;
+            arcs.push_back(arc);
+            arc.flag = NO_SYMBOL_NUMBER;
+        } else if (t.get_alphabet().is_meta_arc(i_s.symbol) ||
+                   from_stage[stage][i_s.symbol] == 0) {
+            arc.last_stage = stage;
+            arc.output = 0;
+            arcs.push_back(arc);
+        } else {
+            follow(stage + 1, from_stage[stage][i_s.symbol], arc, arcs);
+        }
+        ++next;
+        i_s = t.take_epsilons_and_flags(next);
+    }
+    arc.target[stage] = state;
+    arc.weight = 0.0;
+}
+
+bool CascadeLookup::out_of_time(void) const
+{
+    // Wall-clock time, as in LookupSession
+    return max_time > 0.0 &&
+        std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                      - start_clock).count() > max_time;
+}
+
+void CascadeLookup::note_result(const CascadeState & state)
+{
+    Weight final_weight = current_weight;
+    for (unsigned int k = 0; k < stages.size(); ++k) {
+        if (!stages[k]->final_index(state[k])) {
+            return;
+        }
+        final_weight += stages[k]->final_weight(state[k]);
+    }
+    HfstOneLevelPath result;
+    result.first = final_weight;
+    for (SymbolNumberVector::const_iterator it = output.begin();
+         it != output.end(); ++it) {
+        result.second.push_back(symbols[*it]);
+    }
+    results->insert(result);
+}
+
+/* A move may only follow another one if the two can't be swapped, i.e.
+   if the stages it changes don't all come before the first stage of the
+   previous move, \a barrier. This keeps one order of the moves that
+   change different transducers independently of each other, instead of
+   walking through all of them. */
+void CascadeLookup::search(const CascadeState & state,
+                           unsigned int input_pos, unsigned int barrier)
+{
+    if (max_results >= 0 && (ssize_t)results->size() >= max_results) {
+        return;
+    }
+    if (out_of_time()) {
+        return;
+    }
+
+    // Don't go round a cycle that doesn't read input
+    CacheKey path_key(state.begin(), state.end());
+    path_key.push_back(input_pos);
+    path_key.push_back(barrier);
+    for (unsigned int k = 0; k < stages.size(); ++k) {
+        const hfst::FdPackedValues & values =
+            flag_states[k].get_packed_values();
+        for (size_t w = 0; w < values.size(); ++w) {
+            path_key.push_back((unsigned int)values[w]);
+            path_key.push_back((unsigned int)(values[w] >> 32));
+        }
+    }
+    std::pair<PathKeyMap::iterator, bool> visit =
+        path_keys.insert(PathKeyMap::value_type(path_key, output.size()));
+    if (!visit.second) {
+        if (output.size() > visit.first->second) {
+            output_cycle = true;
+        }
+        return;
+    }
+
+    if (input_pos == input.size()) {
+        note_result(state);
+    }
+
+    std::shared_ptr<const CascadeArcs> arcs = get_arcs(state, 0);
+    for (CascadeArcs::const_iterator it = arcs->begin();
+         it != arcs->end(); ++it) {
+        if (it->last_stage < barrier) {
+            continue;
+        }
+        if (it->flag == NO_SYMBOL_NUMBER) {
+            take(*it, input_pos);
+            continue;
+        }
+        hfst::FdState<SymbolNumber> & flag_state =
+            flag_states[it->first_stage];
+        size_t flag_position = flag_state.log_position();
+        if (flag_state.apply_operation_logged(it->flag)) {
+            take(*it, input_pos);
+        }
+        flag_state.rollback(flag_position);
+    }
+
+    if (input_pos < input.size()) {
+        arcs = get_arcs(state, input[input_pos]);
+        for (CascadeArcs::const_iterator it = arcs->begin();
+             it != arcs->end(); ++it) {
+            if (it->last_stage >= barrier) {
+                take(*it, input_pos + 1);
+            }
+        }
+    }
+
+    path_keys.erase(path_key);
+}
+
+void CascadeLookup::take(const CascadeArc & arc, unsigned int input_pos)
+{
+    Weight old_weight = current_weight;
+    current_weight += arc.weight;
+    if (arc.output != 0) {
+        output.push_back(arc.output);
+    }
+    search(arc.target, input_pos, arc.first_stage);
+    if (arc.output != 0) {
+        output.pop_back();
+    }
+    current_weight = old_weight;
+}
+
+HfstOneLevelPaths * CascadeLookup::lookup_fd(const std::string & s,
+                                             ssize_t limit,
+                                             double time_cutoff)
+{
+    results = new HfstOneLevelPaths;
+    output_cycle = false;
+    if (!initialize_input(s.c_str())) {
+        HfstOneLevelPaths * retval = results;
+        results = NULL;
+        return retval;
+    }
+    max_results = limit;
+    max_time = time_cutoff;
+    if (time_cutoff > 0.0) {
+        start_clock = std::chrono::steady_clock::now();
+    }
+    current_weight = 0.0;
+    output.clear();
+    path_keys.clear();
+    for (unsigned int k = 0; k < stages.size(); ++k) {
+        flag_states[k] = hfst::FdState<SymbolNumber>(
+            stages[k]->get_alphabet().get_fd_table());
+    }
+
+    search(CascadeState(stages.size(), 0), 0, 0);
+
+    HfstOneLevelPaths * retval = results;
+    results = NULL;
+    return retval;
+}
+
+HfstOneLevelPaths * CascadeLookup::lookup_fd(const StringVector & s,
+                                             ssize_t limit,
+                                             double time_cutoff)
+{
+    std::string input_str;
+    for (StringVector::const_iterator it = s.begin(); it != s.end(); ++it) {
+        input_str.append(*it);
+    }
+    return lookup_fd(input_str, limit, time_cutoff);
+}
+
+void CascadeLookup::clear_cache(void)
+{
+    cache.clear();
+    cache_positions.clear();
+    hits = 0;
+    misses = 0;
+}
+
+} // namespace hfst_ol
+
+#else // MAIN_TEST was defined
+
+#include <cassert>
+#include <iostream>
+#include "HfstTransducer.h"
+#include "implementations/ConvertTransducerFormat.h"
+
+using hfst::HfstTransducer;
+using hfst::implementations::HfstBasicTransducer;
+using hfst::implementations::HfstBasicTransition;
+using hfst::implementations::ConversionFunctions;
+
+int main(int argc, char * argv[])
+{
+    std::cout << "Unit tests for " __FILE__ ":" << std::endl;
+
+    // a -> b c, with an epsilon move and a weight
+    HfstBasicTransducer first;
+    first.add_transition(0, HfstBasicTransition(1, "a", "b", 0.5));
+    first.add_transition(1, HfstBasicTransition(2, "@_EPSILON_SYMBOL_@",
+                                                "c", 0.25));
+    first.set_final_weight(2, 0.0);
+    // e -> d, which the second transducer doesn't know
+    first.add_transition(0, HfstBasicTransition(3, "e", "d", 0.0));
+    first.set_final_weight(3, 0.0);
+    // b c -> x, and anything else to itself
+    HfstBasicTransducer second;
+    second.add_transition(0, HfstBasicTransition(1, "b", "x", 1.0));
+    second.add_transition(1, HfstBasicTransition(2, "c",
+                                                 "@_EPSILON_SYMBOL_@", 0.0));
+    second.add_transition(0, HfstBasicTransition(2, "@_IDENTITY_SYMBOL_@",
+                                                 "@_IDENTITY_SYMBOL_@", 2.0));
+    second.set_final_weight(2, 0.125);
+
+    HfstTransducer t1(first, hfst::TROPICAL_OPENFST_TYPE);
+    HfstTransducer t2(second, hfst::TROPICAL_OPENFST_TYPE);
+    HfstTransducer composed(t1);
+    composed.compose(t2).convert(hfst::HFST_OLW_TYPE);
+
+    std::vector<hfst_ol::Transducer *> stages;
+    stages.push_back(ConversionFunctions::hfst_transducer_to_hfst_ol(&t1));
+    stages.push_back(ConversionFunctions::hfst_transducer_to_hfst_ol(&t2));
+    hfst_ol::CascadeLookup cascade(stages, 2);
+
+    const char * inputs[] = { "a", "e", "b", "", "aa", "a" };
+    for (unsigned int i = 0; i < 6; ++i) {
+        hfst::HfstOneLevelPaths * expected = composed.lookup_fd(inputs[i]);
+        hfst::HfstOneLevelPaths * found = cascade.lookup_fd(inputs[i]);
+        assert(found->size() == expected->size());
+        assert(!cascade.found_output_cycle());
+        hfst::HfstOneLevelPaths::const_iterator e = expected->begin();
+        for (hfst::HfstOneLevelPaths::const_iterator f = found->begin();
+             f != found->end(); ++f, ++e) {
+            std::string found_str, expected_str;
+            for (size_t j = 0; j < f->second.size(); ++j) {
+                found_str += f->second[j];
+            }
+            for (size_t j = 0; j < e->second.size(); ++j) {
+                expected_str += e->second[j];
+            }
+            assert(found_str == expected_str);
+            assert(f->first == e->first);
+        }
+        delete expected;
+        delete found;
+    }
+    assert(cascade.get_cached_states() <= 2);
+    assert(cascade.get_hits() + cascade.get_misses() > 0);
+
+    std::cout << "ok" << std::endl;
+    return 0;
+}
+
+#endif // MAIN_TEST
@@ -0,0 +1,167 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+#ifndef _HFST_OL_TRANSDUCER_CASCADE_H_
+#define _HFST_OL_TRANSDUCER_CASCADE_H_
+
+#include <list>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+#include "transducer.h"
+
+namespace hfst_ol {
+
+/** \brief A tuple of states, one for each transducer of a cascade. */
+typedef std::vector<TransitionTableIndex> CascadeState;
+
+/** \brief A move of a composed cascade from one CascadeState to another.
+
+    The states of the transducers from \a first_stage to \a last_stage
+    change; the others stay where they are. A move either reads an input
+    symbol with the first transducer or is started by an input epsilon of
+    transducer \a first_stage, and each transducer passes its output to the
+    next one until a transducer outputs epsilon or the last one is reached.
+    A move that takes a flag diacritic \a flag of transducer \a first_stage
+    changes that transducer only.
+*/
+struct CascadeArc
+{
+    unsigned int first_stage;
+    unsigned int last_stage;
+    SymbolNumber flag;
+    // The output of the last transducer as a cascade symbol, 0 for none
+    SymbolNumber output;
+    Weight weight;
+    CascadeState target;
+};
+
+typedef std::vector<CascadeArc> CascadeArcs;
+
+/** \brief Lookup through the composition of a cascade of transducers,
+    without composing them.
+
+    The composition is walked state tuple by state tuple for the string
+    being looked up only, so cascades whose composition is too big to
+    build can be used. The moves from the tuples that have been expanded
+    are kept in a bounded cache shared by all lookups, the least recently
+    used ones being dropped first.
+
+    Flag diacritics are obeyed in each transducer separately. The results
+    of an input that is infinitely ambiguous are cut at the cycles that
+    produce output, see #found_output_cycle.
+
+    The transducers are not owned and must outlive the CascadeLookup.
+    A CascadeLookup may only be used by one thread at a time.
+*/
+class CascadeLookup
+{
+protected:
+    typedef std::vector<unsigned int> CacheKey;
+    struct CacheKeyHash
+    {
+        size_t operator()(const CacheKey & key) const;
+    };
+    typedef std::pair<CacheKey, std::shared_ptr<const CascadeArcs> >
+        CacheEntry;
+    typedef std::list<CacheEntry> CacheEntryList;
+    typedef std::unordered_map<CacheKey, size_t, CacheKeyHash> PathKeyMap;
+
+    std::vector<Transducer *> stages;
+
+    // Symbols are numbered over the whole cascade, 0 being epsilon.
+    // Symbols of the input that no transducer knows are numbered from
+    // known_symbol_count onwards for the duration of one lookup.
+    SymbolTable symbols;
+    StringSymbolMap symbol_numbers;
+    SymbolNumber known_symbol_count;
+    // For each transducer, its symbol for each cascade symbol, or
+    // NO_SYMBOL_NUMBER, and the cascade symbol for each of its symbols
+    std::vector<SymbolNumberVector> to_stage;
+    std::vector<SymbolNumberVector> from_stage;
+
+    // Most recently used first
+    CacheEntryList cache;
+    std::unordered_map<CacheKey, CacheEntryList::iterator, CacheKeyHash>
+        cache_positions;
+    size_t max_cached_states;
+    size_t hits;
+    size_t misses;
+
+    // The state of the current lookup
+    SymbolNumberVector input;
+    SymbolNumberVector output;
+    std::vector<hfst::FdState<SymbolNumber> > flag_states;
+    Weight current_weight;
+    HfstOneLevelPaths * results;
+    ssize_t max_results;
+    double max_time;
+    std::chrono::steady_clock::time_point start_clock;
+    PathKeyMap path_keys;
+    bool output_cycle;
+
+    SymbolNumber add_symbol(const std::string & symbol);
+    SymbolNumber stage_symbol(unsigned int stage, SymbolNumber symbol) const;
+    bool initialize_input(const char * input_str);
+
+    std::shared_ptr<const CascadeArcs> get_arcs(const CascadeState & state,
+                                                SymbolNumber symbol);
+    void expand(const CascadeState & state, SymbolNumber symbol,
+                CascadeArcs & arcs);
+    void follow(unsigned int stage, SymbolNumber symbol,
+                CascadeArc & arc, CascadeArcs & arcs);
+    bool follow_transitions(unsigned int stage, SymbolNumber stage_symbol,
+                            SymbolNumber symbol, CascadeArc & arc,
+                            CascadeArcs & arcs);
+    void follow_epsilons(unsigned int stage, CascadeArc & arc,
+                         CascadeArcs & arcs);
+
+    void search(const CascadeState & state, unsigned int input_pos,
+                unsigned int barrier);
+    void take(const CascadeArc & arc, unsigned int input_pos);
+    void note_result(const CascadeState & state);
+    bool out_of_time(void) const;
+
+public:
+    /** \brief A lookup through the composition of \a stages, in order,
+        keeping the moves from at most \a max_cached_states expanded
+        state tuples. A bound of 0 turns the cache off. */
+    CascadeLookup(const std::vector<Transducer *> & stages,
+                  size_t max_cached_states = 100000);
+
+    /** \brief Tokenize \a s with the first transducer and look it up
+        through the cascade, obeying flag diacritics. At most \a limit
+        results are returned if \a limit is not negative, and the lookup
+        is cut short after \a time_cutoff seconds if it is positive. The
+        result is newly allocated. */
+    HfstOneLevelPaths * lookup_fd(const std::string & s, ssize_t limit = -1,
+                                  double time_cutoff = 0.0);
+    HfstOneLevelPaths * lookup_fd(const StringVector & s, ssize_t limit = -1,
+                                  double time_cutoff = 0.0);
+
+    /** \brief Whether the last lookup found a cycle producing output,
+        i.e. its input has infinitely many results. */
+    bool found_output_cycle(void) const
+        { return output_cycle; }
+
+    /** \brief Drop all cached moves. */
+    void clear_cache(void);
+
+    size_t get_hits(void) const
+        { return hits; }
+    size_t get_misses(void) const
+        { return misses; }
+    size_t get_cached_states(void) const
+        { return cache.size(); }
+    size_t get_max_cached_states(void) const
+        { return max_cached_states; }
+};
+
+} // namespace hfst_ol
+
+#endif // _HFST_OL_TRANSDUCER_CASCADE_H_
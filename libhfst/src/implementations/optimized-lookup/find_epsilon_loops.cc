@@ -45,16 +45,16 @@ bool TraversalState::operator<(const TraversalState & rhs) const
     return false;
 }
 
-void Transducer::find_loop_epsilon_transitions(
+void LookupSession::find_loop_epsilon_transitions(
     unsigned int input_pos,
     TransitionTableIndex i)
 {
-    FlagDiacriticState flags = flag_state.get_values();
+    FlagDiacriticState flags = flag_state.get_packed_values();
     while (true)
     {
-        TransitionTableIndex target = tables->get_transition_target(i);
+        TransitionTableIndex target = tables.get_transition_target(i);
         TraversalState epsilon_reachable(target, flags);
-        if (tables->get_transition_input(i) == 0) // epsilon
+        if (tables.get_transition_input(i) == 0) // epsilon
         {
             // We try to trap non-progressing loops
             if (traversal_states.count(epsilon_reachable) == 1) {
@@ -66,12 +66,12 @@ void Transducer::find_loop_epsilon_transitions(
             traversal_states.erase(epsilon_reachable);
             found_transition = true;
             ++i;
-        } else if (alphabet->is_flag_diacritic(
-                       tables->get_transition_input(i))) {
-            
-            if (flag_state.apply_operation(
-                    *(alphabet->get_operation(
-                          tables->get_transition_input(i))))) {
+        } else if (alphabet.is_flag_diacritic(
+                       tables.get_transition_input(i))) {
+            size_t flag_position = flag_state.log_position();
+            if (flag_state.apply_operation_logged(
+                    *(alphabet.get_operation(
+                          tables.get_transition_input(i))))) {
                 // flag diacritic allowed
                 if (traversal_states.count(epsilon_reachable) == 1) {
                     // We've been here before
@@ -81,7 +81,7 @@ void Transducer::find_loop_epsilon_transitions(
                 find_loop(input_pos, target);
                 traversal_states.erase(epsilon_reachable);
             }
-            flag_state.assign_values(flags);
+            flag_state.rollback(flag_position);
             ++i;
         } else { // it's not epsilon and it's not a flag, so nothing to do
             return;
@@ -89,28 +89,28 @@ void Transducer::find_loop_epsilon_transitions(
     }
 }
 
-void Transducer::find_loop_epsilon_indices(unsigned int input_pos,
+void LookupSession::find_loop_epsilon_indices(unsigned int input_pos,
                                                 TransitionTableIndex i)
 {
-    if (tables->get_index_input(i) == 0)
+    if (tables.get_index_input(i) == 0)
     {
         find_loop_epsilon_transitions(
             input_pos,
-            tables->get_index_target(i) - TRANSITION_TARGET_TABLE_START);
+            tables.get_index_target(i) - TRANSITION_TARGET_TABLE_START);
         found_transition = true;
     }
 }
 
-void Transducer::find_loop_transitions(SymbolNumber input,
+void LookupSession::find_loop_transitions(SymbolNumber input,
                                             unsigned int input_pos,
                                             TransitionTableIndex i)
 {
 
-    while (tables->get_transition_input(i) != NO_SYMBOL_NUMBER) {
-        if (tables->get_transition_input(i) == input) {
+    while (tables.get_transition_input(i) != NO_SYMBOL_NUMBER) {
+        if (tables.get_transition_input(i) == input) {
             // We're not going to find an epsilon / flag loop
             traversal_states.clear();
-            find_loop(input_pos, tables->get_transition_target(i));
+            find_loop(input_pos, tables.get_transition_target(i));
             found_transition = true;
         } else {
             return;
@@ -119,15 +119,15 @@ void Transducer::find_loop_transitions(SymbolNumber input,
     }
 }
 
-void Transducer::find_loop_index(SymbolNumber input,
+void LookupSession::find_loop_index(SymbolNumber input,
                                       unsigned int input_pos,
                                       TransitionTableIndex i)
 {
-    if (tables->get_index_input(i+input) == input)
+    if (tables.get_index_input(i+input) == input)
     {
         find_loop_transitions(input,
                               input_pos,
-                              tables->get_index_target(i+input) -
+                              tables.get_index_target(i+input) -
                               TRANSITION_TARGET_TABLE_START);
         found_transition = true;
     }
@@ -136,7 +136,7 @@ void Transducer::find_loop_index(SymbolNumber input,
 
 
 
-void Transducer::find_loop(unsigned int input_pos,
+void LookupSession::find_loop(unsigned int input_pos,
                            TransitionTableIndex i)
 {
     found_transition = false;
@@ -156,9 +156,9 @@ void Transducer::find_loop(unsigned int input_pos,
         ++input_pos;
 
         find_loop_transitions(input, input_pos, i+1);
-        if (alphabet->get_default_symbol() != NO_SYMBOL_NUMBER &&
+        if (alphabet.get_default_symbol() != NO_SYMBOL_NUMBER &&
             !found_transition) {
-            find_loop_transitions(alphabet->get_default_symbol(),
+            find_loop_transitions(alphabet.get_default_symbol(),
                                   input_pos, i+1);
         }
     }
@@ -177,8 +177,8 @@ void Transducer::find_loop(unsigned int input_pos,
         find_loop_index(input, input_pos, i+1);
         // If we have a default symbol defined and we didn't find an index,
         // check for that
-        if (alphabet->get_default_symbol() != NO_SYMBOL_NUMBER && !found_transition) {
-            find_loop_index(alphabet->get_default_symbol(),
+        if (alphabet.get_default_symbol() != NO_SYMBOL_NUMBER && !found_transition) {
+            find_loop_index(alphabet.get_default_symbol(),
                             input_pos, i+1);
         }
     }
@@ -0,0 +1,251 @@
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+
+#include "letter-trie.h"
+
+#ifndef MAIN_TEST
+
+#include <algorithm>
+
+namespace hfst_ol {
+
+const OlLetterTrie::Node OlLetterTrie::ROOT;
+const OlLetterTrie::Node OlLetterTrie::NO_NODE;
+const SymbolNumber OlLetterTrie::NO_KEY;
+const int OlLetterTrie::FREE;
+
+OlLetterTrie::OlLetterTrie():
+    base(UCHAR_MAX + 2, 0),
+    check(UCHAR_MAX + 2, ROOT),
+    symbols(UCHAR_MAX + 2, NO_KEY),
+    first_free(UCHAR_MAX + 2)
+{
+    // the children of the root are always at 1 + c
+    base[ROOT] = 1;
+}
+
+void OlLetterTrie::claim(Node n, Node parent)
+{
+    if (n >= check.size()) {
+        size_t new_size = std::max<size_t>(n + 1, check.size() * 2);
+        base.resize(new_size, 0);
+        check.resize(new_size, FREE);
+        symbols.resize(new_size, NO_KEY);
+    }
+    check[n] = parent;
+    while (!is_free(first_free)) {
+        ++first_free;
+    }
+}
+
+void OlLetterTrie::release(Node n)
+{
+    base[n] = 0;
+    check[n] = FREE;
+    symbols[n] = NO_KEY;
+    if (n < first_free) {
+        first_free = n;
+    }
+}
+
+OlLetterTrie::Node OlLetterTrie::find_base(
+    const std::vector<unsigned char> & labels)
+{
+    // labels is sorted, so nothing can fit below first_free - labels[0]
+    Node b = first_free > labels[0] ? first_free - labels[0] : 1;
+    while (true) {
+        bool fits = true;
+        for (size_t i = 0; i < labels.size(); ++i) {
+            if (!is_free(b + labels[i])) {
+                fits = false;
+                break;
+            }
+        }
+        if (fits) {
+            return b;
+        }
+        ++b;
+    }
+}
+
+OlLetterTrie::Node OlLetterTrie::add_child(Node parent, unsigned char c)
+{
+    if (parent == ROOT) {
+        return 1 + c;
+    }
+    if (base[parent] == 0) {
+        base[parent] = find_base(std::vector<unsigned char>(1, c));
+        claim(base[parent] + c, parent);
+        return base[parent] + c;
+    }
+    Node child = base[parent] + c;
+    if (child < check.size() && check[child] == (int)parent) {
+        return child;
+    }
+    if (is_free(child)) {
+        claim(child, parent);
+        return child;
+    }
+    // The cell is taken by another node's child, so move the children of
+    // parent to where there is room for all of them and the new one.
+    std::vector<unsigned char> labels;
+    for (unsigned int x = 0; x <= UCHAR_MAX; ++x) {
+        if (x == c || step(parent, x) != NO_NODE) {
+            labels.push_back(x);
+        }
+    }
+    Node new_base = find_base(labels);
+    for (size_t i = 0; i < labels.size(); ++i) {
+        if (labels[i] == c) {
+            continue;
+        }
+        Node old_node = base[parent] + labels[i];
+        Node new_node = new_base + labels[i];
+        claim(new_node, parent);
+        base[new_node] = base[old_node];
+        symbols[new_node] = symbols[old_node];
+        if (base[old_node] != 0) {
+            for (unsigned int y = 0; y <= UCHAR_MAX; ++y) {
+                Node grandchild = base[old_node] + y;
+                if (grandchild < check.size() &&
+                    check[grandchild] == (int)old_node) {
+                    check[grandchild] = new_node;
+                }
+            }
+        }
+        release(old_node);
+    }
+    base[parent] = new_base;
+    claim(new_base + c, parent);
+    return new_base + c;
+}
+
+void OlLetterTrie::add_string(const char * p, SymbolNumber symbol_key)
+{
+    if (*p == 0) {
+        return;
+    }
+    Node node = ROOT;
+    for (; *p != 0; ++p) {
+        node = add_child(node, (unsigned char)(*p));
+    }
+    symbols[node] = symbol_key;
+}
+
+bool OlLetterTrie::has_key_starting_with(const char c) const
+{
+    return has_children(1 + (unsigned char)c);
+}
+
+SymbolNumber OlLetterTrie::find_key(char ** p) const
+{
+    const unsigned char * s = (const unsigned char *)(*p);
+    Node node = 1 + s[0];
+    SymbolNumber key = symbols[node];
+    size_t length = 1;
+    // a node for '\0' never has children, so this doesn't read past the end
+    for (size_t i = 1; has_children(node); ++i) {
+        node = step(node, s[i]);
+        if (node == NO_NODE) {
+            break;
+        }
+        if (symbols[node] != NO_KEY) {
+            key = symbols[node];
+            length = i + 1;
+        }
+    }
+    *p += length;
+    return key;
+}
+
+SymbolNumber OlLetterTrie::find_string(const char * p) const
+{
+    if (*p == 0) {
+        return NO_KEY;
+    }
+    Node node = ROOT;
+    for (; *p != 0; ++p) {
+        node = step(node, (unsigned char)(*p));
+        if (node == NO_NODE) {
+            return NO_KEY;
+        }
+    }
+    return symbols[node];
+}
+
+bool OlLetterTrie::has_symbol(SymbolNumber symbol_key) const
+{
+    return std::find(symbols.begin(), symbols.end(), symbol_key)
+        != symbols.end();
+}
+
+}
+
+#else // MAIN_TEST was defined
+
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+using hfst_ol::OlLetterTrie;
+
+int main(int argc, char * argv[])
+{
+    std::cout << "Unit tests for " __FILE__ ":" << std::endl;
+
+    OlLetterTrie trie;
+    trie.add_string("a", 1);
+    trie.add_string("ab", 2);
+    trie.add_string("abcd", 3);
+    trie.add_string("\xc3\xa4", 4);
+    trie.add_string("<n>", 5);
+
+    // the longest match wins, and the pointer moves past it
+    char input[] = "abcx";
+    char * p = input;
+    assert(trie.find_key(&p) == 2);
+    assert(p == input + 2);
+    assert(trie.find_key(&p) == OlLetterTrie::NO_KEY);
+    assert(p == input + 3);
+    assert(trie.find_key(&p) == OlLetterTrie::NO_KEY);
+    assert(p == input + 4);
+
+    char input2[] = "\xc3\xa4<n";
+    p = input2;
+    assert(trie.find_key(&p) == 4);
+    assert(trie.find_key(&p) == OlLetterTrie::NO_KEY);
+    assert(p == input2 + 3);
+
+    assert(trie.find_string("abcd") == 3);
+    assert(trie.find_string("abc") == OlLetterTrie::NO_KEY);
+    assert(trie.has_key_starting_with('a'));
+    assert(!trie.has_key_starting_with('b'));
+    assert(trie.has_symbol(5) && !trie.has_symbol(6));
+
+    // enough overlapping multichar symbols to make nodes move around
+    OlLetterTrie big;
+    char buffer[16];
+    for (unsigned int i = 0; i < 3000; ++i) {
+        sprintf(buffer, "+%x%c", i * 7919 % 4096, 'A' + i % 26);
+        big.add_string(buffer, i);
+    }
+    for (unsigned int i = 0; i < 3000; ++i) {
+        sprintf(buffer, "+%x%c", i * 7919 % 4096, 'A' + i % 26);
+        assert(big.find_string(buffer) == i);
+    }
+    OlLetterTrie copy(big);
+    sprintf(buffer, "+%x%c", 5 * 7919 % 4096, 'A' + 5 % 26);
+    assert(copy.find_string(buffer) == 5);
+
+    std::cout << "ok" << std::endl;
+    return 0;
+}
+
+#endif // MAIN_TEST
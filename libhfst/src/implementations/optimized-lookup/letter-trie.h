@@ -0,0 +1,105 @@
+// -*- mode: c++; -*-
+// Copyright (c) 2016 University of Helsinki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+// See the file COPYING included with this distribution for more
+// information.
+
+#ifndef _HFST_OL_TRANSDUCER_LETTER_TRIE_H_
+#define _HFST_OL_TRANSDUCER_LETTER_TRIE_H_
+
+#include <vector>
+#include <climits>
+#include <cstddef>
+
+namespace hfst_ol {
+
+typedef unsigned short SymbolNumber;
+
+/** \brief A trie from the bytes of symbol strings to symbol numbers.
+
+    The trie is a double array: node n has its child for byte c at
+    base[n] + c, and that cell belongs to n if check[base[n] + c] == n.
+    The children of the root are fixed at 1 + c, so the first byte is a
+    plain array lookup, and all the nodes live in three flat vectors
+    instead of a tree of separately allocated nodes.
+
+    Symbols can be added at any time. When the cells a node's new child
+    needs are taken, the node's children are moved to a free place. */
+class OlLetterTrie
+{
+public:
+    /** A node of the trie. */
+    typedef unsigned int Node;
+    /** The node which is the parent of the nodes for single bytes. */
+    static const Node ROOT = 0;
+    /** Returned by step when there is no such child. */
+    static const Node NO_NODE = 0;
+    /** The symbol of a node that doesn't end a symbol string. */
+    static const SymbolNumber NO_KEY = USHRT_MAX;
+
+private:
+    std::vector<int> base;
+    std::vector<int> check;
+    std::vector<SymbolNumber> symbols;
+    // no cell below this one is free
+    Node first_free;
+
+    static const int FREE = -1;
+
+    bool is_free(Node n) const
+        { return n >= check.size() || check[n] == FREE; }
+    void claim(Node n, Node parent);
+    void release(Node n);
+    Node find_base(const std::vector<unsigned char> & labels);
+    Node add_child(Node parent, unsigned char c);
+
+public:
+    OlLetterTrie();
+
+    void add_string(const char * p, SymbolNumber symbol_key);
+    bool has_key_starting_with(const char c) const;
+
+    /** Find the longest symbol that the string at *p starts with and
+        move *p past it. If there is none, move *p one byte forward and
+        return NO_KEY. */
+    SymbolNumber find_key(char ** p) const;
+
+    /** The symbol whose string is exactly p, or NO_KEY. */
+    SymbolNumber find_string(const char * p) const;
+
+    /** Whether any string has been added with the given symbol number. */
+    bool has_symbol(SymbolNumber symbol_key) const;
+
+    /** The child of node for byte c, or NO_NODE. For walking the trie
+        over input that isn't a null-terminated string. */
+    Node step(Node node, unsigned char c) const
+        {
+            if (node == ROOT) {
+                return 1 + c;
+            }
+            if (base[node] == 0) {
+                return NO_NODE;
+            }
+            Node child = base[node] + c;
+            if (child < check.size() && check[child] == (int)node) {
+                return child;
+            }
+            return NO_NODE;
+        }
+
+    /** Whether node has any children. */
+    bool has_children(Node node) const
+        { return base[node] != 0; }
+
+    /** The symbol whose string ends at node, or NO_KEY. */
+    SymbolNumber symbol(Node node) const
+        { return symbols[node]; }
+};
+
+}
+
+#endif
@@ -8,6 +8,8 @@
 // information.
 #include "transducer.h"
 
+#include <algorithm>
+
 namespace hfst_ol {
 
 int nByte_utf8(unsigned char c)
@@ -67,13 +69,11 @@ bool InputString::initialize(const Encoder & encoder,
     return true;
 }
 
-TreeNode TreeNode::update_lexicon(SymbolNumber next_symbol,
+TreeNode TreeNode::update_lexicon(unsigned int next_path,
                                   TransitionTableIndex next_lexicon,
-                                  Weight weight)
+                                  Weight weight) const
 {
-    SymbolNumberVector str(this->string);
-    str.push_back(next_symbol);
-    return TreeNode(str,
+    return TreeNode(next_path,
                     this->input_state,
                     this->mutator_state,
                     next_lexicon,
@@ -81,13 +81,11 @@ TreeNode TreeNode::update_lexicon(SymbolNumber next_symbol,
                     this->weight + weight);
 }
 
-TreeNode TreeNode::update_mutator(SymbolNumber next_symbol,
+TreeNode TreeNode::update_mutator(unsigned int next_path,
                                   TransitionTableIndex next_mutator,
-                                  Weight weight)
+                                  Weight weight) const
 {
-    SymbolNumberVector str(this->string);
-    str.push_back(next_symbol);
-    return TreeNode(str,
+    return TreeNode(next_path,
                     this->input_state,
                     next_mutator,
                     this->lexicon_state,
@@ -95,15 +93,13 @@ TreeNode TreeNode::update_mutator(SymbolNumber next_symbol,
                     this->weight + weight);
 }
 
-TreeNode TreeNode::update(SymbolNumber next_symbol,
+TreeNode TreeNode::update(unsigned int next_path,
                           unsigned int next_input,
                           TransitionTableIndex next_mutator,
                           TransitionTableIndex next_lexicon,
-                          Weight weight)
+                          Weight weight) const
 {
-    SymbolNumberVector str(this->string);
-    str.push_back(next_symbol);
-    return TreeNode(str,
+    return TreeNode(next_path,
                     next_input,
                     next_mutator,
                     next_lexicon,
@@ -111,14 +107,12 @@ TreeNode TreeNode::update(SymbolNumber next_symbol,
                     this->weight + weight);
 }
 
-TreeNode TreeNode::update(SymbolNumber next_symbol,
+TreeNode TreeNode::update(unsigned int next_path,
                           TransitionTableIndex next_mutator,
                           TransitionTableIndex next_lexicon,
-                          Weight weight)
+                          Weight weight) const
 {
-    SymbolNumberVector str(this->string);
-    str.push_back(next_symbol);
-    return TreeNode(str,
+    return TreeNode(next_path,
                     this->input_state,
                     next_mutator,
                     next_lexicon,
@@ -126,26 +120,46 @@ TreeNode TreeNode::update(SymbolNumber next_symbol,
                     this->weight + weight);
 }
 
-void Speller::lexicon_epsilons(void)
+unsigned int Speller::extend_path(unsigned int path, SymbolNumber symbol)
+{
+    SpellerPathNode node;
+    node.symbol = symbol;
+    node.parent = path;
+    paths.push_back(node);
+    return hfst::size_t_to_uint(paths.size() - 1);
+}
+
+void Speller::push(const TreeNode & node)
 {
-    if (!lexicon->has_epsilons_or_flags(queue.front().lexicon_state + 1)) {
+    if (max_weight >= 0.0 && node.weight > max_weight) {
         return;
     }
-    TransitionTableIndex next = lexicon->next(queue.front().lexicon_state, 0);
+    if (beam >= 0.0 && node.weight > best_weight + beam) {
+        return;
+    }
+    queue.push(node);
+}
+
+void Speller::lexicon_epsilons(const TreeNode & node)
+{
+    if (!lexicon->has_epsilons_or_flags(node.lexicon_state + 1)) {
+        return;
+    }
+    TransitionTableIndex next = lexicon->next(node.lexicon_state, 0);
     STransition i_s = lexicon->take_epsilons_and_flags(next);
     
     while (i_s.symbol != NO_SYMBOL_NUMBER) {
         if (lexicon->get_transition(next).get_input_symbol() == 0) {
-            queue.push_back(queue.front().update_lexicon(i_s.symbol,
-                                                         i_s.index,
-                                                         i_s.weight));
+            push(node.update_lexicon(extend_path(node.path, i_s.symbol),
+                                     i_s.index,
+                                     i_s.weight));
         } else {
-            TreeNode front = queue.front();
+            TreeNode front = node;
             if (front.flag_state.apply_operation(
                     lexicon->get_transition(next).get_input_symbol())) {
-                queue.push_back(front.update_lexicon(i_s.symbol,
-                                                     i_s.index,
-                                                     i_s.weight));
+                push(front.update_lexicon(extend_path(node.path, i_s.symbol),
+                                          i_s.index,
+                                          i_s.weight));
             }
         }
         ++next;
@@ -153,27 +167,26 @@ void Speller::lexicon_epsilons(void)
     }
 }
 
-void Speller::lexicon_consume(void)
+void Speller::lexicon_consume(const TreeNode & node)
 {
-    unsigned int input_state = queue.front().input_state;
+    unsigned int input_state = node.input_state;
     if (input_state >= input.len()||
         !lexicon->has_transitions(
-            queue.front().lexicon_state + 1, input[input_state])) {
+            node.lexicon_state + 1, input[input_state])) {
         return;
     }
 
-    TransitionTableIndex next = lexicon->next(queue.front().lexicon_state,
+    TransitionTableIndex next = lexicon->next(node.lexicon_state,
                                               input[input_state]);
     STransition i_s = lexicon->take_non_epsilons(next,
                                                  input[input_state]);
 
     while (i_s.symbol != NO_SYMBOL_NUMBER) {
-        queue.push_back(queue.front().update(
-                            i_s.symbol,
-                            input_state + 1,
-                            queue.front().mutator_state,
-                            i_s.index,
-                            i_s.weight));
+        push(node.update(extend_path(node.path, i_s.symbol),
+                         input_state + 1,
+                         node.mutator_state,
+                         i_s.index,
+                         i_s.weight));
         
         ++next;
         i_s = lexicon->take_non_epsilons(next, input[input_state]);
@@ -181,40 +194,39 @@ void Speller::lexicon_consume(void)
     
 }
 
-void Speller::mutator_epsilons(void)
+void Speller::mutator_epsilons(const TreeNode & node)
 {
-    if (!mutator->has_transitions(queue.front().mutator_state + 1, 0)) {
+    if (!mutator->has_transitions(node.mutator_state + 1, 0)) {
         return;
     }
-    TransitionTableIndex next_m = mutator->next(queue.front().mutator_state, 0);
+    TransitionTableIndex next_m = mutator->next(node.mutator_state, 0);
     STransition mutator_i_s = mutator->take_epsilons(next_m);
    
     while (mutator_i_s.symbol != NO_SYMBOL_NUMBER) {
         if (mutator_i_s.symbol == 0) {
-            queue.push_back(queue.front().update_mutator(mutator_i_s.symbol,
-                                                         mutator_i_s.index,
-                                                         mutator_i_s.weight));
+            push(node.update_mutator(extend_path(node.path, mutator_i_s.symbol),
+                                     mutator_i_s.index,
+                                     mutator_i_s.weight));
         } else {
             if (!lexicon->has_transitions(
-                    queue.front().lexicon_state + 1,
+                    node.lexicon_state + 1,
                     alphabet_translator[mutator_i_s.symbol])) {
                 ++next_m;
                 mutator_i_s = mutator->take_epsilons(next_m);
                 continue;
             }
             TransitionTableIndex next_l = lexicon->next(
-                queue.front().lexicon_state,
+                node.lexicon_state,
                 alphabet_translator[mutator_i_s.symbol]);
             STransition lexicon_i_s = lexicon->take_non_epsilons(
                 next_l,
                 alphabet_translator[mutator_i_s.symbol]);
             
             while (lexicon_i_s.symbol != NO_SYMBOL_NUMBER) {
-                queue.push_back(queue.front().update(
-                                    lexicon_i_s.symbol,
-                                    mutator_i_s.index,
-                                    lexicon_i_s.index,
-                                    lexicon_i_s.weight + mutator_i_s.weight));
+                push(node.update(extend_path(node.path, lexicon_i_s.symbol),
+                                 mutator_i_s.index,
+                                 lexicon_i_s.index,
+                                 lexicon_i_s.weight + mutator_i_s.weight));
                 ++next_l;
                 lexicon_i_s = lexicon->take_non_epsilons(
                     next_l,
@@ -226,16 +238,16 @@ void Speller::mutator_epsilons(void)
     }
 }
 
-void Speller::consume_input(void)
+void Speller::consume_input(const TreeNode & node)
 {
-    unsigned int input_state = queue.front().input_state;
+    unsigned int input_state = node.input_state;
     if (input_state >= input.len()||
-        !mutator->has_transitions(queue.front().mutator_state + 1,
+        !mutator->has_transitions(node.mutator_state + 1,
                                   input[input_state])) {
         return; // not enough input to consume of no suitable transitions
     }
     
-    TransitionTableIndex next_m = mutator->next(queue.front().mutator_state,
+    TransitionTableIndex next_m = mutator->next(node.mutator_state,
                                                 input[input_state]);
     
     STransition mutator_i_s = mutator->take_non_epsilons(next_m,
@@ -245,14 +257,14 @@ void Speller::consume_input(void)
 
         if (mutator_i_s.symbol == 0) {
             
-            queue.push_back(queue.front().update(0,
-                                                 input_state + 1,
-                                                 mutator_i_s.index,
-                                                 queue.front().lexicon_state,
-                                                 mutator_i_s.weight));
+            push(node.update(extend_path(node.path, 0),
+                             input_state + 1,
+                             mutator_i_s.index,
+                             node.lexicon_state,
+                             mutator_i_s.weight));
         } else {
             if (!lexicon->has_transitions(
-                    queue.front().lexicon_state + 1,
+                    node.lexicon_state + 1,
                     alphabet_translator[mutator_i_s.symbol])) {
                 ++next_m;
                 mutator_i_s = mutator->take_non_epsilons(next_m,
@@ -260,7 +272,7 @@ void Speller::consume_input(void)
                 continue;
             }
             TransitionTableIndex next_l = lexicon->next(
-                queue.front().lexicon_state,
+                node.lexicon_state,
                 alphabet_translator[mutator_i_s.symbol]);
             
             STransition lexicon_i_s = lexicon->take_non_epsilons(
@@ -268,12 +280,11 @@ void Speller::consume_input(void)
                 alphabet_translator[mutator_i_s.symbol]);
             
             while (lexicon_i_s.symbol != NO_SYMBOL_NUMBER) {
-                queue.push_back(
-                    queue.front().update(lexicon_i_s.symbol,
-                                         input_state + 1,
-                                         mutator_i_s.index,
-                                         lexicon_i_s.index,
-                                         lexicon_i_s.weight + mutator_i_s.weight));
+                push(node.update(extend_path(node.path, lexicon_i_s.symbol),
+                                 input_state + 1,
+                                 mutator_i_s.index,
+                                 lexicon_i_s.index,
+                                 lexicon_i_s.weight + mutator_i_s.weight));
                 ++next_l;
                 lexicon_i_s = lexicon->take_non_epsilons(
                     next_l,
@@ -286,48 +297,100 @@ void Speller::consume_input(void)
     }
 }
 
+/* The weight of the nth lightest correction in \a corrections */
+static Weight nth_best_weight(const std::map<std::string, Weight> & corrections,
+                              unsigned int n)
+{
+    std::vector<Weight> weights;
+    weights.reserve(corrections.size());
+    for (std::map<std::string, Weight>::const_iterator it = corrections.begin();
+         it != corrections.end(); ++it) {
+        weights.push_back(it->second);
+    }
+    std::nth_element(weights.begin(), weights.begin() + (n - 1), weights.end());
+    return weights[n - 1];
+}
 
-CorrectionQueue Speller::correct(char * line)
+CorrectionQueue Speller::correct(char * line, int nbest,
+                                 Weight max_weight_, Weight beam_)
 {
     // if input initialization fails, return empty correction queue
     if (!init_input(line, mutator->get_encoder(),
                     mutator->get_unknown_symbol())) {
         return CorrectionQueue();
     }
+    max_weight = max_weight_;
+    beam = beam_;
+    best_weight = INFINITE_WEIGHT;
+    const unsigned int n = nbest > 0 ? (unsigned int)nbest : 0;
+    // The weight that a correction has to beat to get into the n best
+    Weight nbest_weight = INFINITE_WEIGHT;
+
     std::map<std::string, Weight> corrections;
     TreeNode start_node(lexicon->get_fd_table());
-    queue.assign(1, start_node);
+    queue = TreeNodeQueue();
+    paths.clear();
+    queue.push(start_node);
 
     while (queue.size() > 0) {
-        lexicon_epsilons();
-        mutator_epsilons();
-        if (queue.front().input_state == input.len()) {
+        TreeNode node = queue.top();
+        queue.pop();
+        if (n > 0 && node.weight > nbest_weight) {
+            // Everything left is heavier than the n best so far
+            break;
+        }
+        if (beam >= 0.0 && node.weight > best_weight + beam) {
+            continue;
+        }
+        lexicon_epsilons(node);
+        mutator_epsilons(node);
+        if (node.input_state == input.len()) {
             /* if our transducers are in final states
              * we generate the correction
              */
-            if (mutator->final_index(queue.front().mutator_state)&&
-                lexicon->final_index(queue.front().lexicon_state)) {
-                std::string string = stringify(queue.front().string);
-                Weight weight = queue.front().weight +
-                    lexicon->final_weight(queue.front().lexicon_state) +
-                    mutator->final_weight(queue.front().mutator_state);
+            if (mutator->final_index(node.mutator_state)&&
+                lexicon->final_index(node.lexicon_state)) {
+                Weight weight = node.weight +
+                    lexicon->final_weight(node.lexicon_state) +
+                    mutator->final_weight(node.mutator_state);
+                if (max_weight >= 0.0 && weight > max_weight) {
+                    continue;
+                }
+                std::string string = stringify(node.path);
                 /* if the correction is novel or better than before, insert it
                  */
-                if (corrections.count(string) == 0||
-                    corrections[string] > weight) {
+                std::map<std::string, Weight>::iterator it
+                    = corrections.find(string);
+                if (it == corrections.end() || it->second > weight) {
                     corrections[string] = weight;
+                    if (weight < best_weight) {
+                        best_weight = weight;
+                    }
+                    if (n > 0 && corrections.size() >= n) {
+                        nbest_weight = nth_best_weight(corrections, n);
+                    }
                 }
             }
         } else {
-            consume_input();
+            consume_input(node);
         }
-        queue.pop_front();
     }
     CorrectionQueue correction_queue;
     std::map<std::string, Weight>::iterator it;
     for (it = corrections.begin(); it != corrections.end(); ++it) {
+        if (beam >= 0.0 && it->second > best_weight + beam) {
+            continue;
+        }
         correction_queue.push(StringWeightPair(it->first, it->second));
     }
+    if (n > 0 && correction_queue.size() > n) {
+        CorrectionQueue best;
+        while (best.size() < n) {
+            best.push(correction_queue.top());
+            correction_queue.pop();
+        }
+        return best;
+    }
     return correction_queue;
 }
 
@@ -336,17 +399,22 @@ bool Speller::check(char * line)
     if (!init_input(line, lexicon->get_encoder(), NO_SYMBOL_NUMBER)) {
         return false;
     }
+    max_weight = -1.0;
+    beam = -1.0;
     TreeNode start_node(lexicon->get_fd_table());
-    queue.assign(1, start_node);
+    queue = TreeNodeQueue();
+    paths.clear();
+    queue.push(start_node);
 
     while (queue.size() > 0) {
-        if (queue.front().input_state == input.len()&&
-            lexicon->final_index(queue.front().lexicon_state)) {
+        TreeNode node = queue.top();
+        queue.pop();
+        if (node.input_state == input.len()&&
+            lexicon->final_index(node.lexicon_state)) {
             return true;
         }
-        lexicon_epsilons();
-        lexicon_consume();
-        queue.pop_front();
+        lexicon_epsilons(node);
+        lexicon_consume(node);
     }
     return false;
 }
@@ -361,6 +429,16 @@ std::string Speller::stringify(SymbolNumberVector symbol_vector)
     return s;
 }
 
+std::string Speller::stringify(unsigned int path)
+{
+    SymbolNumberVector symbol_vector;
+    for (; path != EMPTY_SPELLER_PATH; path = paths[path].parent) {
+        symbol_vector.push_back(paths[path].symbol);
+    }
+    std::reverse(symbol_vector.begin(), symbol_vector.end());
+    return stringify(symbol_vector);
+}
+
 bool Speller::init_input(char * str,
                          const Encoder & encoder,
                          SymbolNumber other)
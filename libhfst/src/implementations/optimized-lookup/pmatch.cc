@@ -9,6 +9,11 @@
 #include "pmatch.h"
 #include "hfst.h"
 
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+
 using hfst::HfstTransducer;
 
 namespace hfst_ol {
@@ -322,6 +327,7 @@ void PmatchAlphabet::count(SymbolNumber sym)
 
 PmatchContainer::PmatchContainer(std::istream & inputstream):
     entry_stack(),
+    first_symbol_default(true),
     verbose(false),
     locate_mode(false),
     line_number(0),
@@ -357,10 +363,8 @@ PmatchContainer::PmatchContainer(std::istream & inputstream):
     global_flag_state = alphabet.get_fd_table();
     encoder = new Encoder(alphabet.get_symbol_table(), orig_symbol_count);
 
-    if (properties.count("initial-symbols") == 1) {
-        collect_first_symbols(properties["initial-symbols"]);
-    }
-    
+    collect_first_symbols(properties);
+
     toplevel = new hfst_ol::PmatchTransducer(
         inputstream,
         header.index_table_size(),
@@ -395,6 +399,7 @@ PmatchContainer::PmatchContainer(std::istream & inputstream):
 
 PmatchContainer::PmatchContainer(Transducer * t):
     entry_stack(),
+    first_symbol_default(true),
     verbose(false),
     locate_mode(false),
     profile_mode(false),
@@ -425,6 +430,7 @@ PmatchContainer::PmatchContainer(Transducer * t):
 // format.
 PmatchContainer::PmatchContainer(std::vector<HfstTransducer> transducers):
     entry_stack(),
+    first_symbol_default(true),
     verbose(false),
     locate_mode(false),
     line_number(0),
@@ -454,6 +460,7 @@ PmatchContainer::PmatchContainer(std::vector<HfstTransducer> transducers):
         orig_symbol_count = symbol_count = alphabet.get_orig_symbol_count();
         global_flag_state = alphabet.get_fd_table();
         encoder = new Encoder(alphabet.get_symbol_table(), orig_symbol_count);
+        collect_first_symbols(properties);
         TransducerTable<TransitionW> transitions = backend->copy_transitionw_table();
         TransducerTable<TransitionWIndex> indices = backend->copy_windex_table();
         toplevel = new hfst_ol::PmatchTransducer(
@@ -527,6 +534,7 @@ PmatchContainer::PmatchContainer(std::vector<HfstTransducer> transducers):
         orig_symbol_count = symbol_count = alphabet.get_orig_symbol_count();
         global_flag_state = alphabet.get_fd_table();
         encoder = new Encoder(alphabet.get_symbol_table(), orig_symbol_count);
+        collect_first_symbols(properties);
         TransducerTable<TransitionW> transitions = harmonized_tmp->copy_transitionw_table();
         TransducerTable<TransitionWIndex> indices = harmonized_tmp->copy_windex_table();
         toplevel = new hfst_ol::PmatchTransducer(
@@ -595,6 +603,58 @@ PmatchContainer::PmatchContainer(void)
     // Not used, but apparently needed by swig to construct these
 }
 
+PmatchContainer::PmatchContainer(const PmatchContainer & rules):
+    alphabet(rules.alphabet),
+    orig_symbol_count(rules.orig_symbol_count),
+    symbol_count(rules.symbol_count),
+    entry_stack(),
+    first_symbol_filter(rules.first_symbol_filter),
+    first_symbol_default(rules.first_symbol_default),
+    verbose(rules.verbose),
+    count_patterns(rules.count_patterns),
+    delete_patterns(rules.delete_patterns),
+    extract_patterns(rules.extract_patterns),
+    locate_mode(rules.locate_mode),
+    mark_patterns(rules.mark_patterns),
+    max_context_length(rules.max_context_length),
+    max_recursion(rules.max_recursion),
+    need_separators(rules.need_separators),
+    xerox_composition(rules.xerox_composition),
+    line_number(0),
+    profile_mode(rules.profile_mode),
+    single_codepoint_tokenization(rules.single_codepoint_tokenization),
+    max_time(0.0),
+    call_counter(0),
+    limit_reached(false),
+    max_weight(INFINITE_WEIGHT),
+    running_weight(0.0),
+    stack_depth(0),
+    best_input_pos(0)
+{
+    reset_recursion();
+    // The copied alphabet still points at the transducers and counters
+    // of rules, so give it its own
+    alphabet.container = this;
+    for (size_t i = 0; i < alphabet.counters.size(); ++i) {
+        if (alphabet.counters[i] != NO_COUNTER) {
+            alphabet.counters[i] = 0;
+        }
+    }
+    for (RtnVector::iterator it = alphabet.rtns.begin();
+         it != alphabet.rtns.end(); ++it) {
+        if (*it != NULL) {
+            *it = new PmatchTransducer(**it, alphabet, this);
+        }
+    }
+    global_flag_state = alphabet.get_fd_table();
+    toplevel = new PmatchTransducer(*rules.toplevel, alphabet, this);
+    encoder = new Encoder(alphabet.get_symbol_table(), orig_symbol_count);
+    // Symbols that rules picked up from its input so far
+    for (SymbolNumber i = orig_symbol_count; i < symbol_count; ++i) {
+        encoder->read_input_symbol(alphabet.get_symbol_table()[i].c_str(), i);
+    }
+}
+
 bool PmatchAlphabet::is_end_tag(const std::string & symbol)
 {
     return symbol.find("@PMATCH_ENDTAG_") == 0 &&
@@ -904,12 +964,21 @@ void PmatchContainer::process(const std::string & input_str)
         best_result.clear();
         SymbolNumber current_input = input[input_pos];
         if (not_possible_first_symbol(current_input)) {
-            copy_to_result(current_input, current_input);
-            ++input_pos;
-            if (locate_mode && alphabet.is_printable(current_input)) {
-                ++printable_input_pos;
-                nonmatching_locations.push_back(
-                    SymbolPair(current_input, current_input));
+            // Pass over the whole run of positions where no match can
+            // begin without going back to the top of the loop
+            unsigned int run_end = input_pos + 1;
+            while (run_end < input.size() &&
+                   not_possible_first_symbol(input[run_end])) {
+                ++run_end;
+            }
+            for (; input_pos < run_end; ++input_pos) {
+                current_input = input[input_pos];
+                copy_to_result(current_input, current_input);
+                if (locate_mode && alphabet.is_printable(current_input)) {
+                    ++printable_input_pos;
+                    nonmatching_locations.push_back(
+                        SymbolPair(current_input, current_input));
+                }
             }
             continue;
         }
@@ -973,7 +1042,7 @@ std::string PmatchContainer::match(const std::string & input,
     max_time = time_cutoff;
     max_weight = weight_cutoff;
     if (max_time > 0.0) {
-        start_clock = clock();
+        start_clock = std::chrono::steady_clock::now();
         call_counter = 0;
         limit_reached = false;
     }
@@ -989,7 +1058,7 @@ LocationVectorVector PmatchContainer::locate(const std::string & input,
     max_time = time_cutoff;
     max_weight = weight_cutoff;
     if (max_time > 0.0) {
-        start_clock = clock();
+        start_clock = std::chrono::steady_clock::now();
         call_counter = 0;
         limit_reached = false;
     }
@@ -1062,6 +1131,19 @@ std::string PmatchContainer::get_pattern_count_info(void)
     return retval;
 }
 
+void PmatchContainer::merge_counts(const PmatchContainer & other)
+{
+    for (std::map<std::string, size_t>::const_iterator it = other.pattern_counts.begin();
+         it != other.pattern_counts.end(); ++it) {
+        pattern_counts[it->first] += it->second;
+    }
+    for (size_t i = 0; i < alphabet.counters.size() && i < other.alphabet.counters.size(); ++i) {
+        if (alphabet.counters[i] != NO_COUNTER && other.alphabet.counters[i] != NO_COUNTER) {
+            alphabet.counters[i] += other.alphabet.counters[i];
+        }
+    }
+}
+
 void PmatchContainer::copy_to_result(const DoubleTape & best_result)
 {
     for (DoubleTape::const_iterator it = best_result.begin();
@@ -1209,14 +1291,57 @@ bool PmatchContainer::input_matches_at(unsigned int pos,
     return true;
 }
 
+std::shared_ptr<const PmatchTransducer::Tables> PmatchTransducer::read_tables(
+    std::istream & is,
+    TransitionTableIndex index_table_size,
+    TransitionTableIndex transition_table_size)
+{
+    std::shared_ptr<Tables> retval(new Tables);
+    // Allocate and read tables
+    char * indextab = (char*) malloc(TransitionWIndex::size * index_table_size);
+    char * transitiontab = (char*) malloc(TransitionW::size * transition_table_size);
+    is.read(indextab, TransitionWIndex::size * index_table_size);
+    is.read(transitiontab, TransitionW::size * transition_table_size);
+    char * orig_p = indextab;
+    retval->index_table.reserve(index_table_size);
+    while(index_table_size) {
+        retval->index_table.push_back(TransitionWIndex(indextab));
+        --index_table_size;
+        indextab += TransitionWIndex::size;
+    }
+    free(orig_p);
+    orig_p = transitiontab;
+    retval->transition_table.reserve(transition_table_size);
+    while(transition_table_size) {
+        retval->transition_table.push_back(TransitionW(transitiontab));
+        --transition_table_size;
+        transitiontab += TransitionW::size;
+    }
+    free(orig_p);
+    return retval;
+}
+
+std::shared_ptr<const PmatchTransducer::Tables> PmatchTransducer::make_tables(
+    std::vector<TransitionW> & transition_vector,
+    std::vector<TransitionWIndex> & index_vector)
+{
+    std::shared_ptr<Tables> retval(new Tables);
+    retval->transition_table.swap(transition_vector);
+    retval->index_table.swap(index_vector);
+    return retval;
+}
+
 PmatchTransducer::PmatchTransducer(std::istream & is,
                                    TransitionTableIndex index_table_size,
                                    TransitionTableIndex transition_table_size,
                                    PmatchAlphabet & alpha,
                                    std::string _name,
                                    PmatchContainer * cont):
-    alphabet(alpha),
     name(_name),
+    tables(read_tables(is, index_table_size, transition_table_size)),
+    transition_table(tables->transition_table),
+    index_table(tables->index_table),
+    alphabet(alpha),
     container(cont)
 {
     orig_symbol_count = hfst::size_t_to_uint(alphabet.get_symbol_table().size());
@@ -1231,28 +1356,6 @@ PmatchTransducer::PmatchTransducer(std::istream & is,
     local_variables.negative_context_success = false;
     local_variables.pending_passthrough = false;
     local_stack.push(local_variables);
-
-    // Allocate and read tables
-    char * indextab = (char*) malloc(TransitionWIndex::size * index_table_size);
-    char * transitiontab = (char*) malloc(TransitionW::size * transition_table_size);
-    is.read(indextab, TransitionWIndex::size * index_table_size);
-    is.read(transitiontab, TransitionW::size * transition_table_size);
-    char * orig_p = indextab;
-    index_table.reserve(index_table_size);
-    while(index_table_size) {
-        index_table.push_back(TransitionWIndex(indextab));
-        --index_table_size;
-        indextab += TransitionWIndex::size;
-    }
-    free(orig_p);
-    orig_p = transitiontab;
-    transition_table.reserve(transition_table_size);
-    while(transition_table_size) {
-        transition_table.push_back(TransitionW(transitiontab));
-        --transition_table_size;
-        transitiontab += TransitionW::size;
-    }
-    free(orig_p);
 }
 
 PmatchTransducer::PmatchTransducer(std::vector<TransitionW> transition_vector,
@@ -1260,10 +1363,11 @@ PmatchTransducer::PmatchTransducer(std::vector<TransitionW> transition_vector,
                                    PmatchAlphabet & alpha,
                                    std::string _name,
                                    PmatchContainer * cont):
-    transition_table(transition_vector),
-    index_table(index_vector),
-    alphabet(alpha),
     name(_name),
+    tables(make_tables(transition_vector, index_vector)),
+    transition_table(tables->transition_table),
+    index_table(tables->index_table),
+    alphabet(alpha),
     container(cont)
 {
     orig_symbol_count = hfst::size_t_to_uint(alphabet.get_symbol_table().size());
@@ -1280,6 +1384,30 @@ PmatchTransducer::PmatchTransducer(std::vector<TransitionW> transition_vector,
     local_stack.push(local_variables);
 }
 
+PmatchTransducer::PmatchTransducer(const PmatchTransducer & other,
+                                   PmatchAlphabet & alpha,
+                                   PmatchContainer * cont):
+    name(other.name),
+    tables(other.tables),
+    transition_table(tables->transition_table),
+    index_table(tables->index_table),
+    alphabet(alpha),
+    orig_symbol_count(other.orig_symbol_count),
+    container(cont)
+{
+    // Only the bottom frame, as left by the constructor
+    LocalVariables local_variables;
+    local_variables.flag_state = alphabet.get_fd_table();
+    local_variables.tape_step = 1;
+    local_variables.max_context_length_remaining = 254;
+    local_variables.context = none;
+    local_variables.context_placeholder = 0;
+    local_variables.default_symbol_trap = false;
+    local_variables.negative_context_success = false;
+    local_variables.pending_passthrough = false;
+    local_stack.push(local_variables);
+}
+
 void PmatchContainer::set_properties(void)
 {
     count_patterns = false;
@@ -1362,12 +1490,45 @@ void PmatchContainer::set_properties(std::map<std::string, std::string> & proper
 void PmatchContainer::collect_first_symbols(const std::string & symbols_list)
 {
     SymbolNumberVector first_symbols = symbol_vector_from_symbols(symbols_list);
+    if (first_symbol_filter.empty()) {
+        first_symbol_default = false;
+    }
     for (SymbolNumberVector::const_iterator it = first_symbols.begin();
          it != first_symbols.end(); ++it) {
-        while (*it >= possible_first_symbols.size()) {
-            possible_first_symbols.push_back(false);
+        if (*it >= first_symbol_filter.size()) {
+            first_symbol_filter.resize(*it + 1, first_symbol_default);
+        }
+        first_symbol_filter[*it] = 1;
+    }
+}
+
+void PmatchContainer::collect_disallowed_first_symbols(const std::string & symbols_list)
+{
+    SymbolNumberVector disallowed_symbols = symbol_vector_from_symbols(symbols_list);
+    if (first_symbol_filter.empty()) {
+        first_symbol_default = true;
+    }
+    for (SymbolNumberVector::const_iterator it = disallowed_symbols.begin();
+         it != disallowed_symbols.end(); ++it) {
+        if (*it >= first_symbol_filter.size()) {
+            first_symbol_filter.resize(*it + 1, first_symbol_default);
         }
-        possible_first_symbols[*it] = true;
+        first_symbol_filter[*it] = 0;
+    }
+}
+
+void PmatchContainer::collect_first_symbols(std::map<std::string, std::string> & properties)
+{
+    // The compiler writes at most one of these, depending on whether
+    // it could work out what the matches begin with or only what they
+    // can't begin with
+    first_symbol_filter.clear();
+    first_symbol_default = true;
+    if (properties.count("initial-symbols") == 1) {
+        collect_first_symbols(properties["initial-symbols"]);
+    }
+    if (properties.count("disallowed-initial-symbols") == 1) {
+        collect_disallowed_first_symbols(properties["disallowed-initial-symbols"]);
     }
 }
 
@@ -1699,26 +1860,24 @@ void PmatchTransducer::take_flag(SymbolNumber input,
                                  unsigned int tape_pos,
                                  TransitionTableIndex i)
 {
-    std::vector<short> old_global_values;
+    size_t global_position = container->global_flag_state.log_position();
     if (alphabet.is_global_flag(input)) {
-        (old_global_values = container->global_flag_state.get_values());
-        if (((container->global_flag_state).apply_operation
+        if (((container->global_flag_state).apply_operation_logged
              (*(alphabet.get_operation(input)))) == false) {
+            container->global_flag_state.rollback(global_position);
             return;
         }
     }
-    std::vector<short> old_values(local_stack.top().flag_state.get_values());
-    if (local_stack.top().flag_state.apply_operation(
+    size_t local_position = local_stack.top().flag_state.log_position();
+    if (local_stack.top().flag_state.apply_operation_logged(
             *(alphabet.get_operation(input)))) {
         // flag diacritic allowed
         // generally we shouldn't care to write flags
 //                container->tape.write(tape_pos, input, output);
         get_analyses(input_pos, tape_pos, transition_table[i].get_target());
     }
-    if (alphabet.is_global_flag(input)) {
-        (container->global_flag_state).assign_values(old_global_values);
-    }
-    local_stack.top().flag_state.assign_values(old_values);
+    container->global_flag_state.rollback(global_position);
+    local_stack.top().flag_state.rollback(local_position);
 }
 
 void PmatchTransducer::take_transitions(SymbolNumber input,
@@ -1780,7 +1939,9 @@ void PmatchTransducer::get_analyses(unsigned int input_pos,
             (container->call_counter % 1000000 == 0 &&
              (container->candidate_found() &&
               // if we have at least something, stop doing more work
-              (((double)(clock() - container->start_clock)) / CLOCKS_PER_SEC) > container->max_time))) {
+              std::chrono::duration<double>(
+                  std::chrono::steady_clock::now() - container->start_clock).count()
+              > container->max_time))) {
             container->limit_reached = true;
             return;
         }
@@ -1916,4 +2077,94 @@ void PmatchTransducer::exit_context(void)
     local_stack.push(new_top);
 }
 
+PmatchParallelMatcher::PmatchParallelMatcher(const PmatchContainer & rules,
+                                             unsigned int threads)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if (threads == 0) {
+            threads = 1;
+        }
+    }
+    for (unsigned int i = 0; i < threads; ++i) {
+        matchers.push_back(new PmatchContainer(rules));
+    }
+}
+
+PmatchParallelMatcher::~PmatchParallelMatcher(void)
+{
+    for (std::vector<PmatchContainer *>::iterator it = matchers.begin();
+         it != matchers.end(); ++it) {
+        delete *it;
+    }
+}
+
+// The state shared by the threads of one PmatchParallelMatcher::run
+struct ParallelMatchBatch
+{
+    const std::vector<std::string> * inputs;
+    std::vector<std::string> * outputs;
+    PmatchJob * job;
+    std::atomic<size_t> next;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+static void run_parallel_match(ParallelMatchBatch * batch,
+                               PmatchContainer * matcher)
+{
+    try {
+        size_t i;
+        while ((i = batch->next++) < batch->inputs->size()) {
+            std::ostringstream out;
+            (*batch->job)(*matcher, (*batch->inputs)[i], out);
+            (*batch->outputs)[i] = out.str();
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(batch->error_mutex);
+        if (!batch->error) {
+            batch->error = std::current_exception();
+        }
+        // Make the other threads stop too
+        batch->next = batch->inputs->size();
+    }
+}
+
+std::vector<std::string> PmatchParallelMatcher::run(
+    const std::vector<std::string> & inputs, PmatchJob job)
+{
+    std::vector<std::string> outputs(inputs.size());
+    ParallelMatchBatch batch;
+    batch.inputs = &inputs;
+    batch.outputs = &outputs;
+    batch.job = &job;
+    batch.next = 0;
+    size_t thread_count = std::min(matchers.size(), inputs.size());
+    if (thread_count <= 1) {
+        if (thread_count == 1) {
+            run_parallel_match(&batch, matchers[0]);
+        }
+    } else {
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers.push_back(std::thread(run_parallel_match, &batch, matchers[i]));
+        }
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+    }
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+    return outputs;
+}
+
+void PmatchParallelMatcher::merge_counts_into(PmatchContainer & container) const
+{
+    for (std::vector<PmatchContainer *>::const_iterator it = matchers.begin();
+         it != matchers.end(); ++it) {
+        container.merge_counts(**it);
+    }
+}
+
 }
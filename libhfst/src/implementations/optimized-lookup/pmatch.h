@@ -14,6 +14,9 @@
 #include <sstream>
 #include <algorithm>
 #include <ctime>
+#include <chrono>
+#include <memory>
+#include <functional>
 #include "HfstTransducer.h"
 #include "HfstExceptionDefs.h"
 #include "transducer.h"
@@ -171,7 +174,12 @@ namespace hfst_ol {
         std::vector<Capture> captures;
         std::vector<Capture> best_captures;
         std::vector<Capture> old_captures;
-        std::vector<bool> possible_first_symbols;
+        // Indexed by symbol number, nonzero if the symbol can begin a
+        // match. Empty if nothing is known about the first symbols.
+        std::vector<char> first_symbol_filter;
+        // Whether symbols outside first_symbol_filter, such as ones first
+        // seen in the input, can begin a match
+        bool first_symbol_default;
         // The flag state for global flags
         hfst::FdState<SymbolNumber> global_flag_state;
         bool verbose;
@@ -194,7 +202,7 @@ namespace hfst_ol {
         // An optional time limit for operations
         double max_time;
         // When we started work
-        clock_t start_clock;
+        std::chrono::steady_clock::time_point start_clock;
         // A counter to avoid checking the clock too often
         unsigned long call_counter;
         // A flag to set for when time has been overstepped
@@ -212,17 +220,29 @@ namespace hfst_ol {
         unsigned int best_input_pos;
         Weight best_weight;
 
+        // Not implemented, matcher contexts are made with the copy
+        // constructor
+        PmatchContainer & operator=(const PmatchContainer & other);
+
     public:
 
         PmatchContainer(std::istream & is);
         PmatchContainer(Transducer * toplevel);
         PmatchContainer(std::vector<hfst::HfstTransducer> transducers);
         PmatchContainer(void);
+        // Make a new matcher context for the rules of another container.
+        // The transition tables are shared, everything that changes
+        // during matching (tapes, stacks, captures, counts and the
+        // alphabet, which grows with unseen input) is private to the new
+        // container, so the two can be used from different threads.
+        PmatchContainer(const PmatchContainer & rules);
         ~PmatchContainer(void);
 
         void set_properties(void);
         void set_properties(std::map<std::string, std::string> & properties);
         void collect_first_symbols(const std::string & symbol_list);
+        void collect_disallowed_first_symbols(const std::string & symbol_list);
+        void collect_first_symbols(std::map<std::string, std::string> & properties);
         SymbolNumberVector symbol_vector_from_symbols(const std::string & symbols);
         void initialize_input(const char * input);
         bool has_unsatisfied_rtns(void) const;
@@ -242,17 +262,22 @@ namespace hfst_ol {
         get_longest_matching_capture(SymbolNumber key, unsigned int input_pos);
         std::string get_profiling_info(void);
         std::string get_pattern_count_info(void);
+        // Add the pattern counts and profiling counters of another
+        // context of the same rules to ours
+        void merge_counts(const PmatchContainer & other);
         bool has_queued_input(unsigned int input_pos);
         bool input_matches_at(unsigned int pos,
                               SymbolNumberVector::iterator begin,
                               SymbolNumberVector::iterator end);
-        bool not_possible_first_symbol(SymbolNumber sym)
+        bool not_possible_first_symbol(SymbolNumber sym) const
         {
-            if (possible_first_symbols.size() == 0) {
+            if (first_symbol_filter.empty()) {
                 return false;
             }
-            return sym >= possible_first_symbols.size() ||
-                possible_first_symbols[sym] == false;
+            if (sym >= first_symbol_filter.size()) {
+                return !first_symbol_default;
+            }
+            return first_symbol_filter[sym] == 0;
         }
         void copy_to_result(const DoubleTape & best_result);
         void copy_to_result(SymbolNumber input, SymbolNumber output);
@@ -363,9 +388,26 @@ namespace hfst_ol {
         };
 
         std::stack<LocalVariables> local_stack;
-    
-        std::vector<TransitionW> transition_table;
-        std::vector<TransitionWIndex> index_table;
+
+        // The tables are not modified after loading, so they are shared
+        // between the copies of a transducer in different matcher
+        // contexts.
+        struct Tables
+        {
+            std::vector<TransitionW> transition_table;
+            std::vector<TransitionWIndex> index_table;
+        };
+        std::shared_ptr<const Tables> tables;
+        const std::vector<TransitionW> & transition_table;
+        const std::vector<TransitionWIndex> & index_table;
+
+        static std::shared_ptr<const Tables> read_tables(
+            std::istream & is,
+            TransitionTableIndex index_table_size,
+            TransitionTableIndex transition_table_size);
+        static std::shared_ptr<const Tables> make_tables(
+            std::vector<TransitionW> & transition_vector,
+            std::vector<TransitionWIndex> & index_vector);
 
         PmatchAlphabet & alphabet;
         SymbolNumber orig_symbol_count;
@@ -445,6 +487,12 @@ namespace hfst_ol {
                          std::string name,
                          PmatchContainer * container);
 
+        // A transducer sharing the tables of another, for a different
+        // matcher context
+        PmatchTransducer(const PmatchTransducer & other,
+                         PmatchAlphabet & alphabet,
+                         PmatchContainer * container);
+
         bool final_index(TransitionTableIndex i) const
         {
             if (indexes_transition_table(i)) {
@@ -472,6 +520,38 @@ namespace hfst_ol {
         friend class PmatchContainer;
     };
 
+    // A job run on one input by PmatchParallelMatcher. It gets the
+    // matcher context of the thread it runs in and writes its result
+    // into the given stream.
+    typedef std::function<void(PmatchContainer &,
+                               const std::string &,
+                               std::ostream &)> PmatchJob;
+
+    // Runs a job on batches of inputs on several threads. Every thread
+    // has its own matcher context made from the same rules, and the
+    // outputs are returned in the order of the inputs.
+    class PmatchParallelMatcher
+    {
+    protected:
+        std::vector<PmatchContainer *> matchers;
+
+        // Not implemented
+        PmatchParallelMatcher(const PmatchParallelMatcher & other);
+        PmatchParallelMatcher & operator=(const PmatchParallelMatcher & other);
+
+    public:
+        // threads == 0 means one thread per hardware thread
+        PmatchParallelMatcher(const PmatchContainer & rules,
+                              unsigned int threads);
+        ~PmatchParallelMatcher(void);
+        unsigned int get_threads(void) const
+            { return (unsigned int)matchers.size(); }
+        std::vector<std::string> run(const std::vector<std::string> & inputs,
+                                     PmatchJob job);
+        // Add the counts of all matcher contexts to those of container
+        void merge_counts_into(PmatchContainer & container) const;
+    };
+
 }
 
 #endif //_HFST_OL_TRANSDUCER_PMATCH_H_
@@ -13,8 +13,18 @@
 #if USE_ICU_UNICODE
 #include <unicode/unistr.h>
 #include <unicode/brkiter.h>
-static UErrorCode characterBoundaryStatus = U_ZERO_ERROR;
-static icu::BreakIterator* characterBoundary = icu::BreakIterator::createCharacterInstance(NULL, characterBoundaryStatus);
+#include <memory>
+// A BreakIterator holds the text it was last given, so every thread that
+// tokenizes needs its own
+static icu::BreakIterator* characterBoundary()
+{
+    static thread_local std::unique_ptr<icu::BreakIterator> iterator;
+    if (!iterator) {
+        UErrorCode characterBoundaryStatus = U_ZERO_ERROR;
+        iterator.reset(icu::BreakIterator::createCharacterInstance(NULL, characterBoundaryStatus));
+    }
+    return iterator.get();
+}
 #endif
 
 namespace hfst_ol_tokenize {
@@ -236,8 +246,8 @@ size_t u8_first_codepoint_size(const unsigned char* c) {
 bool is_cg_tag(const string & str) {
 #if USE_ICU_UNICODE
     icu::UnicodeString us(str.c_str());
-    characterBoundary->setText(us);
-    return us.length() > characterBoundary->following(0);
+    characterBoundary()->setText(us);
+    return us.length() > characterBoundary()->following(0);
 #else
     // Note: invalid codepoints are also treated as tags;  ¯\_(ツ)_/¯
     return str.size() > u8_first_codepoint_size((const unsigned char*)str.c_str());
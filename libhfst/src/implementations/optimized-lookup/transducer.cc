@@ -10,6 +10,17 @@
 #include "./transducer.h"
 
 #include <cstdio> // testing
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+#ifndef _MSC_VER
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
 
 #ifndef MAIN_TEST
 
@@ -187,40 +198,60 @@ Weight TransitionWIndex::final_weight(void) const
     return weight.w;
 }
 
-void OlLetterTrie::add_string(const char * p, SymbolNumber symbol_key)
+TableMapping::TableMapping(const std::string & filename,
+                           size_t offset, size_t length):
+    region(NULL), region_size(0), data(NULL), data_size(length), mapped(false)
 {
-    if (*(p+1) == 0)
-    {
-        symbols[(unsigned char)(*p)] = symbol_key;
-        return;
+#ifndef _MSC_VER
+    if (length > 0) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            HFST_THROW(StreamNotReadableException);
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 ||
+            (size_t)file_stat.st_size < offset + length) {
+            close(fd);
+            HFST_THROW(TransducerHasWrongTypeException);
+        }
+        // mmap wants a page-aligned offset, so map from the start of the
+        // page and skip the leading bytes
+        size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        size_t aligned_offset = offset - offset % page_size;
+        region_size = length + (offset - aligned_offset);
+        void * p = mmap(NULL, region_size, PROT_READ, MAP_SHARED,
+                        fd, (off_t)aligned_offset);
+        close(fd);
+        if (p != MAP_FAILED) {
+            region = static_cast<char*>(p);
+            data = region + (offset - aligned_offset);
+            mapped = true;
+            return;
+        }
     }
-    if (letters[(unsigned char)(*p)] == NULL)
-    {
-        letters[(unsigned char)(*p)] = new OlLetterTrie();
+#endif
+    // No mmap available or it failed, read the range instead
+    region_size = length;
+    region = static_cast<char*>(malloc(length > 0 ? length : 1));
+    std::ifstream is(filename.c_str(), std::ios::in | std::ios::binary);
+    is.seekg(offset);
+    is.read(region, length);
+    if (!is) {
+        free(region);
+        HFST_THROW(TransducerHasWrongTypeException);
     }
-    letters[(unsigned char)(*p)]->add_string(p+1,symbol_key);
+    data = region;
 }
 
-bool OlLetterTrie::has_key_starting_with(const char c) const
+TableMapping::~TableMapping()
 {
-    return letters[(unsigned char) c] != NULL;
-}
-
-SymbolNumber OlLetterTrie::find_key(char ** p)
-{
-    const char * old_p = *p;
-    ++(*p);
-    if (letters[(unsigned char)(*old_p)] == NULL)
-    {
-        return symbols[(unsigned char)(*old_p)];
-    }
-    SymbolNumber s = letters[(unsigned char)(*old_p)]->find_key(p);
-    if (s == NO_SYMBOL_NUMBER)
-    {
-        --(*p);
-        return symbols[(unsigned char)(*old_p)];
+#ifndef _MSC_VER
+    if (mapped) {
+        munmap(region, region_size);
+        return;
     }
-    return s;
+#endif
+    free(region);
 }
 
 void Encoder::read_input_symbols(const SymbolTable & kt)
@@ -245,7 +276,7 @@ void Encoder::read_input_symbol(const char * s, const int s_num)
     letters.add_string(s, s_num);
 }
 
-SymbolNumber Encoder::find_key(char ** p)
+SymbolNumber Encoder::find_key(char ** p) const
 {
     if (!should_ascii_tokenize((unsigned char) **p) ||
         ascii_symbols[(unsigned char)(**p)] == NO_SYMBOL_NUMBER)
@@ -257,15 +288,368 @@ SymbolNumber Encoder::find_key(char ** p)
     return s;
 }
 
-bool Transducer::initialize_input(const char * input)
+void Transducer::include_symbol_in_alphabet(const std::string & sym)
+{
+    if (cache != NULL) {
+        // results for inputs with this symbol may change
+        cache->clear();
+    }
+    SymbolNumber key = alphabet->symbol_from_string(sym);
+    if (key != NO_SYMBOL_NUMBER) {
+        return;
+    }
+    key = hfst::size_t_to_uint(alphabet->get_symbol_table().size());
+    alphabet->add_symbol(sym);
+    char * cstr_for_encoder = new char[sym.size() + 1];
+    //std::strcpy(cstr_for_encoder, sym.c_str());
+    strcpy(cstr_for_encoder, sym.c_str());
+    encoder->read_input_symbol(cstr_for_encoder, key);
+    delete[] cstr_for_encoder;
+}
+
+HfstOneLevelPaths * Transducer::lookup_fd(const StringVector & s, ssize_t limit,
+                                          double time_cutoff)
+{
+    std::string input_str;
+    for (StringVector::const_iterator it = s.begin(); it != s.end(); ++it) {
+        input_str.append(*it);
+    }
+    return lookup_fd(get_session(), input_str, limit, time_cutoff);
+}
+
+HfstOneLevelPaths * Transducer::lookup_fd(const std::string & s, ssize_t limit,
+                                          double time_cutoff)
+{
+    return lookup_fd(get_session(), s, limit, time_cutoff);
+}
+
+HfstOneLevelPaths * Transducer::lookup_fd(const char * s, ssize_t limit,
+                                          double time_cutoff)
+{
+    return lookup_fd(get_session(), std::string(s), limit, time_cutoff);
+}
+
+HfstOneLevelPaths * Transducer::lookup_fd(LookupSession & session,
+                                          const std::string & s,
+                                          ssize_t limit,
+                                          double time_cutoff) const
+{
+    if (cache == NULL || time_cutoff > 0.0) {
+        return session.lookup_fd(s, limit, time_cutoff);
+    }
+    HfstOneLevelPaths * results = new HfstOneLevelPaths;
+    if (cache->find(s, limit, *results)) {
+        return results;
+    }
+    delete results;
+    results = session.lookup_fd(s, limit, time_cutoff);
+    cache->insert(s, limit, *results);
+    return results;
+}
+
+void Transducer::set_lookup_cache(size_t max_entries, size_t max_bytes)
+{
+    delete cache;
+    cache = NULL;
+    if (max_entries != 0 || max_bytes != 0) {
+        cache = new LookupCache(max_entries, max_bytes);
+    }
+}
+
+HfstTwoLevelPaths * Transducer::lookup_fd_pairs(const std::string & s,
+                                                ssize_t limit,
+                                                double time_cutoff)
+{
+    return get_session().lookup_fd_pairs(s, limit, time_cutoff);
+}
+
+HfstTwoLevelPaths * Transducer::lookup_fd_pairs(const char * s, ssize_t limit,
+                                                double time_cutoff)
+{
+    return get_session().lookup_fd_pairs(s, limit, time_cutoff);
+}
+
+bool Transducer::is_lookup_infinitely_ambiguous(const std::string & s)
+{
+    return get_session().is_lookup_infinitely_ambiguous(s);
+}
+
+bool Transducer::is_lookup_infinitely_ambiguous(const StringVector & s)
+{
+    return get_session().is_lookup_infinitely_ambiguous(s);
+}
+
+LookupSession & Transducer::get_session(void)
+{
+    if (session == NULL) {
+        session = new LookupSession(*this);
+    }
+    return *session;
+}
+
+LookupCache::LookupCache(size_t max_entries, size_t max_bytes):
+    max_entries(max_entries), max_bytes(max_bytes),
+    bytes(0), hits(0), misses(0)
+{}
+
+std::string LookupCache::make_key(const std::string & input, ssize_t limit)
+{
+    // Inputs are C strings, so they can't contain the separator
+    std::ostringstream key;
+    key << input << '\0' << limit;
+    return key.str();
+}
+
+size_t LookupCache::entry_bytes(const Entry & entry)
+{
+    // An estimate of the memory used by the entry, its list node, its
+    // position in the hash table and the nodes of the result set
+    size_t size = sizeof(Entry) + 2 * sizeof(void*) + entry.first.capacity()
+        + entry.first.size() + 4 * sizeof(void*);
+    for (HfstOneLevelPaths::const_iterator it = entry.second.begin();
+         it != entry.second.end(); ++it) {
+        size += sizeof(HfstOneLevelPath) + 4 * sizeof(void*);
+        for (StringVector::const_iterator sym = it->second.begin();
+             sym != it->second.end(); ++sym) {
+            size += sizeof(std::string) + sym->capacity();
+        }
+    }
+    return size;
+}
+
+void LookupCache::evict(void)
+{
+    while (!entries.empty() &&
+           ((max_entries != 0 && entries.size() > max_entries) ||
+            (max_bytes != 0 && bytes > max_bytes))) {
+        Entry & last = entries.back();
+        bytes -= entry_bytes(last);
+        positions.erase(last.first);
+        entries.pop_back();
+    }
+}
+
+bool LookupCache::find(const std::string & input, ssize_t limit,
+                       HfstOneLevelPaths & result)
+{
+    std::string key = make_key(input, limit);
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::unordered_map<std::string, EntryList::iterator>::iterator it =
+        positions.find(key);
+    if (it == positions.end()) {
+        ++misses;
+        return false;
+    }
+    ++hits;
+    // Move the entry to the front of the list
+    entries.splice(entries.begin(), entries, it->second);
+    result = it->second->second;
+    return true;
+}
+
+void LookupCache::insert(const std::string & input, ssize_t limit,
+                         const HfstOneLevelPaths & result)
+{
+    Entry entry(make_key(input, limit), result);
+    size_t size = entry_bytes(entry);
+    if (max_bytes != 0 && size > max_bytes) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (positions.find(entry.first) != positions.end()) {
+        // Another thread got here first
+        return;
+    }
+    entries.push_front(Entry());
+    entries.front().first.swap(entry.first);
+    entries.front().second.swap(entry.second);
+    positions[entries.front().first] = entries.begin();
+    bytes += size;
+    evict();
+}
+
+void LookupCache::clear(void)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    entries.clear();
+    positions.clear();
+    bytes = 0;
+}
+
+size_t LookupCache::get_hits(void) const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return hits;
+}
+
+size_t LookupCache::get_misses(void) const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return misses;
+}
+
+size_t LookupCache::get_entries(void) const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return entries.size();
+}
+
+size_t LookupCache::get_bytes(void) const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return bytes;
+}
+
+// The state shared by the threads of a batch lookup. Each thread takes
+// the next unclaimed input until all of them have been looked up.
+struct BatchLookup
+{
+    const Transducer & transducer;
+    const StringVector & inputs;
+    ssize_t limit;
+    double time_cutoff;
+    bool check_infinite;
+    ssize_t infinite_limit;
+    std::vector<HfstOneLevelPaths*> results;
+    // not std::vector<bool>, whose elements can't be written concurrently
+    std::vector<char> infinite;
+    std::atomic<size_t> next;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    BatchLookup(const Transducer & t, const StringVector & i, ssize_t l,
+                double c, bool ci, ssize_t il):
+        transducer(t), inputs(i), limit(l), time_cutoff(c),
+        check_infinite(ci), infinite_limit(il),
+        results(i.size(), NULL), infinite(i.size(), 0), next(0)
+        {}
+
+    void run(void)
+    {
+        try {
+            LookupSession session(transducer);
+            for (size_t i = next++; i < inputs.size(); i = next++) {
+                ssize_t l = limit;
+                if (check_infinite &&
+                    session.is_lookup_infinitely_ambiguous(inputs[i])) {
+                    infinite[i] = 1;
+                    l = infinite_limit;
+                }
+                results[i] = transducer.lookup_fd(session, inputs[i], l,
+                                                  time_cutoff);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            // stop the other threads too
+            next = inputs.size();
+        }
+    }
+};
+
+static void run_batch_lookup(BatchLookup * batch)
+{
+    batch->run();
+}
+
+std::vector<HfstOneLevelPaths*> Transducer::lookup_fd_batch(
+    const StringVector & inputs, unsigned int threads, ssize_t limit,
+    double time_cutoff, std::vector<bool> * infinite,
+    ssize_t infinite_limit) const
+{
+    BatchLookup batch(*this, inputs, limit, time_cutoff,
+                      infinite != NULL && time_cutoff == 0.0,
+                      infinite_limit);
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads > inputs.size()) {
+        threads = hfst::size_t_to_uint(inputs.size());
+    }
+    if (threads <= 1) {
+        batch.run();
+    } else {
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < threads; ++i) {
+            workers.push_back(std::thread(run_batch_lookup, &batch));
+        }
+        for (unsigned int i = 0; i < threads; ++i) {
+            workers[i].join();
+        }
+    }
+    if (batch.error) {
+        for (size_t i = 0; i < batch.results.size(); ++i) {
+            delete batch.results[i];
+        }
+        std::rethrow_exception(batch.error);
+    }
+    if (infinite != NULL) {
+        infinite->assign(batch.infinite.begin(), batch.infinite.end());
+    }
+    return batch.results;
+}
+
+LookupSession::LookupSession(const Transducer & t):
+    alphabet(*t.alphabet), tables(*t.tables), encoder(*t.encoder),
+    current_weight(0.0), lookup_paths(NULL),
+    input_tape(), output_tape(),
+    flag_state(t.alphabet->get_fd_table()), found_transition(false),
+    max_lookups(-1), recursion_depth_left(MAX_RECURSION_DEPTH),
+    max_time(0.0), start_clock(), extra_symbols(), extra_symbols_start(0),
+    table_type(OtherTables)
+{
+    // Find out the concrete type of the tables once, so that the lookup
+    // core can be instantiated for it and doesn't need virtual calls
+    if (dynamic_cast<const TransducerTables<TransitionWIndex, TransitionW>*>(
+            &tables) != NULL) {
+        table_type = WeightedTables;
+    } else if (dynamic_cast<const TransducerTables<TransitionIndex, Transition>*>(
+                   &tables) != NULL) {
+        table_type = UnweightedTables;
+    } else if (dynamic_cast<const MappedTransducerTables<
+               TransitionWIndex, TransitionW>*>(&tables) != NULL) {
+        table_type = MappedWeightedTables;
+    } else if (dynamic_cast<const MappedTransducerTables<
+               TransitionIndex, Transition>*>(&tables) != NULL) {
+        table_type = MappedUnweightedTables;
+    }
+}
+
+SymbolNumber LookupSession::extra_symbol(const std::string & symbol)
+{
+    for (size_t i = 0; i < extra_symbols.size(); ++i) {
+        if (extra_symbols[i] == symbol) {
+            return hfst::size_t_to_uint(extra_symbols_start + i);
+        }
+    }
+    extra_symbols.push_back(symbol);
+    return hfst::size_t_to_uint(extra_symbols_start + extra_symbols.size() - 1);
+}
+
+std::string LookupSession::string_from_symbol(SymbolNumber symbol) const
 {
+    if (symbol != NO_SYMBOL_NUMBER && symbol >= extra_symbols_start) {
+        return extra_symbols[symbol - extra_symbols_start];
+    }
+    return alphabet.string_from_symbol(symbol);
+}
+
+bool LookupSession::initialize_input(const char * input)
+{
+    // Symbols not in the alphabet are numbered after it, but only for the
+    // duration of this lookup, so the transducer itself isn't modified
+    extra_symbols.clear();
+    extra_symbols_start = hfst::size_t_to_uint(
+        alphabet.get_symbol_table().size());
     char * input_str = const_cast<char *>(input);
     char ** input_str_ptr = &input_str;
     unsigned int i = 0;
     SymbolNumber k = NO_SYMBOL_NUMBER;
     while(**input_str_ptr != 0) {
         char * original_input_loc = *input_str_ptr;
-        k = encoder->find_key(input_str_ptr);
+        k = encoder.find_key(input_str_ptr);
         if (k == NO_SYMBOL_NUMBER) {
             // Add what we assume to be an unknown utf-8 symbol to the alphabet
             *input_str_ptr = original_input_loc;
@@ -273,14 +657,8 @@ bool Transducer::initialize_input(const char * input)
             if (bytes_to_tokenize == 0) {
                 return false; // tokenization failed
             }
-            char * new_symbol = new char[bytes_to_tokenize + 1];
-            memcpy(new_symbol, *input_str_ptr, bytes_to_tokenize);
-            new_symbol[bytes_to_tokenize] = '\0';
+            k = extra_symbol(std::string(*input_str_ptr, bytes_to_tokenize));
             (*input_str_ptr) += bytes_to_tokenize;
-            alphabet->add_symbol(new_symbol);
-            k = hfst::size_t_to_uint(alphabet->get_symbol_table().size() - 1);
-            encoder->read_input_symbol(new_symbol, k);
-            delete [] new_symbol;
         }
         input_tape.write(i, k);
         ++i;
@@ -289,22 +667,7 @@ bool Transducer::initialize_input(const char * input)
     return true;
 }
 
-void Transducer::include_symbol_in_alphabet(const std::string & sym)
-{
-    SymbolNumber key = alphabet->symbol_from_string(sym);
-    if (key != NO_SYMBOL_NUMBER) {
-        return;
-    }
-    key = hfst::size_t_to_uint(alphabet->get_symbol_table().size());
-    alphabet->add_symbol(sym);
-    char * cstr_for_encoder = new char[sym.size() + 1];
-    //std::strcpy(cstr_for_encoder, sym.c_str());
-    strcpy(cstr_for_encoder, sym.c_str());
-    encoder->read_input_symbol(cstr_for_encoder, key);
-    delete[] cstr_for_encoder;
-}
-
-HfstOneLevelPaths * Transducer::lookup_fd(const StringVector & s, ssize_t limit,
+HfstOneLevelPaths * LookupSession::lookup_fd(const StringVector & s, ssize_t limit,
                                           double time_cutoff)
 {
     std::string input_str;
@@ -314,19 +677,19 @@ HfstOneLevelPaths * Transducer::lookup_fd(const StringVector & s, ssize_t limit,
     return lookup_fd(input_str, limit, time_cutoff);
 }
 
-HfstOneLevelPaths * Transducer::lookup_fd(const std::string & s, ssize_t limit,
+HfstOneLevelPaths * LookupSession::lookup_fd(const std::string & s, ssize_t limit,
                                           double time_cutoff)
 {
     return lookup_fd(s.c_str(), limit, time_cutoff);
 }
 
-HfstTwoLevelPaths * Transducer::lookup_fd_pairs(const std::string & s, ssize_t limit,
+HfstTwoLevelPaths * LookupSession::lookup_fd_pairs(const std::string & s, ssize_t limit,
                                                 double time_cutoff)
 {
     return lookup_fd_pairs(s.c_str(), limit, time_cutoff);
 }
 
-bool Transducer::is_lookup_infinitely_ambiguous(const std::string & s)
+bool LookupSession::is_lookup_infinitely_ambiguous(const std::string & s)
 {
     if (!initialize_input(s.c_str())) {
         return false;
@@ -336,13 +699,13 @@ bool Transducer::is_lookup_infinitely_ambiguous(const std::string & s)
         find_loop(0, 0);
     } catch (bool e) {
         current_weight = 0.0;
-        flag_state = alphabet->get_fd_table();
+        flag_state = alphabet.get_fd_table();
         return e;
     }
     return false;
 }
 
-bool Transducer::is_lookup_infinitely_ambiguous(const StringVector & s)
+bool LookupSession::is_lookup_infinitely_ambiguous(const StringVector & s)
 {
     std::string input_str;
     for (StringVector::const_iterator it = s.begin(); it != s.end(); ++it) {
@@ -352,14 +715,14 @@ bool Transducer::is_lookup_infinitely_ambiguous(const StringVector & s)
 }
 
 
-HfstOneLevelPaths * Transducer::lookup_fd(const char * s, ssize_t limit,
+HfstOneLevelPaths * LookupSession::lookup_fd(const char * s, ssize_t limit,
                                           double time_cutoff)
 {
     max_lookups = limit;
     max_time = 0.0;
     if (time_cutoff > 0.0) {
         max_time = time_cutoff;
-        start_clock = clock();
+        start_clock = std::chrono::steady_clock::now();
     }
     HfstOneLevelPaths * results = new HfstOneLevelPaths;
     if (!initialize_input(s)) {
@@ -368,7 +731,7 @@ HfstOneLevelPaths * Transducer::lookup_fd(const char * s, ssize_t limit,
     lookup_paths = new HfstTwoLevelPaths;
     traversal_states.clear();
     //current_weight += s.second;
-    get_analyses(0, 0, 0);
+    analyse();
     //current_weight -= s.second;
     for (HfstTwoLevelPaths::iterator it = lookup_paths->begin();
          it != lookup_paths->end(); ++it) {
@@ -385,14 +748,14 @@ HfstOneLevelPaths * Transducer::lookup_fd(const char * s, ssize_t limit,
     return results;
 }
 
-HfstTwoLevelPaths * Transducer::lookup_fd_pairs(const char * s, ssize_t limit,
+HfstTwoLevelPaths * LookupSession::lookup_fd_pairs(const char * s, ssize_t limit,
                                                 double time_cutoff)
 {
     max_lookups = limit;
     max_time = 0.0;
     if (time_cutoff > 0.0) {
         max_time = time_cutoff;
-        start_clock = clock();
+        start_clock = std::chrono::steady_clock::now();
     }
     HfstTwoLevelPaths * results = new HfstTwoLevelPaths;
     lookup_paths = results;
@@ -402,40 +765,43 @@ HfstTwoLevelPaths * Transducer::lookup_fd_pairs(const char * s, ssize_t limit,
     }
     traversal_states.clear();
     //current_weight += s.second;
-    get_analyses(0, 0, 0);
+    analyse();
     //current_weight -= s.second;
     lookup_paths = NULL;
     return results;
 }
 
-void Transducer::try_epsilon_transitions(unsigned int input_pos,
-                                         unsigned int output_pos,
-                                         TransitionTableIndex i)
+template <class Tables>
+void LookupSession::try_epsilon_transitions(const Tables & t,
+                                            unsigned int input_pos,
+                                            unsigned int output_pos,
+                                            TransitionTableIndex i)
 {
     while (true)
     {
-        SymbolNumber input = tables->get_transition_input(i);
-        SymbolNumber output = tables->get_transition_output(i);
-        TransitionTableIndex target = tables->get_transition_target(i);
-        Weight weight = tables->get_weight(i);
+        SymbolNumber input = t.transition_input(i);
+        SymbolNumber output = t.transition_output(i);
+        TransitionTableIndex target = t.transition_target(i);
+        Weight weight = t.transition_weight(i);
         Weight old_weight = current_weight;
         if (input == 0) // epsilon
         {
             output_tape.write(output_pos, input, output);
             current_weight += weight;
-            get_analyses(input_pos, output_pos + 1, target);
+            get_analyses(t, input_pos, output_pos + 1, target);
             found_transition = true;
             current_weight = old_weight;
             ++i;
-        } else if (alphabet->is_flag_diacritic(input)) {
-            FlagDiacriticState flags = flag_state.get_values();
-            if (flag_state.apply_operation(
-                    *(alphabet->get_operation(input)))) {
+        } else if (alphabet.is_flag_diacritic(input)) {
+            TraversalState flag_reachable(target,
+                                          flag_state.get_packed_values());
+            size_t flag_position = flag_state.log_position();
+            if (flag_state.apply_operation_logged(
+                    *(alphabet.get_operation(input)))) {
                 // flag diacritic allowed
-                TraversalState flag_reachable(target, flags);
                 if (traversal_states.count(flag_reachable) == 1) {
                     // We've been here before at this input, back out
-                    flag_state.assign_values(flags);
+                    flag_state.rollback(flag_position);
                     ++i;
                     continue;
                 }
@@ -443,12 +809,12 @@ void Transducer::try_epsilon_transitions(unsigned int input_pos,
                 traversal_states.insert(flag_reachable);
                 output_tape.write(output_pos, input, output);
                 current_weight += weight;
-                get_analyses(input_pos, output_pos + 1, target);
+                get_analyses(t, input_pos, output_pos + 1, target);
                 found_transition = true;
                 current_weight = old_weight;
                 traversal_states.erase(flag_reachable);
             }
-            flag_state.assign_values(flags);
+            flag_state.rollback(flag_position);
             ++i;
         } else { // it's not epsilon and it's not a flag, so nothing to do
             return;
@@ -456,44 +822,48 @@ void Transducer::try_epsilon_transitions(unsigned int input_pos,
     }
 }
 
-void Transducer::try_epsilon_indices(unsigned int input_pos,
-                                     unsigned int output_pos,
-                                     TransitionTableIndex i)
+template <class Tables>
+void LookupSession::try_epsilon_indices(const Tables & t,
+                                        unsigned int input_pos,
+                                        unsigned int output_pos,
+                                        TransitionTableIndex i)
 {
-    if (tables->get_index_input(i) == 0)
+    if (t.index_input(i) == 0)
     {
-        try_epsilon_transitions(input_pos,
+        try_epsilon_transitions(t, input_pos,
                                 output_pos,
-                                tables->get_index_target(i) -
+                                t.index_target(i) -
                                 TRANSITION_TARGET_TABLE_START);
         found_transition = true;
     }
 }
 
-void Transducer::find_transitions(SymbolNumber input,
-                                  unsigned int input_pos,
-                                  unsigned int output_pos,
-                                  TransitionTableIndex i)
+template <class Tables>
+void LookupSession::find_transitions(const Tables & t,
+                                     SymbolNumber input,
+                                     unsigned int input_pos,
+                                     unsigned int output_pos,
+                                     TransitionTableIndex i)
 {
 
-    while (tables->get_transition_input(i) != NO_SYMBOL_NUMBER)
+    while (t.transition_input(i) != NO_SYMBOL_NUMBER)
     {
-        if (tables->get_transition_input(i) == input)
+        if (t.transition_input(i) == input)
         {
             Weight old_weight = current_weight;
             // We're not going to find an epsilon / flag loop
             traversal_states.clear();
-            SymbolNumber output = tables->get_transition_output(i);
-            if (alphabet->is_meta_arc(output)) {
+            SymbolNumber output = t.transition_output(i);
+            if (alphabet.is_meta_arc(output)) {
                 // we got here via default, identity or unknown, so look
                 // back in the input tape to find the symbol we want to write
                 output = input_tape[input_pos - 1];
             }
             output_tape.write(output_pos, input, output);
-            current_weight += tables->get_weight(i);
-            get_analyses(input_pos,
+            current_weight += t.transition_weight(i);
+            get_analyses(t, input_pos,
                          output_pos + 1,
-                         tables->get_transition_target(i));
+                         t.transition_target(i));
             current_weight = old_weight;
             found_transition = true;
         }
@@ -505,17 +875,19 @@ void Transducer::find_transitions(SymbolNumber input,
     }
 }
 
-void Transducer::find_index(SymbolNumber input,
-                            unsigned int input_pos,
-                            unsigned int output_pos,
-                            TransitionTableIndex i)
+template <class Tables>
+void LookupSession::find_index(const Tables & t,
+                               SymbolNumber input,
+                               unsigned int input_pos,
+                               unsigned int output_pos,
+                               TransitionTableIndex i)
 {
-    if (tables->get_index_input(i+input) == input)
+    if (t.index_input(i+input) == input)
     {
-        find_transitions(input,
+        find_transitions(t, input,
                          input_pos,
                          output_pos,
-                         tables->get_index_target(i+input) -
+                         t.index_target(i+input) -
                          TRANSITION_TARGET_TABLE_START);
         found_transition = true;
     }
@@ -524,9 +896,11 @@ void Transducer::find_index(SymbolNumber input,
 
 
 
-void Transducer::get_analyses(unsigned int input_pos,
-                              unsigned int output_pos,
-                              TransitionTableIndex i)
+template <class Tables>
+void LookupSession::get_analyses(const Tables & t,
+                                 unsigned int input_pos,
+                                 unsigned int output_pos,
+                                 TransitionTableIndex i)
 {
     found_transition = false;
     
@@ -540,8 +914,10 @@ void Transducer::get_analyses(unsigned int input_pos,
         return;
     }
     if (max_time > 0.0) {
-        // quit if we've overspent our time
-        if ((((double) clock() - start_clock) / CLOCKS_PER_SEC) > max_time) {
+        // quit if we've overspent our time. This is wall-clock time,
+        // because clock() counts the time of all threads of the process.
+        if (std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                          - start_clock).count() > max_time) {
             return;
         }
     }
@@ -553,9 +929,9 @@ void Transducer::get_analyses(unsigned int input_pos,
         if (input_tape[input_pos] == NO_SYMBOL_NUMBER) {
             if (max_lookups < 0 || (ssize_t)lookup_paths->size() < max_lookups) {
                 output_tape.write(output_pos, NO_SYMBOL_NUMBER, NO_SYMBOL_NUMBER);
-                if (tables->get_transition_finality(i)) {
+                if (t.transition_finality(i)) {
                     Weight old_weight = current_weight;
-                    current_weight += tables->get_weight(i);
+                    current_weight += t.transition_weight(i);
                     note_analysis();
                     current_weight = old_weight;
                 }
@@ -563,7 +939,7 @@ void Transducer::get_analyses(unsigned int input_pos,
         }
 
         // Then we check epsilons
-        try_epsilon_transitions(input_pos,
+        try_epsilon_transitions(t, input_pos,
                                 output_pos,
                                 i+1);
 
@@ -576,25 +952,25 @@ void Transducer::get_analyses(unsigned int input_pos,
         SymbolNumber input = input_tape[input_pos];
         ++input_pos;
 
-        if (input < alphabet->get_orig_symbol_count()) {
+        if (input < alphabet.get_orig_symbol_count()) {
             // Input is in the alphabet
-            find_transitions(input,
+            find_transitions(t, input,
                              input_pos,
                              output_pos,
                              i+1);
         } else {
-            if (alphabet->get_identity_symbol() != NO_SYMBOL_NUMBER) {
-                find_transitions(alphabet->get_identity_symbol(),
+            if (alphabet.get_identity_symbol() != NO_SYMBOL_NUMBER) {
+                find_transitions(t, alphabet.get_identity_symbol(),
                                  input_pos, output_pos, i+1);
             }
-            if (alphabet->get_unknown_symbol() != NO_SYMBOL_NUMBER) {
-                find_transitions(alphabet->get_unknown_symbol(),
+            if (alphabet.get_unknown_symbol() != NO_SYMBOL_NUMBER) {
+                find_transitions(t, alphabet.get_unknown_symbol(),
                                  input_pos, output_pos, i+1);
             }
         }
-        if (alphabet->get_default_symbol() != NO_SYMBOL_NUMBER &&
+        if (alphabet.get_default_symbol() != NO_SYMBOL_NUMBER &&
             !found_transition) {
-            find_transitions(alphabet->get_default_symbol(),
+            find_transitions(t, alphabet.get_default_symbol(),
                              input_pos, output_pos, i+1);
         }
     }
@@ -603,16 +979,16 @@ void Transducer::get_analyses(unsigned int input_pos,
         if (input_tape[input_pos] == NO_SYMBOL_NUMBER) {
             if (max_lookups < 0 || (ssize_t)lookup_paths->size() < max_lookups) {
                 output_tape.write(output_pos, NO_SYMBOL_NUMBER, NO_SYMBOL_NUMBER);
-                if (tables->get_index_finality(i)) {
+                if (t.index_finality(i)) {
                     Weight old_weight = current_weight;
-                    current_weight += tables->get_final_weight(i);
+                    current_weight += t.index_final_weight(i);
                     note_analysis();
                     current_weight = old_weight;
                 }
             }
         }
         
-        try_epsilon_indices(input_pos,
+        try_epsilon_indices(t, input_pos,
                             output_pos,
                             i+1);
         
@@ -624,23 +1000,23 @@ void Transducer::get_analyses(unsigned int input_pos,
         SymbolNumber input = input_tape[input_pos];
         ++input_pos;
 
-        if (input < alphabet->get_orig_symbol_count()) {
+        if (input < alphabet.get_orig_symbol_count()) {
             // Input is in the alphabet
-            find_index(input, input_pos, output_pos, i+1);
+            find_index(t, input, input_pos, output_pos, i+1);
         } else {
-            if (alphabet->get_identity_symbol() != NO_SYMBOL_NUMBER) {
-                find_index(alphabet->get_identity_symbol(),
+            if (alphabet.get_identity_symbol() != NO_SYMBOL_NUMBER) {
+                find_index(t, alphabet.get_identity_symbol(),
                            input_pos, output_pos, i+1);
             }
-            if (alphabet->get_unknown_symbol() != NO_SYMBOL_NUMBER) {
-                find_index(alphabet->get_unknown_symbol(),
+            if (alphabet.get_unknown_symbol() != NO_SYMBOL_NUMBER) {
+                find_index(t, alphabet.get_unknown_symbol(),
                            input_pos, output_pos, i+1);
             }
         }
         // If we have a default symbol defined and we didn't find an index,
         // check for that
-        if (alphabet->get_default_symbol() != NO_SYMBOL_NUMBER && !found_transition) {
-            find_index(alphabet->get_default_symbol(),
+        if (alphabet.get_default_symbol() != NO_SYMBOL_NUMBER && !found_transition) {
+            find_index(t, alphabet.get_default_symbol(),
                        input_pos, output_pos, i+1);
         }
     }
@@ -648,49 +1024,74 @@ void Transducer::get_analyses(unsigned int input_pos,
     ++recursion_depth_left;
 }
 
-void Transducer::note_analysis(void)
+void LookupSession::analyse(void)
+{
+    switch (table_type) {
+    case WeightedTables:
+        get_analyses(static_cast<const TransducerTables<
+                     TransitionWIndex, TransitionW>&>(tables), 0, 0, 0);
+        break;
+    case UnweightedTables:
+        get_analyses(static_cast<const TransducerTables<
+                     TransitionIndex, Transition>&>(tables), 0, 0, 0);
+        break;
+    case MappedWeightedTables:
+        get_analyses(static_cast<const MappedTransducerTables<
+                     TransitionWIndex, TransitionW>&>(tables), 0, 0, 0);
+        break;
+    case MappedUnweightedTables:
+        get_analyses(static_cast<const MappedTransducerTables<
+                     TransitionIndex, Transition>&>(tables), 0, 0, 0);
+        break;
+    default:
+        get_analyses(TablesInterfaceAccess(tables), 0, 0, 0);
+    }
+}
+
+void LookupSession::note_analysis(void)
 {
     HfstTwoLevelPath result;
     for (DoubleTape::const_iterator it = output_tape.begin();
          it->output != NO_SYMBOL_NUMBER; ++it) {
-        result.second.push_back(StringPair(alphabet->string_from_symbol(it->input),
-                                           alphabet->string_from_symbol(it->output)));
+        result.second.push_back(StringPair(string_from_symbol(it->input),
+                                           string_from_symbol(it->output)));
     }
     result.first = current_weight;
     lookup_paths->insert(result);
 }
 
 Transducer::Transducer():
-    header(NULL), alphabet(NULL), tables(NULL),
-    current_weight(0.0), lookup_paths(NULL), encoder(NULL),
-    input_tape(), output_tape(),
-    flag_state(), found_transition(false), max_lookups(-1),
-    recursion_depth_left(MAX_RECURSION_DEPTH){}
+    header(NULL), alphabet(NULL), tables(NULL), encoder(NULL),
+    session(NULL), cache(NULL) {}
 
 Transducer::Transducer(std::istream& is):
     header(new TransducerHeader(is)),
     alphabet(new TransducerAlphabet(is, header->symbol_count())),
-    tables(NULL), current_weight(0.0), lookup_paths(NULL),
+    tables(NULL),
     encoder(new Encoder(alphabet->get_symbol_table(),
                         header->input_symbol_count())),
-    input_tape(), output_tape(),
-    flag_state(alphabet->get_fd_table()), found_transition(false), max_lookups(-1),
-    recursion_depth_left(MAX_RECURSION_DEPTH)
+    session(NULL), cache(NULL)
 {
     load_tables(is);
 }
 
+Transducer::Transducer(std::istream& is, const std::string & filename):
+    header(new TransducerHeader(is)),
+    alphabet(new TransducerAlphabet(is, header->symbol_count())),
+    tables(NULL),
+    encoder(new Encoder(alphabet->get_symbol_table(),
+                        header->input_symbol_count())),
+    session(NULL), cache(NULL)
+{
+    map_tables(is, filename);
+}
 
 Transducer::Transducer(bool weighted):
     header(new TransducerHeader(weighted)),
     alphabet(new TransducerAlphabet()),
-    current_weight(0.0),
-    lookup_paths(NULL),
     encoder(new Encoder(alphabet->get_symbol_table(),
                         header->input_symbol_count())),
-    input_tape(), output_tape(),
-    flag_state(alphabet->get_fd_table()), found_transition(false),
-    max_lookups(-1), recursion_depth_left(MAX_RECURSION_DEPTH)
+    session(NULL), cache(NULL)
 {
     if(weighted)
         tables = new TransducerTables<TransitionWIndex,TransitionW>();
@@ -706,13 +1107,9 @@ Transducer::Transducer(const TransducerHeader& header,
     alphabet(new TransducerAlphabet(alphabet)),
     tables(new TransducerTables<TransitionIndex,Transition>(
                index_table, transition_table)),
-    current_weight(0.0),
-    lookup_paths(NULL),
     encoder(new Encoder(alphabet.get_symbol_table(),
                         header.input_symbol_count())),
-    input_tape(), output_tape(),
-    flag_state(alphabet.get_fd_table()), found_transition(false), max_lookups(-1),
-    recursion_depth_left(MAX_RECURSION_DEPTH)
+    session(NULL), cache(NULL)
 {}
 
 Transducer::Transducer(const TransducerHeader& header,
@@ -723,13 +1120,9 @@ Transducer::Transducer(const TransducerHeader& header,
     alphabet(new TransducerAlphabet(alphabet)),
     tables(new TransducerTables<TransitionWIndex,TransitionW>(
                index_table, transition_table)),
-    current_weight(0.0),
-    lookup_paths(NULL),
     encoder(new Encoder(alphabet.get_symbol_table(),
                         header.input_symbol_count())),
-    input_tape(), output_tape(),
-    flag_state(alphabet.get_fd_table()), found_transition(false), max_lookups(-1),
-    recursion_depth_left(MAX_RECURSION_DEPTH)
+    session(NULL), cache(NULL)
 {}
 
 Transducer::~Transducer()
@@ -738,6 +1131,8 @@ Transducer::~Transducer()
     delete alphabet;
     delete tables;
     delete encoder;
+    delete session;
+    delete cache;
 }
 
 TransducerTable<TransitionWIndex> Transducer::copy_windex_table()
@@ -803,6 +1198,33 @@ void Transducer::load_tables(std::istream& is)
     }
 }
 
+void Transducer::map_tables(std::istream& is, const std::string & filename)
+{
+    std::streampos table_start = is.tellg();
+    if (table_start == std::streampos(-1)) {
+        load_tables(is);
+        return;
+    }
+    bool weighted = header->probe_flag(Weighted);
+    size_t index_bytes = (weighted ? TransitionWIndex::size :
+                          TransitionIndex::size) * header->index_table_size();
+    size_t transition_bytes = (weighted ? TransitionW::size :
+                               Transition::size) * header->target_table_size();
+    TableMapping * mapping = new TableMapping(
+        filename, (size_t)table_start, index_bytes + transition_bytes);
+    if (weighted)
+        tables = new MappedTransducerTables<TransitionWIndex,TransitionW>(
+            mapping, header->index_table_size(),header->target_table_size());
+    else
+        tables = new MappedTransducerTables<TransitionIndex,Transition>(
+            mapping, header->index_table_size(),header->target_table_size());
+    // Leave the stream where reading the tables would have left it
+    is.seekg(table_start + (std::streamoff)(index_bytes + transition_bytes));
+    if(!is) {
+        HFST_THROW(TransducerHasWrongTypeException);
+    }
+}
+
 void Transducer::write(std::ostream& os) const
 {
     header->write(os);
@@ -29,12 +29,17 @@
 #include <deque>
 #include <queue>
 #include <stdexcept>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include <chrono>
 #include <time.h>
 
 #include "../../HfstExceptionDefs.h"
 #include "../../HfstFlagDiacritics.h"
 #include "../../HfstSymbolDefs.h"
 #include "../../HfstDataTypes.h"
+#include "letter-trie.h"
 
 #ifdef _MSC_VER
  #include <BaseTsd.h>
@@ -69,7 +74,7 @@ typedef std::vector<std::string> SymbolTable;
 typedef std::pair<std::string, std::string> StringPair;
 
 // for ospell
-typedef std::vector<short> FlagDiacriticState;
+typedef hfst::FdPackedValues FlagDiacriticState;
 typedef std::map<SymbolNumber, hfst::FdOperation> OperationMap;
 typedef std::map<std::string, SymbolNumber> StringSymbolMap;
 class STransition;
@@ -659,6 +664,9 @@ public:
             return (i < TRANSITION_TARGET_TABLE_START) ?
                 table[i] : table[i-TRANSITION_TARGET_TABLE_START];
         }
+    // Like operator[], but i must already be an offset into this table
+    const T& entry(TransitionTableIndex i) const
+        { return table[i]; }
 
     std::vector<T> get_vector(void) const { return std::vector<T>(table); } ;
   
@@ -749,6 +757,28 @@ public:
         { return index_table[i].final(); }
     Weight get_final_weight(TransitionTableIndex i) const
         { return index_table[i].final_weight(); }
+
+    // Non-virtual accessors for the lookup core, which is instantiated for
+    // each table type. Indices are offsets into the respective table, i.e.
+    // transition indices have had TRANSITION_TARGET_TABLE_START subtracted.
+    SymbolNumber index_input(TransitionTableIndex i) const
+        { return index_table.entry(i).get_input_symbol(); }
+    TransitionTableIndex index_target(TransitionTableIndex i) const
+        { return index_table.entry(i).get_target(); }
+    bool index_finality(TransitionTableIndex i) const
+        { return index_table.entry(i).T1::final(); }
+    Weight index_final_weight(TransitionTableIndex i) const
+        { return index_table.entry(i).T1::final_weight(); }
+    SymbolNumber transition_input(TransitionTableIndex i) const
+        { return transition_table.entry(i).get_input_symbol(); }
+    SymbolNumber transition_output(TransitionTableIndex i) const
+        { return transition_table.entry(i).get_output_symbol(); }
+    TransitionTableIndex transition_target(TransitionTableIndex i) const
+        { return transition_table.entry(i).get_target(); }
+    Weight transition_weight(TransitionTableIndex i) const
+        { return transition_table.entry(i).T2::get_weight(); }
+    bool transition_finality(TransitionTableIndex i) const
+        { return transition_table.entry(i).T2::final(); }
   
     void display() const
         {
@@ -760,37 +790,193 @@ public:
 };
 
 
-// There follow some classes for implementing lookup
-    
-class OlLetterTrie;
-typedef std::vector<OlLetterTrie*> OlLetterTrieVector;
+/** \brief A read-only byte range of a file.
 
-class OlLetterTrie
+    Where the platform supports it, the range is memory-mapped, so that
+    every process loading the same file shares one copy of the pages through
+    the page cache. Otherwise the range is read into a private buffer.
+*/
+class TableMapping
 {
 private:
-    OlLetterTrieVector letters;
-    SymbolNumberVector symbols;
-    
+    char * region;
+    size_t region_size;
+    const char * data;
+    size_t data_size;
+    bool mapped;
+
+    TableMapping(const TableMapping&);
+    TableMapping& operator=(const TableMapping&);
 public:
-    OlLetterTrie():
-        letters(UCHAR_MAX+1, static_cast<OlLetterTrie*>(NULL)),
-        symbols(UCHAR_MAX+1,NO_SYMBOL_NUMBER)
-        {}
+    TableMapping(const std::string & filename, size_t offset, size_t length);
+    ~TableMapping();
+
+    const char * get_data(void) const { return data; }
+    size_t size(void) const { return data_size; }
+    bool is_mapped(void) const { return mapped; }
+};
+
+/** \brief Transducer tables that point directly at the packed on-disk
+    layout of the index and transition tables instead of copying them.
+
+    The accessors used by lookup decode entries in place. Callers that need
+    references to whole TransitionIndex or Transition objects (writing,
+    conversion) get them from a copy of the tables built on first use.
+*/
+template <class T1, class T2>
+class MappedTransducerTables : public TransducerTablesInterface
+{
+protected:
+    TableMapping * mapping;
+    char * index_data;
+    char * transition_data;
+    TransitionTableIndex index_table_size;
+    TransitionTableIndex transition_table_size;
 
-    ~OlLetterTrie() {
-        for (size_t i=0 ; i<letters.size() ; ++i) {
-            delete letters[i];
-            letters[i] = 0;
+    mutable TransducerTable<T1> * index_view;
+    mutable TransducerTable<T2> * transition_view;
+    mutable std::once_flag view_flag;
+
+    char * index_entry(TransitionTableIndex i) const
+        {
+            return index_data + T1::size *
+                ((i < TRANSITION_TARGET_TABLE_START) ?
+                 i : i - TRANSITION_TARGET_TABLE_START);
         }
-    }
-    
-    void add_string(const char * p,SymbolNumber symbol_key);
-    bool has_key_starting_with(const char c) const;
-    
-    SymbolNumber find_key(char ** p);
-    
+    char * transition_entry(TransitionTableIndex i) const
+        {
+            return transition_data + T2::size *
+                ((i < TRANSITION_TARGET_TABLE_START) ?
+                 i : i - TRANSITION_TARGET_TABLE_START);
+        }
+    void build_views(void) const
+        {
+            index_view = new TransducerTable<T1>();
+            for (TransitionTableIndex i = 0; i < index_table_size; ++i) {
+                index_view->append(T1(index_entry(i)));
+            }
+            transition_view = new TransducerTable<T2>();
+            for (TransitionTableIndex i = 0; i < transition_table_size; ++i) {
+                transition_view->append(T2(transition_entry(i)));
+            }
+        }
+    void ensure_views(void) const
+        {
+            std::call_once(view_flag,
+                           &MappedTransducerTables<T1, T2>::build_views, this);
+        }
+
+    MappedTransducerTables(const MappedTransducerTables&);
+    MappedTransducerTables& operator=(const MappedTransducerTables&);
+public:
+    // Takes ownership of mapping, which must hold the index table
+    // immediately followed by the transition table
+    MappedTransducerTables(TableMapping * mapping,
+                           TransitionTableIndex index_table_size,
+                           TransitionTableIndex transition_table_size):
+        mapping(mapping),
+        index_data(const_cast<char*>(mapping->get_data())),
+        transition_data(const_cast<char*>(mapping->get_data())
+                        + T1::size * index_table_size),
+        index_table_size(index_table_size),
+        transition_table_size(transition_table_size),
+        index_view(NULL), transition_view(NULL) {}
+
+    ~MappedTransducerTables()
+        {
+            delete index_view;
+            delete transition_view;
+            delete mapping;
+        }
+
+    const TransitionIndex& get_index(TransitionTableIndex i) const
+        { ensure_views(); return (*index_view)[i]; }
+    const Transition& get_transition(TransitionTableIndex i) const
+        { ensure_views(); return (*transition_view)[i]; }
+    Weight get_weight(TransitionTableIndex i) const
+        { return T2(transition_entry(i)).get_weight(); }
+    SymbolNumber get_transition_input(TransitionTableIndex i) const
+        { return T2(transition_entry(i)).get_input_symbol(); }
+    SymbolNumber get_transition_output(TransitionTableIndex i) const
+        { return T2(transition_entry(i)).get_output_symbol(); }
+    TransitionTableIndex get_transition_target(TransitionTableIndex i) const
+        { return T2(transition_entry(i)).get_target(); }
+    bool get_transition_finality(TransitionTableIndex i) const
+        { return T2(transition_entry(i)).final(); }
+    SymbolNumber get_index_input(TransitionTableIndex i) const
+        { return T1(index_entry(i)).get_input_symbol(); }
+    TransitionTableIndex get_index_target(TransitionTableIndex i) const
+        { return T1(index_entry(i)).get_target(); }
+    bool get_index_finality(TransitionTableIndex i) const
+        { return T1(index_entry(i)).final(); }
+    Weight get_final_weight(TransitionTableIndex i) const
+        { return T1(index_entry(i)).final_weight(); }
+
+    // Non-virtual accessors for the lookup core, see TransducerTables
+    SymbolNumber index_input(TransitionTableIndex i) const
+        { return T1(index_data + T1::size * i).get_input_symbol(); }
+    TransitionTableIndex index_target(TransitionTableIndex i) const
+        { return T1(index_data + T1::size * i).get_target(); }
+    bool index_finality(TransitionTableIndex i) const
+        { return T1(index_data + T1::size * i).T1::final(); }
+    Weight index_final_weight(TransitionTableIndex i) const
+        { return T1(index_data + T1::size * i).T1::final_weight(); }
+    SymbolNumber transition_input(TransitionTableIndex i) const
+        { return T2(transition_data + T2::size * i).get_input_symbol(); }
+    SymbolNumber transition_output(TransitionTableIndex i) const
+        { return T2(transition_data + T2::size * i).get_output_symbol(); }
+    TransitionTableIndex transition_target(TransitionTableIndex i) const
+        { return T2(transition_data + T2::size * i).get_target(); }
+    Weight transition_weight(TransitionTableIndex i) const
+        { return T2(transition_data + T2::size * i).T2::get_weight(); }
+    bool transition_finality(TransitionTableIndex i) const
+        { return T2(transition_data + T2::size * i).T2::final(); }
+
+    void display() const
+        {
+            ensure_views();
+            std::cout << "Transition index table:" << std::endl;
+            index_view->display(false);
+            std::cout << "Transition table:" << std::endl;
+            transition_view->display(true);
+        }
+};
+
+
+/** \brief The non-virtual accessors of TransducerTables for any
+    TransducerTablesInterface, for tables of a type the lookup core isn't
+    instantiated for.
+*/
+class TablesInterfaceAccess
+{
+protected:
+    const TransducerTablesInterface & tables;
+public:
+    TablesInterfaceAccess(const TransducerTablesInterface & t): tables(t) {}
+
+    SymbolNumber index_input(TransitionTableIndex i) const
+        { return tables.get_index_input(i); }
+    TransitionTableIndex index_target(TransitionTableIndex i) const
+        { return tables.get_index_target(i); }
+    bool index_finality(TransitionTableIndex i) const
+        { return tables.get_index_finality(i); }
+    Weight index_final_weight(TransitionTableIndex i) const
+        { return tables.get_final_weight(i); }
+    SymbolNumber transition_input(TransitionTableIndex i) const
+        { return tables.get_transition_input(i); }
+    SymbolNumber transition_output(TransitionTableIndex i) const
+        { return tables.get_transition_output(i); }
+    TransitionTableIndex transition_target(TransitionTableIndex i) const
+        { return tables.get_transition_target(i); }
+    Weight transition_weight(TransitionTableIndex i) const
+        { return tables.get_weight(i); }
+    bool transition_finality(TransitionTableIndex i) const
+        { return tables.get_transition_finality(i); }
 };
 
+
+// There follow some classes for implementing lookup
+    
 class Encoder {
     
 protected:
@@ -809,7 +995,7 @@ public:
             read_input_symbols(st);
         }
 
-    SymbolNumber find_key(char ** p);
+    SymbolNumber find_key(char ** p) const;
 
     friend class Transducer;
     friend class PmatchContainer;
@@ -892,7 +1078,64 @@ public:
         }
 };
 
+class LookupSession;
+
+/** \brief A bounded cache of lookup results that evicts the least
+    recently used result first.
+
+    Results are keyed by the input string and the result limit. The cache
+    can be bounded by the number of results, by the approximate number of
+    bytes they take, or both; a bound of 0 means no bound. The member
+    functions lock the cache, so it can be shared by threads.
+*/
+class LookupCache
+{
+protected:
+    typedef std::pair<std::string, HfstOneLevelPaths> Entry;
+    typedef std::list<Entry> EntryList;
+    // Most recently used first
+    EntryList entries;
+    std::unordered_map<std::string, EntryList::iterator> positions;
+    size_t max_entries;
+    size_t max_bytes;
+    size_t bytes;
+    size_t hits;
+    size_t misses;
+    mutable std::mutex cache_mutex;
+
+    static std::string make_key(const std::string & input, ssize_t limit);
+    static size_t entry_bytes(const Entry & entry);
+    void evict(void);
+
+public:
+    LookupCache(size_t max_entries, size_t max_bytes = 0);
+
+    /** \brief Copy the result cached for \a input and \a limit to
+        \a result. Return whether there was one. */
+    bool find(const std::string & input, ssize_t limit,
+              HfstOneLevelPaths & result);
+    /** \brief Cache \a result for \a input and \a limit. A result bigger
+        than the byte bound isn't cached. */
+    void insert(const std::string & input, ssize_t limit,
+                const HfstOneLevelPaths & result);
+    void clear(void);
+
+    size_t get_hits(void) const;
+    size_t get_misses(void) const;
+    size_t get_entries(void) const;
+    size_t get_bytes(void) const;
+    size_t get_max_entries(void) const
+        { return max_entries; }
+    size_t get_max_bytes(void) const
+        { return max_bytes; }
+};
+
 /** \brief A compiled transducer format, suitable for fast lookup operations.
+
+    The lookup functions of a Transducer use one LookupSession owned by the
+    transducer, so they may not be called from several threads at once.
+    To look up strings concurrently, give each thread its own
+    LookupSession on the same Transducer.
  */
 class Transducer
 {
@@ -901,63 +1144,34 @@ protected:
     TransducerAlphabet* alphabet;
     TransducerTablesInterface* tables;
     void load_tables(std::istream& is);
+    void map_tables(std::istream& is, const std::string & filename);
 
-    // for lookup
-    Weight current_weight;
-    HfstTwoLevelPaths * lookup_paths;
     Encoder * encoder;
-    Tape input_tape;
-    DoubleTape output_tape;
-    hfst::FdState<SymbolNumber> flag_state;
-    // This is to keep track of whether we're going to take a default transition
-    bool found_transition;
-    // For keeping a tally of previously epsilon-visited states to control
-    // going into loops
-    TraversalStates traversal_states;
-
-    ssize_t max_lookups;
-    unsigned int recursion_depth_left;
-    double max_time;
-    clock_t start_clock;
-
-    void try_epsilon_transitions(unsigned int input_tape_pos,
-                                 unsigned int output_tape_pos,
-                                 TransitionTableIndex i);
-  
-    void try_epsilon_indices(unsigned int input_tape_pos,
-                             unsigned int output_tape_pos,
-                             TransitionTableIndex i);
-
-    void find_transitions(SymbolNumber input,
-                          unsigned int input_tape_pos,
-                          unsigned int output_tape_pos,
-                          TransitionTableIndex i);
-
-    void find_index(SymbolNumber input,
-                    unsigned int input_tape_pos,
-                    unsigned int output_tape_pos,
-                    TransitionTableIndex i);
-    
-    void get_analyses(unsigned int input_tape_pos,
-                      unsigned int output_tape_pos,
-                      TransitionTableIndex i);
-    
-    void find_loop_epsilon_transitions(unsigned int input_pos,
-                                       TransitionTableIndex i);
-    void find_loop_epsilon_indices(unsigned int input_pos,
-                                   TransitionTableIndex i);
-    void find_loop_transitions(SymbolNumber input,
-                               unsigned int input_pos,
-                               TransitionTableIndex i);
-    void find_loop_index(SymbolNumber input,
-                         unsigned int input_pos,
-                         TransitionTableIndex i);
-    void find_loop(unsigned int input_pos,
-                   TransitionTableIndex i);
+    // The session used by the lookup functions of the transducer itself,
+    // created on first use
+    LookupSession * session;
+    LookupSession & get_session(void);
+    // The cache of lookup_fd results, if caching is on
+    LookupCache * cache;
 
+private:
+    // Not implemented, the transducer owns its tables, session and cache.
+    // Use copy() instead.
+    Transducer(const Transducer & other);
+    Transducer & operator=(const Transducer & other);
 
 public:
     Transducer(std::istream& is);
+    /** \brief Read a transducer from \a is, which must be positioned in
+        file \a filename, mapping the index and transition tables into
+        memory from that file instead of copying them.
+
+        The header and alphabet are parsed from \a is as usual and \a is is
+        left positioned after the tables. The file must not be modified
+        while the transducer is alive. If the position of \a is cannot be
+        determined, the tables are read from the stream as usual.
+    */
+    Transducer(std::istream& is, const std::string & filename);
     Transducer(bool weighted);
     Transducer(Transducer * t);
     Transducer();
@@ -1022,7 +1236,6 @@ public:
         TransitionTableIndex state_index) const;
 
 
-    bool initialize_input(const char * input_str);
     void include_symbol_in_alphabet(const std::string & sym);
     HfstOneLevelPaths * lookup_fd(const StringVector & s, ssize_t limit = -1,
         double time_cutoff = 0.0);
@@ -1038,7 +1251,48 @@ public:
                                         double time_cutoff = 0.0);
     HfstTwoLevelPaths * lookup_fd_pairs(const char * s, ssize_t limit = -1,
                                         double time_cutoff = 0.0);
-    void note_analysis(void);
+    /** \brief Look up \a s like lookup_fd, but with \a session, going
+        through the lookup cache if there is one.
+
+        The results of lookups with a \a time_cutoff may be incomplete, so
+        they are neither taken from nor stored in the cache.
+    */
+    HfstOneLevelPaths * lookup_fd(LookupSession & session,
+                                  const std::string & s, ssize_t limit = -1,
+                                  double time_cutoff = 0.0) const;
+
+    /** \brief Cache the results of lookup_fd and lookup_fd_batch.
+
+        At most \a max_entries results taking about \a max_bytes bytes
+        are kept, a bound of 0 meaning no bound. If both are 0, caching is
+        switched off. Any previously cached results are dropped. This may
+        not be called while lookups are being done.
+    */
+    void set_lookup_cache(size_t max_entries, size_t max_bytes = 0);
+    /** \brief The lookup cache, or NULL if caching is off. */
+    const LookupCache * get_lookup_cache(void) const
+        { return cache; }
+
+    /** \brief Look up each string of \a inputs like lookup_fd, spreading
+        the lookups over \a threads threads.
+
+        Every thread has a LookupSession of its own, so the transducer is
+        shared but not modified. The results are newly allocated and
+        returned in the order of \a inputs. If \a threads is 0, one thread
+        per hardware thread is used.
+        The lookup cache of the transducer, if any, is shared by the threads.
+
+        If \a infinite is not NULL and \a time_cutoff is 0.0, each input is
+        first checked with is_lookup_infinitely_ambiguous. The lookup of an
+        infinitely ambiguous input is limited to \a infinite_limit results
+        instead of \a limit, and the corresponding element of \a infinite
+        is set to true.
+    */
+    std::vector<HfstOneLevelPaths*> lookup_fd_batch(
+        const StringVector & inputs, unsigned int threads = 0,
+        ssize_t limit = -1, double time_cutoff = 0.0,
+        std::vector<bool> * infinite = NULL,
+        ssize_t infinite_limit = -1) const;
 
     // Methods for supporting ospell
     SymbolNumber get_unknown_symbol(void) const
@@ -1063,8 +1317,129 @@ public:
 
     
     friend class ConvertTransducer;
+    friend class LookupSession;
 };
 
+/** \brief The mutable state of lookup operations on a Transducer.
+
+    Looking up strings through a LookupSession doesn't modify the
+    Transducer, so any number of sessions, e.g. one per thread, can share
+    one Transducer. Input symbols that aren't in the alphabet of the
+    transducer are kept in the session. A session reuses its buffers from
+    one lookup to the next, but a single session may only be used by one
+    thread at a time.
+*/
+class LookupSession
+{
+protected:
+    const TransducerAlphabet & alphabet;
+    const TransducerTablesInterface & tables;
+    const Encoder & encoder;
+
+    Weight current_weight;
+    HfstTwoLevelPaths * lookup_paths;
+    Tape input_tape;
+    DoubleTape output_tape;
+    hfst::FdState<SymbolNumber> flag_state;
+    // This is to keep track of whether we're going to take a default transition
+    bool found_transition;
+    // For keeping a tally of previously epsilon-visited states to control
+    // going into loops
+    TraversalStates traversal_states;
+
+    ssize_t max_lookups;
+    unsigned int recursion_depth_left;
+    double max_time;
+    std::chrono::steady_clock::time_point start_clock;
+
+    // Input symbols missing from the alphabet, numbered from
+    // extra_symbols_start onwards
+    SymbolTable extra_symbols;
+    SymbolNumber extra_symbols_start;
+
+    // The concrete type of the tables, which selects the instantiation of
+    // the lookup core
+    enum TableType { WeightedTables, UnweightedTables,
+                     MappedWeightedTables, MappedUnweightedTables,
+                     OtherTables };
+    TableType table_type;
+
+    SymbolNumber extra_symbol(const std::string & symbol);
+    std::string string_from_symbol(SymbolNumber symbol) const;
+    bool initialize_input(const char * input_str);
+    void note_analysis(void);
+    void analyse(void);
+
+    // The lookup core, templated on the tables so that table accesses
+    // can be inlined
+    template <class Tables>
+    void try_epsilon_transitions(const Tables & t,
+                                 unsigned int input_tape_pos,
+                                 unsigned int output_tape_pos,
+                                 TransitionTableIndex i);
+  
+    template <class Tables>
+    void try_epsilon_indices(const Tables & t,
+                             unsigned int input_tape_pos,
+                             unsigned int output_tape_pos,
+                             TransitionTableIndex i);
+
+    template <class Tables>
+    void find_transitions(const Tables & t,
+                          SymbolNumber input,
+                          unsigned int input_tape_pos,
+                          unsigned int output_tape_pos,
+                          TransitionTableIndex i);
+
+    template <class Tables>
+    void find_index(const Tables & t,
+                    SymbolNumber input,
+                    unsigned int input_tape_pos,
+                    unsigned int output_tape_pos,
+                    TransitionTableIndex i);
+    
+    template <class Tables>
+    void get_analyses(const Tables & t,
+                      unsigned int input_tape_pos,
+                      unsigned int output_tape_pos,
+                      TransitionTableIndex i);
+    
+    void find_loop_epsilon_transitions(unsigned int input_pos,
+                                       TransitionTableIndex i);
+    void find_loop_epsilon_indices(unsigned int input_pos,
+                                   TransitionTableIndex i);
+    void find_loop_transitions(SymbolNumber input,
+                               unsigned int input_pos,
+                               TransitionTableIndex i);
+    void find_loop_index(SymbolNumber input,
+                         unsigned int input_pos,
+                         TransitionTableIndex i);
+    void find_loop(unsigned int input_pos,
+                   TransitionTableIndex i);
+
+public:
+    LookupSession(const Transducer & t);
+
+    bool is_lookup_infinitely_ambiguous(const StringVector & s);
+    bool is_lookup_infinitely_ambiguous(const std::string & input);
+
+    HfstOneLevelPaths * lookup_fd(const StringVector & s, ssize_t limit = -1,
+        double time_cutoff = 0.0);
+    /* Tokenize and lookup, accounting for flag diacritics, the surface string
+       \a s. The return value, a pointer to HfstOneLevelPaths
+       (which is a set) of analyses, is newly allocated.
+    */
+    HfstOneLevelPaths * lookup_fd(const std::string & s, ssize_t limit = -1,
+                                  double time_cutoff = 0.0);
+    HfstOneLevelPaths * lookup_fd(const char * s, ssize_t limit = -1,
+                                  double time_cutoff = 0.0);
+    HfstTwoLevelPaths * lookup_fd_pairs(const std::string & s, ssize_t limit = -1,
+                                        double time_cutoff = 0.0);
+    HfstTwoLevelPaths * lookup_fd_pairs(const char * s, ssize_t limit = -1,
+                                        double time_cutoff = 0.0);
+};
+
+
 class STransition{
 public:
     TransitionTableIndex index;
@@ -1201,23 +1576,39 @@ typedef std::priority_queue<StringWeightPair,
 
   };*/
 
+/** \brief One step of a partial correction: the output symbol taken and
+    the step before it. The partial corrections of a search share their
+    prefixes this way instead of each holding a copy of its string. */
+struct SpellerPathNode
+{
+    SymbolNumber symbol;
+    unsigned int parent;
+};
+
+typedef std::vector<SpellerPathNode> SpellerPathTable;
+
+// The path of a node that has no output yet
+const unsigned int EMPTY_SPELLER_PATH = UINT_MAX;
+
 class TreeNode
 {
 public:
-    SymbolNumberVector string;
+    // Index of the last step of this node's output in the path table
+    // of the Speller, or EMPTY_SPELLER_PATH
+    unsigned int path;
     unsigned int input_state;
     TransitionTableIndex mutator_state;
     TransitionTableIndex lexicon_state;
     hfst::FdState<SymbolNumber> flag_state;
     Weight weight;
 
-    TreeNode(SymbolNumberVector prev_string,
+    TreeNode(unsigned int path_,
              unsigned int i,
              TransitionTableIndex mutator,
              TransitionTableIndex lexicon,
              hfst::FdState<SymbolNumber> state,
              Weight w):
-        string(prev_string),
+        path(path_),
         input_state(i),
         mutator_state(mutator),
         lexicon_state(lexicon),
@@ -1226,7 +1617,7 @@ public:
         { }
 
     TreeNode(hfst::FdState<SymbolNumber> start_state): // starting state node
-        string(SymbolNumberVector()),
+        path(EMPTY_SPELLER_PATH),
         input_state(0),
         mutator_state(0),
         lexicon_state(0),
@@ -1234,31 +1625,39 @@ public:
         weight(0.0)
         { }
 
-    TreeNode update_lexicon(SymbolNumber next_symbol,
+    TreeNode update_lexicon(unsigned int next_path,
                             TransitionTableIndex next_lexicon,
-                            Weight weight);
+                            Weight weight) const;
 
-    TreeNode update_mutator(SymbolNumber next_symbol,
+    TreeNode update_mutator(unsigned int next_path,
                             TransitionTableIndex next_mutator,
-                            Weight weight);
-
-    void increment_mutator(void);
+                            Weight weight) const;
 
-    TreeNode update(SymbolNumber next_symbol,
+    TreeNode update(unsigned int next_path,
                     unsigned int next_input,
                     TransitionTableIndex next_mutator,
                     TransitionTableIndex next_lexicon,
-                    Weight weight);
+                    Weight weight) const;
 
-    TreeNode update(SymbolNumber next_symbol,
+    TreeNode update(unsigned int next_path,
                     TransitionTableIndex next_mutator,
                     TransitionTableIndex next_lexicon,
-                    Weight weight);
+                    Weight weight) const;
 
 
 };
 
-typedef std::deque<TreeNode> TreeNodeQueue;
+/* Orders the search queue so that the lightest node comes out first */
+class TreeNodeComparison
+{
+public:
+    bool operator() (const TreeNode & lhs, const TreeNode & rhs) const
+        { return lhs.weight > rhs.weight; }
+};
+
+typedef std::priority_queue<TreeNode,
+                            std::vector<TreeNode>,
+                            TreeNodeComparison> TreeNodeQueue;
 
 int nByte_utf8(unsigned char c);
 
@@ -1298,6 +1697,10 @@ public:
 
 /** \brief A spellchecker, constructed from two optimized-lookup transducer
     instances. An alphabet translator is built at construction time.
+
+    Corrections are searched for best first: the partial correction with
+    the smallest weight so far is always extended next. With nonnegative
+    weights this lets the search be cut short, see #correct.
 */
 class Speller
 {
@@ -1306,9 +1709,14 @@ public:
     Transducer * lexicon;
     InputString input;
     TreeNodeQueue queue;
+    SpellerPathTable paths;
     SymbolNumberVector alphabet_translator;
 //    hfst::FdTable<SymbolNumber> operations;
     std::vector<std::string> symbol_table;
+    // Limits of the correction in progress, see correct()
+    Weight max_weight;
+    Weight beam;
+    Weight best_weight;
     
     Speller(Transducer * mutator_ptr, Transducer * lexicon_ptr):
         mutator(mutator_ptr),
@@ -1317,7 +1725,10 @@ public:
         queue(TreeNodeQueue()),
         alphabet_translator(SymbolNumberVector()),
 //  operations(lexicon->get_fd_table()),
-        symbol_table(lexicon->get_symbol_table())
+        symbol_table(lexicon->get_symbol_table()),
+        max_weight(-1.0),
+        beam(-1.0),
+        best_weight(INFINITE_WEIGHT)
         {
             build_alphabet_translator();
         }
@@ -1325,17 +1736,35 @@ public:
     bool init_input(char * str, const Encoder & encoder, SymbolNumber other);
 
     void build_alphabet_translator(void);
-    void lexicon_epsilons(void);
-    void mutator_epsilons(void);
-    void consume_input(void);
-    void lexicon_consume(void);
+    unsigned int extend_path(unsigned int path, SymbolNumber symbol);
+    void push(const TreeNode & node);
+    void lexicon_epsilons(const TreeNode & node);
+    void mutator_epsilons(const TreeNode & node);
+    void consume_input(const TreeNode & node);
+    void lexicon_consume(const TreeNode & node);
     /** See if \a line is in the lexicon.
      */
     bool check(char * line);
     /** Return a priority queue of corrections of \a line.
+
+        The search can be limited in three ways, each of which is off
+        when given a negative value (or 0 for \a nbest):
+        - \a max_weight: no corrections heavier than this are returned,
+          and partial corrections heavier than this are not extended.
+        - \a beam: no corrections more than this heavier than the best
+          one found so far are returned or extended.
+        - \a nbest: at most this many corrections are returned, and the
+          search stops as soon as no partial correction left can give a
+          better one than the nbest found so far.
+
+        The limits assume that weights are nonnegative, so that
+        extending a partial correction never makes it lighter.
      */
-    CorrectionQueue correct(char * line);
+    CorrectionQueue correct(char * line, int nbest = 0,
+                            Weight max_weight = -1.0,
+                            Weight beam = -1.0);
     std::string stringify(SymbolNumberVector symbol_vector);
+    std::string stringify(unsigned int path);
 };
 
 }
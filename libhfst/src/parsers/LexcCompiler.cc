@@ -21,6 +21,19 @@
 #include <vector>
 #include <algorithm>
 #include <ctime>
+#include <chrono>
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <exception>
+
+#ifdef _MSC_VER
+#  include <process.h>
+#  define getpid _getpid
+#else
+#  include <unistd.h>
+#endif
 
 using std::string;
 using std::map;
@@ -31,6 +44,8 @@ using std::set_difference;
 
 #include "LexcCompiler.h"
 #include "HfstTransducer.h"
+#include "HfstInputStream.h"
+#include "HfstOutputStream.h"
 #include "XreCompiler.h"
 #include "lexc-utils.h"
 #ifdef YACC_USE_PARSER_H_EXTENSION
@@ -47,6 +62,8 @@ using hfst::hfst_fprintf_console;
 #endif // WINDOWS
 
 using hfst::HfstTransducer;
+using hfst::HfstInputStream;
+using hfst::HfstOutputStream;
 using hfst::implementations::HfstTransitionGraph;
 using hfst::implementations::HfstBasicTransducer;
 using hfst::implementations::HfstState;
@@ -86,6 +103,7 @@ LexcCompiler::LexcCompiler() :
     format_(TROPICAL_OPENFST_TYPE),
     xre_(TROPICAL_OPENFST_TYPE),
     initialLexiconName_("Root"),
+    jobs_(1),
     totalEntries_(0),
     currentEntries_(0),
 #ifdef WINDOWS
@@ -113,6 +131,7 @@ LexcCompiler::LexcCompiler(ImplementationType impl) :
     format_(impl),
     xre_(impl),
     initialLexiconName_("Root"),
+    jobs_(1),
     totalEntries_(0),
     currentEntries_(0),
 #ifdef WINDOWS
@@ -147,6 +166,7 @@ LexcCompiler::LexcCompiler(ImplementationType impl, bool withFlags, bool alignSt
     format_(impl),
     xre_(impl),
     initialLexiconName_("Root"),
+    jobs_(1),
     totalEntries_(0),
     currentEntries_(0),
 #ifdef WINDOWS
@@ -188,7 +208,21 @@ LexcCompiler::LexcCompiler(ImplementationType impl, bool withFlags, bool alignSt
       stringsTrie_ =hfst::implementations::HfstBasicTransducer(); // ?
       stringTries_.clear();
       stringVectors_.clear();
+      lexiconTries_.clear();
+      lexiconFingerprints_.clear();
+      rebuiltLexicons_.clear();
+      cachedLexicons_.clear();
+      stageTimes_.clear();
       regexps_.clear();
+      for (map<string,vector<HfstTransducer*> >::iterator it
+             = regexpEntries_.begin(); it != regexpEntries_.end(); ++it)
+        {
+          for (size_t i = 0; i < it->second.size(); i++)
+            {
+              delete it->second[i];
+            }
+        }
+      regexpEntries_.clear();
     }
 
 
@@ -401,6 +435,183 @@ LexcCompiler::addAlphabet(const string& alpha)
     return *this;
 }
 
+LexcCompiler&
+LexcCompiler::setCacheDirectory(const string& directory)
+{
+    cacheDirectory_ = directory;
+    return *this;
+}
+
+LexcCompiler&
+LexcCompiler::setJobs(unsigned int jobs)
+{
+    jobs_ = (jobs == 0) ? std::thread::hardware_concurrency() : jobs;
+    if (jobs_ == 0)
+      {
+        jobs_ = 1;
+      }
+    return *this;
+}
+
+unsigned int
+LexcCompiler::getEffectiveJobs() const
+{
+    // SFST and foma keep global state in their operations
+    if (format_ != TROPICAL_OPENFST_TYPE && format_ != LOG_OPENFST_TYPE)
+      {
+        return 1;
+      }
+    return jobs_;
+}
+
+const vector<string>&
+LexcCompiler::getRebuiltLexicons() const
+{
+    return rebuiltLexicons_;
+}
+
+const vector<string>&
+LexcCompiler::getCachedLexicons() const
+{
+    return cachedLexicons_;
+}
+
+const vector<pair<string,double> >&
+LexcCompiler::getStageTimes() const
+{
+    return stageTimes_;
+}
+
+// 64-bit FNV-1a, used to fingerprint the entries of a lexicon
+static const unsigned long long FINGERPRINT_BASIS = 14695981039346656037ULL;
+static const unsigned long long FINGERPRINT_PRIME = 1099511628211ULL;
+
+static void fingerprint(unsigned long long & h, const void * data, size_t size)
+{
+    const unsigned char * bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++)
+      {
+        h ^= bytes[i];
+        h *= FINGERPRINT_PRIME;
+      }
+}
+
+static void fingerprint(unsigned long long & h, const string & str)
+{
+    // include the terminating null so that "ab" "c" and "a" "bc" differ
+    fingerprint(h, str.c_str(), str.size() + 1);
+}
+
+void
+LexcCompiler::addToTrie(const StringPairVector& entry, double weight)
+{
+    float w = hfst::double_to_float(weight);
+    if (cacheDirectory_.empty() && getEffectiveJobs() <= 1)
+      {
+        stringsTrie_.disjunct(entry, w);
+        return;
+      }
+
+    lexiconTries_[currentLexiconName_].disjunct(entry, w);
+    if (cacheDirectory_.empty())
+      {
+        return;
+      }
+
+    // Compiling a lexicon depends on nothing but its tokenized entries,
+    // so fingerprinting them is enough to know when to compile it again.
+    map<string,unsigned long long>::iterator fp
+      = lexiconFingerprints_.find(currentLexiconName_);
+    if (fp == lexiconFingerprints_.end())
+      {
+        fp = lexiconFingerprints_.insert
+          (pair<string,unsigned long long>(currentLexiconName_,
+                                           FINGERPRINT_BASIS)).first;
+        int format = static_cast<int>(format_);
+        fingerprint(fp->second, &format, sizeof(format));
+      }
+    for (StringPairVector::const_iterator it = entry.begin();
+         it != entry.end(); it++)
+      {
+        fingerprint(fp->second, it->first);
+        fingerprint(fp->second, it->second);
+      }
+    fingerprint(fp->second, &w, sizeof(w));
+}
+
+// guards the error stream while lexicons are compiled in parallel
+static std::mutex lexicon_report_mutex;
+// makes the names of temporary cache files unique within the process
+static std::atomic<unsigned int> cache_temporary_count(0);
+
+HfstTransducer*
+LexcCompiler::compileLexicon(const string& name, bool& cached)
+{
+    cached = false;
+    const HfstBasicTransducer& trie = lexiconTries_.find(name)->second;
+    if (cacheDirectory_.empty())
+      {
+        HfstTransducer* lexicon = new HfstTransducer(trie, format_);
+        lexicon->optimize();
+        return lexicon;
+      }
+
+    char hex[17];
+    sprintf(hex, "%016llx", lexiconFingerprints_.find(name)->second);
+    string filename = cacheDirectory_ + "/" + hex + ".hfst";
+
+    FILE * cache_file = fopen(filename.c_str(), "rb");
+    if (cache_file != NULL)
+      {
+        fclose(cache_file);
+        try
+          {
+            HfstInputStream in(filename);
+            if (in.get_type() == format_)
+              {
+                HfstTransducer* lexicon = new HfstTransducer(in);
+                in.close();
+                cached = true;
+                return lexicon;
+              }
+            in.close();
+          }
+        catch (const HfstException &)
+          {
+            // an unreadable file is compiled again and overwritten
+          }
+      }
+
+    HfstTransducer* lexicon = new HfstTransducer(trie, format_);
+    lexicon->optimize();
+
+    // Write to a temporary file first so that an interrupted compilation
+    // or another compiler sharing the directory never sees half a file.
+    // The process id and a counter keep compilers that write the same
+    // lexicon at the same time from writing into each other's file.
+    char suffix[64];
+    sprintf(suffix, ".%ld.%u.tmp", (long)getpid(), cache_temporary_count++);
+    string tmpname = filename + suffix;
+    try
+      {
+        HfstOutputStream out(tmpname, format_);
+        out << *lexicon;
+        out.close();
+        if (rename(tmpname.c_str(), filename.c_str()) != 0)
+          {
+            remove(tmpname.c_str());
+          }
+      }
+    catch (const HfstException &)
+      {
+        std::lock_guard<std::mutex> lock(lexicon_report_mutex);
+        std::ostream * err = get_stream(error_);
+        if (!quiet_) *err << "warning: could not write " << filename << std::endl;
+        flush(err);
+      }
+    return lexicon;
+}
+
 // Construct vector nameJoiner data contJoiner and add to trie
 LexcCompiler&
 LexcCompiler::addStringEntry(const string& data,
@@ -475,7 +686,7 @@ LexcCompiler::addStringEntry(const string& data,
 	    it->second.replace(start_pos, zero.length(), "0");
 	  }
       }
-    stringsTrie_.disjunct(newVector, hfst::double_to_float(weight));
+    addToTrie(newVector, weight);
 
     return *this;
 }
@@ -683,7 +894,7 @@ LexcCompiler::addStringPairEntry(const string& upper, const string& lower,
 	  }
       }
 
-    stringsTrie_.disjunct(newVector, hfst::double_to_float(weight));
+    addToTrie(newVector, weight);
 
     return *this;
 }
@@ -727,12 +938,8 @@ LexcCompiler::addXreEntry(const string& regexp, const string& continuation,
     tokenizer_.add_multichar_symbol(regex_key);
 
     // FIXME: add all implicit chars to multichar symbols
-    if (regexps_.find(regex_key) == regexps_.end())
-      {
-        regexps_.insert(pair<string,HfstTransducer*>(regex_key,
-                                                   new HfstTransducer(format_)));
-      }
-    regexps_[regex_key]->disjunct(*newPaths).optimize();
+    // the entries of each key are disjuncted in compileLexical
+    regexpEntries_[regex_key].push_back(newPaths);
     if (!quiet_)
       {
         if ((currentEntries_ % 10000) == 0)
@@ -765,7 +972,7 @@ LexcCompiler::addXreEntry(const string& regexp, const string& continuation,
       }
       tokenizer_.add_multichar_symbol(joinerEnc);
       StringPairVector newVector(tokenizer_.tokenize(joinerEnc + regex_key + encodedCont));
-      stringsTrie_.disjunct(newVector, hfst::double_to_float(weight));
+      addToTrie(newVector, weight);
 
 
 
@@ -854,6 +1061,84 @@ LexcCompiler::setInitialLexiconName(const string& lexiconName)
     return *this;
 }
 
+// Call f(i) for every i below n on at most jobs threads. An exception
+// thrown by f is passed on once all threads have finished.
+template<class F>
+static void parallel_for(size_t n, unsigned int jobs, F f)
+{
+    if (jobs <= 1 || n <= 1)
+      {
+        for (size_t i = 0; i < n; i++)
+          {
+            f(i);
+          }
+        return;
+      }
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < jobs && t < n; t++)
+      {
+        threads.push_back(std::thread([&]()
+          {
+            for (size_t i = next++; i < n; i = next++)
+              {
+                try
+                  {
+                    f(i);
+                  }
+                catch (...)
+                  {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error)
+                      {
+                        error = std::current_exception();
+                      }
+                  }
+              }
+          }));
+      }
+    for (size_t t = 0; t < threads.size(); t++)
+      {
+        threads[t].join();
+      }
+    if (error)
+      {
+        std::rethrow_exception(error);
+      }
+}
+
+// Disjunct all of transducers into transducers[0] and delete the rest.
+// Pairs are merged in rounds, each round on up to jobs threads, so that
+// no single union has to absorb all the others one by one.
+static void parallel_union(vector<HfstTransducer*>& transducers,
+                           unsigned int jobs)
+{
+    while (transducers.size() > 1)
+      {
+        size_t half = (transducers.size() + 1) / 2;
+        parallel_for(transducers.size() - half, jobs, [&](size_t i)
+          {
+            transducers[i]->disjunct(*transducers[half + i]).optimize();
+            delete transducers[half + i];
+            transducers[half + i] = NULL;
+          });
+        transducers.resize(half);
+      }
+}
+
+// Record the time since @a start as the duration of @a stage and start
+// timing the next stage.
+static void end_stage(vector<pair<string,double> > & times, const char * stage,
+                      std::chrono::steady_clock::time_point & start)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    times.push_back(pair<string,double>
+                    (stage, std::chrono::duration<double>(now - start).count()));
+    start = now;
+}
+
 HfstTransducer*
 LexcCompiler::compileLexical()
   {
@@ -874,10 +1159,76 @@ LexcCompiler::compileLexical()
         return 0;
       }
 
-    HfstTransducer lexicons(stringsTrie_, format_);
+    stageTimes_.clear();
+    rebuiltLexicons_.clear();
+    cachedLexicons_.clear();
+    std::chrono::steady_clock::time_point stage_start
+      = std::chrono::steady_clock::now();
 
+    const unsigned int jobs = getEffectiveJobs();
+    HfstTransducer lexicons(format_);
+    if (lexiconTries_.empty())
+      {
+        lexicons = HfstTransducer(stringsTrie_, format_);
+      }
+    else
+      {
+        vector<string> names;
+        for (map<string,HfstBasicTransducer>::const_iterator it
+               = lexiconTries_.begin(); it != lexiconTries_.end(); ++it)
+          {
+            names.push_back(it->first);
+          }
+        vector<HfstTransducer*> compiled(names.size(), NULL);
+        // vector<bool> packs bits, which threads cannot write separately
+        vector<char> cached(names.size(), 0);
+        parallel_for(names.size(), jobs, [&](size_t i)
+          {
+            bool from_cache = false;
+            compiled[i] = compileLexicon(names[i], from_cache);
+            cached[i] = from_cache;
+          });
+        for (size_t i = 0; i < names.size(); i++)
+          {
+            if (cached[i])
+              cachedLexicons_.push_back(names[i]);
+            else
+              rebuiltLexicons_.push_back(names[i]);
+          }
+        parallel_union(compiled, jobs);
+        lexicons = *compiled[0];
+        delete compiled[0];
+      }
 
     lexicons.optimize();
+    end_stage(stageTimes_, "lexicons", stage_start);
+
+    // Disjunct the regular expression entries of each key, together with
+    // the union left by an earlier call if there is one.
+    vector<string> regexp_keys;
+    vector<vector<HfstTransducer*> > regexp_entries;
+    for (map<string,vector<HfstTransducer*> >::iterator it
+           = regexpEntries_.begin(); it != regexpEntries_.end(); ++it)
+      {
+        regexp_keys.push_back(it->first);
+        regexp_entries.push_back(vector<HfstTransducer*>());
+        regexp_entries.back().swap(it->second);
+        map<string,HfstTransducer*>::iterator earlier = regexps_.find(it->first);
+        if (earlier != regexps_.end())
+          {
+            regexp_entries.back().push_back(earlier->second);
+          }
+      }
+    regexpEntries_.clear();
+    parallel_for(regexp_keys.size(), jobs, [&](size_t i)
+      {
+        parallel_union(regexp_entries[i], 1);
+      });
+    for (size_t i = 0; i < regexp_keys.size(); i++)
+      {
+        regexps_[regexp_keys[i]] = regexp_entries[i][0];
+      }
+    end_stage(stageTimes_, "regexp unions", stage_start);
 
     // repeat star to overgenerate
     lexicons.repeat_star().optimize();
@@ -1039,6 +1390,7 @@ LexcCompiler::compileLexical()
           }
 
         lexicons.compose(joinersAll).optimize();
+        end_stage(stageTimes_, "morphotax", stage_start);
 
         if (debug)
           {
@@ -1093,6 +1445,7 @@ LexcCompiler::compileLexical()
 
         lexicons.substitute(allSubstitutions).optimize();
         lexicons.prune_alphabet();
+        end_stage(stageTimes_, "joiners", stage_start);
 
         if (debug)
           {
@@ -1160,6 +1513,7 @@ LexcCompiler::compileLexical()
         lexicons_basic.substitute(regMarkToTr, true);
 
         lexicons_basic.prune_alphabet();
+        end_stage(stageTimes_, "regexps", stage_start);
 
         if (debug)
           {
@@ -1239,9 +1593,11 @@ LexcCompiler::compileLexical()
         filtered_lexicons.compose(*flag_filter, true).optimize();
          
         rv->assign(filtered_lexicons);
+        end_stage(stageTimes_, "flags", stage_start);
     }
 
     rv->optimize();
+    end_stage(stageTimes_, "optimize", stage_start);
     
     if(!quiet_) *err << endl;
     
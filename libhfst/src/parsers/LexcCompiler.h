@@ -26,6 +26,8 @@
 #endif
 
 #include <string>
+#include <vector>
+#include <map>
 #include <cstdio>
 
 //#include "HfstTransducer.h"
@@ -138,9 +140,35 @@ class LexcCompiler
   //! @brief set start lexicon's name to @a lexicon_name.
   LexcCompiler& setInitialLexiconName(const std::string& lexicon_name);
 
+  //! @brief compile each lexicon separately and keep it in @a directory.
+  //! A lexicon whose entries have not changed since an earlier compilation
+  //! is then read from @a directory instead of being compiled again.
+  //! The files are named after a fingerprint of the entries, so stale files
+  //! are never used, only left behind. An empty @a directory, the default,
+  //! compiles all lexicons at once without caching.
+  LexcCompiler& setCacheDirectory(const std::string& directory);
+
+  //! @brief compile lexicons and regular expression entries on up to
+  //! @a jobs threads, 0 meaning one per core. Must be set before parsing.
+  //! Only OpenFst formats are compiled in parallel; the other back-ends
+  //! are not thread-safe and always use one thread.
+  LexcCompiler& setJobs(unsigned int jobs);
+
   //! @brief create final usable version of current lexicons and entries.
   hfst::HfstTransducer* compileLexical();
 
+  //! @brief names of the lexicons that the last compileLexical compiled,
+  //! when a cache directory is set.
+  const std::vector<std::string>& getRebuiltLexicons() const;
+
+  //! @brief names of the lexicons that the last compileLexical read from
+  //! the cache directory.
+  const std::vector<std::string>& getCachedLexicons() const;
+
+  //! @brief stages of the last compileLexical and the time in seconds that
+  //! each of them took, in the order they were run.
+  const std::vector<std::pair<std::string,double> >& getStageTimes() const;
+
   //! @brief get trie formed by current string entries
   const std::map<std::string,hfst::HfstTransducer>& getStringTries() const;
 
@@ -152,6 +180,19 @@ class LexcCompiler
   const LexcCompiler& printConnectedness(bool & warnings_printed);
 
   private:
+  //! @brief add the path @a entry weighing @a weight to the trie of the
+  //! current lexicon.
+  void addToTrie(const StringPairVector& entry, double weight);
+
+  //! @brief the number of threads to compile with, 1 if format_ does
+  //! not allow more.
+  unsigned int getEffectiveJobs() const;
+
+  //! @brief compile the lexicon @a name, or read it from the cache
+  //! directory if it has been compiled before, setting @a cached.
+  //! Safe to call for different lexicons at the same time.
+  hfst::HfstTransducer* compileLexicon(const std::string& name, bool& cached);
+
   bool quiet_;
   bool verbose_;
   bool align_strings_;
@@ -174,10 +215,18 @@ class LexcCompiler
   std::map<std::string,hfst::HfstTransducer*> stringTries_;
   std::map<std::string,HfstBasicTransducer*> stringVectors_;
   HfstBasicTransducer stringsTrie_;
+  std::string cacheDirectory_;
+  std::map<std::string,HfstBasicTransducer> lexiconTries_;
+  std::map<std::string,unsigned long long> lexiconFingerprints_;
+  std::vector<std::string> rebuiltLexicons_;
+  std::vector<std::string> cachedLexicons_;
+  std::vector<std::pair<std::string,double> > stageTimes_;
+  unsigned int jobs_;
 
 
 
   std::map<std::string,hfst::HfstTransducer*> regexps_;
+  std::map<std::string,std::vector<hfst::HfstTransducer*> > regexpEntries_;
   std::set<std::string> lexiconNames_;
   std::set<std::string> noFlags_;
   std::set<std::string> continuations_;
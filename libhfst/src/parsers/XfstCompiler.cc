@@ -322,7 +322,7 @@ namespace xfst {
   void XfstCompiler::set_error_stream(std::ostream & os)
   {
     error_ = &os;
-    //this->xre_.set_error_stream(this->error_);
+    this->xre_.set_error_stream(this->error_);
     this->lexc_.set_error_stream(this->error_);
   }
 
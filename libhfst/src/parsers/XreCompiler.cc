@@ -23,18 +23,134 @@
 
 namespace hfst { namespace xre {
 
-    unsigned int cr=0; // number of chars read from xre input
-    unsigned int lr=1; // number of lines read from xre input
-    std::set<unsigned int> positions;
-    char * position_symbol = NULL;
-    std::ostream * error_(&std::cerr);
+    // The state of the regex being parsed in this thread. The settings
+    // are those of the compiler that parses it, see XreCompiler::Scope.
+    thread_local unsigned int cr=0; // number of chars read from xre input
+    thread_local unsigned int lr=1; // number of lines read from xre input
+    thread_local std::set<unsigned int> positions;
+    thread_local char * position_symbol = NULL;
+    thread_local std::ostream * error_(&std::cerr);
 #ifdef WINDOWS
-    std::ostringstream winoss_;
-    std::ostream * redirected_stream_ = NULL;
-    bool output_to_console_(false);
+    thread_local std::ostringstream winoss_;
+    thread_local std::ostream * redirected_stream_ = NULL;
+    thread_local bool output_to_console_(false);
 #endif
-    bool verbose_(false);
-    std::set<std::string> * defined_multichar_symbols_(NULL);
+    thread_local bool verbose_(false);
+    thread_local std::set<std::string> * defined_multichar_symbols_(NULL);
+
+extern thread_local bool expand_definitions;
+extern thread_local bool harmonize_;
+extern thread_local bool harmonize_flags_;
+extern thread_local SubexpressionCache * subexpression_cache;
+
+/* Make the settings of a compiler the current ones in this thread for as
+   long as it compiles. A compiler may be used while another one is
+   compiling, e.g. by the merge operator, so the outer settings are put
+   back afterwards. */
+struct XreCompiler::Scope
+{
+  XreCompiler & compiler;
+  std::ostream * outer_error;
+  bool outer_verbose;
+  bool outer_expand_definitions;
+  bool outer_harmonize;
+  bool outer_harmonize_flags;
+  std::set<std::string> * outer_multichar_symbols;
+  SubexpressionCache * outer_cache;
+  unsigned int outer_cr;
+
+  Scope(XreCompiler & compiler_):
+    compiler(compiler_),
+    outer_error(hfst::xre::error_),
+    outer_verbose(hfst::xre::verbose_),
+    outer_expand_definitions(hfst::xre::expand_definitions),
+    outer_harmonize(hfst::xre::harmonize_),
+    outer_harmonize_flags(hfst::xre::harmonize_flags_),
+    outer_multichar_symbols(hfst::xre::defined_multichar_symbols_),
+    outer_cache(hfst::xre::subexpression_cache),
+    outer_cr(hfst::xre::cr)
+  {
+    hfst::xre::error_ = compiler.error_stream_;
+    hfst::xre::verbose_ = compiler.verbose_;
+    hfst::xre::expand_definitions = compiler.expand_definitions_;
+    hfst::xre::harmonize_ = compiler.harmonization_;
+    hfst::xre::harmonize_flags_ = compiler.flag_harmonization_;
+    hfst::xre::defined_multichar_symbols_ = compiler.check_multichar_symbols_ ?
+      &compiler.defined_multichar_symbols_ : NULL;
+    hfst::xre::subexpression_cache = compiler.subexpression_cache_.get();
+    hfst::xre::cr = 0;
+  }
+
+  ~Scope()
+  {
+    hfst::xre::error_ = outer_error;
+    hfst::xre::verbose_ = outer_verbose;
+    hfst::xre::expand_definitions = outer_expand_definitions;
+    hfst::xre::harmonize_ = outer_harmonize;
+    hfst::xre::harmonize_flags_ = outer_harmonize_flags;
+    hfst::xre::defined_multichar_symbols_ = outer_multichar_symbols;
+    hfst::xre::subexpression_cache = outer_cache;
+    hfst::xre::cr = outer_cr;
+  }
+};
+
+SubexpressionCache::SubexpressionCache(size_t max_entries):
+  max_entries_(max_entries), lookups_(0), hits_(0)
+{}
+
+std::shared_ptr<const HfstTransducer>
+SubexpressionCache::get(const std::string & key)
+{
+  lookups_++;
+  std::unordered_map<std::string, std::shared_ptr<const HfstTransducer> >
+    ::const_iterator it = entries_.find(key);
+  if (it == entries_.end())
+    {
+      return std::shared_ptr<const HfstTransducer>();
+    }
+  hits_++;
+  return it->second;
+}
+
+void
+SubexpressionCache::add(const std::string & key,
+                        const std::vector<std::string> & names,
+                        const HfstTransducer & transducer)
+{
+  if (entries_.size() >= max_entries_)
+    {
+      entries_.clear();
+      keys_by_name_.clear();
+    }
+  entries_[key] = std::shared_ptr<const HfstTransducer>
+    (new HfstTransducer(transducer));
+  for (std::vector<std::string>::const_iterator it = names.begin();
+       it != names.end(); it++)
+    {
+      keys_by_name_.insert(std::make_pair(*it, key));
+    }
+}
+
+void
+SubexpressionCache::forget(const std::string & name)
+{
+  typedef std::unordered_multimap<std::string, std::string>::iterator
+    NameIterator;
+  std::pair<NameIterator, NameIterator> range
+    = keys_by_name_.equal_range(name);
+  for (NameIterator it = range.first; it != range.second; it++)
+    {
+      entries_.erase(it->second);
+    }
+  keys_by_name_.erase(range.first, range.second);
+}
+
+void
+SubexpressionCache::clear()
+{
+  entries_.clear();
+  keys_by_name_.clear();
+}
 
 XreCompiler::XreCompiler() :
     definitions_(),
@@ -42,7 +158,14 @@ XreCompiler::XreCompiler() :
     function_arguments_(),
     list_definitions_(),
     format_(hfst::TROPICAL_OPENFST_TYPE),
-    verbose_(false)
+    verbose_(false),
+    error_stream_(&std::cerr),
+    expand_definitions_(false),
+    harmonization_(true),
+    flag_harmonization_(false),
+    defined_multichar_symbols_(),
+    check_multichar_symbols_(false),
+    contained_only_comments_(false)
 #ifdef WINDOWS
     , output_to_console_(false)
 #endif
@@ -54,27 +177,49 @@ XreCompiler::XreCompiler(hfst::ImplementationType impl) :
     function_arguments_(),
     list_definitions_(),
     format_(impl),
-    verbose_(false)
+    verbose_(false),
+    error_stream_(&std::cerr),
+    expand_definitions_(false),
+    harmonization_(true),
+    flag_harmonization_(false),
+    defined_multichar_symbols_(),
+    check_multichar_symbols_(false),
+    contained_only_comments_(false)
 #ifdef WINDOWS
     , output_to_console_(false)
 #endif
 {}
 
     XreCompiler::XreCompiler(const struct XreConstructorArguments & args) :
-    definitions_(args.definitions),
+    definitions_(),
     function_definitions_(args.function_definitions),
     function_arguments_(args.function_arguments),
     list_definitions_(args.list_definitions),
     format_(args.format),
-    verbose_(false)
+    verbose_(false),
+    error_stream_(&std::cerr),
+    expand_definitions_(false),
+    harmonization_(true),
+    flag_harmonization_(false),
+    defined_multichar_symbols_(),
+    check_multichar_symbols_(false),
+    contained_only_comments_(false)
 #ifdef WINDOWS
     , output_to_console_(false)
 #endif
-{}
+{
+  // The definitions are owned by the compiler they come from. The copies
+  // share their implementations until changed.
+  for (std::map<std::string,hfst::HfstTransducer*>::const_iterator it
+         = args.definitions.begin(); it != args.definitions.end(); it++)
+    {
+      definitions_[it->first] = new HfstTransducer(*(it->second));
+    }
+}
 
     XreCompiler::~XreCompiler()
     {
-      for(std::map<std::string,hfst::HfstTransducer*>::iterator it
+      for(DefinitionMap::iterator it
             = definitions_.begin(); it != definitions_.end(); it++)
         {
           delete it->second;
@@ -84,7 +229,6 @@ XreCompiler::XreCompiler(hfst::ImplementationType impl) :
     void XreCompiler::set_verbosity(bool verbose)
     {
       this->verbose_ = verbose;
-      hfst::xre::verbose_ = verbose; // TODO
     }
 
     bool XreCompiler::get_verbosity()
@@ -92,15 +236,31 @@ XreCompiler::XreCompiler(hfst::ImplementationType impl) :
       return this->verbose_;
     }
 
-    // TODO: get rid of global variables
+    void XreCompiler::set_subexpression_caching(bool value)
+    {
+      if (! value)
+        {
+          subexpression_cache_.reset();
+        }
+      else if (subexpression_cache_.get() == NULL)
+        {
+          subexpression_cache_.reset(new SubexpressionCache());
+        }
+    }
+
+    const SubexpressionCache * XreCompiler::get_subexpression_cache() const
+    {
+      return subexpression_cache_.get();
+    }
+
     void XreCompiler::set_error_stream(std::ostream * os)
     {
-      hfst::xre::error_ = os;
+      this->error_stream_ = os;
     }
 
     std::ostream * XreCompiler::get_error_stream()
     {
-      return hfst::xre::error_;
+      return this->error_stream_;
     }
 
   XreCompiler&
@@ -173,7 +333,11 @@ XreCompiler::define(const std::string& name, const std::string& xre)
         }
       return false;
     }
-  definitions_[name] = compiled;
+  HfstTransducer *& definition = definitions_[name];
+  delete definition;
+  definition = compiled;
+  if (subexpression_cache_.get() != NULL)
+    subexpression_cache_->forget(name);
   return true;
 }
 
@@ -186,7 +350,12 @@ XreCompiler::define_list(const std::string& name, const std::set<std::string>& s
 void
 XreCompiler::define(const std::string& name, const HfstTransducer & transducer)
 {
-  definitions_[name] = new HfstTransducer(transducer);
+  HfstTransducer * copy = new HfstTransducer(transducer);
+  HfstTransducer *& definition = definitions_[name];
+  delete definition;
+  definition = copy;
+  if (subexpression_cache_.get() != NULL)
+    subexpression_cache_->forget(name);
 }
 
 bool
@@ -219,58 +388,49 @@ XreCompiler::is_function_definition(const std::string & name)
 void
 XreCompiler::undefine(const std::string& name)
 {
-if (definitions_.find(name) != definitions_.end())
-  {
-    delete definitions[name];
-    definitions_.erase(name);
-  }
+  DefinitionMap::iterator it = definitions_.find(name);
+  if (it != definitions_.end())
+    {
+      delete it->second;
+      definitions_.erase(it);
+    }
+  if (subexpression_cache_.get() != NULL)
+    subexpression_cache_->forget(name);
 }
 
 void
 XreCompiler::remove_defined_multichar_symbols()
 {
-  if (defined_multichar_symbols_ != NULL)
-    {
-      delete defined_multichar_symbols_;
-      defined_multichar_symbols_ = NULL;
-    }
+  defined_multichar_symbols_.clear();
+  check_multichar_symbols_ = false;
 }
 
 void
 XreCompiler::add_defined_multichar_symbol(const std::string & symbol)
 {
-  if (defined_multichar_symbols_ == NULL)
-    {
-      defined_multichar_symbols_ = new std::set<std::string>();
-    }
-  defined_multichar_symbols_->insert(symbol);
+  defined_multichar_symbols_.insert(symbol);
+  check_multichar_symbols_ = true;
 }
 
-extern bool expand_definitions;
-extern bool harmonize_;
-extern bool harmonize_flags_;
-    //extern bool verbose_;
-    //extern FILE * warning_stream;
-
 void XreCompiler::set_expand_definitions(bool expand)
 {
-  expand_definitions=expand;
+  expand_definitions_=expand;
 }
 
 void XreCompiler::set_harmonization(bool harmonize)
 {
-  harmonize_=harmonize;
+  harmonization_=harmonize;
 }
 
 void XreCompiler::set_flag_harmonization(bool harmonize_flags)
 {
-  harmonize_flags_=harmonize_flags;
+  flag_harmonization_=harmonize_flags;
 }
 
 bool
 XreCompiler::contained_only_comments()
 {
-  return contains_only_comments;
+  return contained_only_comments_;
 }
 
 HfstTransducer*
@@ -278,12 +438,11 @@ XreCompiler::compile(const std::string& xre)
 {
   // debug
   //std::cerr << "XreCompiler: " << this << " : compile(\"" << xre << "\")" << std::endl;
-  unsigned int cr_before = cr;
-  cr = 0;
+  Scope scope(*this);
   try
     {
       HfstTransducer * retval = hfst::xre::compile(xre, definitions_, function_definitions_, function_arguments_, list_definitions_, format_);
-      cr = cr_before;
+      contained_only_comments_ = contains_only_comments;
       return retval;
     }
   catch (const char * msg)
@@ -300,13 +459,12 @@ XreCompiler::compile_first(const std::string& xre, unsigned int & chars_read)
 {
   // debug
   //std::cerr << "XreCompiler: " << this << " : compile_first(\"" << xre << "\"";
-  unsigned int cr_before = cr;
-  cr = 0;
+  Scope scope(*this);
   try
     {
       HfstTransducer * retval = hfst::xre::compile_first(xre, definitions_, function_definitions_, function_arguments_, list_definitions_, format_, chars_read);
       //std::cerr << ", " << chars_read << ")" << std::endl;
-      cr = cr_before;
+      contained_only_comments_ = contains_only_comments;
       return retval;
     }
   catch (const char * msg)
@@ -321,10 +479,9 @@ XreCompiler::compile_first(const std::string& xre, unsigned int & chars_read)
 bool XreCompiler::get_positions_of_symbol_in_xre
 (const std::string & symbol, const std::string & xre, std::set<unsigned int> & positions_)
 {
+  Scope scope(*this);
   position_symbol = strdup(symbol.c_str());
   positions.clear();
-  unsigned int cr_before = cr;
-  cr = 0;
   HfstTransducer * compiled =
     hfst::xre::compile(xre, definitions_, function_definitions_, function_arguments_, list_definitions_, format_);
   free(position_symbol);
@@ -338,7 +495,6 @@ bool XreCompiler::get_positions_of_symbol_in_xre
     }
   delete compiled;
   positions_ = positions;
-  cr = cr_before;
   return true;
 }
 
@@ -362,15 +518,15 @@ main(int, char**)
     XreCompiler defaultXre();
 #if HAVE_SFST
     std::cout << " (SFST)..." << std::endl;;
-    XreCompiler sfstXre = XreCompiler(SFST_TYPE);
+    XreCompiler sfstXre(SFST_TYPE);
 #endif
 #if HAVE_OPENFST
     std::cout << " (OpenFst)..." << std::endl;;
-    XreCompiler ofstXre = XreCompiler(TROPICAL_OPENFST_TYPE);
+    XreCompiler ofstXre(TROPICAL_OPENFST_TYPE);
 #endif
 #if HAVE_FOMA
     std::cout << " (Foma)..." << std::endl;;
-    XreCompiler fomaXre = XreCompiler(FOMA_TYPE);
+    XreCompiler fomaXre(FOMA_TYPE);
 #endif
     HfstBasicTransducer basicCat;
     basicCat.add_state(1);
@@ -497,6 +653,32 @@ main(int, char**)
 #if HAVE_FOMA
     std::cout << " foma define(vowels, a | e | i | o | u | y)..." << std::endl;;
     fomaXre.define("vowels", "a | e | i | o | u | y");
+#endif
+#if HAVE_OPENFST
+    std::cout << std::endl << "subexpression cache:" << std::endl;
+    XreCompiler cachingXre(TROPICAL_OPENFST_TYPE);
+    cachingXre.set_subexpression_caching(true);
+    cachingXre.set_expand_definitions(true);
+    cachingXre.define("V", "a | e");
+    const char * repeated = "[V | i] x [ V | i ] x [.#. y]:b [.#. y]:b ;";
+    HfstTransducer* cached = cachingXre.compile(repeated);
+    assert(cached != 0);
+    assert(cachingXre.get_subexpression_cache()->get_lookups() == 4);
+    assert(cachingXre.get_subexpression_cache()->get_hits() == 2);
+    ofstXre.set_expand_definitions(true);
+    ofstXre.define("V", "a | e");
+    HfstTransducer* uncached = ofstXre.compile(repeated);
+    assert(cached->compare(*uncached));
+    delete cached;
+    delete uncached;
+    // a new definition of V is used in place of the cached one
+    cachingXre.define("V", "o");
+    ofstXre.define("V", "o");
+    cached = cachingXre.compile(repeated);
+    uncached = ofstXre.compile(repeated);
+    assert(cached->compare(*uncached));
+    delete cached;
+    delete uncached;
 #endif
     std::cout << "ok." << std::endl;
     return EXIT_SUCCESS;
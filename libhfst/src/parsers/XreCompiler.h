@@ -29,6 +29,8 @@
 
 #include <string>
 #include <cstdio>
+#include <memory>
+#include <unordered_map>
 #include "../HfstDataTypes.h"
 
 namespace hfst {
@@ -36,6 +38,9 @@ namespace hfst {
 //! Regular Expresisions (XRE) parsing.
 namespace xre {
 
+  //! @brief The transducers defined with XreCompiler::define, by name.
+  typedef std::unordered_map<std::string,hfst::HfstTransducer*> DefinitionMap;
+
   // needed for merge operation
 struct XreConstructorArguments
 {
@@ -60,7 +65,48 @@ struct XreConstructorArguments
   }
 };
 
+//! @brief Transducers compiled from bracketed subexpressions, by a
+//!        normalized form of the subexpression.
+//!
+//! An entry is dropped when a definition that its subexpression may refer
+//! to changes. The cache is emptied when it gets full.
+class SubexpressionCache
+{
+  public:
+  SubexpressionCache(size_t max_entries=10000);
+
+  //! @brief The transducer stored under @a key or an empty pointer.
+  std::shared_ptr<const HfstTransducer> get(const std::string & key);
+
+  //! @brief Store a copy of @a transducer under @a key. @a names are the
+  //!        symbols of the subexpression that may name a definition.
+  void add(const std::string & key, const std::vector<std::string> & names,
+           const HfstTransducer & transducer);
+
+  //! @brief Drop the entries whose subexpression refers to @a name.
+  void forget(const std::string & name);
+
+  void clear();
+
+  size_t get_lookups() const { return lookups_; }
+  size_t get_hits() const { return hits_; }
+  size_t size() const { return entries_.size(); }
+
+  private:
+  std::unordered_map<std::string, std::shared_ptr<const HfstTransducer> >
+    entries_;
+  std::unordered_multimap<std::string, std::string> keys_by_name_;
+  size_t max_entries_;
+  size_t lookups_;
+  size_t hits_;
+};
+
 //! @brief A compiler holding information needed to compile XREs.
+//!
+//! Each compiler keeps its own definitions and settings, so different
+//! compilers may compile at the same time in different threads if the
+//! back-end allows it (OpenFst does, SFST and foma do not). A single
+//! compiler may only be used by one thread at a time.
 class XreCompiler
 {
   public:
@@ -147,6 +193,14 @@ class XreCompiler
   //!        Default is false.
   void set_flag_harmonization(bool harmonize_flags);
 
+  //! @brief Whether the transducers compiled from bracketed subexpressions
+  //!        are kept and used again when the same subexpression comes up.
+  //!        Default is false.
+  void set_subexpression_caching(bool value);
+
+  //! @brief The subexpression cache, NULL if caching is off.
+  const SubexpressionCache * get_subexpression_cache() const;
+
   void set_verbosity(bool verbose);
   bool get_verbosity();
   void set_error_stream(std::ostream * os);
@@ -160,12 +214,25 @@ class XreCompiler
   static void flush(std::ostream * oss);
 
   private:
-  std::map<std::string,hfst::HfstTransducer*> definitions_;
+  // Installs the settings below for the parser while compiling
+  struct Scope;
+
+  DefinitionMap definitions_;
   std::map<std::string, std::string> function_definitions_;
   std::map<std::string, unsigned int > function_arguments_;
   std::map<std::string, std::set<std::string> > list_definitions_;
   hfst::ImplementationType format_;
   bool verbose_;
+  std::ostream * error_stream_;
+  bool expand_definitions_;
+  bool harmonization_;
+  bool flag_harmonization_;
+  std::set<std::string> defined_multichar_symbols_;
+  bool check_multichar_symbols_;
+  bool contained_only_comments_;
+  // Also makes XreCompiler non-copyable; a copy would have deleted
+  // the definitions it shares with the original twice anyway.
+  std::unique_ptr<SubexpressionCache> subexpression_cache_;
 #ifdef WINDOWS
   bool output_to_console_;
   // global std::ostringstream * winoss_;
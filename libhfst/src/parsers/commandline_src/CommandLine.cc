@@ -76,11 +76,20 @@ void CommandLine::print_help(void)
         << "  -D, --dont-resolve-right Don't resolve right-arrow conflicts."
         << std::endl
         << "  -f, --format=FORMAT      Store result in format FORMAT."
+        << std::endl
+        << "  -j, --jobs=N             Compile rules on N threads (0 for one"
+        << std::endl
+        << "                           per core)."
         << std::endl << std::endl;
   
   std::cerr << "Format may be one of openfst-log, openfst-tropical, foma or sfst."
         << std::endl << std::endl;
 
+  std::cerr << "Rules are compiled on several threads only in the openfst"
+            << std::endl
+            << "formats. With --verbose, the time taken by each rule is printed."
+            << std::endl << std::endl;
+
   std::cerr << "By default format is openfst-tropical. By default right arrow "
             << std::endl
             << "conflicts are resolved and left arrow conflicts are not resolved."
@@ -99,6 +108,7 @@ int CommandLine::parse_options(int argc, char** argv)
   bool isDebug = false;
   char * infilename = NULL;
   char * debug_file_name = NULL;
+  unsigned int number_of_jobs = 1;
   ImplementationType form = hfst::TROPICAL_OPENFST_TYPE;
 
   // use of this function requires options are settable on global scope
@@ -118,12 +128,13 @@ int CommandLine::parse_options(int argc, char** argv)
       {"dont-resolve-right",no_argument, 0, 'D'},
       {"debug_file",required_argument, 0, 'd'},
       {"format",required_argument, 0, 'f'},
+      {"jobs",required_argument, 0, 'j'},
       {0,0,0,0}
         };
       int option_index = 0;
       // add tool-specific options here
       int c = getopt_long(argc, argv,
-               ":hVvqsu" "i:o:" "RDi:d:f:",
+               ":hVvqsu" "i:o:" "RDi:d:f:j:",
                long_options, &option_index);
       if (-1 == c)
         {
@@ -205,6 +216,20 @@ int CommandLine::parse_options(int argc, char** argv)
           exit(1);
         }
       break;
+    case 'j':
+      {
+        char * end = NULL;
+        long n = strtol(optarg,&end,10);
+        if (*optarg == 0 || *end != 0 || n < 0)
+          {
+            std::cerr << "Invalid argument for --jobs: \"" << optarg
+                      << "\". Try running with option -h or --help."
+                      << std::endl;
+            exit(1);
+          }
+        number_of_jobs = (unsigned int)n;
+      }
+      break;
     case ':':
       std::cerr << "Missing argument for -" << (char)optopt
             << ". Try using --help."
@@ -250,6 +275,7 @@ int CommandLine::parse_options(int argc, char** argv)
   this->has_output_file = outputNamed;
   this->resolve_left_conflicts = resolve_left;
   this->resolve_right_conflicts = resolve_right;
+  this->jobs = number_of_jobs;
   if (this->has_input_file)
     { this->input_file_name = infilename; }
   if (this->has_output_file)
@@ -280,6 +306,7 @@ CommandLine::CommandLine(int argc,char * argv[]):
   output_file(NULL),
   resolve_left_conflicts(false),
   resolve_right_conflicts(true),
+  jobs(1),
   help(false),
   version(false),
   usage(false),
@@ -339,6 +366,7 @@ std::ostream &operator<<(std::ostream &out,const CommandLine &command_line)
     << "OUTFILE EXIST:\t" << command_line.has_output_file << std::endl
     << "OUTFILE:\t"       << command_line.output_file_name << std::endl
     << "FORMAT:\t\t"      << command_line.format << std::endl
+    << "JOBS:\t\t"        << command_line.jobs << std::endl
     << "RESOLVE:\t"       << command_line.resolve_conflicts << std::endl;
   return out;
 }
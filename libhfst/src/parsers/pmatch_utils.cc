@@ -2238,8 +2238,25 @@ StringSet PmatchUnaryOperation::get_initial_RC_initial_symbols(void)
 StringSet PmatchUnaryOperation::get_initial_NRC_initial_symbols(void)
 {
     if (op == NRC) {
+        // A symbol rules out every match beginning with it only if the
+        // context accepts that symbol alone. NRC({ab}) says nothing about
+        // matches that begin with a and go on with something else.
         HfstTransducer * tmp = this->root->evaluate();
-        StringSet retval(tmp->get_initial_input_symbols());
+        tmp->input_project();
+        StringSet initial(tmp->get_initial_input_symbols());
+        StringSet retval;
+        HfstTransducer empty(tmp->get_type());
+        for (StringSet::const_iterator it = initial.begin(); it != initial.end(); ++it) {
+            if (it->find("@I.") == 0) {
+                // an Ins stands for a whole language, not for one symbol
+                continue;
+            }
+            HfstTransducer alone(*it, tmp->get_type());
+            alone.compose(*tmp);
+            if (!alone.compare(empty)) {
+                retval.insert(*it);
+            }
+        }
         delete tmp;
         return retval;
     }
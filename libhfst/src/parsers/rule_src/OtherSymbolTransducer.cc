@@ -87,6 +87,9 @@ void OtherSymbolTransducer::set_transducer_type
 (ImplementationType transducer_type)
 { OtherSymbolTransducer::transducer_type = transducer_type; }
 
+ImplementationType OtherSymbolTransducer::get_transducer_type(void)
+{ return OtherSymbolTransducer::transducer_type; }
+
 OtherSymbolTransducer::OtherSymbolTransducer(void):
   is_broken(false),
   transducer(transducer_type)
@@ -176,6 +179,13 @@ OtherSymbolTransducer::OtherSymbolTransducer
   transducer(another.transducer)
 { /*add_diamond_transition();*/ }
 
+OtherSymbolTransducer OtherSymbolTransducer::deep_copy(void) const
+{
+  OtherSymbolTransducer retval(*this);
+  retval.transducer = transducer.deep_copy();
+  return retval;
+}
+
 OtherSymbolTransducer &OtherSymbolTransducer::harmonize_diacritics
 (OtherSymbolTransducer &t)
 {
@@ -141,6 +141,9 @@ class OtherSymbolTransducer
   //! @brief Set the type of transducer to be used
   static void set_transducer_type(ImplementationType transducer_type);
 
+  //! @brief Get the type of transducer that is used
+  static ImplementationType get_transducer_type(void);
+
   //! @brief Construct empty transducer.
   OtherSymbolTransducer(void);
 
@@ -154,6 +157,10 @@ class OtherSymbolTransducer
   //! @brief Copy constructor.
   OtherSymbolTransducer(const OtherSymbolTransducer &another);
 
+  //! @brief Return a copy of @a this that shares no data with it, so that
+  //! it can be used on another thread.
+  OtherSymbolTransducer deep_copy(void) const;
+
   //! @brief Set @a this equal to @another.
   OtherSymbolTransducer &operator=(const OtherSymbolTransducer &another);
 
@@ -51,6 +51,13 @@ Rule::Rule(const std::string &name,
     }
 }
 
+Rule::Rule(const std::string &name,
+           const OtherSymbolTransducer &rule_transducer):
+  is_empty(false),
+  name(unescape_name(name)),
+  rule_transducer(rule_transducer)
+{}
+
 Rule::~Rule(void)
 {}
 
@@ -82,6 +89,13 @@ bool Rule::empty(void) const
 OtherSymbolTransducer Rule::compile(void)
 { return OtherSymbolTransducer(); }
 
+void Rule::unshare_transducers(void)
+{
+  center = center.deep_copy();
+  context = context.deep_copy();
+  rule_transducer = rule_transducer.deep_copy();
+}
+
 void Rule::store(HfstOutputStream &out)
 {
   if (is_empty)
@@ -107,6 +121,9 @@ void Rule::store(HfstOutputStream &out)
 std::string Rule::get_name(void)
 { return name; }
 
+const OtherSymbolTransducer &Rule::get_rule_transducer(void) const
+{ return rule_transducer; }
+
 void Rule::add_name(void)
 { rule_transducer.add_info_symbol(name); }
 
@@ -55,6 +55,11 @@ class Rule
   Rule(const std::string &name,
        const RuleVector &v);
 
+  //! @brief Construct a rule whose transducer is @a rule_transducer, e.g.
+  //! an intersection of rules computed elsewhere.
+  Rule(const std::string &name,
+       const OtherSymbolTransducer &rule_transducer);
+
   //! @brief If conflict resolution incoreporates this rule in another rule
   //! @a empty return true and false otherwise.
   bool empty(void) const;
@@ -65,12 +70,20 @@ class Rule
   //! @brief Compile @a this.
   virtual OtherSymbolTransducer compile(void);
 
+  //! @brief Replace the transducers of @a this with copies that share no
+  //! data with other rules, so that @a this can be compiled on another
+  //! thread. Must be called on the thread that built the rule.
+  void unshare_transducers(void);
+
   //! @brief Store this transducer in @a out.
   void store(HfstOutputStream &out);
 
   //! @brief Get the name of this rule.
   std::string get_name(void);
 
+  //! @brief Get the compiled transducer of this rule.
+  const OtherSymbolTransducer &get_rule_transducer(void) const;
+
   //! @brief Return <tt>?* DIAMOND ?* DIAMOND ?*</tt>.
   static OtherSymbolTransducer get_universal_language_with_diamonds(void);
 
@@ -18,6 +18,8 @@
 
 #include "RuleContainer.h"
 
+#include <chrono>
+
 RuleContainer::RuleContainer(void):
   report(true)
 {}
@@ -33,16 +35,43 @@ RuleContainer::~RuleContainer(void)
 void RuleContainer::add_rule(Rule * rule)
 { rule_vector.push_back(rule); }
 
-void RuleContainer::compile(std::ostream &msg_out,bool be_verbose)
+void RuleContainer::compile
+(std::ostream &msg_out,bool be_verbose,unsigned int jobs)
 {
-  for (RuleVector::iterator it = rule_vector.begin();
+  // Copies of OpenFst transducers share their data through reference
+  // counts that are not thread-safe, so each rule gets transducers of its
+  // own before any of them is compiled on a worker.
+  if (jobs > 1)
+    {
+      for (RuleVector::iterator it = rule_vector.begin();
        it != rule_vector.end();
        ++it)
+    { (*it)->unshare_transducers(); }
+    }
+  std::vector<double> seconds(rule_vector.size(),0.0);
+  parallel_for(rule_vector.size(),jobs,[&](size_t i)
     {
-      if (be_verbose)
-    { msg_out << "Compiling " << Rule::get_print_name((*it)->get_name())
-          << std::endl; }
-      (*it)->compile();
+      if (be_verbose && jobs <= 1)
+    { msg_out << "Compiling "
+          << Rule::get_print_name(rule_vector[i]->get_name())
+          << std::flush; }
+      std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+      rule_vector[i]->compile();
+      seconds[i] = std::chrono::duration<double>
+    (std::chrono::steady_clock::now() - start).count();
+      if (be_verbose && jobs <= 1)
+    { msg_out << " (" << seconds[i] << " s)" << std::endl; }
+    });
+
+  // The rules compiled on other threads are reported in the same order
+  // as the ones compiled one by one.
+  if (be_verbose && jobs > 1)
+    {
+      for (size_t i = 0; i < rule_vector.size(); ++i)
+    { msg_out << "Compiling "
+          << Rule::get_print_name(rule_vector[i]->get_name())
+          << " (" << seconds[i] << " s)" << std::endl; }
     }
 }
 
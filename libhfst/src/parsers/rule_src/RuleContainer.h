@@ -24,6 +24,10 @@
 #endif
 
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
 
 #include "Rule.h"
 
@@ -38,9 +42,56 @@ class RuleContainer
   RuleContainer(void);
   virtual void add_rule(Rule * rule);
   virtual ~RuleContainer(void);
-  void compile(std::ostream &msg_out,bool be_verbose);
+
+  //! @brief Compile the rules on at most @a jobs threads. The rules are
+  //! independent of each other, so they can be compiled in any order. If
+  //! @a be_verbose, the time taken by each rule is printed in the order of
+  //! the rules.
+  void compile(std::ostream &msg_out,bool be_verbose,unsigned int jobs = 1);
   void store(HfstOutputStream &out,std::ostream &msg_out,bool be_verbose);
   void add_missing_symbols_freely(const SymbolRange &diacritics);
+
+  //! @brief Call @a f(i) for every i below @a n on at most @a jobs
+  //! threads. An exception thrown by @a f is passed on once all threads
+  //! have finished.
+  template<class F> static void parallel_for
+    (size_t n,unsigned int jobs,F f);
 };
 
+template<class F> void RuleContainer::parallel_for
+(size_t n,unsigned int jobs,F f)
+{
+  if (jobs <= 1 || n <= 1)
+    {
+      for (size_t i = 0; i < n; ++i)
+    { f(i); }
+      return;
+    }
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < jobs && t < n; ++t)
+    {
+      threads.push_back(std::thread([&]()
+        {
+          for (size_t i = next++; i < n; i = next++)
+        {
+          try
+            { f(i); }
+          catch (...)
+            {
+              std::lock_guard<std::mutex> lock(error_mutex);
+              if (! error)
+            { error = std::current_exception(); }
+            }
+        }
+        }));
+    }
+  for (size_t t = 0; t < threads.size(); ++t)
+    { threads[t].join(); }
+  if (error)
+    { std::rethrow_exception(error); }
+}
+
 #endif // RULE_CONTAINER_H_
@@ -16,6 +16,9 @@
 
 #include "TwolCGrammar.h"
 
+#include <thread>
+#include <chrono>
+
 std::string TwolCGrammar::get_original_name(const std::string &name)
 { return name.substr(0,name.find("SUBCASE:")); }
 
@@ -24,7 +27,8 @@ TwolCGrammar::TwolCGrammar(bool be_quiet,
                            bool resolve_left_conflicts,
                            bool resolve_right_conflicts):
   be_quiet(be_quiet),
-  be_verbose(be_verbose)
+  be_verbose(be_verbose),
+  jobs(1)
 {
   left_arrow_rule_container.set_report_left_arrow_conflicts(! be_quiet);
   left_arrow_rule_container.set_resolve_left_arrow_conflicts
@@ -35,6 +39,13 @@ TwolCGrammar::TwolCGrammar(bool be_quiet,
     (resolve_right_conflicts);
 }
 
+void TwolCGrammar::set_jobs(unsigned int jobs)
+{
+  this->jobs = (jobs == 0) ? std::thread::hardware_concurrency() : jobs;
+  if (this->jobs == 0)
+    { this->jobs = 1; }
+}
+
 void TwolCGrammar::define_diacritics(const SymbolRange &diacritics)
 {
   this->diacritics = diacritics;
@@ -178,18 +189,89 @@ void TwolCGrammar::compile_and_store(HfstOutputStream &out)
   if (! be_quiet)
     { std::cerr << "Compiling rules." << std::endl; }
 
-  left_arrow_rule_container.compile(std::cerr,(! be_quiet) && be_verbose);
-  right_arrow_rule_container.compile(std::cerr,(! be_quiet) && be_verbose);
-  other_rule_container.compile(std::cerr,(! be_quiet) && be_verbose);
+  // The workers get deep copies of their transducers, see
+  // HfstTransducer::deep_copy. Only the OpenFst formats are compiled on
+  // several threads.
+  ImplementationType type = OtherSymbolTransducer::get_transducer_type();
+  unsigned int threads =
+    (type == hfst::TROPICAL_OPENFST_TYPE || type == hfst::LOG_OPENFST_TYPE) ?
+    jobs : 1;
+  bool report = (! be_quiet) && be_verbose;
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  left_arrow_rule_container.compile(std::cerr,report,threads);
+  right_arrow_rule_container.compile(std::cerr,report,threads);
+  other_rule_container.compile(std::cerr,report,threads);
 
+  // Intersect the subcases of each rule. They are intersected in rounds of
+  // pairs, and the pairs of all rules in a round are intersected on the
+  // workers. The pairing only depends on the number of subcases, so the
+  // result is the same for any number of threads.
+  std::vector<std::string> names;
+  std::vector<OtherSymbolTransducerVector> subcases;
   for (StringRuleSetMap::const_iterator it = name_to_rule_subcases.begin();
        it != name_to_rule_subcases.end();
        ++it)
+    {
+      names.push_back(it->first);
+      subcases.push_back(OtherSymbolTransducerVector());
+      for (RuleSet::const_iterator jt = it->second.begin();
+       jt != it->second.end();
+       ++jt)
+    {
+      // a worker must not share data with the transducers of another
+      if (! (*jt)->empty())
+        { subcases.back().push_back
+        (threads > 1 ? (*jt)->get_rule_transducer().deep_copy() :
+         (*jt)->get_rule_transducer()); }
+    }
+    }
+  while (true)
+    {
+      std::vector<std::pair<size_t,size_t> > pairs;
+      for (size_t i = 0; i < subcases.size(); ++i)
+    {
+      size_t half = (subcases[i].size() + 1) / 2;
+      for (size_t j = 0; j + half < subcases[i].size(); ++j)
+        { pairs.push_back(std::pair<size_t,size_t>(i,j)); }
+    }
+      if (pairs.empty())
+    { break; }
+      RuleContainer::parallel_for(pairs.size(),threads,[&](size_t k)
+    {
+      OtherSymbolTransducerVector &v = subcases[pairs[k].first];
+      size_t half = (v.size() + 1) / 2;
+      v[pairs[k].second].apply
+        (&HfstTransducer::intersect,v[half + pairs[k].second]);
+    });
+      for (size_t i = 0; i < subcases.size(); ++i)
+    { subcases[i].resize((subcases[i].size() + 1) / 2); }
+    }
+
+  for (size_t i = 0; i < names.size(); ++i)
+    {
+      if (subcases[i].empty())
     { compiled_rule_container.add_rule
-    (new Rule(it->first,Rule::RuleVector(it->second.begin(),
-                         it->second.end()))); }
+        (new Rule(names[i],Rule::RuleVector())); }
+      else
+    {
+      OtherSymbolTransducer rule_transducer(TWOLC_UNKNOWN);
+      rule_transducer.apply(&HfstTransducer::repeat_star);
+      rule_transducer.apply(&HfstTransducer::intersect,subcases[i][0]);
+      compiled_rule_container.add_rule
+        (new Rule(names[i],rule_transducer));
+    }
+    }
   compiled_rule_container.add_missing_symbols_freely(diacritics);
 
+  if (report)
+    { std::cerr << "Compiled " << names.size() << " rules on " << threads
+        << (threads == 1 ? " thread" : " threads") << " in "
+        << std::chrono::duration<double>
+           (std::chrono::steady_clock::now() - start).count()
+        << " s." << std::endl; }
+
   if (! be_quiet)
     { std::cerr << "Storing rules." << std::endl; }
   compiled_rule_container.store(out,std::cerr,(! be_quiet) && be_verbose);
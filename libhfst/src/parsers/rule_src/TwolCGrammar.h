@@ -52,6 +52,7 @@ class TwolCGrammar
   typedef HandyMap<std::string,RuleSet> StringRuleSetMap;
   bool be_quiet;
   bool be_verbose;
+  unsigned int jobs;
   StringRuleSetMap name_to_rule_subcases;
 
   LeftArrowRuleContainer left_arrow_rule_container;
@@ -82,6 +83,14 @@ class TwolCGrammar
         const SymbolPairVector &center,
         op::OPERATOR oper,
         const OtherSymbolTransducerVector contexts);
+
+  //! @brief Compile rules and intersect their subcases on @a jobs threads,
+  //! 0 meaning one per core. Only OpenFst formats are compiled in
+  //! parallel: each worker gets deep copies of its transducers, made on
+  //! this thread, since OpenFst copies share data through reference counts
+  //! that are not thread-safe. The other formats always use one thread.
+  //! The result doesn't depend on the number of threads.
+  void set_jobs(unsigned int jobs);
   void compile_and_store(HfstOutputStream &out);
 };
 
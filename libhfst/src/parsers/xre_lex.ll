@@ -31,9 +31,9 @@ extern int xreerror(const char*);
 // when performing variable substitution in function definition.
 namespace hfst {
   namespace xre {
-    extern unsigned int cr; // number of characters read
-    extern std::set<unsigned int> positions; // positions of a given SYMBOL
-    extern char * position_symbol;  // the given SYMBOL
+    extern thread_local unsigned int cr; // number of characters read
+    extern thread_local std::set<unsigned int> positions; // positions of a given SYMBOL
+    extern thread_local char * position_symbol;  // the given SYMBOL
 } }
 
 // a macro that increments the number of characters read
@@ -214,11 +214,39 @@ BRACED      [{]([^}]|[\300-\337].|[\340-\357]..|[\360-\367]...)+[}]
 }
 
 "[.#.]" { hfst::xre::cr += 5; yylval->label = strdup(".#."); return SYMBOL; }
-"[.#." { hfst::xre::cr += 1; unput('.'); unput('#'); unput('.'); return LEFT_BRACKET; }
+"[.#." {
+    hfst::xre::cr += 1;
+    unput('.'); unput('#'); unput('.');
+    unsigned int length = 0;
+    HfstTransducer * cached
+      = hfst::xre::get_cached_brackets(&yylval->label, length);
+    if (cached != NULL) {
+      for (unsigned int i = 0; i < length; i++) {
+        yyinput(yyscanner);
+      }
+      yylval->transducer = cached;
+      return CACHED_BRACKETS;
+    }
+    return LEFT_BRACKET;
+}
 ".#.]" { hfst::xre::cr += 3; unput(']'); yylval->label = strdup(".#."); return SYMBOL; }
 "[." { CR; return LEFT_BRACKET_DOTTED; }
 ".]" { CR; return RIGHT_BRACKET_DOTTED; }
-"[" { CR; return LEFT_BRACKET; }
+"[" {
+    CR;
+    unsigned int length = 0;
+    HfstTransducer * cached
+      = hfst::xre::get_cached_brackets(&yylval->label, length);
+    if (cached != NULL) {
+      // skip the rest of the subexpression, it has been compiled before
+      for (unsigned int i = 0; i < length; i++) {
+        yyinput(yyscanner);
+      }
+      yylval->transducer = cached;
+      return CACHED_BRACKETS;
+    }
+    return LEFT_BRACKET;
+}
 "]" { CR; return RIGHT_BRACKET; }
 "(" { CR; return LEFT_PARENTHESIS; }
 ")" { CR; return RIGHT_PARENTHESIS; }
@@ -28,12 +28,12 @@ using namespace hfst::implementations;
 namespace hfst {
   namespace xre {
     // number of characters read, used for scanning function definition xre for argument symbols
-    extern unsigned int cr;
-    extern bool harmonize_;
-    extern bool harmonize_flags_;
-    extern bool allow_extra_text_at_end;
+    extern thread_local unsigned int cr;
+    extern thread_local bool harmonize_;
+    extern thread_local bool harmonize_flags_;
+    extern thread_local bool allow_extra_text_at_end;
 
-    bool has_weight_been_zeroed = false; // to control how many times a warning is given
+    thread_local bool has_weight_been_zeroed = false; // to control how many times a warning is given
     float zero_weights(float f)
     {
         if ((! has_weight_been_zeroed) && (f != 0))
@@ -111,7 +111,7 @@ int xrelex ( YYSTYPE * , yyscan_t );
 
 %type <transducer> XRE REGEXP1 REGEXP2  REGEXP4 REGEXP5 REGEXP6 REGEXP7
                     REGEXP8 REGEXP9 REGEXP10 REGEXP11 REGEXP12 LABEL
-                   REPLACE REGEXP3 SUB1  SUB3 SYMBOL_LIST
+                   REPLACE REGEXP3 SUB1  SUB3 SYMBOL_LIST BRACKETED
 %type <replaceRuleVectorWithArrow> PARALLEL_RULES
 %type <replaceRuleWithArrow>  RULE
 %type <mappingVectorWithArrow> MAPPINGPAIR_VECTOR
@@ -162,7 +162,11 @@ int xrelex ( YYSTYPE * , yyscan_t );
 
 %nonassoc <label> READ_BIN READ_TEXT READ_SPACED READ_PROLOG READ_RE
 %nonassoc <label> FUNCTION_NAME   // function call
-%token LEFT_BRACKET RIGHT_BRACKET LEFT_PARENTHESIS RIGHT_PARENTHESIS
+// the key of the bracketed subexpression in the subexpression cache, if any
+%token <label> LEFT_BRACKET
+// a bracketed subexpression found in the subexpression cache
+%token <transducer> CACHED_BRACKETS
+%token RIGHT_BRACKET LEFT_PARENTHESIS RIGHT_PARENTHESIS
        LEFT_BRACKET_DOTTED RIGHT_BRACKET_DOTTED SUBVAL
 %token EPSILON_TOKEN ANY_TOKEN BOUNDARY_MARKER
 %token LEXER_ERROR
@@ -332,7 +336,7 @@ REGEXP2: REPLACE
          }
         ;
 
-SUB1: SUBSTITUTE_LEFT LEFT_BRACKET REPLACE COMMA { $$ = $3; } ; // first argument
+SUB1: SUBSTITUTE_LEFT LEFT_BRACKET REPLACE COMMA { free($2); $$ = $3; } ; // first argument
 SUB2: HALFARC COMMA { $$ = $1; } ;  // symbol that needs to be replaced
 SUB3: SYMBOL_LIST RIGHT_BRACKET {  $$ = $1;  }  // symbol list
       |
@@ -949,50 +953,56 @@ REGEXP10: REGEXP11 { $$ = $1; }
        ;
 
 REGEXP11: REGEXP12 { $$ = $1; }
-        | LEFT_BRACKET REGEXP2 RIGHT_BRACKET {
-            $$ = & $2->optimize();
-        }
+        | BRACKETED { $$ = $1; }
         // [foo]:[bar]
-        | LEFT_BRACKET REGEXP2 RIGHT_BRACKET PAIR_SEPARATOR LEFT_BRACKET REGEXP2 RIGHT_BRACKET {
-            $$ = & $2->cross_product(*$6);
-            delete $6;
+        | BRACKETED PAIR_SEPARATOR BRACKETED {
+            $$ = & $1->cross_product(*$3);
+            delete $3;
         }
         // [foo]:{bar}
-        | LEFT_BRACKET REGEXP2 RIGHT_BRACKET PAIR_SEPARATOR CURLY_BRACKETS {
-     	    HfstTransducer * tmp = hfst::xre::xfst_curly_label_to_transducer($5,$5);
-            free($5);
-            $$ = & $2->cross_product(*tmp);
+        | BRACKETED PAIR_SEPARATOR CURLY_BRACKETS {
+     	    HfstTransducer * tmp = hfst::xre::xfst_curly_label_to_transducer($3,$3);
+            free($3);
+            $$ = & $1->cross_product(*tmp);
             delete tmp;
         }
         // {foo}:[bar]
-        | CURLY_BRACKETS PAIR_SEPARATOR LEFT_BRACKET REGEXP2 RIGHT_BRACKET {
+        | CURLY_BRACKETS PAIR_SEPARATOR BRACKETED {
      	    HfstTransducer * tmp = hfst::xre::xfst_curly_label_to_transducer($1,$1);
             free($1);
-            $$ = & $4->cross_product(*tmp);
+            $$ = & $3->cross_product(*tmp);
             delete tmp;
         }
         // [foo]:bar
-        | LEFT_BRACKET REGEXP2 RIGHT_BRACKET PAIR_SEPARATOR HALFARC {
-            HfstTransducer * tmp = hfst::xre::expand_definition($5);
-            free($5);
-            $$ = & $2->cross_product(*tmp);
+        | BRACKETED PAIR_SEPARATOR HALFARC {
+            HfstTransducer * tmp = hfst::xre::expand_definition($3);
+            free($3);
+            $$ = & $1->cross_product(*tmp);
             delete tmp;
         }
         // foo:[bar]
-        | HALFARC PAIR_SEPARATOR LEFT_BRACKET REGEXP2 RIGHT_BRACKET {
+        | HALFARC PAIR_SEPARATOR BRACKETED {
             $$ = hfst::xre::expand_definition($1);
             free($1);
-            $$ = & $$->cross_product(*$4);
-            delete $4;
+            $$ = & $$->cross_product(*$3);
+            delete $3;
         }
-        | LEFT_BRACKET REGEXP2 RIGHT_BRACKET WEIGHT {
-            $$ = & $2->set_final_weights(hfst::double_to_float($4), true).optimize();
+        | BRACKETED WEIGHT {
+            $$ = & $1->set_final_weights(hfst::double_to_float($2), true).optimize();
         }
         | LEFT_PARENTHESIS REGEXP2 RIGHT_PARENTHESIS {
             $$ = & $2->optionalize();
         }
         ;
 
+// [foo], taken from the subexpression cache if it has been compiled before
+BRACKETED: LEFT_BRACKET REGEXP2 RIGHT_BRACKET {
+            $$ = & $2->optimize();
+            hfst::xre::cache_brackets($1, $$);
+        }
+        | CACHED_BRACKETS { $$ = $1; }
+        ;
+
 // building 3rd argument in the substitute list
 SYMBOL_LIST: HALFARC {
             if (strcmp($1, hfst::internal_unknown.c_str()) == 0)
@@ -1233,7 +1243,9 @@ LABEL: HALFARC {
               // do not include the characters read when evaluating functions inside it
               unsigned int chars_read = hfst::xre::cr;
 
+              hfst::xre::begin_input(hfst::xre::get_function_xre($1));
               int parse_retval = xreparse(scanner);
+              hfst::xre::end_input();
 
               hfst::xre::cr = chars_read;
               hfst::xre::undefine_function_args($1);
@@ -38,12 +38,13 @@ extern char * xreget_text(yyscan_t);
 
 namespace hfst {
   namespace xre {
-    extern unsigned int cr; // number of characters read, defined in XreCompiler.cc
-    extern unsigned int lr; // number of lines read, defined in XreCompiler.cc
-    bool allow_extra_text_at_end = false;
-    extern std::ostream * error_;
-    extern bool verbose_;
-    extern std::set<std::string> * defined_multichar_symbols_;
+    extern thread_local unsigned int cr; // number of characters read, defined in XreCompiler.cc
+    extern thread_local unsigned int lr; // number of lines read, defined in XreCompiler.cc
+    thread_local bool allow_extra_text_at_end = false;
+    extern thread_local std::ostream * error_;
+    extern thread_local bool verbose_;
+    extern thread_local std::set<std::string> * defined_multichar_symbols_;
+    extern thread_local char * position_symbol;
   }
 }
 
@@ -102,23 +103,34 @@ namespace hfst
 namespace xre
 {
 
-  char* data;
-  std::map<std::string,hfst::HfstTransducer*> definitions;
-  std::map<std::string,std::string>  function_definitions;
-  std::map<std::string,unsigned int> function_arguments;
-  std::map<std::string,std::set<string> > symbol_lists;
-  char* startptr; // changed this to an internal variable in compile functions
-hfst::HfstTransducer* last_compiled;
-bool contains_only_comments = false;
-hfst::ImplementationType format;
-size_t len;
-
-  bool expand_definitions=false;
-  bool harmonize_=true;
-  bool harmonize_flags_=false;
+  thread_local char* data;
+  thread_local DefinitionMap * definitions = NULL;
+  thread_local std::map<std::string,std::string>  function_definitions;
+  thread_local std::map<std::string,unsigned int> function_arguments;
+  thread_local std::map<std::string,std::set<string> > symbol_lists;
+  thread_local char* startptr; // changed this to an internal variable in compile functions
+thread_local hfst::HfstTransducer* last_compiled;
+thread_local bool contains_only_comments = false;
+thread_local hfst::ImplementationType format;
+thread_local size_t len;
+
+  thread_local bool expand_definitions=false;
+  thread_local bool harmonize_=true;
+  thread_local bool harmonize_flags_=false;
   //bool verbose_=false;
 
-  std::string substitution_function_symbol;
+  thread_local std::string substitution_function_symbol;
+  thread_local SubexpressionCache * subexpression_cache = NULL;
+
+  // The texts being scanned, innermost last, and the values of cr
+  // at their beginning
+  struct ScannedInput
+  {
+    const char * text;
+    size_t length;
+    unsigned int start;
+  };
+  thread_local std::vector<ScannedInput> inputs;
 
 void set_substitution_function_symbol(const std::string &symbol)
 {
@@ -511,19 +523,277 @@ get_weight(const char *s)
     return rv;
 }
 
+void begin_input(const char * text)
+{
+  ScannedInput input = { text, strlen(text), cr };
+  inputs.push_back(input);
+}
+
+void end_input()
+{
+  inputs.pop_back();
+}
+
+/* Scan the regex @a text for as long as it is parsed. Inputs left over
+   by a function call that threw are dropped too. */
+class InputScope
+{
+  size_t outer_size;
+ public:
+  InputScope(const char * text):
+    outer_size(inputs.size())
+  { begin_input(text); }
+  ~InputScope()
+  { inputs.resize(outer_size); }
+};
+
+/* Whether @a c can be a part of a symbol name, c.f. NAME_CH in
+   xre_lex.ll. */
+static bool is_name_char(char c)
+{
+  if ((unsigned char)c >= 0x80)
+    return true;
+  if ((unsigned char)c <= 0x20 || c == 0x7f)
+    return false;
+  return strchr("- |<>%!,.^:\";@~\\&?$+*/_(){}[]", c) == NULL;
+}
+
+static bool is_file_reference(const char * s)
+{
+  const char * prefixes[] = { "@\"", "@bin\"", "@txt\"", "@stxt\"",
+                              "@pl\"", "@re\"" };
+  for (unsigned int i = 0; i < sizeof(prefixes)/sizeof(prefixes[0]); i++)
+    {
+      if (strncmp(s, prefixes[i], strlen(prefixes[i])) == 0)
+        return true;
+    }
+  return false;
+}
+
+/* Scan the bracketed subexpression whose '[' precedes @a s. Set @a length
+   to the number of characters up to and including the matching ']',
+   @a normalized to the subexpression with its whitespace normalized and
+   @a names to the symbols in it that may name a definition. Return false
+   if the subexpression does not end or its transducer may depend on more
+   than the definitions: function calls, merges, files, and comments and
+   dotted brackets to keep the scanning simple. */
+static bool scan_brackets(const char * s, unsigned int & length,
+                          std::string & normalized,
+                          std::vector<std::string> & names)
+{
+  unsigned int depth = 1;
+  std::string name;
+  const char * c = s;
+  while (*c != '\0')
+    {
+      if (*c == '%' || is_name_char(*c))
+        {
+          if (*c == '#' && name.empty())
+            return false; // a comment
+          if (*c == '%')
+            {
+              if (*(c + 1) == '\0')
+                return false;
+              normalized += *c;
+              c++;
+            }
+          name += *c;
+          normalized += *c;
+          c++;
+          continue;
+        }
+      if (! name.empty())
+        {
+          if (*c == '(')
+            return false; // a function call
+          names.push_back(name);
+          name.clear();
+        }
+
+      if (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n')
+        {
+          if (! normalized.empty() &&
+              normalized[normalized.size() - 1] != ' ' &&
+              normalized[normalized.size() - 1] != '[')
+            normalized += ' ';
+          c++;
+        }
+      else if (*c == '"')
+        {
+          const char * end = strchr(c + 1, '"');
+          if (end == NULL)
+            return false;
+          std::string quoted(c + 1, end);
+          if (quoted.find('\\') != std::string::npos)
+            return false;
+          if (! quoted.empty())
+            names.push_back(quoted);
+          normalized.append(c, end + 1);
+          c = end + 1;
+        }
+      else if (*c == '{')
+        {
+          const char * end = strchr(c + 1, '}');
+          if (end == NULL || end == c + 1)
+            return false;
+          normalized.append(c, end + 1);
+          c = end + 1;
+        }
+      else if (*c == '!' || (*c == '@' && is_file_reference(c)))
+        {
+          return false;
+        }
+      else if (*c == '[')
+        {
+          if (strncmp(c, "[.#.]", 5) == 0)
+            {
+              normalized.append(c, 5);
+              c += 5;
+              continue;
+            }
+          if (strncmp(c, "[]", 2) == 0)
+            {
+              normalized.append(c, 2);
+              c += 2;
+              continue;
+            }
+          if (*(c + 1) == '.' && strncmp(c, "[.#.", 4) != 0)
+            return false;
+          depth++;
+          normalized += *c;
+          c++;
+        }
+      else if (*c == '.')
+        {
+          if (strncmp(c, ".#.", 3) == 0)
+            {
+              normalized.append(c, 3);
+              c += 3;
+              continue;
+            }
+          if (*(c + 1) == ']' || strncmp(c, ".m>.", 4) == 0 ||
+              strncmp(c, ".<m.", 4) == 0)
+            return false;
+          normalized += *c;
+          c++;
+        }
+      else if (*c == ']')
+        {
+          if (! normalized.empty() && normalized[normalized.size() - 1] == ' ')
+            normalized.erase(normalized.size() - 1);
+          normalized += *c;
+          c++;
+          if (--depth == 0)
+            {
+              length = (unsigned int)(c - s);
+              return true;
+            }
+        }
+      else
+        {
+          normalized += *c;
+          c++;
+        }
+    }
+  return false;
+}
+
 HfstTransducer*
-compile(const string& xre, map<string,HfstTransducer*>& defs,
+get_cached_brackets(char ** key, unsigned int & length)
+{
+  *key = NULL;
+  length = 0;
+  // positions of symbols are searched for when defining functions
+  if (subexpression_cache == NULL || position_symbol != NULL ||
+      inputs.empty())
+    return NULL;
+
+  const ScannedInput & input = inputs.back();
+  size_t position = cr - input.start;
+  if (position == 0 || position > input.length ||
+      input.text[position - 1] != '[')
+    return NULL;
+  // the bracket of `[...] belongs to the substitute operator
+  for (size_t i = position - 1; i > 0; i--)
+    {
+      char c = input.text[i - 1];
+      if (c == '`')
+        return NULL;
+      if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+        break;
+    }
+
+  unsigned int scanned = 0;
+  std::string normalized;
+  std::vector<std::string> names;
+  if (! scan_brackets(input.text + position, scanned, normalized, names))
+    return NULL;
+  // the settings that the transducer depends on
+  normalized += expand_definitions ? '1' : '0';
+  normalized += harmonize_ ? '1' : '0';
+  normalized += harmonize_flags_ ? '1' : '0';
+  normalized += hfst::get_xerox_composition() ? '1' : '0';
+  normalized += hfst::get_flag_is_epsilon_in_composition() ? '1' : '0';
+  normalized += hfst::get_minimization() ? '1' : '0';
+  normalized += (char)('0' + (int)hfst::get_minimization_algorithm());
+  normalized += hfst::get_minimize_even_if_already_minimal() ? '1' : '0';
+  normalized += hfst::get_encode_weights() ? '1' : '0';
+  normalized += hfst::get_harmonize_smaller() ? '1' : '0';
+  normalized += hfst::get_unknown_symbols_in_use() ? '1' : '0';
+
+  std::shared_ptr<const HfstTransducer> cached
+    = subexpression_cache->get(normalized);
+  if (cached.get() == NULL)
+    {
+      *key = strdup(normalized.c_str());
+      return NULL;
+    }
+  count_lines(std::string(input.text + position, scanned).c_str());
+  length = scanned;
+  return new HfstTransducer(*cached);
+}
+
+void cache_brackets(char * key, const HfstTransducer * t)
+{
+  if (key == NULL)
+    return;
+  unsigned int length = 0;
+  std::string normalized;
+  std::vector<std::string> names;
+  if (subexpression_cache != NULL &&
+      scan_brackets(key, length, normalized, names))
+    {
+      subexpression_cache->add(key, names, *t);
+    }
+  free(key);
+}
+
+/* Make the definitions of a compiler the current ones for as long as
+   its regex is parsed. A regex may be compiled while parsing another,
+   e.g. by the merge operator. */
+class DefinitionScope
+{
+  DefinitionMap * outer_definitions;
+ public:
+  DefinitionScope(DefinitionMap & defs):
+    outer_definitions(definitions)
+  { definitions = &defs; }
+  ~DefinitionScope()
+  { definitions = outer_definitions; }
+};
+
+HfstTransducer*
+compile(const string& xre, DefinitionMap& defs,
         map<string, string>& func_defs,
         map<string, unsigned int > func_args,
         map<string, std::set<string> >& lists,
         ImplementationType impl)
 {
-    // lock here?
     data = strdup(xre.c_str());
     // use an internal variable startptr_ instead of global startptr
     char * startptr_ = data;
     len = strlen(data);
-    definitions = defs;
+    DefinitionScope scope(defs);
     function_definitions = func_defs;
     function_arguments = func_args;
     symbol_lists = lists;
@@ -534,6 +804,7 @@ compile(const string& xre, map<string,HfstTransducer*>& defs,
     yyscan_t scanner;
     xrelex_init(&scanner);
     YY_BUFFER_STATE bs = xre_scan_string(startptr_,scanner);
+    InputScope input_scope(startptr_);
     
     int parse_retval = xreparse(scanner);
 
@@ -545,9 +816,7 @@ compile(const string& xre, map<string,HfstTransducer*>& defs,
     len = 0;
     if (parse_retval == 0 && !contains_only_comments) // if (yynerrs == 0)
       {
-        HfstTransducer* rv = new HfstTransducer(*last_compiled);
-        delete last_compiled;
-        return rv;
+        return last_compiled;
       }
     else
       {
@@ -557,19 +826,18 @@ compile(const string& xre, map<string,HfstTransducer*>& defs,
 
   // todo: Contains lots of code copied directly from compile(...), should be rewritten..
 HfstTransducer*
-compile_first(const string& xre, map<string,HfstTransducer*>& defs,
+compile_first(const string& xre, DefinitionMap& defs,
               map<string, string>& func_defs,
               map<string, unsigned int > func_args,
               map<string, std::set<string> >& lists,
               ImplementationType impl,
               unsigned int & chars_read)
 {
-    // lock here?
     data = strdup(xre.c_str());
     // use an internal variable startptr_ instead of global startptr
     char * startptr_ = data;
     len = strlen(data);
-    definitions = defs;
+    DefinitionScope scope(defs);
     function_definitions = func_defs;
     function_arguments = func_args;
     symbol_lists = lists;
@@ -585,6 +853,7 @@ compile_first(const string& xre, map<string,HfstTransducer*>& defs,
     hfst::xre::allow_extra_text_at_end = true;
     hfst::xre::cr = 0;
     hfst::xre::lr = 1;
+    InputScope input_scope(startptr_);
 
     int parse_retval = xreparse(scanner);
     chars_read = hfst::xre::cr;
@@ -599,9 +868,7 @@ compile_first(const string& xre, map<string,HfstTransducer*>& defs,
     len = 0;
     if (parse_retval == 0 && !contains_only_comments) // if (yynerrs == 0)
       {
-        HfstTransducer* rv = new HfstTransducer(*last_compiled);
-        delete last_compiled;
-        return rv;
+        return last_compiled;
       }
     else
       {
@@ -667,7 +934,12 @@ bool define_function_args(const char * name, const std::vector<HfstTransducer> *
       ostringstream os;
       os << arg_number;
       std::string function_arg = "@" + std::string(name) + os.str() + "@";
-      definitions[function_arg] = new HfstTransducer(*it);
+      // the argument shares the implementation of *it until changed
+      HfstTransducer *& definition = (*definitions)[function_arg];
+      delete definition; // left over from a call that failed
+      definition = new HfstTransducer(*it);
+      if (subexpression_cache != NULL)
+        subexpression_cache->forget(function_arg);
       //fprintf(stderr, "defined function arg: '%s', %i:\n", name, arg_number); // DEBUG
       //std::cerr << *it << std::endl;
       arg_number++;
@@ -687,18 +959,21 @@ void undefine_function_args(const char * name)
       ostringstream os;
       os << arg_number;
       std::string function_arg = "@" + std::string(name) + os.str() + "@";
-      delete definitions[function_arg];
-      definitions.erase(function_arg);
+      DefinitionMap::iterator def = definitions->find(function_arg);
+      if (def != definitions->end())
+        {
+          delete def->second;
+          definitions->erase(def);
+        }
+      if (subexpression_cache != NULL)
+        subexpression_cache->forget(function_arg);
       //fprintf(stderr, "undefined function arg: '%s', %i:\n", name, arg_number); // DEBUG
     }
 }
 
 bool is_definition(const char* symbol)
 {
-  std::string symbol_(symbol);
-  if (definitions.find(symbol_) == definitions.end())
-    return false;
-  return true;
+  return definitions->find(symbol) != definitions->end();
 }
 
 HfstTransducer*
@@ -706,13 +981,11 @@ expand_definition(const char* symbol)
 {
   if (expand_definitions)
     {
-      for (std::map<std::string,hfst::HfstTransducer*>::const_iterator it
-             = definitions.begin(); it != definitions.end(); it++)
+      DefinitionMap::const_iterator it = definitions->find(symbol);
+      if (it != definitions->end())
         {
-          if (strcmp(it->first.c_str(), symbol) == 0)
-            {
-              return new HfstTransducer(*(it->second));
-            }
+          // shares the implementation of the definition until changed
+          return new HfstTransducer(*(it->second));
         }
     }
   return new HfstTransducer(symbol, symbol, hfst::xre::format);
@@ -724,19 +997,15 @@ expand_definition(HfstTransducer* tr, const char* symbol)
 {
   if (expand_definitions)
     {
-      for (std::map<std::string,hfst::HfstTransducer*>::const_iterator it
-             = definitions.begin(); it != definitions.end(); it++)
+      DefinitionMap::const_iterator it = definitions->find(symbol);
+      if (it != definitions->end())
         {
-          if (strcmp(it->first.c_str(), symbol) == 0)
-            {
-              StringSet alpha = it->second->get_alphabet();
-              tr->substitute(hfst::StringPair(symbol,symbol), *(it->second), false); // do not harmonize
-              if (alpha.find(symbol) == alpha.end())
-                tr->remove_from_alphabet(symbol);
-              //if (it->second->get_alphabet().find(symbol) != it->second->get_alphabet().end())
-              //  std::cerr << "WARN: symbol '" << std::string(symbol) << "' was removed" << std::endl;
-              break;
-            }
+          StringSet alpha = it->second->get_alphabet();
+          tr->substitute(hfst::StringPair(symbol,symbol), *(it->second), false); // do not harmonize
+          if (alpha.find(symbol) == alpha.end())
+            tr->remove_from_alphabet(symbol);
+          //if (it->second->get_alphabet().find(symbol) != it->second->get_alphabet().end())
+          //  std::cerr << "WARN: symbol '" << std::string(symbol) << "' was removed" << std::endl;
         }
     }
   return tr;
@@ -1039,7 +1308,8 @@ xfst_label_to_transducer(const char* input, const char* output)
   HfstTransducer * merge_first_to_second(HfstTransducer * tr1, HfstTransducer * tr2)
   {
     // Merge operation creates an XreCompiler that needs this information below. Otherwise, it will overwrite all this.
-    struct XreConstructorArguments args(hfst::xre::definitions, hfst::xre::function_definitions, hfst::xre::function_arguments, hfst::xre::symbol_lists, hfst::xre::format);
+    std::map<std::string,hfst::HfstTransducer*> defs(definitions->begin(), definitions->end());
+    struct XreConstructorArguments args(defs, hfst::xre::function_definitions, hfst::xre::function_arguments, hfst::xre::symbol_lists, hfst::xre::format);
 
     tr1->optimize();
     tr2->merge(*tr1, args);
@@ -19,19 +19,25 @@
 
 #include <map>
 #include "HfstDataTypes.h"
+#include "XreCompiler.h"
 
 namespace hfst { namespace xre {
 
-extern char* data;
-extern char* startptr;
-extern size_t len;
-extern std::map<std::string,hfst::HfstTransducer*> definitions;
-extern std::map<std::string,std::string> function_definitions;
-extern std::map<std::string,unsigned int> function_arguments;
-extern std::map<std::string, std::set<std::string> > symbol_lists;
-extern HfstTransducer* last_compiled;
-extern bool contains_only_comments;
-extern ImplementationType format;
+// The state of the regex being parsed is kept separately for each thread,
+// so that different compilers can be used in parallel.
+extern thread_local char* data;
+extern thread_local char* startptr;
+extern thread_local size_t len;
+// the definitions of the compiler whose regex is being parsed
+extern thread_local DefinitionMap * definitions;
+extern thread_local std::map<std::string,std::string> function_definitions;
+extern thread_local std::map<std::string,unsigned int> function_arguments;
+extern thread_local std::map<std::string, std::set<std::string> > symbol_lists;
+extern thread_local HfstTransducer* last_compiled;
+extern thread_local bool contains_only_comments;
+extern thread_local ImplementationType format;
+// the subexpression cache of the compiler, NULL if it has none
+extern thread_local SubexpressionCache * subexpression_cache;
 
 void set_substitution_function_symbol(const std::string &symbol);
 
@@ -88,7 +94,7 @@ HfstTransducer* unescape_enclosing_angle_brackets(HfstTransducer *t);
  * @brief compile new transducer
  */
 HfstTransducer* compile(const std::string& xre,
-                        std::map<std::string,hfst::HfstTransducer*>& defs,
+                        DefinitionMap& defs,
                         std::map<std::string,std::string>& func_defs,
                         std::map<std::string,unsigned int> func_args,
                         std::map<std::string, std::set<std::string> >& lists,
@@ -98,13 +104,35 @@ HfstTransducer* compile(const std::string& xre,
  * @brief compile new transducer defined by the first regex in @a xre.
  */
 HfstTransducer* compile_first(const std::string& xre,
-                              std::map<std::string,hfst::HfstTransducer*>& defs,
+                              DefinitionMap& defs,
                               std::map<std::string,std::string>& func_defs,
                               std::map<std::string,unsigned int> func_args,
                               std::map<std::string, std::set<std::string> >& lists,
                               hfst::ImplementationType type,
                               unsigned int & chars_read);
 
+/**
+ * @brief Make @a text the input being scanned until end_input is called.
+ * The characters of @a text are counted from the current value of cr.
+ */
+void begin_input(const char * text);
+void end_input();
+
+/**
+ * @brief Look up the bracketed subexpression whose '[' was read last in the
+ * subexpression cache. If found, count the @a length characters after the
+ * '[' that it takes as read and return a copy of its transducer. Else
+ * return NULL and set @a key to the key of the subexpression for
+ * cache_brackets, or to NULL if it cannot be cached.
+ */
+HfstTransducer* get_cached_brackets(char ** key, unsigned int & length);
+
+/**
+ * @brief Store @a t, compiled from the bracketed subexpression whose key
+ * is @a key, in the subexpression cache and free @a key.
+ */
+void cache_brackets(char * key, const HfstTransducer * t);
+
 /**
  * @brief For a single-transition transducer, if the transition symbol is a name for
  * transducer definition, expand the transition into the corresponding transducer.
@@ -211,6 +211,7 @@ libhfst_source_files = ["libhfst/src/parsers/XfstCompiler" + cpp,
                         "libhfst/src/string-utils" + cpp,
                         "libhfst/src/implementations/HfstBasicTransducer" + cpp,
                         "libhfst/src/implementations/HfstBasicTransition" + cpp,
+                        "libhfst/src/implementations/HfstFrozenTransducer" + cpp,
                         "libhfst/src/implementations/ConvertTransducerFormat" + cpp,
                         "libhfst/src/implementations/HfstTropicalTransducerTransitionData" + cpp,
                         "libhfst/src/implementations/ConvertTropicalWeightTransducer" + cpp,
@@ -227,11 +228,13 @@ libhfst_source_files = ["libhfst/src/parsers/XfstCompiler" + cpp,
                         "libhfst/src/implementations/compose_intersect/ComposeIntersectFst" + cpp,
                         "libhfst/src/implementations/compose_intersect/ComposeIntersectUtilities" + cpp,
                         "libhfst/src/implementations/optimized-lookup/transducer" + cpp,
+                        "libhfst/src/implementations/optimized-lookup/letter-trie" + cpp,
                         "libhfst/src/implementations/optimized-lookup/convert" + cpp,
                         "libhfst/src/implementations/optimized-lookup/ospell" + cpp,
                         "libhfst/src/implementations/optimized-lookup/pmatch" + cpp,
                         "libhfst/src/implementations/optimized-lookup/pmatch_tokenize" + cpp,
                         "libhfst/src/implementations/optimized-lookup/find_epsilon_loops" + cpp,
+                        "libhfst/src/implementations/optimized-lookup/cascade" + cpp,
                         "libhfst/src/parsers/xre_lex" + cpp,
                         "libhfst/src/parsers/xre_parse" + cpp,
                         "libhfst/src/parsers/pmatch_parse" + cpp,
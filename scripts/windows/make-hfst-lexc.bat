@@ -62,10 +62,12 @@ implementations\compose_intersect\ComposeIntersectRule.cpp ^
 implementations\compose_intersect\ComposeIntersectFst.cpp ^
 implementations\compose_intersect\ComposeIntersectUtilities.cpp ^
 implementations\optimized-lookup\transducer.cpp ^
+implementations\optimized-lookup\letter-trie.cpp ^
 implementations\optimized-lookup\convert.cpp ^
 implementations\optimized-lookup\ospell.cpp ^
 implementations\optimized-lookup\pmatch.cpp ^
 implementations\optimized-lookup\find_epsilon_loops.cpp ^
+implementations\optimized-lookup\cascade.cpp ^
 parsers\xre_lex.cpp ^
 parsers\xre_parse.cpp ^
 parsers\pmatch_parse.cpp ^
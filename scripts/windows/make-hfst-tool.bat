@@ -47,6 +47,7 @@ hfst-string-conversions.cpp ^
 string-utils.cpp ^
 implementations\HfstBasicTransducer.cpp ^
 implementations\HfstBasicTransition.cpp ^
+implementations\HfstFrozenTransducer.cpp ^
 implementations\HfstTropicalTransducerTransitionData.cpp ^
 implementations\ConvertTransducerFormat.cpp ^
 implementations\ConvertTropicalWeightTransducer.cpp ^
@@ -63,10 +64,12 @@ implementations\compose_intersect\ComposeIntersectRule.cpp ^
 implementations\compose_intersect\ComposeIntersectFst.cpp ^
 implementations\compose_intersect\ComposeIntersectUtilities.cpp ^
 implementations\optimized-lookup\transducer.cpp ^
+implementations\optimized-lookup\letter-trie.cpp ^
 implementations\optimized-lookup\convert.cpp ^
 implementations\optimized-lookup\ospell.cpp ^
 implementations\optimized-lookup\pmatch.cpp ^
 implementations\optimized-lookup\find_epsilon_loops.cpp ^
+implementations\optimized-lookup\cascade.cpp ^
 parsers\xre_lex.cpp ^
 parsers\xre_parse.cpp ^
 parsers\pmatch_parse.cpp ^
@@ -16,7 +16,9 @@ compose_intersect\ComposeIntersectRule.cpp ^
 compose_intersect\ComposeIntersectFst.cpp ^
 compose_intersect\ComposeIntersectUtilities.cpp ^
 optimized-lookup\transducer.cpp ^
+optimized-lookup\letter-trie.cpp ^
 optimized-lookup\convert.cpp ^
 optimized-lookup\ospell.cpp ^
 optimized-lookup\pmatch.cpp ^
-optimized-lookup\find_epsilon_loops.cpp
+optimized-lookup\find_epsilon_loops.cpp ^
+optimized-lookup\cascade.cpp
@@ -0,0 +1,101 @@
+/*
+   Test file for harmonizing transducers.
+   Tropical OpenFst transducers are harmonized natively, without
+   converting them to HfstBasicTransducer. The result must accept the
+   same language as harmonizing HfstBasicTransducers, and
+   get_harmonization_counts must tell what had to be done.
+*/
+
+#include "HfstTransducer.h"
+#include "auxiliary_functions.cc"
+
+using namespace hfst;
+
+using implementations::HfstState;
+using implementations::HfstBasicTransition;
+using implementations::HfstBasicTransducer;
+
+/* a:b, ?:? and ?:c, so the identity and the unknown arcs have to be
+   expanded with the symbols of the other transducer. */
+HfstBasicTransducer with_unknowns()
+{
+  HfstBasicTransducer t;
+  HfstState s = t.add_state();
+  t.add_transition(0, HfstBasicTransition(s, "a", "b", 0.5));
+  t.add_transition(0, HfstBasicTransition
+                   (s, "@_IDENTITY_SYMBOL_@", "@_IDENTITY_SYMBOL_@", 1));
+  t.add_transition(0, HfstBasicTransition
+                   (s, "@_UNKNOWN_SYMBOL_@", "c", 2));
+  t.set_final_weight(s, 0);
+  return t;
+}
+
+/* a:a and d:d, nothing to expand. */
+HfstBasicTransducer without_unknowns()
+{
+  HfstBasicTransducer t;
+  HfstState s = t.add_state();
+  t.add_transition(0, HfstBasicTransition(s, "a", "a", 0));
+  t.add_transition(0, HfstBasicTransition(s, "d", "d", 0.3));
+  t.set_final_weight(s, 0);
+  return t;
+}
+
+int main(int argc, char **argv)
+{
+  if (! HfstTransducer::is_implementation_type_available
+      (TROPICAL_OPENFST_TYPE))
+    { return 0; }
+
+  verbose_print("Native harmonization", TROPICAL_OPENFST_TYPE);
+
+  HfstBasicTransducer basic1 = with_unknowns();
+  HfstBasicTransducer basic2 = without_unknowns();
+  basic1.harmonize(basic2);
+  HfstTransducer expected1(basic1, TROPICAL_OPENFST_TYPE);
+  HfstTransducer expected2(basic2, TROPICAL_OPENFST_TYPE);
+
+  HfstTransducer native1(with_unknowns(), TROPICAL_OPENFST_TYPE);
+  HfstTransducer native2(without_unknowns(), TROPICAL_OPENFST_TYPE);
+  reset_harmonization_counts();
+  native1.harmonize(native2);
+  HarmonizationCounts counts = get_harmonization_counts();
+  assert(counts.expanded == 1);
+  assert(counts.unchanged == 0 && counts.recoded == 0 &&
+         counts.converted == 0);
+
+  assert(native1.get_alphabet() == expected1.get_alphabet());
+  assert(native2.get_alphabet() == expected2.get_alphabet());
+  assert(native1.compare(expected1));
+  assert(native2.compare(expected2));
+
+  // transducers that are already harmonized are left as they are
+  HfstTransducer again1(native1);
+  HfstTransducer again2(native2);
+  reset_harmonization_counts();
+  again1.harmonize(again2);
+  counts = get_harmonization_counts();
+  assert(counts.unchanged == 1);
+  assert(counts.recoded == 0 && counts.expanded == 0 &&
+         counts.converted == 0);
+  assert(again1.compare(native1));
+  assert(again2.compare(native2));
+
+  // other types go through HfstBasicTransducer
+  if (HfstTransducer::is_implementation_type_available(SFST_TYPE))
+    {
+      verbose_print("Harmonization through HfstBasicTransducer", SFST_TYPE);
+      HfstTransducer sfst1(with_unknowns(), SFST_TYPE);
+      HfstTransducer sfst2(without_unknowns(), SFST_TYPE);
+      reset_harmonization_counts();
+      sfst1.harmonize(sfst2);
+      counts = get_harmonization_counts();
+      assert(counts.converted == 1);
+      assert(counts.unchanged == 0 && counts.recoded == 0 &&
+             counts.expanded == 0);
+      assert(sfst1.compare(HfstTransducer(basic1, SFST_TYPE)));
+      assert(sfst2.compare(HfstTransducer(basic2, SFST_TYPE)));
+    }
+
+  return 0;
+}
@@ -0,0 +1,154 @@
+/*
+   Test file for spelling correction with hfst_ol::Speller.
+   Corrections are searched for best first and the search is cut short
+   by the nbest, max_weight and beam limits. The corrections must come
+   out lightest first and be the same as the ones found without limits,
+   minus the ones that the limits leave out.
+*/
+
+#include "HfstTransducer.h"
+#include "implementations/ConvertTransducerFormat.h"
+#include "implementations/optimized-lookup/transducer.h"
+#include "auxiliary_functions.cc"
+
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <vector>
+
+using namespace hfst;
+
+using implementations::HfstState;
+using implementations::HfstBasicTransition;
+using implementations::HfstBasicTransducer;
+using implementations::ConversionFunctions;
+
+typedef std::vector<hfst_ol::StringWeightPair> Corrections;
+
+const char * letters [] = { "a", "b", "c", "o", "t", "u" };
+const unsigned int LETTERS = 6;
+
+void add_word(HfstBasicTransducer & t, const char * word, float weight)
+{
+  HfstState s = 0;
+  for (const char * c = word; *c != '\0'; ++c)
+    {
+      HfstState target = t.add_state();
+      std::string symbol(1, *c);
+      t.add_transition(s, HfstBasicTransition(target, symbol, symbol, 0));
+      s = target;
+    }
+  t.set_final_weight(s, weight);
+}
+
+/* Every letter may be changed to any other one at a weight of 1. */
+HfstBasicTransducer error_model()
+{
+  HfstBasicTransducer t;
+  for (unsigned int i = 0; i < LETTERS; i++)
+    {
+      for (unsigned int j = 0; j < LETTERS; j++)
+        {
+          t.add_transition(0, HfstBasicTransition
+                           (0, letters[i], letters[j], i == j ? 0 : 1));
+        }
+    }
+  t.set_final_weight(0, 0);
+  return t;
+}
+
+HfstBasicTransducer lexicon()
+{
+  HfstBasicTransducer t;
+  add_word(t, "cat", 0);
+  add_word(t, "bat", 0.2f);
+  add_word(t, "cot", 0.3f);
+  add_word(t, "cut", 0.6f);
+  add_word(t, "tab", 0.1f);
+  add_word(t, "bot", 0.9f);
+  return t;
+}
+
+/* Pop all of \a queue, checking that the weights never go down. */
+Corrections in_order(hfst_ol::CorrectionQueue queue)
+{
+  Corrections corrections;
+  while (queue.size() > 0)
+    {
+      if (corrections.size() > 0)
+        { assert(corrections.back().second <= queue.top().second); }
+      corrections.push_back(queue.top());
+      queue.pop();
+    }
+  return corrections;
+}
+
+/* Whether \a limited is what is left of \a all after taking the \a n
+   lightest ones no heavier than \a max_weight and no more than \a beam
+   heavier than the lightest one. */
+bool matches(const Corrections & limited, const Corrections & all,
+             unsigned int n, float max_weight, float beam)
+{
+  Corrections expected;
+  for (Corrections::const_iterator it = all.begin(); it != all.end(); ++it)
+    {
+      if (n > 0 && expected.size() == n)
+        { break; }
+      if (max_weight >= 0 && it->second > max_weight)
+        { break; }
+      if (beam >= 0 && it->second > all.front().second + beam)
+        { break; }
+      expected.push_back(*it);
+    }
+  if (limited.size() != expected.size())
+    { return false; }
+  for (unsigned int i = 0; i < limited.size(); i++)
+    {
+      if (limited[i].first != expected[i].first ||
+          std::fabs(limited[i].second - expected[i].second) > 0.0001)
+        { return false; }
+    }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  if (! HfstTransducer::is_implementation_type_available
+      (TROPICAL_OPENFST_TYPE))
+    { return 0; }
+
+  verbose_print("Spelling correction with limits", HFST_OLW_TYPE);
+
+  HfstTransducer errmodel(error_model(), TROPICAL_OPENFST_TYPE);
+  HfstTransducer words(lexicon(), TROPICAL_OPENFST_TYPE);
+  hfst_ol::Speller speller
+    (ConversionFunctions::hfst_transducer_to_hfst_ol(&errmodel),
+     ConversionFunctions::hfst_transducer_to_hfst_ol(&words));
+
+  char input[] = "cat";
+  Corrections all = in_order(speller.correct(input));
+  assert(all.size() == 6);
+  assert(all.front().first == "cat" && all.front().second == 0);
+  assert(all.back().first == "bot");
+
+  // cat 0, bat 1.2, cot 1.3, cut 1.6, tab 2.1, bot 2.9
+  const unsigned int CASES = 7;
+  const int nbests []        = {  1,    3,    0,    0,    0,    2,  6 };
+  const float max_weights [] = { -1,   -1,  1.5,    0,   -1,  1.5, -1 };
+  const float beams []       = { -1,   -1,   -1,   -1, 1.25,   -1, -1 };
+  for (unsigned int i = 0; i < CASES; i++)
+    {
+      Corrections limited = in_order
+        (speller.correct(input, nbests[i], max_weights[i], beams[i]));
+      assert(limited.size() > 0);
+      assert(matches(limited, all, nbests[i], max_weights[i], beams[i]));
+    }
+
+  // a word that is in the lexicon needs no changes
+  char correct_word[] = "tab";
+  assert(speller.check(correct_word));
+  Corrections best = in_order(speller.correct(correct_word, 1));
+  assert(best.size() == 1 && best.front().first == "tab");
+
+  return 0;
+}
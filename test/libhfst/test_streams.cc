@@ -105,6 +105,47 @@ int main(int argc, char **argv)
       assert(transducers[2].compare(tr3));
       assert(transducers[3].compare(tr4));
 
+      /* Indexed streams. */
+      verbose_print("Writing an indexed HfstOutputStream", types[i]);
+
+      tr1.set_name("first");
+      tr2.set_name("second");
+      tr3.set_name("third");
+      tr4.set_name("fourth");
+      HfstOutputStream indexed_out("indexed.hfst", types[i]);
+      indexed_out.set_write_index(true);
+      indexed_out << tr1 << tr2 << tr3 << tr4;
+      indexed_out.close();
+
+      verbose_print("Random access to an indexed HfstInputStream", types[i]);
+
+      HfstInputStream indexed_in("indexed.hfst");
+      assert(indexed_in.has_index());
+      StringVector names = indexed_in.get_index_names();
+      assert(names.size() == 4);
+      assert(names[0] == "first" && names[3] == "fourth");
+      assert(indexed_in.seek_transducer("third"));
+      HfstTransducer third(indexed_in);
+      assert(third.compare(tr3));
+      assert(third.get_name() == "third");
+      assert(indexed_in.seek_transducer("first"));
+      HfstTransducer first(indexed_in);
+      assert(first.compare(tr1));
+      assert(! indexed_in.seek_transducer("fifth"));
+      indexed_in.close();
+
+      /* The index is skipped when reading sequentially. */
+      HfstInputStream sequential_in("indexed.hfst");
+      transducers_read=0;
+      while (not sequential_in.is_eof())
+        {
+          HfstTransducer tr(sequential_in);
+          transducers_read++;
+        }
+      sequential_in.close();
+      assert(transducers_read == 4);
+      remove("indexed.hfst");
+
     }
 
 }
@@ -0,0 +1,130 @@
+/*
+   Test file for the symbol table shared by all HfstBasicTransducers.
+   Several threads compile transducers from AT&T text at the same
+   time, all of them introducing new symbols and sharing some, and
+   check that every symbol keeps its number and string.
+*/
+
+#include "HfstTransducer.h"
+#include "auxiliary_functions.cc"
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace hfst;
+
+using implementations::HfstState;
+using implementations::HfstBasicTransition;
+using implementations::HfstBasicTransducer;
+
+const unsigned int THREADS = 8;
+const unsigned int ROUNDS = 50;
+const unsigned int SYMBOLS = 200;
+
+std::string shared_symbol(unsigned int k)
+{
+  std::ostringstream oss;
+  oss << "shared" << k;
+  return oss.str();
+}
+
+std::string own_symbol(unsigned int thread, unsigned int round, unsigned int k)
+{
+  std::ostringstream oss;
+  oss << "t" << thread << "r" << round << "s" << k;
+  return oss.str();
+}
+
+/* Compile a chain transducer from AT&T text, substitute some of its
+   symbols and check the result. The number that each shared symbol got
+   is stored in shared_numbers. */
+void compile_transducers(unsigned int thread,
+                         std::vector<unsigned int> * shared_numbers,
+                         bool * ok)
+{
+  *ok = true;
+  for (unsigned int round = 0; round < ROUNDS; round++)
+    {
+      std::ostringstream att;
+      for (unsigned int k = 0; k < SYMBOLS; k++)
+        {
+          att << k << "\t" << k+1 << "\t" << shared_symbol(k) << "\t"
+              << own_symbol(thread, round, k) << "\t0.5\n";
+        }
+      att << SYMBOLS << "\t0\n";
+
+      FILE * file = tmpfile();
+      fputs(att.str().c_str(), file);
+      rewind(file);
+      unsigned int linecount = 0;
+      HfstBasicTransducer fsm
+        = HfstBasicTransducer::read_in_att_format(file, "@0@", linecount);
+      fclose(file);
+
+      HfstSymbolSubstitutions substitutions;
+      for (unsigned int k = 0; k < SYMBOLS; k += 2)
+        {
+          substitutions[own_symbol(thread, round, k)]
+            = own_symbol(thread, round + ROUNDS, k);
+        }
+      fsm.substitute_symbols(substitutions);
+
+      for (unsigned int k = 0; k < SYMBOLS; k++)
+        {
+          const HfstBasicTransition & tr = fsm.transitions(k)[0];
+          std::string expected_output = (k % 2 == 0) ?
+            own_symbol(thread, round + ROUNDS, k) :
+            own_symbol(thread, round, k);
+          if (tr.get_input_symbol() != shared_symbol(k) ||
+              tr.get_output_symbol() != expected_output)
+            *ok = false;
+          if (round == 0)
+            shared_numbers->push_back(tr.get_input_number());
+          else if (shared_numbers->at(k) != tr.get_input_number())
+            *ok = false;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+  verbose_print("Concurrent symbol interning");
+
+  std::vector<std::vector<unsigned int> > shared_numbers(THREADS);
+  bool ok[THREADS];
+  std::vector<std::thread> workers;
+  for (unsigned int i = 0; i < THREADS; i++)
+    {
+      workers.push_back(std::thread(compile_transducers, i,
+                                    &shared_numbers[i], &ok[i]));
+    }
+  for (unsigned int i = 0; i < THREADS; i++)
+    {
+      workers[i].join();
+    }
+
+  for (unsigned int i = 0; i < THREADS; i++)
+    {
+      assert(ok[i]);
+      assert(shared_numbers[i] == shared_numbers[0]);
+    }
+
+  /* Every shared symbol has a number of its own. */
+  std::set<unsigned int> distinct(shared_numbers[0].begin(),
+                                  shared_numbers[0].end());
+  assert(distinct.size() == SYMBOLS);
+
+  /* The numbers are the same when the symbols are used again
+     from the main thread. */
+  HfstBasicTransducer fsm;
+  for (unsigned int k = 0; k < SYMBOLS; k++)
+    {
+      fsm.add_transition(0, HfstBasicTransition(0, shared_symbol(k),
+                                                shared_symbol(k), 0));
+      assert(fsm.transitions(0)[k].get_input_number()
+             == shared_numbers[0][k]);
+    }
+
+  return 0;
+}
@@ -0,0 +1,48 @@
+/*
+   Test file for the error stream of XfstCompiler.
+   A syntax error in a regular expression is reported by the regex
+   compiler of XfstCompiler, so it must end up in the stream given
+   to XfstCompiler::set_error_stream and not in std::cerr.
+*/
+
+#include "HfstTransducer.h"
+#include "parsers/XfstCompiler.h"
+#include "auxiliary_functions.cc"
+
+#include <sstream>
+
+using namespace hfst;
+using hfst::xfst::XfstCompiler;
+
+void test_type(ImplementationType type)
+{
+  verbose_print("Regex syntax error in xfst error stream", type);
+
+  std::ostringstream out;
+  std::ostringstream err;
+  {
+    XfstCompiler compiler(type);
+    compiler.setVerbosity(true);
+    compiler.set_output_stream(out);
+    compiler.set_error_stream(err);
+    compiler.parse_line(std::string("regex [a b ;\n"));
+  }
+
+  assert(err.str().find("xre parsing failed") != std::string::npos);
+  assert(out.str().find("xre parsing failed") == std::string::npos);
+}
+
+int main(int argc, char **argv)
+{
+  const unsigned int TYPES=3;
+  const ImplementationType types [] = {SFST_TYPE,
+                                       TROPICAL_OPENFST_TYPE,
+                                       FOMA_TYPE};
+  for (unsigned int i=0; i < TYPES; i++)
+    {
+      if (! HfstTransducer::is_implementation_type_available(types[i]))
+        continue;
+      test_type(types[i]);
+    }
+  return 0;
+}
@@ -0,0 +1,138 @@
+/*
+   Test file for compiling regular expressions in parallel.
+   Several threads compile the same regular expressions at the same
+   time, each with an XreCompiler of its own, and the results are
+   checked against the ones compiled in one thread. Half of the
+   compilers expand their definitions and half do not, so that the
+   settings of one compiler cannot leak into another.
+
+   Only OpenFst transducers are used, since the SFST and foma
+   back-ends keep state of their own in global variables.
+*/
+
+#include "HfstTransducer.h"
+#include "parsers/XreCompiler.h"
+#include "auxiliary_functions.cc"
+
+#include <thread>
+#include <vector>
+
+using namespace hfst;
+using hfst::xre::XreCompiler;
+
+const unsigned int THREADS = 8;
+const unsigned int ROUNDS = 20;
+
+const char * regexes[] = {
+  "a b c ;",
+  "[a|b|c]* d ;",
+  "Vowel+ ;",
+  "[Vowel:x Vowel]* ;",
+  "a -> b || c _ d ;",
+  "[a|e] @-> x ... y ;",
+  "~[?* Vowel Vowel ?*] ;",
+  "Double(Vowel) ;",
+  "[cat .x. dog] .o. [dog -> mouse] ;",
+  "a:b::0.5 | c:d::1.5 ;",
+  "{cat} | {dog} .P. c a t ;",
+  "$[Vowel Vowel] & [a|e|i]^{2,4} ;"
+};
+const unsigned int REGEXES = sizeof(regexes) / sizeof(regexes[0]);
+
+void set_up(XreCompiler & compiler, bool expand)
+{
+  compiler.set_expand_definitions(expand);
+  compiler.set_verbosity(false);
+  compiler.define("Vowel", "[a|e|i|o|u] ;");
+  compiler.define_function("Double(", 1, "[\"@Double(1@\" \"@Double(1@\"]");
+}
+
+/* Compile every regex ROUNDS times and store the last results. */
+void compile_regexes(ImplementationType type, bool expand,
+                     std::vector<HfstTransducer*> * results, bool * ok)
+{
+  *ok = true;
+  XreCompiler compiler(type);
+  set_up(compiler, expand);
+  results->assign(REGEXES, NULL);
+  for (unsigned int round = 0; round < ROUNDS; round++)
+    {
+      for (unsigned int i = 0; i < REGEXES; i++)
+        {
+          HfstTransducer * compiled = compiler.compile(regexes[i]);
+          if (compiled == NULL)
+            {
+              *ok = false;
+              continue;
+            }
+          delete (*results)[i];
+          (*results)[i] = compiled;
+        }
+    }
+}
+
+void test_type(ImplementationType type)
+{
+  verbose_print("Parallel regex compilation", type);
+
+  std::vector<HfstTransducer*> expected[2];
+  for (unsigned int expand = 0; expand < 2; expand++)
+    {
+      XreCompiler compiler(type);
+      set_up(compiler, expand == 1);
+      for (unsigned int i = 0; i < REGEXES; i++)
+        {
+          HfstTransducer * compiled = compiler.compile(regexes[i]);
+          assert(compiled != NULL);
+          expected[expand].push_back(compiled);
+        }
+    }
+
+  std::vector<std::vector<HfstTransducer*> > results(THREADS);
+  bool ok[THREADS];
+  std::vector<std::thread> workers;
+  for (unsigned int t = 0; t < THREADS; t++)
+    {
+      workers.push_back(std::thread(compile_regexes, type, t % 2 == 1,
+                                    &results[t], &ok[t]));
+    }
+  for (unsigned int t = 0; t < THREADS; t++)
+    {
+      workers[t].join();
+    }
+
+  for (unsigned int t = 0; t < THREADS; t++)
+    {
+      assert(ok[t]);
+      for (unsigned int i = 0; i < REGEXES; i++)
+        {
+          assert(results[t][i]->compare(*expected[t % 2][i], false));
+          delete results[t][i];
+        }
+    }
+
+  /* Names are left as they are unless definitions are expanded. */
+  assert(! expected[0][2]->compare(*expected[1][2], false));
+
+  for (unsigned int expand = 0; expand < 2; expand++)
+    {
+      for (unsigned int i = 0; i < REGEXES; i++)
+        {
+          delete expected[expand][i];
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+  const unsigned int TYPES=2;
+  const ImplementationType types [] = {TROPICAL_OPENFST_TYPE,
+                                       LOG_OPENFST_TYPE};
+  for (unsigned int i=0; i < TYPES; i++)
+    {
+      if (! HfstTransducer::is_implementation_type_available(types[i]))
+        continue;
+      test_type(types[i]);
+    }
+  return 0;
+}
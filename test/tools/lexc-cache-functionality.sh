@@ -0,0 +1,66 @@
+#!/bin/sh
+TOOLDIR=../../tools/src
+TOOL=$TOOLDIR/hfst-lexc
+COMPARE_TOOL=$TOOLDIR/hfst-compare
+
+for tool in $TOOL $COMPARE_TOOL;
+do
+    if ! test -x $tool ; then
+        echo "missing hfst-lexc, assuming configured off, skipping"
+        exit 77
+    fi
+done
+
+CACHE=lexc-cache.tmp
+rm -rf $CACHE
+mkdir $CACHE
+
+printf 'LEXICON Root\nNouns ;\n\nLEXICON Nouns\ncat # ;\ndog # ;\n' > cache.lexc
+
+# the first compilation builds both lexicons
+if ! $TOOL -v --cache=$CACHE cache.lexc -o test.cached 2> cache.report ; then
+    echo "hfst-lexc --cache failed"
+    exit 1
+fi
+if ! grep -q "Rebuilt 2 of 2 lexicons" cache.report ; then
+    echo "lexicons were not built on the first compilation"
+    exit 1
+fi
+$TOOL cache.lexc -o test.uncached 2> /dev/null
+if ! $COMPARE_TOOL -s test.cached test.uncached ; then
+    echo "results with and without the cache differ"
+    exit 1
+fi
+
+# nothing has changed, so both lexicons come from the cache
+if ! $TOOL -v --cache=$CACHE cache.lexc -o test.cached 2> cache.report ; then
+    echo "hfst-lexc --cache failed"
+    exit 1
+fi
+if ! grep -q "Rebuilt 0 of 2 lexicons" cache.report ; then
+    echo "unchanged lexicons were not read from the cache"
+    exit 1
+fi
+if ! $COMPARE_TOOL -s test.cached test.uncached ; then
+    echo "result read from the cache differs"
+    exit 1
+fi
+
+# only the changed lexicon is built again
+printf 'LEXICON Root\nNouns ;\n\nLEXICON Nouns\ncat # ;\ndog # ;\nbird # ;\n' > cache.lexc
+if ! $TOOL -v --cache=$CACHE cache.lexc -o test.cached 2> cache.report ; then
+    echo "hfst-lexc --cache failed"
+    exit 1
+fi
+if ! grep -q "Rebuilt 1 of 2 lexicons: Nouns" cache.report ; then
+    echo "the changed lexicon was not built again"
+    exit 1
+fi
+$TOOL cache.lexc -o test.uncached 2> /dev/null
+if ! $COMPARE_TOOL -s test.cached test.uncached ; then
+    echo "results with and without the cache differ after a change"
+    exit 1
+fi
+
+rm -rf $CACHE cache.lexc cache.report test.cached test.uncached
+exit 0
@@ -0,0 +1,41 @@
+#!/bin/sh
+TOOLDIR=../../tools/src
+TOOL=$TOOLDIR/hfst-lexc
+COMPARE_TOOL=$TOOLDIR/hfst-compare
+
+for tool in $TOOL $COMPARE_TOOL;
+do
+    if ! test -x $tool ; then
+        echo "missing hfst-lexc, assuming configured off, skipping"
+        exit 77
+    fi
+done
+
+if test "$srcdir" = ""; then
+    srcdir="./"
+fi
+
+# lexicons compiled on several threads give the same result as on one
+LEXCTESTS="basic.cat-dog-bird.lexc basic.two-lexicons.lexc basic.root-loop.lexc
+          basic.regexps.lexc hfst.weights.lexc xre.definitions.lexc
+          stress.random-lexicons-100.lexc"
+
+for i in $LEXCTESTS ; do
+    for flags in "" "-F" ; do
+        if ! $TOOL $flags -j 1 $srcdir/$i -o test.jobs1 2> /dev/null ; then
+            echo "hfst-lexc $flags -j 1 failed on $i"
+            exit 1
+        fi
+        if ! $TOOL $flags -j 4 $srcdir/$i -o test.jobs4 2> /dev/null ; then
+            echo "hfst-lexc $flags -j 4 failed on $i"
+            exit 1
+        fi
+        if ! $COMPARE_TOOL -s test.jobs1 test.jobs4 ; then
+            echo "results of $i $flags on 1 and 4 threads differ"
+            exit 1
+        fi
+    done
+done
+
+rm -f test.jobs1 test.jobs4
+exit 0
@@ -104,6 +104,21 @@ check_compile_run '' \
     'ab ac' '<AB>a</AB>b <AC>a</AC>c'
 
 
+# The first symbols of an initial NRC() are used to skip positions where
+# no match can begin. Only a context matching one symbol alone rules out
+# that symbol.
+
+test_begin "NRC() at the beginning of a match"
+
+check_compile_run \
+    --code 'One-symbol NRC' 'set need-separators off Define TOP NRC({a}) Alpha+ EndTag(A);' \
+    --inout '' 'ab ca' 'a<A>b</A> <A>ca</A>'
+
+check_compile_run \
+    --code 'Multi-symbol NRC' 'set need-separators off Define TOP NRC({ab}) Alpha+ EndTag(A);' \
+    --inout '' 'ab ac' 'a<A>b</A> <A>ac</A>'
+
+
 # Not a bug (reported 2013-01-15; Sam clarified 2013-08-16)
 
 test_begin "Multiple EndTags in a single define"
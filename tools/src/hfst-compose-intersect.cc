@@ -33,6 +33,8 @@
 #include <cstring>
 #include <getopt.h>
 #include <set>
+#include <chrono>
+#include <thread>
 
 #include "HfstTransducer.h"
 #include "HfstInputStream.h"
@@ -60,6 +62,7 @@ static bool invert=false;
 static bool encode_weights=false;
 static bool fast_ci=false;
 static bool harmonize=false;
+static unsigned int jobs=1;
 
 void
 print_usage()
@@ -80,7 +83,14 @@ print_usage()
             "  -e, --encode-weights         Encode weights when minimizing\n"
             "                               (default is false).\n"
             "  -a, --harmonize              Harmonize symbols.\n"
+            "  -j, --jobs=N                 Prepare the rules on N threads\n"
+            "                               (0 for one per core).\n"
            );
+        fprintf(message_out,
+"\nWith --verbose, the time taken by the composition and the number of\n"
+"threads used are printed, so that runs with different --jobs can be\n"
+"compared. Only openfst-tropical and openfst-log rules are prepared on\n"
+"more than one thread.\n");
         //print_common_binary_program_parameter_instructions(message_out);
         fprintf(message_out,
 "\nIf OUTFILE, or either INFILE1 or INFILE2 is missing or -, standard\n"
@@ -116,11 +126,12 @@ parse_options(int argc, char** argv)
           {"encode-weights", no_argument, 0, 'e'},
           {"fast", no_argument, 0, 'f'},
           {"harmonize", no_argument, 0, 'a'},
+          {"jobs", required_argument, 0, 'j'},
           {0,0,0,0}
         };
         int option_index = 0;
         int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT
-                             HFST_GETOPT_BINARY_SHORT "FIeHfa",
+                             HFST_GETOPT_BINARY_SHORT "FIeHfaj:",
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -143,6 +154,14 @@ parse_options(int argc, char** argv)
         case 'a':
           harmonize = true;
           break;
+        case 'j':
+          if (atoi(optarg) < 0)
+            {
+              fprintf(stderr, "Error: invalid argument for --jobs: '%s'\n", optarg);
+              return EXIT_FAILURE;
+            }
+          jobs = atoi(optarg);
+          break;
         }
     }
 
@@ -373,6 +392,18 @@ compose_streams(HfstInputStream& firststream, HfstInputStream& secondstream)
             harmonize_rules(lexicon, rules);
           }
 
+        // compose_intersect uses one thread for other formats
+        unsigned int threads = jobs;
+        if (lexicon.get_type() != hfst::TROPICAL_OPENFST_TYPE &&
+            lexicon.get_type() != hfst::LOG_OPENFST_TYPE)
+          { threads = 1; }
+        else if (threads == 0)
+          { threads = std::thread::hardware_concurrency(); }
+        if (threads == 0)
+          { threads = 1; }
+        std::chrono::steady_clock::time_point start
+          = std::chrono::steady_clock::now();
+
         if (fast_ci)
           {
             // To hopefully speed up stuff: Compose intersect the output
@@ -383,7 +414,7 @@ compose_streams(HfstInputStream& firststream, HfstInputStream& secondstream)
               {
                 HfstTransducer lexicon_input(lexicon);
                 lexicon_input.input_project().minimize();
-                lexicon_input.compose_intersect(rules,true);
+                lexicon_input.compose_intersect(rules,true,true,jobs);
                 
                 lexicon_input.compose(lexicon);
                 lexicon = lexicon_input;
@@ -392,14 +423,19 @@ compose_streams(HfstInputStream& firststream, HfstInputStream& secondstream)
               {
                 HfstTransducer lexicon_output(lexicon);
                 lexicon_output.output_project().minimize();
-                lexicon_output.compose_intersect(rules,false);
+                lexicon_output.compose_intersect(rules,false,true,jobs);
                 lexicon.compose(lexicon_output);
               }
           }
         else
           {
-            lexicon.compose_intersect(rules,invert);
+            lexicon.compose_intersect(rules,invert,true,jobs);
           }
+        verbose_printf("Composed with " SIZE_T_SPECIFIER " rules on %u "
+                       "thread(s) in %.3f s\n",
+                       rules.size(), threads,
+                       std::chrono::duration<double>
+                       (std::chrono::steady_clock::now() - start).count());
 
         char* composed_name = static_cast<char*>(malloc(sizeof(char) *
                                                         (strlen(lexiconname) +
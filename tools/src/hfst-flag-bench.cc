@@ -0,0 +1,220 @@
+//! @file hfst-flag-bench.cc
+//!
+//! @brief Flag diacritic state benchmark
+//!
+//! @author HFST Team
+
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, version 3 of the License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+
+#include "hfst-commandline.h"
+#include "hfst-program-options.h"
+#include "hfst-tool-metadata.h"
+#include "HfstTransducer.h"
+#include "HfstInputStream.h"
+#include "HfstExceptionDefs.h"
+#include "HfstFlagDiacritics.h"
+
+#include "inc/globals-common.h"
+
+using hfst::HfstTransducer;
+using hfst::HfstInputStream;
+using hfst::FdOperation;
+using hfst::FdTable;
+using hfst::FdState;
+
+static char * analyser_filename = NULL;
+static unsigned int rounds = 200000;
+
+void
+print_usage()
+{
+    // c.f. http://www.gnu.org/prep/standards/standards.html#g_t_002d_002dhelp
+    fprintf(message_out, "Usage: %s [OPTIONS...] ANALYSER\n"
+            "measure the cost of keeping flag diacritic states during a search\n"
+            "\n", program_name);
+    print_common_program_options(message_out);
+    fprintf(message_out,
+            "Benchmark options:\n"
+            "  -r, --rounds=N        Apply N flag diacritics (default 200000)\n");
+    fprintf(message_out,
+            "\n"
+            "The flag diacritics in the alphabet of ANALYSER are applied in a\n"
+            "fixed pseudo-random order, going back to the previous state after\n"
+            "two out of three of them like a backtracking search does. This is\n"
+            "done once by copying the state before each flag and once with the\n"
+            "undo log, and the time taken by each is printed.\n"
+            "\n");
+    print_report_bugs();
+    fprintf(message_out, "\n");
+    print_more_info();
+    fprintf(message_out, "\n");
+}
+
+int
+parse_options(int argc, char** argv)
+{
+    extend_options_getenv(&argc, &argv);
+    // use of this function requires options are settable on global scope
+    while (true)
+    {
+        static const struct option long_options[] =
+        {
+          HFST_GETOPT_COMMON_LONG,
+          {"rounds", required_argument, 0, 'r'},
+          {0,0,0,0}
+        };
+        int option_index = 0;
+        int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT "r:",
+                             long_options, &option_index);
+        if (-1 == c)
+        {
+            break;
+        }
+        switch (c)
+        {
+#include "inc/getopt-cases-common.h"
+        case 'r':
+            if (atoi(optarg) < 1)
+            {
+                std::cerr << "Invalid argument for --rounds\n";
+                return EXIT_FAILURE;
+            }
+            rounds = atoi(optarg);
+            break;
+#include "inc/getopt-cases-error.h"
+        }
+    }
+    if ((optind + 1) != argc)
+    {
+        std::cerr << "An analyser must be given\n";
+        return EXIT_FAILURE;
+    }
+    analyser_filename = hfst_strdup(argv[optind]);
+    return EXIT_CONTINUE;
+}
+
+double elapsed_s(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>
+        (std::chrono::steady_clock::now() - start).count();
+}
+
+int run_benchmark(const FdTable<int> & table, int flags,
+                  std::ostream & outstream)
+{
+    FdState<int> copied(table);
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < rounds; ++i)
+    {
+        int symbol = (int)(((unsigned long)i * 7919) % flags);
+        FdState<int> saved(copied);
+        copied.apply_operation(symbol);
+        if (i % 3 != 0)
+        {
+            copied = saved;
+        }
+    }
+    double copy_s = elapsed_s(start);
+
+    FdState<int> logged(table);
+    start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < rounds; ++i)
+    {
+        int symbol = (int)(((unsigned long)i * 7919) % flags);
+        size_t mark = logged.log_position();
+        logged.apply_operation_logged(symbol);
+        if (i % 3 != 0)
+        {
+            logged.rollback(mark);
+        }
+    }
+    double log_s = elapsed_s(start);
+
+    if (copied.get_packed_values() != logged.get_packed_values())
+    {
+        std::cerr << program_name << ": copying states and the undo log "
+                  << "ended up in different states\n";
+        return EXIT_FAILURE;
+    }
+    outstream << "flags: " << flags
+              << "\nfeatures: " << table.num_features()
+              << "\nwords: " << copied.get_packed_values().size()
+              << "\nrounds: " << rounds
+              << "\ncopying states: " << copy_s << " s"
+              << "\nundo log: " << log_s << " s\n";
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char ** argv)
+{
+    hfst_set_program_name(argv[0], "0.1", "HfstFlagBench");
+    hfst_setlocale();
+    int retval = parse_options(argc, argv);
+    if (retval != EXIT_CONTINUE)
+    {
+        return retval;
+    }
+    HfstTransducer * analyser = NULL;
+    try
+    {
+        verbose_printf("Reading analyser from %s...\n", analyser_filename);
+        HfstInputStream in(analyser_filename);
+        analyser = new HfstTransducer(in);
+        in.close();
+        FdTable<int> table;
+        int flags = 0;
+        hfst::StringSet alphabet = analyser->get_alphabet();
+        for (hfst::StringSet::const_iterator it = alphabet.begin();
+             it != alphabet.end(); ++it)
+        {
+            if (FdOperation::is_diacritic(*it))
+            {
+                table.define_diacritic(flags++, *it);
+            }
+        }
+        if (flags == 0)
+        {
+            std::cerr << program_name << ": " << analyser_filename
+                      << " has no flag diacritics\n";
+            retval = EXIT_FAILURE;
+        }
+        else
+        {
+            retval = run_benchmark(table, flags, std::cout);
+        }
+    }
+    catch (const HfstException & e)
+    {
+        std::cerr << program_name << ": " << e.what() << std::endl;
+        retval = EXIT_FAILURE;
+    }
+    delete analyser;
+    free(analyser_filename);
+    return retval;
+}
@@ -53,6 +53,7 @@ using hfst::ImplementationType;
 
 ImplementationType output_type = hfst::UNSPECIFIED_TYPE;
 bool hfst_format = true;
+bool write_index = false;
 std::string options = "";
 
 void set_output_type(ImplementationType type)
@@ -85,14 +86,21 @@ print_usage()
     "  -l, --openfst-log                 Write output in (HFST's) log weight (OpenFST) implementation\n"
     "  -O, --optimized-lookup-unweighted Write output in the HFST optimized-lookup implementation\n"
     "  -w, --optimized-lookup-weighted   Write output in optimized-lookup (weighted) implementation\n"
-    "  -Q  --quick                       When converting to optimized-lookup, don't try hard to compress\n");
+    "  -Q  --quick                       When converting to optimized-lookup, don't try hard to compress\n"
+    "  -I, --index                       Append an index of the transducers to OUTFILE\n");
     fprintf(message_out, "\n");
     print_common_unary_program_parameter_instructions(message_out);
         fprintf(message_out,
             "FMT must be name of a format usable by libhfst, i.e. one of the following:\n"
         "{ foma, openfst-tropical, openfst-log, sfst, xfsm\n"
         "  optimized-lookup-weighted, optimized-lookup-unweighted }.\n"
-        "Note that xfsm format is always written in native format without HFST wrappers.\n");
+        "Note that xfsm format is always written in native format without HFST wrappers.\n"
+        "When converting to optimized-lookup with --verbose, the time spent packing\n"
+        "the index table and the share of its entries used are printed.\n"
+        "With --index, single transducers can be read from OUTFILE by name without\n"
+        "reading the ones before them, e.g. with hfst-head --name. OUTFILE must be\n"
+        "a file and not standard output. Versions of HFST without index support\n"
+        "fail on the index after reading the last transducer of such a file.\n");
     fprintf(message_out, "\n");
     print_report_bugs();
     fprintf(message_out, "\n");
@@ -121,12 +129,13 @@ parse_options(int argc, char** argv)
           {"optimized-lookup-unweighted",   no_argument, 0, 'O'},
           {"optimized-lookup-weighted",no_argument, 0, 'w'},
       {"quick",              no_argument, 0, 'Q'},
+          {"index",              no_argument, 0, 'I'},
           {0,0,0,0}
         };
         int option_index = 0;
         // add tool-specific options here
         int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT
-                             HFST_GETOPT_UNARY_SHORT "SFtlOwQf:bx",
+                             HFST_GETOPT_UNARY_SHORT "SFtlOwQf:bxI",
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -179,6 +188,9 @@ parse_options(int argc, char** argv)
     case 'Q':
         options = "quick";
         break;
+        case 'I':
+          write_index = true;
+          break;
 #include "inc/getopt-cases-error.h"
         }
     }
@@ -192,6 +204,12 @@ parse_options(int argc, char** argv)
 
 #include "inc/check-params-common.h"
 #include "inc/check-params-unary.h"
+    if (write_index && (! hfst_format || output_type == hfst::XFSM_TYPE ||
+                        outfile == stdout))
+    {
+        error(EXIT_FAILURE, 0,
+              "--index requires an output file in HFST format");
+    }
     return EXIT_CONTINUE;
 }
 int
@@ -224,7 +242,10 @@ process_stream(HfstInputStream& instream, HfstOutputStream& outstream)
                          inputname, transducer_n);
         }
         try {
-            orig.convert(output_type, options);
+            // with --verbose, conversion to optimized-lookup reports
+            // how the index table was packed
+            orig.convert(output_type,
+                         verbose ? options + " statistics" : options);
         } HFST_CATCH(HfstException)
         hfst_set_name(orig, orig, "convert");
         hfst_set_formula(orig, orig, "Id");
@@ -315,6 +336,7 @@ int main( int argc, char **argv ) {
     HfstOutputStream* outstream = (outfile != stdout) ?
       new HfstOutputStream(outfilename, output_type, hfst_format) :
       new HfstOutputStream(output_type, hfst_format);
+    outstream->set_write_index(write_index);
 
     retval = process_stream(*instream, *outstream);
     delete instream;
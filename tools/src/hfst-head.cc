@@ -53,6 +53,7 @@ using hfst::HfstOutputStream;
 
 // add tools-specific variables here
 long head_count = 1;
+char * transducer_name = NULL;
 
 void
 print_usage()
@@ -68,12 +69,17 @@ print_usage()
     fprintf(message_out, "Archive options:\n"
             "  -n, --n-first=[-]K   print the first K transducers;\n"
             "                       with the leading `-', print all but "
-            "last K transducers\n");
+            "last K transducers\n"
+            "  -N, --name=NAME      print the transducer named NAME from an\n"
+            "                       indexed archive\n");
     fprintf(message_out, "\n");
     print_common_unary_program_parameter_instructions(message_out);
     fprintf(message_out, "K must be an integer, as parsed by "
             "strtoul base 10, and not 0.\n"
-            "If K is omitted default is 1.");
+            "If K is omitted default is 1.\n"
+            "With --name, the archive must be a file written with an index,\n"
+            "e.g. by hfst-fst2fst --index, and the transducers before NAME\n"
+            "are not read.");
     fprintf(message_out, "\n");
     print_report_bugs();
     fprintf(message_out, "\n");
@@ -93,13 +99,14 @@ parse_options(int argc, char** argv)
           HFST_GETOPT_COMMON_LONG,
           HFST_GETOPT_UNARY_LONG,
           {"n-first", required_argument, 0, 'n'},
+          {"name", required_argument, 0, 'N'},
           // add tool-specific options here
             {0,0,0,0}
         };
         int option_index = 0;
         // add tool-specific options here
         int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT
-                             HFST_GETOPT_UNARY_SHORT "n:",
+                             HFST_GETOPT_UNARY_SHORT "n:N:",
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -113,6 +120,9 @@ parse_options(int argc, char** argv)
         case 'n':
           head_count = hfst_strtol(optarg, 10);
           break;
+        case 'N':
+          transducer_name = hfst_strdup(optarg);
+          break;
 #include "inc/getopt-cases-error.h"
         }
     }
@@ -130,7 +140,23 @@ int
 process_stream(HfstInputStream& instream, HfstOutputStream& outstream)
   {
     size_t transducer_n=0;
-    if (head_count > 0)
+    if (transducer_name != NULL)
+      {
+        if (! instream.has_index())
+          {
+            error(EXIT_FAILURE, 0, "%s has no index, cannot find %s",
+                  inputfilename, transducer_name);
+          }
+        if (! instream.seek_transducer(transducer_name))
+          {
+            error(EXIT_FAILURE, 0, "%s has no transducer named %s",
+                  inputfilename, transducer_name);
+          }
+        verbose_printf("Forwarding %s...\n", transducer_name);
+        HfstTransducer trans(instream);
+        outstream << trans;
+      }
+    else if (head_count > 0)
       {
         while (instream.is_good() && (transducer_n < head_count))
         {
@@ -230,6 +256,7 @@ int main( int argc, char **argv ) {
     delete outstream;
     free(inputfilename);
     free(outfilename);
+    free(transducer_name);
     return retval;
 }
 
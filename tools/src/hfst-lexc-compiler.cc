@@ -68,6 +68,8 @@ static bool treat_warnings_as_errors = false;
 static bool xerox_composition = true;  // Compatibility with Xerox tools is the default
 static bool encode_weights = false;
 static bool enc = false;
+static char * cache_directory = 0;
+static unsigned int jobs = 1;
 
 void
 print_usage()
@@ -90,7 +92,12 @@ print_usage()
                "  -x, --xerox-composition=VALUE Whether flag diacritics are treated as ordinary\n"
                "                                symbols in composition (default is true).\n"
                "  -X, --xfst=VARIABLE     toggle xfst compatibility option VARIABLE.\n"
-               "  -W, --Werror            treat warnings as errors\n");
+               "  -W, --Werror            treat warnings as errors\n"
+               "  -C, --cache=DIR         keep compiled lexicons in DIR and only\n"
+               "                          recompile the lexicons that have changed\n"
+               "                          (which ones is shown with --verbose)\n"
+               "  -j, --jobs=N            compile lexicons on N threads (0 for one\n"
+               "                          per core)\n");
         fprintf(message_out, "\n");
         fprintf(message_out,
                 "If INFILE or OUTFILE are omitted or -, standard streams will "
@@ -142,11 +149,13 @@ parse_options(int argc, char** argv)
           {"xerox-composition", required_argument,    0, 'x'},
           {"xfst", required_argument, 0, 'X'},
           {"Werror", no_argument,    0, 'W'},
+          {"cache", required_argument,    0, 'C'},
+          {"jobs", required_argument,    0, 'j'},
           {0,0,0,0}
         };
         int option_index = 0;
         int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT
-                             "Ef:o:AFMRx:X:W",
+                             "Ef:o:AFMRx:X:WC:j:",
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -212,6 +221,17 @@ parse_options(int argc, char** argv)
         case 'W':
           treat_warnings_as_errors = true;
           break;
+        case 'C':
+          cache_directory = hfst_strdup(optarg);
+          break;
+        case 'j':
+          if (atoi(optarg) < 0)
+            {
+              fprintf(stderr, "Error: invalid argument for --jobs: '%s'\n", optarg);
+              return EXIT_FAILURE;
+            }
+          jobs = atoi(optarg);
+          break;
 
 #include "inc/getopt-cases-error.h"
         }
@@ -252,6 +272,37 @@ parse_options(int argc, char** argv)
     return EXIT_CONTINUE;
 }
 
+void
+print_compilation_report(const LexcCompiler& lexc)
+{
+    if (!verbose)
+      {
+        return;
+      }
+    if (cache_directory != 0)
+      {
+        const std::vector<std::string>& rebuilt = lexc.getRebuiltLexicons();
+        fprintf(stderr, "Rebuilt %u of %u lexicons",
+                (unsigned int)rebuilt.size(),
+                (unsigned int)(rebuilt.size() + lexc.getCachedLexicons().size()));
+        for (unsigned int i = 0; i < rebuilt.size(); i++)
+          {
+            fprintf(stderr, "%s %s", (i == 0 ? ":" : ","), rebuilt[i].c_str());
+          }
+        fprintf(stderr, "\n");
+      }
+    const std::vector<std::pair<std::string,double> >& stages
+      = lexc.getStageTimes();
+    double total = 0.0;
+    for (unsigned int i = 0; i < stages.size(); i++)
+      {
+        fprintf(stderr, "  %-14s %.3f s\n", stages[i].first.c_str(),
+                stages[i].second);
+        total += stages[i].second;
+      }
+    fprintf(stderr, "  %-14s %.3f s\n", "total", total);
+}
+
 int
 lexc_streams(LexcCompiler& lexc, HfstOutputStream& outstream)
 {
@@ -295,6 +346,7 @@ lexc_streams(LexcCompiler& lexc, HfstOutputStream& outstream)
           }
         return EXIT_FAILURE;
       }
+    print_compilation_report(lexc);
     hfst_set_name(*res, lexcfilenames[0], "lexc");
     hfst_set_formula(*res, lexcfilenames[0], "L");
     verbose_printf("\nWriting... ");
@@ -370,10 +422,16 @@ int main( int argc, char **argv ) {
       {
         lexc.setTreatWarningsAsErrors(true);
       }
+    if (cache_directory != 0)
+      {
+        lexc.setCacheDirectory(cache_directory);
+      }
+    lexc.setJobs(jobs);
     retval = lexc_streams(lexc, *outstream);
     delete outstream;
     free(lexcfilenames);
     free(outfilename);
+    free(cache_directory);
     return retval;
 }
 
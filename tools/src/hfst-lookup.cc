@@ -23,6 +23,8 @@
 
 #ifdef WINDOWS
 #  include <io.h>
+#else
+#  include <unistd.h>
 #endif
 
 #include <iostream>
@@ -45,6 +47,7 @@ using hfst::hfst_fprintf_console;
 #endif
 
 #include <limits>
+#include <thread>
 #include <math.h>
 
 #include "hfst-commandline.h"
@@ -55,6 +58,8 @@ using hfst::hfst_fprintf_console;
 #include "HfstInputStream.h"
 #include "HfstOutputStream.h"
 #include "implementations/HfstBasicTransducer.h"
+#include "implementations/ConvertTransducerFormat.h"
+#include "implementations/optimized-lookup/cascade.h"
 
 #include "inc/globals-common.h"
 #include "inc/globals-unary.h"
@@ -129,6 +134,10 @@ enum lookup_output_format
 static lookup_input_format input_format = UTF8_TOKEN_INPUT;
 static lookup_output_format output_format = XEROX_OUTPUT;
 static double time_cutoff = 0.0;
+static unsigned int threads = 1;
+static size_t cache_entries = 0;
+static size_t cache_bytes = 0;
+static size_t cascade_states = 100000;
 
 // XFST variables for apply
 static bool show_flags = false;
@@ -265,7 +274,14 @@ print_usage()
             "  -t, --time-cutoff=S              Limit search after having used S seconds per input\n"
             "                                   (only for lookup-optimized transducers)\n"
             "  -C, --cascade=CASCADE            How multiple transducers in input are handled\n"
-            "  -P, --progress                   Show neat progress bar if possible\n");
+            "  -P, --progress                   Show neat progress bar if possible\n"
+            "  -j, --threads=N                  Look up inputs in N parallel threads\n"
+            "                                   (only for lookup-optimized transducers)\n"
+            "  -k, --cache=K                    Cache the results of up to K inputs\n"
+            "                                   (only for lookup-optimized transducers)\n"
+            "  -K, --cache-bytes=BYTES          Limit the result cache to about BYTES bytes\n"
+            "  -S, --cascade-states=STATES      Cache the moves from up to STATES state tuples\n"
+            "                                   with --cascade=composition\n");
     fprintf(message_out, "\n");
     print_common_unary_program_parameter_instructions(message_out);
     fprintf(message_out,
@@ -278,12 +294,23 @@ print_usage()
             "Epsilon is printed by default as an empty string.\n"
             "B must be a non-negative float.\n"
             "S must be a non-negative float. The default, 0.0, indicates no cutoff.\n"
+            "N must be a positive integer, or 0 for one thread per processor. The\n"
+            "default is 1. With N other than 1, inputs are read and looked up in blocks,\n"
+            "and the results are printed in input order once a block is finished.\n"
+            "Input from a terminal is always looked up line by line in one thread.\n"
+            "The result cache drops the least recently used results first. It is on if\n"
+            "K or BYTES is given, a missing or 0 bound meaning no bound. With -x, its\n"
+            "hits and misses are printed in the statistics.\n"
             "If the input contains several transducers, a set containing\n"
             "results from all transducers is printed for each input string.\n");
     fprintf(message_out, "\n");
 
     fprintf(message_out, "CASCADE must be one of { union, priority-union, composition }.\n"
-            "If not specified, defaults to {union}.\n");
+            "If not specified, defaults to {union}. With {composition}, the\n"
+            "composition of the transducers is walked for each input without\n"
+            "building it, the transducers being converted to optimized lookup\n"
+            "format first, unless print-pairs is on or obey-flags is off.\n"
+            "STATES defaults to 100000, 0 turning the cache off.\n");
     fprintf(message_out, "\n");
 
     fprintf(message_out, "STREAM can be { input, output, both }. If not given, defaults to {both}.\n"
@@ -341,12 +368,16 @@ parse_options(int argc, char** argv)
             {"pipe-mode", optional_argument, 0, 'p'},
             {"progress", no_argument, 0, 'P'},
             {"cascade", required_argument, 0, 'C'},
+            {"threads", required_argument, 0, 'j'},
+            {"cache", required_argument, 0, 'k'},
+            {"cache-bytes", required_argument, 0, 'K'},
+            {"cascade-states", required_argument, 0, 'S'},
             {0,0,0,0}
         };
         int option_index = 0;
         // add tool-specific options here
         int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT
-                             HFST_GETOPT_UNARY_SHORT "I:O:F:xc:n:X:e:E:b:t:p::PC:",
+                             HFST_GETOPT_UNARY_SHORT "I:O:F:xc:n:X:e:E:b:t:p::PC:j:k:K:S:",
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -483,6 +514,30 @@ parse_options(int argc, char** argv)
             show_progress_bar = true;
             break;
 
+        case 'j':
+            threads = hfst_strtoul(optarg, 10);
+            if (threads == 0)
+              {
+                threads = std::thread::hardware_concurrency();
+                if (threads == 0)
+                  {
+                    threads = 1;
+                  }
+              }
+            break;
+
+        case 'k':
+            cache_entries = hfst_strtoul(optarg, 10);
+            break;
+
+        case 'K':
+            cache_bytes = hfst_strtoul(optarg, 10);
+            break;
+
+        case 'S':
+            cascade_states = hfst_strtoul(optarg, 10);
+            break;
+
         case 'C':
             if (strcmp(optarg, "union") == 0)
               { cascade_ = CASCADE_UNION; }
@@ -1129,6 +1184,20 @@ void lookup_fd_and_print(HfstBasicTransducer * tr, HfstTransducer * TR, HfstOneL
                          bool print_fail = false, const HfstOneLevelPath * input_to_print = NULL,
                          bool no_newline = false);
 
+static void
+warn_infinite_results(size_t maxnum)
+{
+  if (!silent) {
+    if (max_number == -1)
+      warning(0, 0, "Got infinite results, number of results limited to " SIZE_T_SPECIFIER "\n"
+              "(can be controlled with --max-number=N)",
+              maxnum);
+    else
+      warning(0, 0, "Got infinite results, number of results limited to " SIZE_T_SPECIFIER "",
+              maxnum);
+  }
+}
+
 HfstOneLevelPaths*
 lookup_simple(const HfstOneLevelPath& s, HfstTransducer& t, bool* infinity, bool print_pairs_at_this_point=false, bool print_fail=false, const HfstOneLevelPath * input_to_print = NULL, bool no_newline=false)
 {
@@ -1136,15 +1205,7 @@ lookup_simple(const HfstOneLevelPath& s, HfstTransducer& t, bool* infinity, bool
   if (time_cutoff == 0.0 && t.is_lookup_infinitely_ambiguous(s.second))
     {
       size_t maxnum = (max_number == -1)? MAX_NUMBER : max_number;
-      if (!silent) {
-        if (max_number == -1)
-          warning(0, 0, "Got infinite results, number of results limited to " SIZE_T_SPECIFIER "\n"
-                  "(can be controlled with --max-number=N)",
-                  maxnum);
-        else
-          warning(0, 0, "Got infinite results, number of results limited to " SIZE_T_SPECIFIER "",
-                  maxnum);
-      }
+      warn_infinite_results(maxnum);
       if (print_pairs)
         lookup_fd_and_print(NULL, &t, *results, s, &maxnum, print_pairs_at_this_point, print_fail, input_to_print, no_newline);
       else
@@ -1734,6 +1795,143 @@ perform_lookups(HfstOneLevelPath& origin, std::vector<HfstBasicTransducer>& casc
     return kvs;
 }
 
+/* Look up \a origin in the composition of the cascade without composing
+   the transducers. Results are cut at cycles that produce output, which
+   are reported as infinite results. */
+HfstOneLevelPaths*
+perform_lookups(HfstOneLevelPath& origin, hfst_ol::CascadeLookup& composed,
+                bool unknown, bool* infinite)
+{
+  if (unknown)
+    {
+      return new HfstOneLevelPaths;
+    }
+  HfstOneLevelPaths* kvs = composed.lookup_fd(origin.second, max_number,
+                                              time_cutoff);
+  if (composed.found_output_cycle())
+    {
+      verbose_printf("Input epsilon cycles cut, results are incomplete\n");
+      *infinite = true;
+    }
+  if (kvs->size() == 0)
+    {
+      verbose_printf("Got no results\n");
+    }
+  return kvs;
+}
+
+/* Look up the lines of lookup_file with \a t in \a threads threads.
+   The lines are read in blocks, each block is looked up with
+   HfstTransducer::lookup_fd_batch and its results are printed in input
+   order before the next block is read. Returns the final position in
+   lookup_file. */
+static long
+lookup_stream_threaded(HfstTransducer& t,
+                       hfst::HfstStrings2FstTokenizer& input_tokenizer,
+                       FILE* outstream, long filesize)
+{
+    const size_t block_size = 1024 * threads;
+    size_t maxnum = (max_number == -1)? MAX_NUMBER : max_number;
+    char* line = 0;
+    size_t llen = 0;
+    long filepos = ftell(lookup_file);
+    bool end_of_input = false;
+    while (!end_of_input)
+      {
+        std::vector<HfstOneLevelPath*> kvs_in;
+        std::vector<char*> markups;
+        std::vector<bool> unknowns;
+        StringVector batch;
+        while (kvs_in.size() < block_size)
+          {
+            if (hfst_getline(&line, &llen, lookup_file) == -1)
+              {
+                end_of_input = true;
+                break;
+              }
+            char * p = line;
+            linen++;
+            while (*p != '\0')
+              {
+                if (*p == '\n' || *p == '\r')
+                  {
+                    *p = '\0';
+                    break;
+                  }
+                p++;
+              }
+            verbose_printf("Looking up %s...\n", line);
+
+            char* markup = 0;
+            bool unknown = false;
+            HfstOneLevelPath* kv = line_to_lookup_path(&line, input_tokenizer,
+                                                       &markup, &unknown, true);
+            if (!unknown)
+              {
+                std::string input;
+                for (StringVector::const_iterator s = kv->second.begin();
+                     s != kv->second.end(); ++s)
+                  {
+                    input.append(*s);
+                  }
+                batch.push_back(input);
+              }
+            kvs_in.push_back(kv);
+            markups.push_back(markup);
+            unknowns.push_back(unknown);
+          }
+        filepos = ftell(lookup_file);
+        if (show_progress_bar)
+          {
+            if (filesize != -1)
+              {
+                fprintf(stderr, "%ld / %ld...\r", filepos, filesize);
+              }
+            else
+              {
+                fprintf(stderr, "%ld / ?...\r", linen);
+              }
+          }
+
+        std::vector<bool> infinite;
+        std::vector<HfstOneLevelPaths*> results =
+          t.lookup_fd_batch(batch, threads, max_number, time_cutoff,
+                            &infinite, maxnum);
+        size_t result_n = 0;
+        for (size_t i = 0; i < kvs_in.size(); i++)
+          {
+            HfstOneLevelPaths* kvs = NULL;
+            bool inf = false;
+            if (unknowns[i])
+              {
+                kvs = new HfstOneLevelPaths;
+              }
+            else
+              {
+                kvs = results[result_n];
+                inf = infinite[result_n];
+                result_n++;
+                if (inf)
+                  {
+                    warn_infinite_results(maxnum);
+                  }
+                if (kvs->size() == 0)
+                  {
+                    verbose_printf("Got no results\n");
+                  }
+              }
+            print_lookups(*kvs, *kvs_in[i], markups[i], unknowns[i], inf,
+                          outstream);
+            delete kvs_in[i];
+            delete kvs;
+            free(markups[i]);
+          }
+        fflush(outstream);
+      }
+    free(line);
+    return filepos;
+}
+
 int
 process_stream(HfstInputStream& inputstream, FILE* outstream)
 {
@@ -1842,6 +2040,39 @@ process_stream(HfstInputStream& inputstream, FILE* outstream)
     hfst::HfstStrings2FstTokenizer input_tokenizer(mc_symbols,
                          std::string(epsilon_format));
 
+    if (only_optimized_lookup && (cache_entries != 0 || cache_bytes != 0))
+      {
+        for (std::vector<HfstTransducer>::iterator it = cascade.begin();
+             it != cascade.end(); ++it)
+          {
+            it->set_lookup_cache(cache_entries, cache_bytes);
+          }
+      }
+
+    // A composition cascade is walked as one transducer, which needs the
+    // transducers in optimized lookup format
+    hfst_ol::CascadeLookup * composed = NULL;
+    if (cascade_ == CASCADE_COMPOSITION && cascade.size() > 1 &&
+        !print_pairs && obey_flags)
+      {
+        std::vector<hfst_ol::Transducer *> stages;
+        for (std::vector<HfstTransducer>::iterator it = cascade.begin();
+             it != cascade.end(); ++it)
+          {
+            if (it->get_type() != HFST_OL_TYPE &&
+                it->get_type() != HFST_OLW_TYPE)
+              {
+                verbose_printf("Converting transducer " SIZE_T_SPECIFIER
+                               " to optimized lookup format...\n",
+                               (size_t)(it - cascade.begin() + 1));
+              }
+            stages.push_back(hfst::implementations::ConversionFunctions::
+                             hfst_transducer_to_hfst_ol(&*it));
+          }
+        composed = new hfst_ol::CascadeLookup(stages, cascade_states);
+        only_optimized_lookup = true;
+      }
+
     if (!only_optimized_lookup)
       {
         char* format_string = hfst_strformat(cascade[0].get_type());
@@ -1866,95 +2097,117 @@ process_stream(HfstInputStream& inputstream, FILE* outstream)
       }
     print_prompt();
     long filepos = ftell(lookup_file);
-    while (true)
-      {
+    bool use_threads = threads != 1 && only_optimized_lookup
+      && cascade.size() == 1 && !print_pairs;
+    // a block is printed only once it is full, which would leave
+    // interactive users and line-at-a-time clients waiting
 #ifdef WINDOWS
-        if (lookup_file == stdin && !pipe_input)
+    use_threads = use_threads && !(lookup_file == stdin && !pipe_input);
+#else
+    use_threads = use_threads && !isatty(fileno(lookup_file));
+#endif
+    if (use_threads)
+      {
+        verbose_printf("Looking up in %u threads\n", threads);
+        filepos = lookup_stream_threaded(cascade[0], input_tokenizer,
+                                         outstream, filesize);
+      }
+    else
+      {
+        while (true)
           {
-            std::string str("");
-            size_t bufsize = 1000;
-            if (! hfst::get_line_from_console(str, bufsize))
+#ifdef WINDOWS
+            if (lookup_file == stdin && !pipe_input)
               {
-                break;
+                std::string str("");
+                size_t bufsize = 1000;
+                if (! hfst::get_line_from_console(str, bufsize))
+                  {
+                    break;
+                  }
+                line = strdup(str.c_str());
               }
-            line = strdup(str.c_str());
-          }
-        else
-          {
+            else
+              {
 #endif
-            if (hfst_getline(&line, &llen, lookup_file) == -1)
-              break;
+                if (hfst_getline(&line, &llen, lookup_file) == -1)
+                  break;
 #ifdef WINDOWS
-          }
+              }
 #endif
 
-        char * p = line;
-        linen++;
+            char * p = line;
+            linen++;
 
-        while (*p != '\0')
-          {
-            if (*p == '\n' || *p == '\r') // '\r' is possible on Windows
+            while (*p != '\0')
               {
-                *p = '\0';
-                break;
-              }
-            p++;
-          }
-        verbose_printf("Looking up %s...\n", line);
-        filepos = ftell(lookup_file);
-        if (show_progress_bar)
-          {
-            if (filesize != -1)
-              {
-                fprintf(stderr, "%ld / %ld...\r", filepos, filesize);
+                if (*p == '\n' || *p == '\r') // '\r' is possible on Windows
+                  {
+                    *p = '\0';
+                    break;
+                  }
+                p++;
               }
-            else
+            verbose_printf("Looking up %s...\n", line);
+            filepos = ftell(lookup_file);
+            if (show_progress_bar)
               {
-                fprintf(stderr, "%ld / ?...\r", linen);
+                if (filesize != -1)
+                  {
+                    fprintf(stderr, "%ld / %ld...\r", filepos, filesize);
+                  }
+                else
+                  {
+                    fprintf(stderr, "%ld / ?...\r", linen);
+                  }
               }
-          }
 
-        char* markup = 0;
-        bool unknown = false;
-        bool infinite = false;
-        HfstOneLevelPaths* kvs;
+            char* markup = 0;
+            bool unknown = false;
+            bool infinite = false;
+            HfstOneLevelPaths* kvs;
 
-        HfstOneLevelPath* kv = line_to_lookup_path(&line, input_tokenizer,
-                                                   &markup,
-                                                   &unknown, only_optimized_lookup);
+            HfstOneLevelPath* kv = line_to_lookup_path(&line, input_tokenizer,
+                                                       &markup,
+                                                       &unknown, only_optimized_lookup);
 
-        if (verbose)
-          {
-            verbose_printf("Tokenized to: ");
-            for (StringVector::const_iterator s = kv->second.begin();
-                 s != kv->second.end();
-                 ++s)
+            if (verbose)
               {
-                verbose_printf("%s ", s->c_str());
+                verbose_printf("Tokenized to: ");
+                for (StringVector::const_iterator s = kv->second.begin();
+                     s != kv->second.end();
+                     ++s)
+                  {
+                    verbose_printf("%s ", s->c_str());
+                  }
+                verbose_printf("\n");
+              }
+            if (composed != NULL)
+              {
+                kvs = perform_lookups(*kv, *composed, unknown, &infinite);
+              }
+            else if (only_optimized_lookup)
+              {
+                kvs = perform_lookups(*kv, cascade, unknown,
+                                      &infinite);
+              }
+            else
+              {
+                kvs = perform_lookups(*kv, cascade_mut,
+                                      unknown, &infinite);
               }
-            verbose_printf("\n");
-          }
-        if (only_optimized_lookup)
-          {
-            kvs = perform_lookups(*kv, cascade, unknown,
-                                  &infinite);
-          }
-        else
-          {
-            kvs = perform_lookups(*kv, cascade_mut,
-                                  unknown, &infinite);
-          }
 
-        if (! print_pairs) {
-          // printing was already done in function lookup_fd
-          print_lookups(*kvs, *kv, markup, unknown, infinite, outstream);
-          fflush(outstream);
-        }
-        delete kv;
-        delete kvs;
+            if (! print_pairs) {
+              // printing was already done in function lookup_fd
+              print_lookups(*kvs, *kv, markup, unknown, infinite, outstream);
+              fflush(outstream);
+            }
+            delete kv;
+            delete kvs;
 
-        print_prompt();
-      } // while lines in input
+            print_prompt();
+          } // while lines in input
+      }
     if (show_progress_bar)
       {
         fprintf(stderr, "%ld/%ld... Done\n", filepos, filesize);
@@ -1969,7 +2222,28 @@ process_stream(HfstInputStream& inputstream, FILE* outstream)
                 "%f\t%f\n",
                 (float)analysed/(float)inputs,
                 (float)analyses/(float)inputs);
+        if (only_optimized_lookup && cascade.size() > 0 &&
+            cascade[0].get_lookup_cache() != NULL)
+          {
+            unsigned long hits = 0;
+            unsigned long misses = 0;
+            for (std::vector<HfstTransducer>::const_iterator it = cascade.begin();
+                 it != cascade.end(); ++it)
+              {
+                hits += it->get_lookup_cache()->get_hits();
+                misses += it->get_lookup_cache()->get_misses();
+              }
+            fprintf(outstream, "Cache hits\tCache misses\n"
+                    "%lu\t%lu\n", hits, misses);
+          }
+        if (composed != NULL)
+          {
+            fprintf(outstream, "Cascade state hits\tCascade state misses\n"
+                    "%lu\t%lu\n", (unsigned long)composed->get_hits(),
+                    (unsigned long)composed->get_misses());
+          }
       }
+    delete composed;
     return EXIT_SUCCESS;
 }
 
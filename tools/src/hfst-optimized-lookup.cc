@@ -32,15 +32,29 @@
 
 #ifdef _MSC_VER
 #  include "hfst-string-conversions.h"
+#  include <io.h>
 using hfst::hfst_fprintf_console;
+#else
+#  include <unistd.h>
 #endif
 
 #include <cstdarg>
 #include <iostream> // DEBUG
+#include <thread>
+
+#include "HfstTransducer.h"
+#include "HfstInputStream.h"
 
 static float beam=-1;
 static bool pipe_input = false;
 static bool pipe_output = false;
+static unsigned int threads = 1;
+static size_t cache_entries = 0;
+static size_t cache_bytes = 0;
+
+int setup_libhfst(const char * filename);
+static void print_weighted_analyses(const std::string & prepend,
+                                    const DisplayMultiMap & analyses);
 
 bool print_usage(void)
 {
@@ -71,10 +85,21 @@ bool print_usage(void)
     "                              (with this option enabled -u and -n don't work and\n" <<
     "                              output won't be ordered by weight).\n" <<
     "  -p, --pipe-mode[=STREAM]    Control input and output streams.\n" <<
+    "  -j, --threads=T             Look up inputs in T parallel threads\n" <<
+    "  -k, --cache=K               Cache the results of up to K inputs\n" <<
+    "  -K, --cache-bytes=BYTES     Limit the result cache to about BYTES bytes\n" <<
     "\n" <<
     "N must be a positive integer. B must be a non-negative float.\n" <<
     "S must be a non-negative float. The default, 0.0, indicates no cutoff.\n"
     "Options -n and -b are combined with AND, i.e. they both restrict the output.\n" <<
+    "T must be a positive integer, or 0 for one thread per processor. The default\n" <<
+    "is 1. With T other than 1, input is read and looked up in blocks, and results\n" <<
+    "are printed in input order once a block is finished.\n" <<
+    "The result cache drops the least recently used results first. It is on if K\n" <<
+    "or BYTES is given, a missing or 0 bound meaning no bound. With -v, its hits\n" <<
+    "and misses are printed at the end.\n" <<
+    "With T other than 1 or with the cache, analyses are always unique and ordered\n" <<
+    "by weight, and -f has no effect.\n" <<
     "\n" <<
     "STREAM can be { input, output, both }. If not given, defaults to {both}.\n" <<
 #ifdef _MSC_VER
@@ -133,11 +158,14 @@ int main(int argc, char **argv)
           {"fast",         no_argument,       0, 'f'},
           {"pipe-mode",    optional_argument,       0, 'p'},
           {"analyses",     required_argument, 0, 'n'},
+          {"threads",      required_argument, 0, 'j'},
+          {"cache",        required_argument, 0, 'k'},
+          {"cache-bytes",  required_argument, 0, 'K'},
           {0,              0,                 0,  0 }
         };
 
       int option_index = 0;
-      c = getopt_long(argc, argv, "hVvqsewb:t:uxfn:p::", long_options, &option_index);
+      c = getopt_long(argc, argv, "hVvqsewb:t:uxfn:p::j:k:K:", long_options, &option_index);
 
       if (c == -1) // no more options to look at
         break;
@@ -220,6 +248,34 @@ int main(int argc, char **argv)
           outputType = xerox;
           break;
 
+        case 'j':
+          if (atoi(optarg) < 0)
+            {
+              std::cerr << "Invalid argument for --threads\n";
+              return EXIT_FAILURE;
+            }
+          threads = atoi(optarg);
+          if (threads == 0)
+            {
+              threads = std::thread::hardware_concurrency();
+              if (threads == 0)
+                threads = 1;
+            }
+          break;
+
+        case 'k':
+        case 'K':
+          if (atol(optarg) < 0)
+            {
+              std::cerr << "Invalid argument for --cache\n";
+              return EXIT_FAILURE;
+            }
+          if (c == 'k')
+            cache_entries = atol(optarg);
+          else
+            cache_bytes = atol(optarg);
+          break;
+
         case 'f':
           beFast = true;
           break;
@@ -260,6 +316,15 @@ int main(int argc, char **argv)
     }
   else if ( (optind + 1) == argc)
     {
+      bool use_libhfst = threads != 1 || cache_entries != 0 || cache_bytes != 0;
+#ifdef WINDOWS
+      if (use_libhfst && pipe_input)
+#else
+      if (use_libhfst)
+#endif
+        {
+          return setup_libhfst(argv[(optind)]);
+        }
       FILE * f = fopen(argv[(optind)], "rb");
       if (f == NULL)
         {
@@ -386,42 +451,6 @@ void TransducerAlphabet::get_next_symbol(FILE * f, SymbolNumber k)
   kt->operator[](k) = strdup(line);
 }
 
-void LetterTrie::add_string(const char * p, SymbolNumber symbol_key)
-{
-  if (*(p+1) == 0)
-    {
-      symbols[(unsigned char)(*p)] = symbol_key;
-      return;
-    }
-  if (letters[(unsigned char)(*p)] == NULL)
-    {
-      letters[(unsigned char)(*p)] = new LetterTrie();
-    }
-  letters[(unsigned char)(*p)]->add_string(p+1,symbol_key);
-}
-
-bool LetterTrie::has_key_starting_with(const char c) const
-{
-    return letters[(unsigned char) c] != NULL;
-}
-
-SymbolNumber LetterTrie::find_key(char ** p)
-{
-  const char * old_p = *p;
-  ++(*p);
-  if (letters[(unsigned char)(*old_p)] == NULL)
-    {
-      return symbols[(unsigned char)(*old_p)];
-    }
-  SymbolNumber s = letters[(unsigned char)(*old_p)]->find_key(p);
-  if (s == NO_SYMBOL_NUMBER)
-    {
-      --(*p);
-      return symbols[(unsigned char)(*old_p)];
-    }
-  return s;
-}
-
 void Encoder::read_input_symbols(KeyTable * kt)
 {
   for (SymbolNumber k = 0; k < number_of_input_symbols; ++k)
@@ -632,6 +661,102 @@ int setup(FILE * f)
   return 0;
 }
 
+/*
+  Print the analyses of one input as TransducerW::printAnalyses does.
+*/
+static void print_batch_analyses(const std::string & input,
+                                 const hfst::HfstOneLevelPaths & analyses)
+{
+  DisplayMultiMap display_map;
+  for (hfst::HfstOneLevelPaths::const_iterator it = analyses.begin();
+       it != analyses.end(); ++it)
+    {
+      std::string analysis;
+      for (hfst::StringVector::const_iterator sym = it->second.begin();
+           sym != it->second.end(); ++sym)
+        analysis.append(*sym);
+      display_map.insert(std::pair<Weight, std::string>(it->first, analysis));
+    }
+  print_weighted_analyses(input, display_map);
+}
+
+/*
+  Run the transducer in file filename on standard input using the
+  hfst_ol lookup of libhfst, looking up blocks of inputs in parallel
+  and caching results if asked to. Each thread has its own lookup state,
+  and the transducer tables are shared between them.
+*/
+int setup_libhfst(const char * filename)
+{
+  try {
+    hfst::HfstInputStream in(filename);
+    in.set_mmap_tables(true);
+    hfst::HfstTransducer t(in);
+    in.close();
+    hfst::ImplementationType type = t.get_type();
+    if (type != hfst::HFST_OL_TYPE && type != hfst::HFST_OLW_TYPE)
+      {
+        std::cerr << "The transducer must be in optimized lookup format.\n";
+        return EXIT_FAILURE;
+      }
+    if (cache_entries != 0 || cache_bytes != 0)
+      t.set_lookup_cache(cache_entries, cache_bytes);
+    // Someone typing or a client waiting for each reply must get the
+    // analyses of a line before the next line is read.
+#ifdef _MSC_VER
+    bool interactive = _isatty(_fileno(stdin)) != 0;
+#else
+    bool interactive = isatty(STDIN_FILENO) != 0;
+#endif
+    const size_t block_size = (interactive || threads == 1) ? 1 : 1024 * threads;
+    bool end_of_input = false;
+    while (!end_of_input)
+      {
+        hfst::StringVector inputs;
+        std::string line;
+        while (inputs.size() < block_size)
+          {
+            if (!std::getline(std::cin, line))
+              {
+                end_of_input = true;
+                break;
+              }
+            if (line.size() > 0 && line[line.size() - 1] == '\r')
+              line.erase(line.size() - 1);
+            inputs.push_back(line);
+          }
+        std::vector<hfst::HfstOneLevelPaths*> results =
+          t.lookup_fd_batch(inputs, threads, -1, time_cutoff);
+        for (size_t i = 0; i < inputs.size(); ++i)
+          {
+            if (echoInputsFlag)
+              {
+#ifdef WINDOWS
+                if (!pipe_output)
+                  hfst_fprintf_console(stdout, "%s\n", inputs[i].c_str());
+                else
+#endif
+                  std::cout << inputs[i] << std::endl;
+              }
+            print_batch_analyses(inputs[i], *results[i]);
+            delete results[i];
+          }
+        std::cout.flush();
+      }
+    if (verboseFlag && t.get_lookup_cache() != NULL)
+      std::cerr << "Cache hits: " << t.get_lookup_cache()->get_hits()
+                << ", misses: " << t.get_lookup_cache()->get_misses()
+                << std::endl;
+  }
+  catch (const HfstException & e)
+    {
+      std::cerr << "Could not read transducer from " << filename << ": "
+                << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  return 0;
+}
+
 /**
  * BEGIN old transducer.cc
  */
@@ -1641,9 +1766,14 @@ void TransducerWFdUniq::note_analysis(SymbolNumber * whole_output_string)
     }
 }
 
-void TransducerW::printAnalyses(std::string prepend)
+/*
+  Print analyses lightest first, at most maxAnalyses of them and only
+  those within beam of the lightest one.
+*/
+static void print_weighted_analyses(const std::string & prepend,
+                                    const DisplayMultiMap & analyses)
 {
-  if (outputType == xerox && display_map.size() == 0)
+  if (outputType == xerox && analyses.size() == 0)
     {
 #ifdef WINDOWS
       if (!pipe_output)
@@ -1663,10 +1793,10 @@ void TransducerW::printAnalyses(std::string prepend)
     }
   int i = 0;
   float lowest_weight = -1;
-  DisplayMultiMap::iterator it = display_map.begin();
-  while ( (it != display_map.end()) && (i < maxAnalyses))
+  DisplayMultiMap::const_iterator it = analyses.begin();
+  while ( (it != analyses.end()) && (i < maxAnalyses))
     {
-      if (it == display_map.begin())
+      if (it == analyses.begin())
         lowest_weight = it->first;
       // if beam is not set, i.e. has a negative value (-1.0), the only constraint
       // is maxAnalyses
@@ -1710,8 +1840,6 @@ void TransducerW::printAnalyses(std::string prepend)
       ++it;
       ++i;
     }
-  display_map.clear();
-
 #ifdef WINDOWS
   if (!pipe_output)
     hfst_fprintf_console(stdout, "\n");
@@ -1720,6 +1848,12 @@ void TransducerW::printAnalyses(std::string prepend)
     std::cout << std::endl;
 }
 
+void TransducerW::printAnalyses(std::string prepend)
+{
+  print_weighted_analyses(prepend, display_map);
+  display_map.clear();
+}
+
 void TransducerWUniq::printAnalyses(std::string prepend)
 {
   if (outputType == xerox && display_map.size() == 0)
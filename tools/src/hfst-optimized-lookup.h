@@ -49,6 +49,8 @@ const char * PACKAGE_STRING = "hfst-optimized-lookup 1.2";
 #include <string>
 #include <time.h>
 
+#include "implementations/optimized-lookup/letter-trie.h"
+
 enum OutputType {HFST, xerox};
 OutputType outputType = xerox;
 
@@ -289,27 +291,8 @@ public:
 
 };
 
-class LetterTrie;
-typedef std::vector<LetterTrie*> LetterTrieVector;
-
-class LetterTrie
-{
-private:
-    LetterTrieVector letters;
-    SymbolNumberVector symbols;
-
-public:
-    LetterTrie(void):
-        letters(UCHAR_MAX, (LetterTrie*) NULL),
-        symbols(UCHAR_MAX,NO_SYMBOL_NUMBER)
-        {}
-
-    void add_string(const char * p,SymbolNumber symbol_key);
-    bool has_key_starting_with(const char c) const;
-
-    SymbolNumber find_key(char ** p);
-
-};
+// The same flat byte trie as the library's optimized-lookup Encoder uses
+typedef hfst_ol::OlLetterTrie LetterTrie;
 
 class Encoder {
 
@@ -323,7 +306,7 @@ private:
 public:
     Encoder(KeyTable * kt, SymbolNumber input_symbol_count):
         number_of_input_symbols(input_symbol_count),
-        ascii_symbols(UCHAR_MAX,NO_SYMBOL_NUMBER)
+        ascii_symbols(UCHAR_MAX+1,NO_SYMBOL_NUMBER)
         {
             read_input_symbols(kt);
         }
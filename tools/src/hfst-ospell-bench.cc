@@ -0,0 +1,264 @@
+//! @file hfst-ospell-bench.cc
+//!
+//! @brief Spelling correction latency benchmark
+//!
+//! @author HFST Team
+
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, version 3 of the License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+
+#include "hfst-commandline.h"
+#include "hfst-program-options.h"
+#include "hfst-tool-metadata.h"
+#include "HfstTransducer.h"
+#include "HfstInputStream.h"
+#include "HfstExceptionDefs.h"
+#include "implementations/ConvertTransducerFormat.h"
+#include "implementations/optimized-lookup/transducer.h"
+
+#include "inc/globals-common.h"
+
+using hfst::HfstTransducer;
+using hfst::HfstInputStream;
+
+static char * errmodel_filename = NULL;
+static char * lexicon_filename = NULL;
+static int nbest = 0;
+static hfst_ol::Weight max_weight = -1.0;
+static hfst_ol::Weight beam = -1.0;
+static unsigned int rounds = 1;
+static bool print_corrections = false;
+
+void
+print_usage()
+{
+    // c.f. http://www.gnu.org/prep/standards/standards.html#g_t_002d_002dhelp
+    fprintf(message_out, "Usage: %s [OPTIONS...] ERRMODEL LEXICON\n"
+            "measure the latency of spelling correction\n"
+            "\n", program_name);
+    print_common_program_options(message_out);
+    fprintf(message_out,
+            "Benchmark options:\n"
+            "  -n, --nbest=N         Stop after the N best corrections\n"
+            "  -w, --max-weight=W    Discard corrections heavier than W\n"
+            "  -b, --beam=W          Discard corrections more than W heavier\n"
+            "                        than the best one\n"
+            "  -r, --rounds=N        Correct every word N times\n"
+            "  -c, --corrections     Print the corrections of each word\n");
+    fprintf(message_out,
+            "\n"
+            "Words are read from standard input, one per line. For each word\n"
+            "the number of corrections and the mean time taken to find them\n"
+            "are printed, followed by totals.\n"
+            "\n");
+    print_report_bugs();
+    fprintf(message_out, "\n");
+    print_more_info();
+    fprintf(message_out, "\n");
+}
+
+int
+parse_options(int argc, char** argv)
+{
+    extend_options_getenv(&argc, &argv);
+    // use of this function requires options are settable on global scope
+    while (true)
+    {
+        static const struct option long_options[] =
+        {
+          HFST_GETOPT_COMMON_LONG,
+          {"nbest", required_argument, 0, 'n'},
+          {"max-weight", required_argument, 0, 'w'},
+          {"beam", required_argument, 0, 'b'},
+          {"rounds", required_argument, 0, 'r'},
+          {"corrections", no_argument, 0, 'c'},
+          {0,0,0,0}
+        };
+        int option_index = 0;
+        int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT
+                             "n:w:b:r:c",
+                             long_options, &option_index);
+        if (-1 == c)
+        {
+            break;
+        }
+        switch (c)
+        {
+#include "inc/getopt-cases-common.h"
+        case 'n':
+            nbest = atoi(optarg);
+            if (nbest < 0)
+            {
+                std::cerr << "Invalid argument for --nbest\n";
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'w':
+            max_weight = hfst_strtoweight(optarg);
+            if (max_weight < 0.0)
+            {
+                std::cerr << "Invalid argument for --max-weight\n";
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'b':
+            beam = hfst_strtoweight(optarg);
+            if (beam < 0.0)
+            {
+                std::cerr << "Invalid argument for --beam\n";
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'r':
+            if (atoi(optarg) < 1)
+            {
+                std::cerr << "Invalid argument for --rounds\n";
+                return EXIT_FAILURE;
+            }
+            rounds = atoi(optarg);
+            break;
+        case 'c':
+            print_corrections = true;
+            break;
+#include "inc/getopt-cases-error.h"
+        }
+    }
+    if ((optind + 2) != argc)
+    {
+        std::cerr << "An error model and a lexicon must be given\n";
+        return EXIT_FAILURE;
+    }
+    errmodel_filename = hfst_strdup(argv[optind]);
+    lexicon_filename = hfst_strdup(argv[optind + 1]);
+    return EXIT_CONTINUE;
+}
+
+HfstTransducer * read_transducer(const char * filename)
+{
+    HfstInputStream in(filename);
+    HfstTransducer * t = new HfstTransducer(in);
+    in.close();
+    return t;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>
+        (std::chrono::steady_clock::now() - start).count();
+}
+
+int process_input(hfst_ol::Speller & speller, std::ostream & outstream)
+{
+    char * line = NULL;
+    size_t bufsize = 0;
+    size_t words = 0;
+    size_t corrections = 0;
+    double total_ms = 0.0;
+    double worst_ms = 0.0;
+    while (hfst_getline(&line, &bufsize, stdin) != -1)
+    {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n')
+        {
+            line[--len] = '\0';
+        }
+        if (len == 0)
+        {
+            continue;
+        }
+        hfst_ol::CorrectionQueue queue;
+        std::chrono::steady_clock::time_point start
+            = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < rounds; ++i)
+        {
+            queue = speller.correct(line, nbest, max_weight, beam);
+        }
+        double ms = elapsed_ms(start) / rounds;
+        ++words;
+        corrections += queue.size();
+        total_ms += ms;
+        if (ms > worst_ms)
+        {
+            worst_ms = ms;
+        }
+        outstream << line << "\t" << queue.size() << "\t" << ms << " ms\n";
+        if (print_corrections)
+        {
+            while (queue.size() > 0)
+            {
+                outstream << "\t" << queue.top().first << "\t"
+                          << queue.top().second << "\n";
+                queue.pop();
+            }
+        }
+    }
+    free(line);
+    outstream << "words: " << words << "\ncorrections: " << corrections
+              << "\ntotal: " << total_ms << " ms\n";
+    if (words > 0)
+    {
+        outstream << "mean: " << total_ms / words << " ms\n"
+                  << "worst: " << worst_ms << " ms\n";
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char ** argv)
+{
+    hfst_set_program_name(argv[0], "0.1", "HfstOspellBench");
+    hfst_setlocale();
+    int retval = parse_options(argc, argv);
+    if (retval != EXIT_CONTINUE)
+    {
+        return retval;
+    }
+    HfstTransducer * errmodel = NULL;
+    HfstTransducer * lexicon = NULL;
+    try
+    {
+        verbose_printf("Reading error model from %s...\n", errmodel_filename);
+        errmodel = read_transducer(errmodel_filename);
+        verbose_printf("Reading lexicon from %s...\n", lexicon_filename);
+        lexicon = read_transducer(lexicon_filename);
+        hfst_ol::Speller speller
+            (hfst::implementations::ConversionFunctions::
+             hfst_transducer_to_hfst_ol(errmodel),
+             hfst::implementations::ConversionFunctions::
+             hfst_transducer_to_hfst_ol(lexicon));
+        retval = process_input(speller, std::cout);
+    }
+    catch (const HfstException & e)
+    {
+        std::cerr << program_name << ": " << e.what() << std::endl;
+        retval = EXIT_FAILURE;
+    }
+    delete errmodel;
+    delete lexicon;
+    free(errmodel_filename);
+    free(lexicon_filename);
+    return retval;
+}
@@ -42,6 +42,7 @@ using std::pair;
 #  include "hfst-string-conversions.h"
 #else
 #  include <getopt.h>
+#  include <unistd.h>
 #endif
 
 #ifdef HAVE_READLINE
@@ -98,6 +99,7 @@ static int max_context = -1;
 static double time_cutoff = 0.0;
 static hfst_ol::Weight weight_cutoff = hfst_ol::INFINITE_WEIGHT;
 static bool profile = false;
+static unsigned int threads = 1;
 
 void
 print_usage()
@@ -121,7 +123,8 @@ print_usage()
             "      --max-recursion     Upper limit for recursion\n"
             "      --weight-cutoff=W   Upper limit for allowed weight\n"
             "  -t, --time-cutoff=S     Limit search after having used S seconds per input\n"
-            "  -p  --profile           Produce profiling data\n");
+            "  -p  --profile           Produce profiling data\n"
+            "  -j, --threads=N         Match inputs in N parallel threads (0 for one per core)\n");
     fprintf(message_out,
             "Use standard streams for input and output.\n"
             "\n"
@@ -181,9 +184,85 @@ void match_and_print(hfst_ol::PmatchContainer & container,
 }
 
 
+void print_summary(hfst_ol::PmatchContainer & container,
+                   std::ostream & outstream)
+{
+    if (count_patterns == on) {
+        outstream << "\n" << container.get_pattern_count_info() << "\n";
+    }
+    if (profile) {
+        outstream << "\n" << container.get_profiling_info() << "\n";
+    }
+}
+
+#ifndef _MSC_VER
+void match_and_print_job(hfst_ol::PmatchContainer & container,
+                         const std::string & input,
+                         std::ostream & outstream)
+{
+    std::string input_text(input);
+    match_and_print(container, outstream, input_text);
+}
+
+// Match a block of inputs in parallel and print the results in input order
+void match_and_print_block(hfst_ol::PmatchParallelMatcher & matcher,
+                           vector<string> & inputs,
+                           std::ostream & outstream)
+{
+    vector<string> outputs = matcher.run(inputs, match_and_print_job);
+    for (vector<string>::const_iterator it = outputs.begin();
+         it != outputs.end(); ++it) {
+        outstream << *it;
+    }
+    inputs.clear();
+}
+
+int process_input_threaded(hfst_ol::PmatchContainer & container,
+                           std::ostream & outstream)
+{
+    hfst_ol::PmatchParallelMatcher matcher(container, threads);
+    const size_t block_size = 1024 * matcher.get_threads();
+    vector<string> inputs;
+    std::string input_text;
+    char * line = NULL;
+    size_t len = 0;
+    while (hfst_getline(&line, &len, stdin) > 0) {
+        if (!blankline_separated) {
+            inputs.push_back(line);
+        } else if (line[0] == '\n') {
+            inputs.push_back(input_text);
+            input_text.clear();
+        } else {
+            input_text.append(line);
+        }
+        free(line);
+        line = NULL;
+        if (inputs.size() >= block_size) {
+            match_and_print_block(matcher, inputs, outstream);
+        }
+    }
+    if (blankline_separated && !input_text.empty()) {
+        inputs.push_back(input_text);
+    }
+    match_and_print_block(matcher, inputs, outstream);
+    // Pattern counts and profiling data were collected by the
+    // per-thread matchers
+    matcher.merge_counts_into(container);
+    print_summary(container, outstream);
+    return EXIT_SUCCESS;
+}
+#endif
+
 int process_input(hfst_ol::PmatchContainer & container,
                   std::ostream & outstream)
 {
+#ifndef _MSC_VER
+    // blocks are printed only once they are full, so a terminal is read
+    // line by line
+    if (threads != 1 && !isatty(STDIN_FILENO)) {
+        return process_input_threaded(container, outstream);
+    }
+#endif
     std::string input_text;
     char * line = NULL;
     size_t len = 0;
@@ -253,12 +332,7 @@ int process_input(hfst_ol::PmatchContainer & container,
     if (blankline_separated && !input_text.empty()) {
         match_and_print(container, outstream, input_text);
     }
-    if (count_patterns == on) {
-        outstream << "\n" << container.get_pattern_count_info() << "\n";
-    }
-    if (profile) {
-        outstream << "\n" << container.get_profiling_info() << "\n";
-    }
+    print_summary(container, outstream);
     return EXIT_SUCCESS;
 }
 
@@ -285,10 +359,11 @@ int parse_options(int argc, char** argv)
                 {"weight-cutoff", required_argument, 0, 'W'},
                 {"time-cutoff", required_argument, 0, 't'},
                 {"profile", no_argument, 0, 'p'},
+                {"threads", required_argument, 0, 'j'},
                 {0,0,0,0}
             };
         int option_index = 0;
-        int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT HFST_GETOPT_UNARY_SHORT "nxlwcdmb:r:W:t:p",
+        int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT HFST_GETOPT_UNARY_SHORT "nxlwcdmb:r:W:t:pj:",
                             long_options, &option_index);
         if (-1 == c)
         {
@@ -355,6 +430,14 @@ int parse_options(int argc, char** argv)
         case 'p':
             profile = true;
             break;
+        case 'j':
+            if (atoi(optarg) < 0)
+            {
+                std::cerr << "Invalid argument for --threads\n";
+                return EXIT_FAILURE;
+            }
+            threads = atoi(optarg);
+            break;
 #include "inc/getopt-cases-error.h"
         }
         
@@ -29,94 +29,13 @@
 
 
 
-//////////Function definitions for LetterTrie
-
-bool
-LetterTrie::has_symbol_0() const
-{
-  for(size_t i=0;i<symbols.size();i++)
-  {
-    if(symbols[i] == 0)
-      return true;
-  }
-  for(size_t i=0;i<letters.size();i++)
-  {
-    if(letters[i] != NULL && letters[i]->has_symbol_0())
-      return true;
-  }
-  return false;
-}
-
-void
-LetterTrie::add_string(const char * p, SymbolNumber symbol_key)
-{
-  if (*(p+1) == 0)
-  {
-    symbols[(unsigned char)(*p)] = symbol_key;
-    return;
-  }
-
-  if (letters[(unsigned char)(*p)] == NULL)
-    letters[(unsigned char)(*p)] = new LetterTrie();
-  letters[(unsigned char)(*p)]->add_string(p+1,symbol_key);
-}
-
-SymbolNumber
-LetterTrie::find_symbol(const char* c) const
-{
-  if(strlen(c) == 1)
-    return symbols[(unsigned char)(c[0])];
-  
-  if(letters[(unsigned char)(c[0])] == NULL)
-    return NO_SYMBOL_NUMBER;
-  else
-    return letters[(unsigned char)(c[0])]->find_symbol(c+1);
-}
-
-SymbolNumber
-LetterTrie::extract_symbol(std::istream& is) const
-{
-  int c = is.get();
-  if(c == EOF)
-    return 0;
-    
-  if(letters[c] == NULL)
-  {
-    if(symbols[c] == NO_SYMBOL_NUMBER)
-      is.putback(c);
-    return symbols[c];
-  }
-  
-  SymbolNumber s = letters[c]->extract_symbol(is);
-  if(s == NO_SYMBOL_NUMBER)
-  {
-    if(symbols[c] == NO_SYMBOL_NUMBER)
-      is.putback(c);
-    return symbols[c];
-  }
-  return s;
-}
-
-
 //////////Function definitions for Symbolizer
 
 void
 Symbolizer::add_symbol(const std::string& symbol_str)
 {
-  std::string p = symbol_str;
-  
-  if(p.length() > 0)
-  {
-    unsigned char first = p.at(0);
-    if(ascii_symbols[first] != 0)
-    { // if the symbol's first character is ASCII and we're not ignoring it yet
-      if(p.length() == 1)
-        ascii_symbols[first] = symbol_count;
-      else
-        ascii_symbols[first] = 0;
-    }
-    letters.add_string(p.c_str(),symbol_count);
-  }
+  if(symbol_str.length() > 0)
+    letters.add_string(symbol_str.c_str(),symbol_count);
   symbol_count++;
 }
 
@@ -130,26 +49,40 @@ Symbolizer::add_symbols(const SymbolTable& st)
 SymbolNumber
 Symbolizer::find_symbol(const char* c) const
 {
-  if(c[0] == 0)
-    return NO_SYMBOL_NUMBER;
-  if(strlen(c) > 1 ||
-     ascii_symbols[(unsigned char)(c[0])] == NO_SYMBOL_NUMBER ||
-     ascii_symbols[(unsigned char)(c[0])] == 0)
-    return letters.find_symbol(c);
-  return ascii_symbols[(unsigned char)(c[0])];
+  return letters.find_string(c);
 }
 
 SymbolNumber
-Symbolizer::extract_symbol(std::istream& is) const
+Symbolizer::extract_symbol(InputBuffer& in) const
 {
-  int c = is.peek();
+  int c = in.peek();
+  if(c == EOF)
+    return 0;
   if(c == 0)
     return NO_SYMBOL_NUMBER;
-  if(ascii_symbols[c] == NO_SYMBOL_NUMBER ||
-     ascii_symbols[c] == 0)
-    return letters.extract_symbol(is);
   
-  return ascii_symbols[is.get()];
+  // walk the trie as far as the input goes, remembering the longest symbol
+  hfst_ol::OlLetterTrie::Node node = letters.step(hfst_ol::OlLetterTrie::ROOT, c);
+  SymbolNumber symbol = letters.symbol(node);
+  size_t length = 1;
+  for(size_t i=1; letters.has_children(node); i++)
+  {
+    c = in.peek(i);
+    if(c == EOF)
+      break;
+    node = letters.step(node, c);
+    if(node == hfst_ol::OlLetterTrie::NO_NODE)
+      break;
+    if(letters.symbol(node) != NO_SYMBOL_NUMBER)
+    {
+      symbol = letters.symbol(node);
+      length = i+1;
+    }
+  }
+  
+  if(symbol != NO_SYMBOL_NUMBER)
+    in.skip(length);
+  return symbol;
 }
 
 
@@ -623,8 +556,17 @@ std::string
 ProcTransducerAlphabet::symbols_to_string(const SymbolNumberVector& symbols, CapitalizationState caps) const
 {
   std::string str="";
+  append_symbols(symbols.begin(), symbols.end(), caps, str);
+  return str;
+}
+
+void
+ProcTransducerAlphabet::append_symbols(SymbolNumberVector::const_iterator begin,
+                                       SymbolNumberVector::const_iterator end,
+                                       CapitalizationState caps, std::string& str) const
+{
   bool first=true;
-  for(SymbolNumberVector::const_iterator it=symbols.begin(); it!=symbols.end(); it++, first=false)
+  for(SymbolNumberVector::const_iterator it=begin; it!=end; it++, first=false)
   {
       if(!is_tag(*it) && escaped_symbols.find(*it) != escaped_symbols.end()) {
           str += "\\";
@@ -635,7 +577,6 @@ ProcTransducerAlphabet::symbols_to_string(const SymbolNumberVector& symbols, Cap
           str += symbol_to_string(*it);
       }
   }
-  return str;
 }
 
 bool
@@ -681,7 +622,7 @@ bool ProcTransducerAlphabet::is_space(const char* c) const
 bool
 ProcTransducerAlphabet::is_tag(SymbolNumber symbol) const
 {
-  std::string str = symbol_to_string(symbol);
+  const std::string& str = symbol_to_string(symbol);
   if(str[0] == '<' && str[str.length()-1] == '>')
     return true;
   // Added a test for GT-style tags, ie tags starting with + and ending with
@@ -696,7 +637,7 @@ bool /* @@@ */
 ProcTransducerAlphabet::is_compound_boundary(SymbolNumber symbol) const
 {
 extern bool processCompounds ;
-  std::string s = symbol_to_string(symbol);
+  const std::string& s = symbol_to_string(symbol);
   if(!processCompounds)
     return false;
 
@@ -19,74 +19,30 @@
 
 #include "hfst-proc.h"
 
-class LetterTrie;
-typedef std::vector<LetterTrie*> LetterTrieVector;
-class Symbolizer;
+class InputBuffer;
 
 extern bool processCompounds ;
 
-class LetterTrie
-{
- private:
-  LetterTrieVector letters;
-  SymbolNumberVector symbols;
-  
-  /**
-   * Whether our symbols vector or that of any of our children contains
-   * symbol number 0
-   */
-  bool has_symbol_0() const;
- public:
-  LetterTrie(void):
-    letters(std::numeric_limits<unsigned char>::max(), (LetterTrie*) NULL),
-    symbols(std::numeric_limits<unsigned char>::max(),NO_SYMBOL_NUMBER)
-  {}
-  
-  LetterTrie(const LetterTrie& o): letters(), symbols(o.symbols)
-  {
-    for(LetterTrieVector::const_iterator it=o.letters.begin(); it!=o.letters.end(); it++)
-      letters.push_back(((*it)==NULL) ? NULL : new LetterTrie(*(*it)));
-  }
-  
-  ~LetterTrie()
-  {
-    for(LetterTrieVector::iterator it=letters.begin(); it!=letters.end(); it++)
-      delete *it;
-  }
-
-  void add_string(const char * p,SymbolNumber symbol_key);
-
-  SymbolNumber find_symbol(const char* c) const;
-  
-  /**
-   * Read the next symbol from the stream. If the next character(s) do not form
-   * a symbol, this version will put the characters back, so the stream is in
-   * the same condition it was when this function was called
-   * @return the number of the symbol, 0 for EOF, or NO_SYMBOL_NUMBER
-   */
-  SymbolNumber extract_symbol(std::istream& is) const;
-  
-  friend class Symbolizer;
-};
-
+/**
+ * Turns strings and input into symbol numbers, using the same flat byte trie
+ * as the optimized-lookup library. Single-byte symbols that don't begin a
+ * longer symbol are found with one array lookup
+ */
 class Symbolizer
 {
  private:
-  LetterTrie letters;
-  SymbolNumberVector ascii_symbols;
+  hfst_ol::OlLetterTrie letters;
   
   SymbolNumber symbol_count;
 
  public:
-  Symbolizer(): letters(),
-    ascii_symbols(std::numeric_limits<unsigned char>::max(),NO_SYMBOL_NUMBER),
-    symbol_count(0) {}
+  Symbolizer(): letters(), symbol_count(0) {}
   Symbolizer(const SymbolTable& st):
-    letters(), ascii_symbols(std::numeric_limits<unsigned char>::max(),NO_SYMBOL_NUMBER), symbol_count(0)
+    letters(), symbol_count(0)
   {
     add_symbols(st);
     
-    if(letters.has_symbol_0())
+    if(letters.has_symbol(0))
     {
       std::cerr << "!! Warning: the letter trie contains references to symbol  !!\n"
                 << "!! number 0. This is almost certainly a bug and could      !!\n"
@@ -98,7 +54,13 @@ class Symbolizer
   void add_symbols(const SymbolTable& st);
   
   SymbolNumber find_symbol(const char *c) const;
-  SymbolNumber extract_symbol(std::istream& is) const;
+  
+  /**
+   * Read the longest symbol at the front of the input. If the next
+   * character(s) do not form a symbol, nothing is read
+   * @return the number of the symbol, 0 for EOF, or NO_SYMBOL_NUMBER
+   */
+  SymbolNumber extract_symbol(InputBuffer& in) const;
 };
 
 
@@ -230,9 +192,18 @@ class ProcTransducerAlphabet : public TransducerAlphabet
   bool is_compound_boundary(SymbolNumber symbol) const;
   int num_compound_boundaries(const SymbolNumberVector& symbols) const;
   
-  std::string symbol_to_string(SymbolNumber symbol) const
+  const std::string& symbol_to_string(SymbolNumber symbol) const
   {return symbol_table[symbol];}
   
+  /**
+   * Append the string representation of the symbols in [begin, end) to str,
+   * without building a temporary string. The case is modified as in
+   * symbols_to_string
+   */
+  void append_symbols(SymbolNumberVector::const_iterator begin,
+                      SymbolNumberVector::const_iterator end,
+                      CapitalizationState caps, std::string& str) const;
+  
   /**
    * Use the symbol table to convert the given symbols into a string, optionally
    * modifying the case of some symbols
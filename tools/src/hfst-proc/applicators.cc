@@ -112,12 +112,13 @@ AnalysisApplicator::apply()
       LookupPathSet finals = state.get_finals_set();
       if (caps_mode == DictionaryCase || caps_mode == CaseSensitiveDictionaryCase)
       {
-        analyzed_forms = formatter.process_finals(finals, Unknown);
+        formatter.process_finals(finals, Unknown, analyzed_forms);
       }
       else
       {
-        analyzed_forms = formatter.process_finals(finals,
-                              token_stream.get_capitalization_state(surface_form));
+        formatter.process_finals(finals,
+                                 token_stream.get_capitalization_state(surface_form),
+                                 analyzed_forms);
       }
       last_stream_location = token_stream.get_pos()-1;
 
@@ -11,9 +11,20 @@
 //       along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm>
-#include <sstream>
+#include <cstdio>
 #include "formatter.h"
 
+/**
+ * Append a weight to the string in the same form as writing it to an ostream
+ * with the default formatting would give
+ */
+static void append_weight(std::string& str, Weight weight)
+{
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%g", weight);
+  str += buffer;
+}
+
 //////////Function definitions for OutputFormatter
 
 TokenVector
@@ -120,22 +131,25 @@ OutputFormatter::preprocess_finals(const LookupPathSet& finals) const
 
 //////////Function definitions for TransliterateOutputFormatter
 
-ProcResult
-TransliterateOutputFormatter::process_finals(const LookupPathSet& finals, CapitalizationState caps) const
+void
+TransliterateOutputFormatter::process_finals(const LookupPathSet& finals, CapitalizationState caps,
+                                             ProcResult& results) const
 {
-  ProcResult results;
+  results.clear();
   LookupPathSet new_finals = preprocess_finals(finals);
 
   for(LookupPathSet::const_iterator it=new_finals.begin(); it!=new_finals.end(); it++)
   {
-    std::ostringstream res;
-    res << token_stream.get_alphabet().symbols_to_string((*it)->get_output_symbols(), caps);
+    std::string& res = results.add();
+    const SymbolNumberVector& symbols = (*it)->get_output_symbols();
+    token_stream.get_alphabet().append_symbols(symbols.begin(), symbols.end(), caps, res);
     if(dynamic_cast<const LookupPathW*>(*it) != NULL && displayWeightsFlag)
-      res << '~' << dynamic_cast<const LookupPathW*>(*it)->get_weight() << '~';
-
-    results.push_back(res.str());
+    {
+      res += '~';
+      append_weight(res, dynamic_cast<const LookupPathW*>(*it)->get_weight());
+      res += '~';
+    }
   }
-  return results;
 }
 
 void
@@ -190,22 +204,24 @@ TransliterateOutputFormatter::print_unknown_word(const TokenVector& surface_form
 
 //////////Function definitions for ApertiumOutputFormatter
 
-ProcResult
-ApertiumOutputFormatter::process_finals(const LookupPathSet& finals, CapitalizationState caps) const
+void
+ApertiumOutputFormatter::process_finals(const LookupPathSet& finals, CapitalizationState caps,
+                                        ProcResult& results) const
 {
-  ProcResult results;
+  results.clear();
   LookupPathSet new_finals = preprocess_finals(finals);
 
   for(LookupPathSet::const_iterator it=new_finals.begin(); it!=new_finals.end(); it++)
   {
-    std::ostringstream res;
-    res << token_stream.get_alphabet().symbols_to_string((*it)->get_output_symbols(), caps);
+    std::string& res = results.add();
+    const SymbolNumberVector& symbols = (*it)->get_output_symbols();
+    token_stream.get_alphabet().append_symbols(symbols.begin(), symbols.end(), caps, res);
     if (dynamic_cast<const LookupPathW *>(*it) != NULL && displayWeightsFlag) {
-      res << '~' << dynamic_cast<const LookupPathW *>(*it)->get_weight() << '~';
+      res += '~';
+      append_weight(res, dynamic_cast<const LookupPathW *>(*it)->get_weight());
+      res += '~';
     }
-    results.push_back(res.str());
   }
-  return results;
 }
 
 ////////
@@ -258,13 +274,13 @@ ApertiumOutputFormatter::print_unknown_word(const TokenVector& surface_form) con
 
 //////////Function definitions for CGOutputFormatter
 
-std::string
-CGOutputFormatter::process_final(const SymbolNumberVector& symbols, CapitalizationState caps) const
+void
+CGOutputFormatter::process_final(const SymbolNumberVector& symbols, CapitalizationState caps,
+                                 std::string& res) const
 {
-  std::ostringstream res;
   size_t start_pos = 0;
 
-  res << '"'; // before start of lexical form
+  res += '"'; // before start of lexical form
 
   while(start_pos < symbols.size())
   {
@@ -278,7 +294,7 @@ CGOutputFormatter::process_final(const SymbolNumberVector& symbols, Capitalizati
 
       if(compound_split == symbols.size())
       {
-        std::string s = token_stream.get_alphabet().symbol_to_string(symbols[i]);
+        const std::string& s = token_stream.get_alphabet().symbol_to_string(symbols[i]);
         if(s == "#" || s == "+" || s[s.length()-1] == '+')
           compound_split = i;
       }
@@ -289,66 +305,66 @@ CGOutputFormatter::process_final(const SymbolNumberVector& symbols, Capitalizati
 
     // grab the base form without tags
     size_t end = (compound_split < tag_start ? compound_split : tag_start);
-    res << token_stream.get_alphabet().symbols_to_string(
-      SymbolNumberVector(symbols.begin()+start_pos,symbols.begin()+end), caps);
+    token_stream.get_alphabet().append_symbols(
+      symbols.begin()+start_pos, symbols.begin()+end, caps, res);
 
     // look for compounding. Don't output the tags for non-final segments
     if(compound_split != symbols.size())
     {
-      res << "#";
+      res += '#';
       start_pos = compound_split+1;
     }
     else
     {
-      res << '"'; // after end of lexical form, now come any tags
+      res += '"'; // after end of lexical form, now come any tags
       if(tag_start != symbols.size())
       {
         for(size_t i=tag_start; i<symbols.size(); i++)
         {
-          std::string tag = token_stream.get_alphabet().symbol_to_string(symbols[i]);
+          const std::string& tag = token_stream.get_alphabet().symbol_to_string(symbols[i]);
+          size_t from = 0;
+          size_t to = tag.size();
           // remove the < and > around Apertium tags
-          if(tag.size() > 0 && tag[0] == '<')
+          if(to > from && tag[from] == '<')
           {
-            tag = tag.substr(1);
-            if(tag.size() > 0 && tag[tag.length()-1] == '>')
-              tag = tag.substr(0,tag.length()-1);
+            from++;
+            if(to > from && tag[to-1] == '>')
+              to--;
           }
           // remove the + in front of GT/Divvun tags:
-          if(tag.size() > 0 && tag[0] == '+')
+          if(to > from && tag[from] == '+')
           {
-            tag = tag.substr(1);
+            from++;
           }
 
-          res << (i==tag_start?"\t":" ") << tag;
+          res += (i==tag_start ? '\t' : ' ');
+          res.append(tag, from, to-from);
         }
       }
       // When -r option is given, print the full analysis string as well
       // (as a specially prefixed tag):
       if(displayRawAnalysisInCG)
       {
-        res << " " << "∏" << '"';
-        res << token_stream.get_alphabet().symbols_to_string(
-          SymbolNumberVector(symbols.begin()+0,symbols.begin()+symbols.size()), caps);
-        res << '"';
+        res += " ∏\"";
+        token_stream.get_alphabet().append_symbols(
+          symbols.begin(), symbols.end(), caps, res);
+        res += '"';
       }
 
       break;
     }
   }
-
-  return res.str();
 }
 
-ProcResult
-CGOutputFormatter::process_finals(const LookupPathSet& finals, CapitalizationState caps) const
+void
+CGOutputFormatter::process_finals(const LookupPathSet& finals, CapitalizationState caps,
+                                  ProcResult& results) const
 {
-  ProcResult results;
+  results.clear();
   LookupPathSet new_finals = preprocess_finals(finals);
 
   for(LookupPathSet::const_iterator it=new_finals.begin(); it!=new_finals.end(); it++)
-    results.push_back(process_final((*it)->get_output_symbols(), caps));
-
-  return results;
+    process_final((*it)->get_output_symbols(), caps, results.add());
 }
 
 void
@@ -374,22 +390,24 @@ CGOutputFormatter::print_unknown_word(const TokenVector& surface_form) const
 
 //////////Function definitions for XeroxOutputFormatter
 
-ProcResult
-XeroxOutputFormatter::process_finals(const LookupPathSet& finals, CapitalizationState caps) const
+void
+XeroxOutputFormatter::process_finals(const LookupPathSet& finals, CapitalizationState caps,
+                                     ProcResult& results) const
 {
-  ProcResult results;
+  results.clear();
   LookupPathSet new_finals = preprocess_finals(finals);
 
   for(LookupPathSet::const_iterator it=new_finals.begin(); it!=new_finals.end(); it++)
   {
-    std::ostringstream res;
-    res << token_stream.get_alphabet().symbols_to_string((*it)->get_output_symbols(), caps);
+    std::string& res = results.add();
+    const SymbolNumberVector& symbols = (*it)->get_output_symbols();
+    token_stream.get_alphabet().append_symbols(symbols.begin(), symbols.end(), caps, res);
     if(dynamic_cast<const LookupPathW*>(*it) != NULL && displayWeightsFlag)
-      res << "\t" << dynamic_cast<const LookupPathW*>(*it)->get_weight();
-
-    results.push_back(res.str());
+    {
+      res += '\t';
+      append_weight(res, dynamic_cast<const LookupPathW*>(*it)->get_weight());
+    }
   }
-  return results;
 }
 
 void
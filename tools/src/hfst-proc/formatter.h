@@ -16,7 +16,39 @@
 #include "lookup-path.h"
 #include "tokenizer.h"
 
-typedef std::vector<std::string> ProcResult;
+/**
+ * The analyses of one surface form as strings ready to be written out. The
+ * strings are kept when the result is cleared, so filling the same result
+ * again for the next word reuses their memory instead of allocating
+ */
+class ProcResult
+{
+  std::vector<std::string> forms;
+  size_t count;
+ public:
+  typedef std::vector<std::string>::const_iterator const_iterator;
+  
+  ProcResult(): forms(), count(0) {}
+  
+  void clear() {count = 0;}
+  size_t size() const {return count;}
+  
+  /**
+   * Add an empty analysis to the end of the result
+   * @return the string to write the analysis into
+   */
+  std::string& add()
+  {
+    if(count == forms.size())
+      forms.push_back(std::string());
+    std::string& form = forms[count++];
+    form.clear();
+    return form;
+  }
+  
+  const_iterator begin() const {return forms.begin();}
+  const_iterator end() const {return forms.begin()+count;}
+};
 
 /**
  * Abstract base class for handling the outputting of lookup results. Subclasses
@@ -54,9 +86,12 @@ class OutputFormatter
    * string representations of the paths that can be written to the output
    * @param finals a list of lookup paths ending in final states
    * @param state the capitalization of the surface form
+   * @param results where the strings are written. Anything already in it is
+   *                cleared first
    */
-  virtual ProcResult process_finals(const LookupPathSet& finals,
-                                                  CapitalizationState state) const = 0;
+  virtual void process_finals(const LookupPathSet& finals,
+                              CapitalizationState state,
+                              ProcResult& results) const = 0;
   virtual void print_word(const TokenVector& surface_form,
                           ProcResult const &analyzed_forms) const = 0;
   virtual void print_unknown_word(const TokenVector& surface_form) const = 0;
@@ -73,8 +108,8 @@ class TransliterateOutputFormatter: public OutputFormatter
  public:
   TransliterateOutputFormatter(TokenIOStream& s, bool f): OutputFormatter(s,f) {}
   
-  ProcResult process_finals(const LookupPathSet& finals,
-                                          CapitalizationState state) const;
+  void process_finals(const LookupPathSet& finals,
+                      CapitalizationState state, ProcResult& results) const;
   void print_word(const TokenVector& surface_form,
                   ProcResult const &analyzed_forms) const;
   void print_unknown_word(const TokenVector& surface_form) const;
@@ -87,8 +122,8 @@ class ApertiumOutputFormatter: public OutputFormatter
  public:
   ApertiumOutputFormatter(TokenIOStream& s, bool f): OutputFormatter(s,f) {}
   
-  ProcResult process_finals(const LookupPathSet& finals,
-                                          CapitalizationState state) const;
+  void process_finals(const LookupPathSet& finals,
+                      CapitalizationState state, ProcResult& results) const;
   void print_word(const TokenVector& surface_form,
                   ProcResult const &analyzed_forms) const;
   void print_unknown_word(const TokenVector& surface_form) const;
@@ -98,12 +133,13 @@ class ApertiumOutputFormatter: public OutputFormatter
 
 class CGOutputFormatter: public OutputFormatter
 {
-  std::string process_final(const SymbolNumberVector& symbols, CapitalizationState caps) const;
+  void process_final(const SymbolNumberVector& symbols, CapitalizationState caps,
+                     std::string& res) const;
  public:
   CGOutputFormatter(TokenIOStream& s, bool f): OutputFormatter(s,f) {}
   
-  ProcResult process_finals(const LookupPathSet& finals,
-                                          CapitalizationState caps) const;
+  void process_finals(const LookupPathSet& finals,
+                      CapitalizationState caps, ProcResult& results) const;
   void print_word(const TokenVector& surface_form,
                   ProcResult const &analyzed_forms) const;
   void print_unknown_word(const TokenVector& surface_form) const;
@@ -117,8 +153,8 @@ class XeroxOutputFormatter: public OutputFormatter
  public:
   XeroxOutputFormatter(TokenIOStream& s, bool f): OutputFormatter(s,f) {}
   
-  ProcResult process_finals(const LookupPathSet& finals,
-                                          CapitalizationState state) const;
+  void process_finals(const LookupPathSet& finals,
+                      CapitalizationState state, ProcResult& results) const;
   void print_word(const TokenVector& surface_form,
                   ProcResult const &analyzed_forms) const;
   void print_unknown_word(const TokenVector& surface_form) const;
@@ -22,6 +22,8 @@
 
 #include <fstream>
 #include <cstdlib>
+#include <chrono>
+#include <streambuf>
 #include "hfst-proc.h"
 #include "transducer.h"
 #include "formatter.h"
@@ -98,6 +100,42 @@ void stream_error(const char* e)
 }
 void stream_error(std::string e) {stream_error(e.c_str());}
 
+/**
+ * An input buffer that reads another stream buffer in blocks of whatever is
+ * available and keeps count of the bytes read, for measuring the throughput
+ * with --throughput
+ */
+class CountingStreambuf: public std::streambuf
+{
+  std::streambuf* source;
+  char buffer[65536];
+  size_t count;
+ protected:
+  int_type underflow()
+  {
+    if(gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+    // wait for one byte, then take as many as are there without waiting,
+    // so that a client on a pipe gets its answer before sending more
+    if(source->sgetc() == traits_type::eof())
+      return traits_type::eof();
+    std::streamsize available = source->in_avail();
+    if(available < 1)
+      available = 1;
+    if(available > (std::streamsize)sizeof(buffer))
+      available = sizeof(buffer);
+    std::streamsize n = source->sgetn(buffer, available);
+    if(n <= 0)
+      return traits_type::eof();
+    count += n;
+    setg(buffer, buffer, buffer+n);
+    return traits_type::to_int_type(*gptr());
+  }
+ public:
+  CountingStreambuf(std::streambuf* s): source(s), count(0) {}
+  size_t bytes_read() const {return count;}
+};
+
 
 bool print_usage(void)
 {
@@ -137,6 +175,8 @@ bool print_usage(void)
     "  -h, --help              Print this help message\n" <<
     "  -X, --raw               Do not perform any mangling to:\n"
     "                          case, ``superblanks'' or anything else!!!\n"
+    "  -b, --throughput        Print the number of bytes read and the time taken\n"
+    "                          to standard error when done\n"
     "\n" <<
 #ifdef HAVE_CONFIG_H
     "Report bugs to " << PACKAGE_BUGREPORT << "\n" <<
@@ -172,6 +212,7 @@ int main(int argc, char **argv)
   int capitalization = 0;
   bool filter_compound_analyses = true;
   bool null_flush = false;
+  bool measure_throughput = false;
   
   while (true)
   {
@@ -204,11 +245,12 @@ int main(int argc, char **argv)
       {"dictionary-case",no_argument,       0, 'w'},
       {"null-flush",     no_argument,       0, 'z'},
       {"raw",            no_argument,       0, 'X'},
+      {"throughput",     no_argument,       0, 'b'},
       {0,                0,                 0,  0 }
     };
     
     int option_index = 0;
-    int c = getopt_long(argc, argv, "hVvqjsagndtpxCkeWrN:l:cwzX", long_options, &option_index);
+    int c = getopt_long(argc, argv, "hVvqjsagndtpxCkeWrN:l:cwzXb", long_options, &option_index);
 
     if (c == -1) // no more options to look at
       break;
@@ -322,6 +364,10 @@ int main(int argc, char **argv)
       null_flush = true;
       break;
       
+    case 'b':
+      measure_throughput = true;
+      break;
+      
     default:
       std::cerr << "Invalid option\n\n";
       print_short_help();
@@ -428,8 +474,10 @@ int main(int argc, char **argv)
     if(verboseFlag)
       std::cout << "Transducer successfully loaded" << std::endl;
     in.close();
-    TokenIOStream token_stream(*input, *output, t.get_alphabet(), null_flush,
-                               rawMode);
+    CountingStreambuf counting_buffer(input->rdbuf());
+    std::istream counted_input(&counting_buffer);
+    TokenIOStream token_stream(measure_throughput ? counted_input : *input,
+                               *output, t.get_alphabet(), null_flush, rawMode);
     Applicator* applicator = NULL;
     OutputFormatter* output_formatter = NULL;
     switch(cmd)
@@ -466,7 +514,20 @@ int main(int argc, char **argv)
         break;
     }
     
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     applicator->apply();
+    if(measure_throughput)
+    {
+      output->flush();
+      double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+      size_t bytes = counting_buffer.bytes_read();
+      std::cerr << "hfst-proc: read " << bytes << " bytes in " << seconds
+                << " s";
+      if(seconds > 0)
+        std::cerr << ", " << bytes/seconds/1e6 << " MB/s";
+      std::cerr << std::endl;
+    }
     
     delete applicator;
     if(output_formatter != NULL)
@@ -32,6 +32,7 @@
 using namespace hfst_ol;
 
 class LookupPath;
+class LookupPathPool;
 
 /**
  * A list of pointers to lookup paths. They are pointers for the sake of
@@ -55,7 +55,16 @@ class LookupPath
   
   virtual ~LookupPath() {}
   
-  virtual LookupPath* clone() const {return new LookupPath(*this);}
+  /**
+   * Make this path a copy of the given path in the same transducer, reusing
+   * the memory already allocated for the output symbols
+   */
+  void assign(const LookupPath& o)
+  {
+    index = o.index;
+    final = o.final;
+    output_symbols = o.output_symbols;
+  }
   
   /**
    * Follow the transition index, modifying our index
@@ -100,6 +109,8 @@ class PathFd
     fd_state(table) {}
   PathFd(const PathFd& o): fd_state(o.fd_state) {}
   virtual ~PathFd() {}
+  
+  void assign(const PathFd& o) {fd_state = o.fd_state;}
 };
 
 /**
@@ -113,7 +124,11 @@ class LookupPathFd : public LookupPath, PathFd
     LookupPath(t, initial), PathFd(t.get_alphabet().get_fd_table()) {}
   LookupPathFd(const LookupPathFd& o): LookupPath(o), PathFd(o) {}
   
-  virtual LookupPath* clone() const {return new LookupPathFd(*this);}
+  void assign(const LookupPathFd& o)
+  {
+    LookupPath::assign(o);
+    PathFd::assign(o);
+  }
   
   virtual bool follow(const Transition& transition);
 };
@@ -139,7 +154,12 @@ class LookupPathW : public LookupPath
   LookupPathW(const LookupPathW& o): LookupPath(o), weight(o.weight),
     final_weight(o.final_weight) {}
   
-  virtual LookupPath* clone() const {return new LookupPathW(*this);}
+  void assign(const LookupPathW& o)
+  {
+    LookupPath::assign(o);
+    weight = o.weight;
+    final_weight = o.final_weight;
+  }
 
   virtual void follow(const TransitionIndex& index);
   virtual bool follow(const Transition& transition);
@@ -173,9 +193,67 @@ class LookupPathWFd : public LookupPathW, PathFd
     LookupPathW(t, initial), PathFd(t.get_alphabet().get_fd_table()) {}
   LookupPathWFd(const LookupPathWFd& o): LookupPathW(o), PathFd(o) {}
   
-  virtual LookupPath* clone() const {return new LookupPathWFd(*this);}
+  void assign(const LookupPathWFd& o)
+  {
+    LookupPathW::assign(o);
+    PathFd::assign(o);
+  }
   
   virtual bool follow(const Transition& transition);
 };
 
+/**
+ * Hands out copies of lookup paths, keeping the paths that are given back so
+ * that they can be reused for later copies instead of being freed. A reused
+ * path keeps the memory of its output symbols and flag diacritic values, so
+ * once a lookup has warmed up, copying paths does not allocate.
+ */
+class LookupPathPool
+{
+ protected:
+  /**
+   * The paths that have been given back and are not in use
+   */
+  LookupPathVector free_paths;
+ public:
+  LookupPathPool(): free_paths() {}
+  virtual ~LookupPathPool()
+  {
+    for(LookupPathVector::const_iterator it=free_paths.begin(); it!=free_paths.end(); it++)
+      delete *it;
+  }
+  
+  /**
+   * Get a path that is a copy of the given one. It belongs to the pool and
+   * must be given back with release instead of being deleted
+   */
+  virtual LookupPath* copy(const LookupPath& path) = 0;
+  
+  /**
+   * Give back a path that was got with copy
+   */
+  void release(LookupPath* path) {free_paths.push_back(path);}
+};
+
+/**
+ * A pool for paths of type PathType. Every path in a lookup has the same type,
+ * which is decided by the transducer, so the paths are copied with PathType's
+ * own assign without going through a virtual clone
+ */
+template<class PathType>
+class TypedLookupPathPool: public LookupPathPool
+{
+ public:
+  LookupPath* copy(const LookupPath& path)
+  {
+    const PathType& typed_path = static_cast<const PathType&>(path);
+    if(free_paths.empty())
+      return new PathType(typed_path);
+    PathType* reused = static_cast<PathType*>(free_paths.back());
+    free_paths.pop_back();
+    reused->assign(typed_path);
+    return reused;
+  }
+};
+
 #endif
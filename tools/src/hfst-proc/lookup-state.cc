@@ -13,10 +13,10 @@
 #include "lookup-state.h"
 
 void
-LookupState::init(LookupPath* initial)
+LookupState::reset()
 {
   clear_paths();
-  paths.push_back(initial);
+  paths.push_back(pool->copy(*initial_path));
   try_epsilons();
 }
 
@@ -63,7 +63,7 @@ void
 LookupState::clear_paths()
 {
   for(LookupPathVector::const_iterator it = paths.begin(); it!=paths.end(); it++)
-    delete *it;
+    pool->release(*it);
   paths.clear();
 }
 
@@ -158,10 +158,10 @@ LookupState::add_path(LookupPath& path)
 }
 
 void
-LookupState::replace_paths(const LookupPathVector& new_paths)
+LookupState::replace_paths()
 {
   clear_paths();
-  paths = new_paths;
+  paths.swap(new_paths);
 }
 
 
@@ -190,7 +190,7 @@ LookupState::try_epsilon_index(const LookupPath& path)
   if(index.matches(0))
   {
     // copy the current path, follow the index, add the new path to the list
-    LookupPath& epsilon_path = *path.clone();
+    LookupPath& epsilon_path = *pool->copy(path);
     epsilon_path.follow(index);
     add_path(epsilon_path);
   }
@@ -214,13 +214,13 @@ LookupState::try_epsilon_transitions(const LookupPath& path)
     if(transducer.is_epsilon(transition))
     {
       // copy the path, follow the transition, add the new path to the list
-      LookupPath& epsilon_path = *path.clone();
+      LookupPath& epsilon_path = *pool->copy(path);
       if(epsilon_path.follow(transition))
         add_path(epsilon_path);
       else
       {
-        // destroy the new path instead of pushing it
-        delete &epsilon_path;
+        // give the new path back instead of pushing it
+        pool->release(&epsilon_path);
       }
     }
     else
@@ -234,10 +234,10 @@ LookupState::try_epsilon_transitions(const LookupPath& path)
 void
 LookupState::apply_input(const SymbolNumber input, const SymbolNumber altinput)
 {
-  LookupPathVector new_paths;
+  new_paths.clear();
   if(input == 0)
   {
-    replace_paths(new_paths);
+    replace_paths();
     return;
   }
   
@@ -263,13 +263,13 @@ LookupState::apply_input(const SymbolNumber input, const SymbolNumber altinput)
     }
   }
   
-  replace_paths(new_paths);
+  replace_paths();
 }
 
 bool
 LookupState::try_index(LookupPathVector& new_paths,
                          const LookupPath& path,
-                         const SymbolNumber input) const
+                         const SymbolNumber input)
 {
   //??? is the +1 here correct?
   TransitionIndex index = transducer.get_index(path.get_index()+input+1);
@@ -277,10 +277,10 @@ LookupState::try_index(LookupPathVector& new_paths,
   if(index.matches(input))
   {
     // copy the path, follow the index, and handle the new transitions
-    LookupPath& extended_path = *path.clone();
+    LookupPath& extended_path = *pool->copy(path);
     extended_path.follow(index);
     bool res = try_transitions(new_paths, extended_path, input);
-    delete &extended_path;
+    pool->release(&extended_path);
     return res;
   }
   return false;
@@ -289,7 +289,7 @@ LookupState::try_index(LookupPathVector& new_paths,
 bool
 LookupState::try_transitions(LookupPathVector& new_paths,
                                const LookupPath& path,
-                               const SymbolNumber input) const
+                               const SymbolNumber input)
 {
   bool found = false;
   TransitionTableIndex transition_index;
@@ -307,7 +307,7 @@ LookupState::try_transitions(LookupPathVector& new_paths,
     if(transition.matches(input))
     {
       // copy the path, follow the transition, add the new path to the list
-      LookupPath& extended_path = *path.clone();
+      LookupPath& extended_path = *pool->copy(path);
       extended_path.follow(transition);
       new_paths.push_back(&extended_path);
       found = true;
@@ -27,15 +27,34 @@ class LookupState
    */
   const ProcTransducer& transducer;
   
+  /**
+   * Where the paths of this lookup come from and go back to. Paths are reused
+   * from one token to the next, so a lookup allocates only until the pool has
+   * grown to the number of paths the transducer needs at once
+   */
+  LookupPathPool* pool;
+  
+  /**
+   * A path pointing to the beginning of the transducer, which is copied to
+   * start each lookup
+   */
+  LookupPath* initial_path;
+  
   /**
    * The active paths in a lookup operation. At the start of a lookup this will
    * contain one path. The lookup has failed if it is ever empty.
    */
   LookupPathVector paths;
   
+  /**
+   * The paths generated by apply_input. Kept between steps so that the
+   * vector's memory is reused
+   */
+  LookupPathVector new_paths;
+  
   
   /**
-   * Delete all active paths and clear the list
+   * Give all active paths back to the pool and clear the list
    */
   void clear_paths();
   
@@ -46,18 +65,10 @@ class LookupState
   void add_path(LookupPath& path);
   
   /**
-   * Get rid of the current paths and replace the list with a new list.
-   * @param new_paths the new list of paths to store in the lookup state
+   * Get rid of the current paths and replace them with the ones in new_paths,
+   * leaving new_paths empty
    */
-  void replace_paths(const LookupPathVector& new_paths);
-  
-  
-  /**
-   * Setup the state with a single initial path ending at starting state and
-   * try epsilons at the initial position
-   * @param initial an initial path to start the lookup
-   */
-  void init(LookupPath* initial);
+  void replace_paths();
   
   
   /**
@@ -103,7 +114,7 @@ class LookupState
    * @return whether the path has a continuation with the given input
    */
   bool try_index(LookupPathVector& new_paths,
-                 const LookupPath& path, const SymbolNumber input) const;
+                 const LookupPath& path, const SymbolNumber input);
   
   /**
    * If the given path points to one or more transitions whose inputs match
@@ -115,7 +126,7 @@ class LookupState
    * @return whether the path has a continuation with the given input
    */
   bool try_transitions(LookupPathVector& new_paths,
-                       const LookupPath& path, const SymbolNumber input) const;
+                       const LookupPath& path, const SymbolNumber input);
   
  public:
   /**
@@ -123,29 +134,34 @@ class LookupState
    * given transducer
    * @param t the transducer in which the lookup will occur
    */
-  LookupState(const ProcTransducer& t): transducer(t), paths()
+  LookupState(const ProcTransducer& t): transducer(t),
+    pool(t.create_path_pool()), initial_path(t.get_initial_path()),
+    paths(), new_paths()
   {
     reset();
   }
   
-  LookupState(const LookupState& o): transducer(o.transducer), paths()
+  LookupState(const LookupState& o): transducer(o.transducer),
+    pool(o.transducer.create_path_pool()),
+    initial_path(pool->copy(*o.initial_path)), paths(), new_paths()
   {
     for(LookupPathVector::const_iterator it=o.paths.begin(); it!=o.paths.end(); it++)
-      paths.push_back((*it)->clone());
+      paths.push_back(pool->copy(**it));
   }
   
   ~LookupState()
   {
     clear_paths();
+    delete initial_path;
+    delete pool;
   }
   
   /**
-   * Clear any current lookup paths and prepare it for a new lookup
+   * Clear any current lookup paths and prepare it for a new lookup, with a
+   * single path at the starting state and any paths reachable from it with
+   * epsilons
    */
-  void reset()
-  {
-    init(transducer.get_initial_path());
-  }
+  void reset();
   
   /**
    * Determine whether there are any active paths
@@ -11,6 +11,7 @@
 //       along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <cstdlib>
+#include <algorithm>
 #include "tokenizer.h"
 #include "transducer.h"
 
@@ -21,7 +22,7 @@ std::set<char> TokenIOStream::escaped_chars;
 TokenIOStream::TokenIOStream(std::istream& i, std::ostream& o,
                              const ProcTransducerAlphabet& a, bool flush,
                              bool raw):
-  is(i), os(o), alphabet(a), null_flush(flush), is_raw(raw),
+  in(i), os(o), alphabet(a), null_flush(flush), is_raw(raw),
   symbolizer(a.get_symbolizer()), superblank_bucket(), token_buffer(1024)
 {
   if(printDebuggingInformationFlag) {
@@ -93,10 +94,64 @@ TokenIOStream::get_capitalization_state(const TokenVector& tokens) const
   return Unknown;
 }
 
+bool
+InputBuffer::fill(size_t needed)
+{
+  // move what is left to the front so that there is room after it
+  if(pos > 0)
+  {
+    std::copy(data.begin()+pos, data.begin()+end, data.begin());
+    end -= pos;
+    pos = 0;
+  }
+  if(needed > data.size())
+    data.resize(needed);
+  
+  while(end < needed)
+  {
+    // wait for one byte, then take as many as are there without waiting
+    if(source.sgetc() == EOF)
+      return false;
+    std::streamsize available = source.in_avail();
+    if(available < 1)
+      available = 1;
+    if(available > (std::streamsize)(data.size()-end))
+      available = data.size()-end;
+    end += source.sgetn(&data[end], available);
+  }
+  return true;
+}
+
 std::string
 TokenIOStream::read_utf8_char()
 {
-  return read_utf8_char(is);
+  std::string retval;
+  unsigned short u8len = 0;
+  int c = in.peek();
+  if(c == EOF)
+    return retval;
+
+  if (c <= 127)
+    u8len = 1;
+  else if ( (c & (128 + 64 + 32 + 16)) == (128 + 64 + 32 + 16) )
+    u8len = 4;
+  else if ( (c & (128 + 64 + 32 )) == (128 + 64 + 32) )
+    u8len = 3;
+  else if ( (c & (128 + 64 )) == (128 + 64))
+    u8len = 2;
+  else
+    stream_error("Invalid UTF-8 character found");
+
+  // like istream::get, stop at a NUL without reading it
+  for(unsigned short i=0; i<u8len; i++)
+  {
+    c = in.peek();
+    if(c == EOF || c == 0)
+      break;
+    retval += (char)in.get();
+  }
+
+  return retval;
 }
 
 std::string
@@ -173,7 +228,7 @@ TokenIOStream::first_nonalphabetic(const TokenVector& s) const
 int
 TokenIOStream::read_escaped()
 {
-  int c = is.get();
+  int c = in.get();
 
   if(c == EOF || escaped_chars.find(c) == escaped_chars.end())
     stream_error("Found non-reserved character after backslash");
@@ -188,9 +243,9 @@ TokenIOStream::read_delimited(const char delim)
   int c = EOF;
   bool is_wblank = false;
   
-  if(is && c != delim)
+  if(c != delim)
   {
-    c = is.get();
+    c = in.get();
     if(c != EOF)
     {
       result += c;
@@ -200,16 +255,16 @@ TokenIOStream::read_delimited(const char delim)
         do_null_flush();
       else if(c == '[')
       {
-        int next_char = is.peek();
+        int next_char = in.peek();
         if(next_char == '[') //Check if wblank is being read
           is_wblank = true;
       }
     }
   }
   
-  while(is && c != delim)
+  while(c != delim)
   {
-    c = is.get();
+    c = in.get();
     if(c == EOF)
       break;
 
@@ -222,7 +277,7 @@ TokenIOStream::read_delimited(const char delim)
   
   if(is_wblank)
   {
-    c = is.get();
+    c = in.get();
     if(c != EOF)
     {
       if(c != delim)
@@ -245,8 +300,7 @@ TokenIOStream::read_delimited(const char delim)
 Token
 TokenIOStream::make_token(bool was_escaped)
 {
-    int c = is.peek();
-  SymbolNumber s = symbolizer.extract_symbol(is);
+  SymbolNumber s = symbolizer.extract_symbol(in);
   if(s == 0)
   {
     // literal NUL without null-flushing
@@ -264,9 +318,14 @@ TokenIOStream::make_token(bool was_escaped)
   }
 
   // the next thing in the stream is not a symbol
-  // (extract_symbol moved the stream back to before anything was read)
+  // (extract_symbol didn't read anything)
   std::string ch = read_utf8_char();
-  if(null_flush && ch == "") {
+  if(ch == "") {
+    // a NUL, which ends the input unless we are null-flushing
+    if(!null_flush) {
+      return Token();
+    }
+    in.get();
     do_null_flush();
   }
   if(was_escaped) {
@@ -281,13 +340,13 @@ TokenIOStream::make_token(bool was_escaped)
 Token
 TokenIOStream::read_token()
 {
-  int next_char = is.peek();
-  if(is.eof())
+  int next_char = in.peek();
+  if(next_char == EOF)
     return Token();
 
   if(next_char == 0 && null_flush) {
     do_null_flush();
-    return Token::as_character(is.get());
+    return Token::as_character((char)in.get());
   }
 
   if(escaped_chars.find(next_char) != escaped_chars.end())
@@ -299,7 +358,7 @@ TokenIOStream::read_token()
         return Token::as_superblank(superblank_bucket.size()-1);
 
       case '\\':
-        next_char = is.get(); // get the peeked char for real
+        next_char = in.get(); // get the peeked char for real
         return make_token(true);
 
       case '<':
@@ -311,7 +370,7 @@ TokenIOStream::read_token()
       }
 
       default:
-        return Token::as_reservedcharacter((char)is.get());
+        return Token::as_reservedcharacter((char)in.get());
     }
   }
   return make_token();
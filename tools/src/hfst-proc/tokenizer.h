@@ -83,6 +83,53 @@ struct Token
 class ProcTransducerAlphabet;
 class Symbolizer;
 
+/**
+ * Reads an input stream in large blocks and hands out its bytes one at a
+ * time, with lookahead for matching multi-byte symbols. Reading stops at
+ * what the stream has available, so input from a pipe is processed as it
+ * arrives
+ */
+class InputBuffer
+{
+  std::streambuf& source;
+  std::vector<char> data;
+  size_t pos;
+  size_t end;
+  
+  /**
+   * Make at least the given number of bytes available starting at pos
+   * @return false if the stream ended before that
+   */
+  bool fill(size_t needed);
+ public:
+  InputBuffer(std::istream& is): source(*is.rdbuf()), data(65536), pos(0), end(0) {}
+  
+  /**
+   * The byte the given distance ahead of the current position, or EOF
+   */
+  int peek(size_t offset=0)
+  {
+    if(pos+offset >= end && !fill(offset+1))
+      return EOF;
+    return (unsigned char)data[pos+offset];
+  }
+  
+  int get()
+  {
+    int c = peek();
+    if(c != EOF)
+      pos++;
+    return c;
+  }
+  
+  /**
+   * Move past bytes that have been looked at with peek
+   */
+  void skip(size_t count) {pos += count;}
+  
+  bool eof() {return peek() == EOF;}
+};
+
 /**
  * Wrapper class around an istream and an ostream for reading and writing
  * tokens, with additional buffering functionality. Input and output
@@ -96,7 +143,7 @@ class TokenIOStream
   static std::set<char> escaped_chars;
   static void initialize_escaped_chars();
 
-  std::istream& is;
+  InputBuffer in;
   std::ostream& os;
   const ProcTransducerAlphabet& alphabet;
   bool null_flush;
@@ -25,12 +25,19 @@ static LookupPath* create_initial_path_fd(const ProcTransducer& t) { return new
 static LookupPath* create_initial_path_weighted(const ProcTransducer& t) { return new LookupPathW(t, 0);}
 static LookupPath* create_initial_path_weighted_fd(const ProcTransducer& t) { return new LookupPathWFd(t, 0);}
 
+template<class PathType>
+static LookupPathPool* create_typed_path_pool() { return new TypedLookupPathPool<PathType>();}
+
 //////////Function definitions for ProcTransducer
 
 InitialPathCreator ProcTransducer::initial_path_creators[2][2] =
     {{create_initial_path, create_initial_path_fd},
      {create_initial_path_weighted, create_initial_path_weighted_fd}};
 
+PathPoolCreator ProcTransducer::path_pool_creators[2][2] =
+    {{create_typed_path_pool<LookupPath>, create_typed_path_pool<LookupPathFd>},
+     {create_typed_path_pool<LookupPathW>, create_typed_path_pool<LookupPathWFd>}};
+
 ProcTransducer::ProcTransducer(std::istream& is): Transducer()
 {
   header = new TransducerHeader(is);
@@ -75,3 +82,9 @@ ProcTransducer::get_initial_path() const
   return (*initial_path_creators[header->probe_flag(Weighted)][alphabet->has_flag_diacritics()])(*this);
 }
 
+LookupPathPool*
+ProcTransducer::create_path_pool() const
+{
+  return (*path_pool_creators[header->probe_flag(Weighted)][alphabet->has_flag_diacritics()])();
+}
+
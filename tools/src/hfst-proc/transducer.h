@@ -27,11 +27,13 @@ using namespace hfst_ol;
 class ProcTransducer;
 
 typedef LookupPath* (*InitialPathCreator)(const ProcTransducer&);
+typedef LookupPathPool* (*PathPoolCreator)();
 
 class ProcTransducer : public Transducer
 {
  protected:
   static InitialPathCreator initial_path_creators[2][2];
+  static PathPoolCreator path_pool_creators[2][2];
 
   /**
    * Check if the transducer accepts an input string consisting of just a blank
@@ -49,6 +51,13 @@ class ProcTransducer : public Transducer
    * @return a new lookup path pointing to the beginning of the transducer
    */
   LookupPath* get_initial_path() const;
+  
+  /**
+   * Create a pool for copying the paths of a lookup in this transducer. The
+   * pool handles the same type of path as get_initial_path returns
+   * @return a new, empty path pool
+   */
+  LookupPathPool* create_path_pool() const;
 };
 
 #endif
@@ -47,6 +47,7 @@ using std::pair;
 #include "HfstTransducer.h"
 #include "HfstInputStream.h"
 #include "HfstOutputStream.h"
+#include "HfstXeroxRules.h"
 #include "parsers/XreCompiler.h"
 #include "hfst-commandline.h"
 #include "hfst-program-options.h"
@@ -77,6 +78,9 @@ static hfst::ImplementationType output_format = hfst::UNSPECIFIED_TYPE;
 static bool harmonize=true;
 static bool harmonize_flags=false;
 static bool minimize_result=true;
+static bool cache_subexpressions=false;
+static float optimization_growth=2;
+static bool profile_replace=false;
 
 void
 print_usage()
@@ -107,6 +111,13 @@ print_usage()
 "  -F, --harmonize-flags     Harmonize flag diacritics.\n"
 "  -E, --encode-weights      Encode weights when minimizing (default is false).\n"
 "  -M, --do-not-minimize     Determinize result instead of minimizing it.\n"
+"  -C, --cache               Compile repeated bracketed subexpressions only once\n"
+"                            (hit rate is shown with --verbose).\n"
+"  -G, --replace-growth=N    Optimize intermediate transducers of replace rules\n"
+"                            only when they grow N times bigger (default 2,\n"
+"                            0 optimizes after every step).\n"
+"  -P, --profile-replace     Print the states, arcs and time of each step of\n"
+"                            compiling replace rules to standard error.\n"
                 );
         fprintf(message_out, "\n");
 
@@ -160,11 +171,14 @@ parse_options(int argc, char** argv)
           {"xerox-composition", required_argument, 0, 'x'},
           {"xfst", required_argument, 0, 'X'},
           {"do-not-minimize", no_argument, 0, 'M'},
+          {"cache", no_argument, 0, 'C'},
+          {"replace-growth", required_argument, 0, 'G'},
+          {"profile-replace", no_argument, 0, 'P'},
           {0,0,0,0}
         };
         int option_index = 0;
         int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT
-                             HFST_GETOPT_UNARY_SHORT "je:lSf:HFEx:X:M"/*"123"*/,
+                             HFST_GETOPT_UNARY_SHORT "je:lSf:HFEx:X:MCG:P"/*"123"*/,
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -211,6 +225,23 @@ parse_options(int argc, char** argv)
         case 'M':
           minimize_result=false;
           break;
+        case 'C':
+          cache_subexpressions=true;
+          break;
+        case 'G':
+          {
+            char * endptr;
+            optimization_growth = strtod(optarg, &endptr);
+            if (*endptr != '\0' || optimization_growth < 0)
+              {
+                fprintf(stderr, "Error: invalid argument to --replace-growth: '%s'\n", optarg);
+                return EXIT_FAILURE;
+              }
+          }
+          break;
+        case 'P':
+          profile_replace=true;
+          break;
         case 'x':
           {
             const char * argument = hfst_strdup(optarg);
@@ -274,7 +305,13 @@ process_stream(HfstOutputStream& outstream)
   comp.set_error_stream(&std::cerr);
   comp.set_harmonization(harmonize);
   comp.set_flag_harmonization(harmonize_flags);
+  comp.set_subexpression_caching(cache_subexpressions);
   hfst::set_minimization(minimize_result);
+  hfst::xeroxRules::set_optimization_threshold(optimization_growth);
+  if (profile_replace)
+    {
+      hfst::xeroxRules::set_profile_stream(&std::cerr);
+    }
   HfstTransducer disjunction(output_format);
 
   char delim = (line_separated)? '\n' : ';';
@@ -423,6 +460,17 @@ process_stream(HfstOutputStream& outstream)
         }
       outstream << disjunction;
     }
+  const hfst::xre::SubexpressionCache * cache = comp.get_subexpression_cache();
+  if (cache != NULL)
+    {
+      verbose_printf("Subexpression cache: %lu lookups, %lu hits (%.1f%%), "
+                     "%lu transducers\n",
+                     (unsigned long)cache->get_lookups(),
+                     (unsigned long)cache->get_hits(),
+                     cache->get_lookups() == 0 ? 0.0 :
+                     100.0 * cache->get_hits() / cache->get_lookups(),
+                     (unsigned long)cache->size());
+    }
   free(line);
   free(first_line);
   return EXIT_SUCCESS;
@@ -66,6 +66,7 @@ static bool superblanks = false; // Input is apertium-style superblanks (overrid
 static bool blankline_separated = true; // Input is separated by blank lines (as opposed to single newlines)
 static bool keep_newlines = false;
 static int token_number = 1;
+static unsigned int threads = 1;
 std::string tokenizer_filename;
 static hfst::ImplementationType default_format = hfst::TROPICAL_OPENFST_TYPE;
 TokenizeSettings settings;
@@ -102,6 +103,8 @@ print_usage()
             "  -C  --conllu             CoNLL-U format\n"
             "  -f, --finnpos            FinnPos output\n"
             "  -L, --visl               VISL input and output (implies -W, handles <s> as blocks and <STYLE> inline)\n"
+            "  -j, --threads=N          Tokenize inputs in N parallel threads (0 for one per core;\n"
+            "                           not with -S, -g or -L)\n"
             );
     fprintf(message_out,
             "Use standard streams for input and output (for now).\n"
@@ -341,12 +344,78 @@ inline void maybe_erase_newline(string& input_text)
     }
 }
 
-int process_input(hfst_ol::PmatchContainer & container,
-                  std::ostream & outstream)
+inline void set_output_precision(std::ostream & outstream)
 {
     if(settings.output_format == cg || settings.output_format == giellacg || settings.output_format == visl) {
         outstream << std::fixed << std::setprecision(10);
     }
+}
+
+void match_and_print_job(hfst_ol::PmatchContainer & container,
+                         const string & input_text,
+                         std::ostream & outstream)
+{
+    set_output_precision(outstream);
+    match_and_print(container, outstream, input_text, settings);
+}
+
+// Tokenize a block of inputs in parallel and print the results in input order
+void match_and_print_block(hfst_ol::PmatchParallelMatcher & matcher,
+                           vector<string> & inputs,
+                           std::ostream & outstream)
+{
+    vector<string> outputs = matcher.run(inputs, match_and_print_job);
+    for (vector<string>::const_iterator it = outputs.begin();
+         it != outputs.end(); ++it) {
+        outstream << *it;
+    }
+    inputs.clear();
+}
+
+int process_input_threaded(hfst_ol::PmatchContainer & container,
+                           std::ostream & outstream)
+{
+    hfst_ol::PmatchParallelMatcher matcher(container, threads);
+    const size_t block_size = 1024 * matcher.get_threads();
+    vector<string> inputs;
+    string input_text;
+    char * line = NULL;
+    size_t bufsize = 0;
+    while (hfst_getline(&line, &bufsize, inputfile) > 0) {
+        if (!blankline_separated) {
+            input_text = line;
+            maybe_erase_newline(input_text);
+            inputs.push_back(input_text);
+        } else if (line[0] == '\n') {
+            maybe_erase_newline(input_text);
+            inputs.push_back(input_text);
+            input_text.clear();
+        } else {
+            input_text.append(line);
+        }
+        free(line);
+        line = NULL;
+        if (inputs.size() >= block_size) {
+            match_and_print_block(matcher, inputs, outstream);
+        }
+    }
+    if (blankline_separated && !input_text.empty()) {
+        maybe_erase_newline(input_text);
+        inputs.push_back(input_text);
+    }
+    match_and_print_block(matcher, inputs, outstream);
+    return EXIT_SUCCESS;
+}
+
+int process_input(hfst_ol::PmatchContainer & container,
+                  std::ostream & outstream)
+{
+    set_output_precision(outstream);
+    if (threads != 1 &&
+        (settings.output_format == giellacg || superblanks || settings.output_format == visl)) {
+        std::cerr << "hfst-tokenize: warning: --threads is not supported with "
+            "this input format, using one thread\n";
+    }
     if(settings.output_format == giellacg || superblanks) {
         if(superblanks) {
             return process_input_0delim<true>(container, outstream);
@@ -358,6 +427,9 @@ int process_input(hfst_ol::PmatchContainer & container,
     if(settings.output_format == visl) {
         return process_input_visl(container, outstream);
     }
+    if (threads != 1) {
+        return process_input_threaded(container, outstream);
+    }
     string input_text;
     char * line = NULL;
     size_t bufsize = 0;
@@ -421,10 +493,11 @@ int parse_options(int argc, char** argv)
                 {"conllu", no_argument, 0, 'C'},
                 {"finnpos", no_argument, 0, 'f'},
                 {"visl", no_argument, 0, 'L'},
+                {"threads", required_argument, 0, 'j'},
                 {0,0,0,0}
             };
         int option_index = 0;
-        int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT "nkawWmub:t:l:zixcSgCfL",
+        int c = getopt_long(argc, argv, HFST_GETOPT_COMMON_SHORT "nkawWmub:t:l:zixcSgCfLj:",
                              long_options, &option_index);
         if (-1 == c)
         {
@@ -519,6 +592,14 @@ int parse_options(int argc, char** argv)
         case 'f':
             settings.output_format = finnpos;
             break;
+        case 'j':
+            if (atoi(optarg) < 0)
+            {
+                std::cerr << "Invalid argument for --threads\n";
+                return EXIT_FAILURE;
+            }
+            threads = atoi(optarg);
+            break;
 #include "inc/getopt-cases-error.h"
         }
 